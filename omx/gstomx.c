@@ -29,6 +29,7 @@
 #include <string.h>
 
 #include "gstomx.h"
+#include "gstomxtrace.h"
 #include "gstomxmjpegdec.h"
 #include "gstomxmpeg2videodec.h"
 #include "gstomxmpeg4videodec.h"
@@ -65,13 +66,17 @@ GST_DEBUG_CATEGORY_STATIC (OMX_API_TRACE);
 
 G_LOCK_DEFINE_STATIC (core_handles);
 static GHashTable *core_handles;
+/* Set once the plugin is unloaded, nothing is preloaded afterwards */
+static gboolean cores_unloaded = FALSE;
 
 /* Cache used by gst_omx_buffer_flags_to_string() */
 G_LOCK_DEFINE_STATIC (buffer_flags_str);
 static GHashTable *buffer_flags_str;
 
-GstOMXCore *
-gst_omx_core_acquire (const gchar * filename)
+/* Returns the core for filename, which is not loaded yet if it was
+ * never acquired. Cores are never removed from core_handles */
+static GstOMXCore *
+gst_omx_core_lookup (const gchar * filename)
 {
   GstOMXCore *core;
 
@@ -86,6 +91,23 @@ gst_omx_core_acquire (const gchar * filename)
     g_mutex_init (&core->lock);
     core->user_count = 0;
     g_hash_table_insert (core_handles, g_strdup (filename), core);
+  }
+  G_UNLOCK (core_handles);
+
+  return core;
+}
+
+GstOMXCore *
+gst_omx_core_acquire (const gchar * filename)
+{
+  GstOMXCore *core;
+
+  /* The global lock is only needed for the lookup. Loading and
+   * initialising the core only blocks other users of the same core */
+  core = gst_omx_core_lookup (filename);
+  g_mutex_lock (&core->lock);
+
+  if (!core->module) {
 
     /* Hack for the Broadcom OpenMAX IL implementation */
 #ifdef USE_OMX_TARGET_RPI
@@ -152,7 +174,6 @@ gst_omx_core_acquire (const gchar * filename)
     GST_DEBUG ("Successfully loaded core '%s'", filename);
   }
 
-  g_mutex_lock (&core->lock);
   core->user_count++;
   if (core->user_count == 1) {
     OMX_ERRORTYPE err;
@@ -160,7 +181,7 @@ gst_omx_core_acquire (const gchar * filename)
     err = core->init ();
     if (err != OMX_ErrorNone) {
       GST_ERROR ("Failed to initialize core '%s': 0x%08x", filename, err);
-      g_mutex_unlock (&core->lock);
+      core->user_count--;
       goto error;
     }
 
@@ -168,7 +189,6 @@ gst_omx_core_acquire (const gchar * filename)
   }
 
   g_mutex_unlock (&core->lock);
-  G_UNLOCK (core_handles);
 
   return core;
 
@@ -187,11 +207,8 @@ symbol_error:
   }
 error:
   {
-    g_hash_table_remove (core_handles, filename);
-    g_mutex_clear (&core->lock);
-    g_slice_free (GstOMXCore, core);
-
-    G_UNLOCK (core_handles);
+    /* The next user retries loading the core */
+    g_mutex_unlock (&core->lock);
 
     return NULL;
   }
@@ -202,8 +219,6 @@ gst_omx_core_release (GstOMXCore * core)
 {
   g_return_if_fail (core != NULL);
 
-  G_LOCK (core_handles);
-
   g_mutex_lock (&core->lock);
 
   GST_DEBUG ("Releasing core %p", core);
@@ -219,21 +234,214 @@ gst_omx_core_release (GstOMXCore * core)
   }
 
   g_mutex_unlock (&core->lock);
+}
+
+static gpointer
+gst_omx_core_preload_func (gpointer user_data)
+{
+  gchar *filename = user_data;
+  GstOMXCore *core;
+  gboolean unloaded;
+
+  /* The reference is kept until the plugin is unloaded, otherwise
+   * the core would be deinitialized again right away */
+  core = gst_omx_core_acquire (filename);
+  if (!core) {
+    GST_WARNING ("Failed to preload core '%s'", filename);
+    g_free (filename);
+    return NULL;
+  }
+
+  G_LOCK (core_handles);
+  unloaded = cores_unloaded;
+  if (!unloaded)
+    core->preloaded = TRUE;
+  G_UNLOCK (core_handles);
+
+  if (unloaded)
+    gst_omx_core_release (core);
+  else
+    GST_INFO ("Preloaded core '%s'", filename);
+
+  g_free (filename);
+
+  return NULL;
+}
+
+/* Loads and initializes the core from a separate thread, so that the
+ * first element using it doesn't have to. Only the first call for
+ * each core starts preloading it */
+static void
+gst_omx_core_preload (const gchar * filename)
+{
+  GstOMXCore *core;
+  GThread *thread;
+  GError *err = NULL;
+  gboolean start;
+
+  core = gst_omx_core_lookup (filename);
+
+  G_LOCK (core_handles);
+  start = !core->preload_started && !cores_unloaded;
+  core->preload_started = TRUE;
+  G_UNLOCK (core_handles);
+
+  if (!start)
+    return;
+
+  thread = g_thread_try_new ("omx-core-preload", gst_omx_core_preload_func,
+      g_strdup (filename), &err);
+  if (!thread) {
+    GST_WARNING ("Failed to start preloading core '%s': %s", filename,
+        err->message);
+    g_error_free (err);
+    return;
+  }
+
+  g_thread_unref (thread);
+}
+
+/* Drops the references kept by preloading, so that the cores are
+ * deinitialized once their last user is gone */
+static void
+gst_omx_core_unload_preloaded (void)
+{
+  GList *preloaded = NULL;
+  GHashTableIter iter;
+  gpointer value;
 
+  G_LOCK (core_handles);
+  cores_unloaded = TRUE;
+  if (core_handles) {
+    g_hash_table_iter_init (&iter, core_handles);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+      GstOMXCore *core = value;
+
+      if (core->preloaded) {
+        core->preloaded = FALSE;
+        preloaded = g_list_prepend (preloaded, core);
+      }
+    }
+  }
   G_UNLOCK (core_handles);
+
+  g_list_free_full (preloaded, (GDestroyNotify) gst_omx_core_release);
+}
+
+/* Number of slots of the component event ring */
+#define GST_OMX_COMPONENT_RING_SIZE 64
+
+static void
+gst_omx_message_ring_init (GstOMXMessageRing * ring, guint size)
+{
+  guint i;
+
+  g_assert ((size & (size - 1)) == 0);
+
+  ring->slots = g_new (GstOMXMessageSlot, size);
+  for (i = 0; i < size; i++)
+    ring->slots[i].seq = i;
+  ring->size = size;
+  ring->head = 0;
+  ring->tail = 0;
+
+  g_queue_init (&ring->overflow);
+  ring->n_overflow = 0;
 }
 
-/* NOTE: comp->messages_lock will be used */
 static void
-gst_omx_component_flush_messages (GstOMXComponent * comp)
+gst_omx_message_ring_clear (GstOMXMessageRing * ring)
 {
   GstOMXMessage *msg;
 
-  g_mutex_lock (&comp->messages_lock);
-  while ((msg = g_queue_pop_head (&comp->messages))) {
+  while ((msg = g_queue_pop_head (&ring->overflow)))
     g_slice_free (GstOMXMessage, msg);
+  ring->n_overflow = 0;
+
+  g_free (ring->slots);
+  ring->slots = NULL;
+  ring->size = 0;
+}
+
+/* Lock-free, called from the OMX callbacks. Returns FALSE if the ring
+ * is full */
+static gboolean
+gst_omx_message_ring_push (GstOMXMessageRing * ring, const GstOMXMessage * msg)
+{
+  GstOMXMessageSlot *slot;
+  guint mask = ring->size - 1;
+  guint pos;
+  gint diff;
+
+  pos = (guint) g_atomic_int_get (&ring->tail);
+  for (;;) {
+    slot = &ring->slots[pos & mask];
+    diff = (gint) ((guint) g_atomic_int_get (&slot->seq) - pos);
+
+    if (diff == 0) {
+      if (g_atomic_int_compare_and_exchange (&ring->tail, (gint) pos,
+              (gint) (pos + 1)))
+        break;
+    } else if (diff < 0) {
+      /* The consumer did not read this slot yet */
+      return FALSE;
+    }
+
+    /* Another producer claimed this position first */
+    pos = (guint) g_atomic_int_get (&ring->tail);
   }
-  g_mutex_unlock (&comp->messages_lock);
+
+  slot->msg = *msg;
+  /* Publish the message to the consumer */
+  g_atomic_int_set (&slot->seq, (gint) (pos + 1));
+
+  return TRUE;
+}
+
+/* NOTE: Only called by the consumer of the ring */
+static gboolean
+gst_omx_message_ring_pop (GstOMXMessageRing * ring, GstOMXMessage * msg)
+{
+  GstOMXMessageSlot *slot;
+  guint pos = (guint) ring->head;
+
+  slot = &ring->slots[pos & (ring->size - 1)];
+  if (g_atomic_int_get (&slot->seq) != (gint) (pos + 1))
+    return FALSE;
+
+  *msg = slot->msg;
+  /* Hand the slot back to the producers for the next round */
+  g_atomic_int_set (&slot->seq, (gint) (pos + ring->size));
+  g_atomic_int_set (&ring->head, (gint) (pos + 1));
+
+  return TRUE;
+}
+
+static gboolean
+gst_omx_message_ring_is_empty (GstOMXMessageRing * ring)
+{
+  guint pos;
+
+  if (g_atomic_int_get (&ring->n_overflow) > 0)
+    return FALSE;
+
+  pos = (guint) g_atomic_int_get (&ring->head);
+  return g_atomic_int_get (&ring->slots[pos & (ring->size - 1)].seq) !=
+      (gint) (pos + 1);
+}
+
+/* Can be called without comp->lock */
+static inline OMX_ERRORTYPE
+gst_omx_component_peek_last_error (GstOMXComponent * comp)
+{
+  return (OMX_ERRORTYPE) g_atomic_int_get ((gint *) & comp->last_error);
+}
+
+/* Can be called without port->lock */
+static inline gboolean
+gst_omx_port_has_done_buffers (GstOMXPort * port)
+{
+  return g_atomic_pointer_get (&port->done_head) != NULL;
 }
 
 static void
@@ -246,221 +454,516 @@ gst_omx_buffer_reset (GstOMXBuffer * buf)
 }
 
 static void gst_omx_buffer_unmap (GstOMXBuffer * buffer);
+static void gst_omx_component_send_message (GstOMXComponent * comp,
+    GstOMXMessage * msg);
 
-/* NOTE: Call with comp->lock, comp->messages_lock will be used */
+/* NOTE: Call with comp->lock */
 static void
-gst_omx_component_handle_messages (GstOMXComponent * comp)
+gst_omx_component_handle_message (GstOMXComponent * comp,
+    const GstOMXMessage * msg)
 {
-  GstOMXMessage *msg;
+  switch (msg->type) {
+    case GST_OMX_MESSAGE_STATE_SET:{
+      GST_INFO_OBJECT (comp->parent, "%s state change to %s finished",
+          comp->name, gst_omx_state_to_string (msg->content.state_set.state));
+      comp->state = msg->content.state_set.state;
+      if (comp->state == comp->pending_state)
+        comp->pending_state = OMX_StateInvalid;
+      break;
+    }
+    case GST_OMX_MESSAGE_FLUSH:{
+      GstOMXPort *port = NULL;
+      OMX_U32 index = msg->content.flush.port;
 
-  g_mutex_lock (&comp->messages_lock);
-  while ((msg = g_queue_pop_head (&comp->messages))) {
-    g_mutex_unlock (&comp->messages_lock);
+      /* Some components complete a flush of all ports with a single event */
+      if (index == OMX_ALL) {
+        gint i, n;
+
+        GST_DEBUG_OBJECT (comp->parent, "%s all ports flushed", comp->name);
+
+        n = (comp->ports ? comp->ports->len : 0);
+        for (i = 0; i < n; i++) {
+          port = g_ptr_array_index (comp->ports, i);
 
-    switch (msg->type) {
-      case GST_OMX_MESSAGE_STATE_SET:{
-        GST_INFO_OBJECT (comp->parent, "%s state change to %s finished",
-            comp->name, gst_omx_state_to_string (msg->content.state_set.state));
-        comp->state = msg->content.state_set.state;
-        if (comp->state == comp->pending_state)
-          comp->pending_state = OMX_StateInvalid;
+          g_mutex_lock (&port->lock);
+          if (port->flushing)
+            port->flushed = TRUE;
+          g_mutex_unlock (&port->lock);
+        }
         break;
       }
-      case GST_OMX_MESSAGE_FLUSH:{
-        GstOMXPort *port = NULL;
-        OMX_U32 index = msg->content.flush.port;
 
-        port = gst_omx_component_get_port (comp, index);
-        if (!port)
-          break;
+      port = gst_omx_component_get_port (comp, index);
+      if (!port)
+        break;
 
-        GST_DEBUG_OBJECT (comp->parent, "%s port %u flushed", comp->name,
-            port->index);
+      GST_DEBUG_OBJECT (comp->parent, "%s port %u flushed", comp->name,
+          port->index);
 
-        if (port->flushing) {
-          port->flushed = TRUE;
-        } else {
-          GST_ERROR_OBJECT (comp->parent, "%s port %u was not flushing",
-              comp->name, port->index);
-        }
+      g_mutex_lock (&port->lock);
+      if (port->flushing) {
+        port->flushed = TRUE;
+      } else {
+        GST_ERROR_OBJECT (comp->parent, "%s port %u was not flushing",
+            comp->name, port->index);
+      }
+      g_mutex_unlock (&port->lock);
 
+      break;
+    }
+    case GST_OMX_MESSAGE_ERROR:{
+      OMX_ERRORTYPE error = msg->content.error.error;
+
+      if (error == OMX_ErrorNone)
         break;
-      }
-      case GST_OMX_MESSAGE_ERROR:{
-        OMX_ERRORTYPE error = msg->content.error.error;
 
-        if (error == OMX_ErrorNone)
-          break;
+      GST_ERROR_OBJECT (comp->parent, "%s got error: %s (0x%08x)", comp->name,
+          gst_omx_error_to_string (error), error);
 
-        GST_ERROR_OBJECT (comp->parent, "%s got error: %s (0x%08x)", comp->name,
-            gst_omx_error_to_string (error), error);
+      /* We only set the first error ever from which
+       * we can't recover anymore.
+       */
+      if (comp->last_error == OMX_ErrorNone)
+        g_atomic_int_set ((gint *) & comp->last_error, error);
+      gst_omx_component_send_message (comp, NULL);
 
-        /* We only set the first error ever from which
-         * we can't recover anymore.
-         */
-        if (comp->last_error == OMX_ErrorNone)
-          comp->last_error = error;
-        g_cond_broadcast (&comp->messages_cond);
+      break;
+    }
+    case GST_OMX_MESSAGE_PORT_ENABLE:{
+      GstOMXPort *port = NULL;
+      OMX_U32 index = msg->content.port_enable.port;
+      OMX_BOOL enable = msg->content.port_enable.enable;
 
+      port = gst_omx_component_get_port (comp, index);
+      if (!port)
         break;
+
+      GST_DEBUG_OBJECT (comp->parent, "%s port %u %s", comp->name,
+          port->index, (enable ? "enabled" : "disabled"));
+
+      g_mutex_lock (&port->lock);
+      if (enable)
+        port->enabled_pending = FALSE;
+      else
+        port->disabled_pending = FALSE;
+      port->port_def_cookie++;
+      g_mutex_unlock (&port->lock);
+      break;
+    }
+    case GST_OMX_MESSAGE_PORT_SETTINGS_CHANGED:{
+      gint i, n;
+      OMX_U32 index = msg->content.port_settings_changed.port;
+      GList *outports = NULL, *l, *k;
+
+      GST_DEBUG_OBJECT (comp->parent, "%s settings changed (port %u)",
+          comp->name, (guint) index);
+
+      /* FIXME: This probably can be done better */
+
+      /* Now update the ports' states */
+      n = (comp->ports ? comp->ports->len : 0);
+      for (i = 0; i < n; i++) {
+        GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+
+        if (index == OMX_ALL || index == port->index) {
+          g_mutex_lock (&port->lock);
+          port->settings_cookie++;
+          port->port_def_cookie++;
+          g_mutex_unlock (&port->lock);
+          if (port->port_def.eDir == OMX_DirOutput && !port->tunneled)
+            outports = g_list_prepend (outports, port);
+        }
       }
-      case GST_OMX_MESSAGE_PORT_ENABLE:{
-        GstOMXPort *port = NULL;
-        OMX_U32 index = msg->content.port_enable.port;
-        OMX_BOOL enable = msg->content.port_enable.enable;
 
-        port = gst_omx_component_get_port (comp, index);
-        if (!port)
-          break;
+      for (k = outports; k; k = k->next) {
+        gboolean found = FALSE;
 
-        GST_DEBUG_OBJECT (comp->parent, "%s port %u %s", comp->name,
-            port->index, (enable ? "enabled" : "disabled"));
+        for (l = comp->pending_reconfigure_outports; l; l = l->next) {
+          if (l->data == k->data) {
+            found = TRUE;
+            break;
+          }
+        }
+
+        if (!found)
+          g_atomic_pointer_set (&comp->pending_reconfigure_outports,
+              g_list_prepend (comp->pending_reconfigure_outports, k->data));
+      }
+
+      g_list_free (outports);
+
+      break;
+    }
+    case GST_OMX_MESSAGE_BUFFER_FLAG:{
+      GstOMXPort *port = NULL;
+      OMX_U32 index = msg->content.buffer_flag.port;
+      OMX_U32 flags = msg->content.buffer_flag.flags;
 
-        if (enable)
-          port->enabled_pending = FALSE;
-        else
-          port->disabled_pending = FALSE;
+      port = gst_omx_component_get_port (comp, index);
+      if (!port)
         break;
+
+      GST_DEBUG_OBJECT (comp->parent,
+          "%s port %u got buffer flags 0x%08x (%s)", comp->name, port->index,
+          (guint) flags, gst_omx_buffer_flags_to_string (flags));
+      g_mutex_lock (&port->lock);
+      if ((flags & OMX_BUFFERFLAG_EOS)
+          && port->port_def.eDir == OMX_DirOutput && !port->eos) {
+        GST_DEBUG_OBJECT (comp->parent, "%s port %u is EOS", comp->name,
+            port->index);
+        port->eos = TRUE;
       }
-      case GST_OMX_MESSAGE_PORT_SETTINGS_CHANGED:{
-        gint i, n;
-        OMX_U32 index = msg->content.port_settings_changed.port;
-        GList *outports = NULL, *l, *k;
+      g_mutex_unlock (&port->lock);
+
+      break;
+    }
+    default:{
+      g_assert_not_reached ();
+      break;
+    }
+  }
+}
 
-        GST_DEBUG_OBJECT (comp->parent, "%s settings changed (port %u)",
-            comp->name, (guint) index);
+/* NOTE: Must be called with port->lock */
+static void
+gst_omx_port_stats_buffer_returned (GstOMXPort * port, GstOMXBuffer * buf)
+{
+  GstOMXPortStats *stats = &port->stats;
+  GstClockTime residency;
+  gint i;
 
-        /* FIXME: This probably can be done better */
+  residency = gst_util_get_timestamp () - buf->submit_time;
 
-        /* Now update the ports' states */
-        n = (comp->ports ? comp->ports->len : 0);
-        for (i = 0; i < n; i++) {
-          GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+  if (stats->n_returned == 0 || residency < stats->residency_min)
+    stats->residency_min = residency;
+  if (residency > stats->residency_max)
+    stats->residency_max = residency;
+  stats->residency_total += residency;
+  stats->n_returned++;
 
-          if (index == OMX_ALL || index == port->index) {
-            port->settings_cookie++;
-            gst_omx_port_update_port_definition (port, NULL);
-            if (port->port_def.eDir == OMX_DirOutput && !port->tunneled)
-              outports = g_list_prepend (outports, port);
-          }
-        }
+  for (i = 0; i < GST_OMX_PORT_STATS_HISTOGRAM_SIZE - 1; i++) {
+    if (residency < (GST_MSECOND << i))
+      break;
+  }
+  stats->residency_histogram[i]++;
+}
 
-        for (k = outports; k; k = k->next) {
-          gboolean found = FALSE;
+static void
+gst_omx_port_handle_done_buffer (GstOMXPort * port, GstOMXBuffer * buf,
+    GstOMXBufferDoneState state)
+{
+  GstOMXComponent *comp = port->comp;
 
-          for (l = comp->pending_reconfigure_outports; l; l = l->next) {
-            if (l->data == k->data) {
-              found = TRUE;
-              break;
-            }
-          }
+  if (state == GST_OMX_BUFFER_DONE_REQUEUED) {
+    /* Can be filled again by upstream */
+    g_queue_push_tail (&port->pending_buffers, buf);
+    return;
+  }
 
-          if (!found)
-            comp->pending_reconfigure_outports =
-                g_list_prepend (comp->pending_reconfigure_outports, k->data);
-        }
+  buf->used = FALSE;
 
-        g_list_free (outports);
+  gst_omx_port_stats_buffer_returned (port, buf);
 
-        break;
-      }
-      case GST_OMX_MESSAGE_BUFFER_FLAG:{
-        GstOMXPort *port = NULL;
-        OMX_U32 index = msg->content.buffer_flag.port;
-        OMX_U32 flags = msg->content.buffer_flag.flags;
+  if (state == GST_OMX_BUFFER_DONE_EMPTIED) {
+    /* Input buffer is empty again and can be used to contain new input */
+    GST_LOG_OBJECT (comp->parent, "%s port %u emptied buffer %p (%p)",
+        comp->name, port->index, buf, buf->omx_buf->pBuffer);
 
-        port = gst_omx_component_get_port (comp, index);
-        if (!port)
-          break;
+    /* Reset all flags, some implementations don't
+     * reset them themselves and the flags are not
+     * valid anymore after the buffer was consumed
+     */
+    gst_omx_buffer_reset (buf);
 
-        GST_DEBUG_OBJECT (comp->parent,
-            "%s port %u got buffer flags 0x%08x (%s)", comp->name, port->index,
-            (guint) flags, gst_omx_buffer_flags_to_string (flags));
-        if ((flags & OMX_BUFFERFLAG_EOS)
-            && port->port_def.eDir == OMX_DirOutput && !port->eos) {
-          GST_DEBUG_OBJECT (comp->parent, "%s port %u is EOS", comp->name,
-              port->index);
-          port->eos = TRUE;
-        }
+    /* Release and unmap the parent buffer, if any */
+    gst_omx_buffer_unmap (buf);
+  } else {
+    /* Output buffer contains output now or
+     * the port was flushed */
+    GST_LOG_OBJECT (comp->parent, "%s port %u filled buffer %p (%p)",
+        comp->name, port->index, buf, buf->omx_buf->pBuffer);
+
+    if ((buf->omx_buf->nFlags & OMX_BUFFERFLAG_EOS)
+        && port->port_def.eDir == OMX_DirOutput && !port->eos) {
+      GST_DEBUG_OBJECT (comp->parent, "%s port %u is EOS", comp->name,
+          port->index);
+      port->eos = TRUE;
+    }
+  }
 
-        break;
-      }
-      case GST_OMX_MESSAGE_BUFFER_DONE:{
-        GstOMXBuffer *buf = msg->content.buffer_done.buffer->pAppPrivate;
-        GstOMXPort *port;
-
-        port = buf->port;
-
-        buf->used = FALSE;
-
-        if (msg->content.buffer_done.empty) {
-          /* Input buffer is empty again and can be used to contain new input */
-          GST_LOG_OBJECT (port->comp->parent,
-              "%s port %u emptied buffer %p (%p)", port->comp->name,
-              port->index, buf, buf->omx_buf->pBuffer);
-
-          /* Reset all flags, some implementations don't
-           * reset them themselves and the flags are not
-           * valid anymore after the buffer was consumed
-           */
-          gst_omx_buffer_reset (buf);
-
-          /* Release and unmap the parent buffer, if any */
-          gst_omx_buffer_unmap (buf);
-        } else {
-          /* Output buffer contains output now or
-           * the port was flushed */
-          GST_LOG_OBJECT (port->comp->parent,
-              "%s port %u filled buffer %p (%p)", port->comp->name, port->index,
-              buf, buf->omx_buf->pBuffer);
-
-          if ((buf->omx_buf->nFlags & OMX_BUFFERFLAG_EOS)
-              && port->port_def.eDir == OMX_DirOutput && !port->eos) {
-            GST_DEBUG_OBJECT (comp->parent, "%s port %u is EOS", comp->name,
-                port->index);
-            port->eos = TRUE;
-          }
-        }
+  /* If an input port is managed by a pool, the buffer will be ready to be
+   * filled again once it's been released to the pool. */
+  if (port->port_def.eDir == OMX_DirOutput || !port->using_pool) {
+    g_queue_push_tail (&port->pending_buffers, buf);
+  }
+}
 
-        /* If an input port is managed by a pool, the buffer will be ready to be
-         * filled again once it's been released to the pool. */
-        if (port->port_def.eDir == OMX_DirOutput || !port->using_pool) {
-          g_queue_push_tail (&port->pending_buffers, buf);
-        }
+static void gst_omx_component_wake (GstOMXComponent * comp,
+    GstOMXPort * port);
 
-        break;
-      }
-      default:{
-        g_assert_not_reached ();
-        break;
-      }
+/* Takes the whole done list of port at once and handles its buffers in
+ * the order the component returned them. Threads waiting for the buffers
+ * to be handled are woken up.
+ *
+ * NOTE: Call with port->lock, comp->messages_lock might be used */
+static void
+gst_omx_port_handle_done_buffers (GstOMXPort * port)
+{
+  GstOMXBuffer *list, *buf, *next;
+  GstOMXBufferDoneState state;
+
+  list = g_atomic_pointer_exchange (&port->done_head, NULL);
+  if (!list)
+    return;
+
+  /* The callbacks push to the head, restore their order */
+  buf = list;
+  list = NULL;
+  while (buf) {
+    next = buf->done_next;
+    buf->done_next = list;
+    list = buf;
+    buf = next;
+  }
+
+  for (buf = list; buf; buf = next) {
+    next = buf->done_next;
+    state = buf->done_state;
+
+    buf->done_next = NULL;
+    buf->done_state = GST_OMX_BUFFER_DONE_NONE;
+
+    gst_omx_port_handle_done_buffer (port, buf, state);
+  }
+
+  gst_omx_component_wake (port->comp, port);
+}
+
+/* Handles all messages of the component ring in one pass and returns
+ * TRUE if there were any, comp->messages_lock is only taken if something
+ * overflowed the ring.
+ *
+ * NOTE: Call with comp->lock */
+static gboolean
+gst_omx_component_drain_ring (GstOMXComponent * comp)
+{
+  GstOMXMessageRing *ring = &comp->ring;
+  GstOMXMessage msg, *overflow_msg;
+  GQueue overflow;
+  gboolean handled = FALSE;
+
+  for (;;) {
+    if (gst_omx_message_ring_pop (ring, &msg)) {
+      gst_omx_component_handle_message (comp, &msg);
+      handled = TRUE;
+      continue;
     }
 
-    g_slice_free (GstOMXMessage, msg);
+    if (g_atomic_int_get (&ring->n_overflow) == 0)
+      break;
 
     g_mutex_lock (&comp->messages_lock);
+    overflow = ring->overflow;
+    g_queue_init (&ring->overflow);
+    g_atomic_int_set (&ring->n_overflow, 0);
+    g_mutex_unlock (&comp->messages_lock);
+
+    while ((overflow_msg = g_queue_pop_head (&overflow))) {
+      gst_omx_component_handle_message (comp, overflow_msg);
+      g_slice_free (GstOMXMessage, overflow_msg);
+      handled = TRUE;
+    }
   }
 
-  g_mutex_unlock (&comp->messages_lock);
+  return handled;
 }
 
-/* NOTE: comp->messages_lock will be used */
+/* NOTE: Call with comp->lock, port->lock and comp->messages_lock
+ * will be used */
+static void
+gst_omx_component_handle_messages (GstOMXComponent * comp)
+{
+  guint i;
+
+  /* The handled events may have changed what others are waiting for */
+  if (gst_omx_component_drain_ring (comp))
+    gst_omx_component_wake (comp, NULL);
+
+  for (i = 0; i < comp->ports->len; i++) {
+    GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+
+    if (!gst_omx_port_has_done_buffers (port))
+      continue;
+
+    g_mutex_lock (&port->lock);
+    gst_omx_port_handle_done_buffers (port);
+    g_mutex_unlock (&port->lock);
+  }
+}
+
+/* Handles the pending buffer completions of port and, if there are any,
+ * the component events. port->lock is released for the latter.
+ *
+ * NOTE: Call with port->lock, comp->lock and comp->messages_lock
+ * might be used */
+static void
+gst_omx_port_handle_messages (GstOMXPort * port)
+{
+  GstOMXComponent *comp = port->comp;
+
+  if (!gst_omx_message_ring_is_empty (&comp->ring)) {
+    g_mutex_unlock (&port->lock);
+    g_mutex_lock (&comp->lock);
+    gst_omx_component_handle_messages (comp);
+    g_mutex_unlock (&comp->lock);
+    g_mutex_lock (&port->lock);
+  }
+
+  gst_omx_port_handle_done_buffers (port);
+}
+
+/* NOTE: Call with comp->messages_lock */
+static void
+gst_omx_component_broadcast (GstOMXComponent * comp, GstOMXPort * port)
+{
+  guint i;
+
+  g_atomic_int_inc (&comp->wake_seq);
+  g_cond_broadcast (&comp->messages_cond);
+
+  if (port) {
+    g_cond_broadcast (&port->cond);
+    return;
+  }
+
+  for (i = 0; i < comp->ports->len; i++) {
+    GstOMXPort *tmp = g_ptr_array_index (comp->ports, i);
+
+    g_cond_broadcast (&tmp->cond);
+  }
+}
+
+/* Publishes that something changed for the threads waiting on port, or
+ * on any port if NULL, and on the component. Only locks if somebody is
+ * waiting.
+ *
+ * NOTE: comp->messages_lock might be used */
+static void
+gst_omx_component_wake (GstOMXComponent * comp, GstOMXPort * port)
+{
+  gboolean waiters;
+  guint i;
+
+  /* Waiters are counted before they compare wake_seq, so they either see
+   * the new value or are seen here */
+  g_atomic_int_inc (&comp->wake_seq);
+
+  waiters = g_atomic_int_get (&comp->n_waiters) > 0;
+  if (port) {
+    waiters |= g_atomic_int_get (&port->n_waiters) > 0;
+  } else {
+    for (i = 0; !waiters && i < comp->ports->len; i++) {
+      GstOMXPort *tmp = g_ptr_array_index (comp->ports, i);
+
+      waiters = g_atomic_int_get (&tmp->n_waiters) > 0;
+    }
+  }
+
+  if (waiters) {
+    g_mutex_lock (&comp->messages_lock);
+    gst_omx_component_broadcast (comp, port);
+    g_mutex_unlock (&comp->messages_lock);
+  }
+}
+
+/* Queues msg, if any, in the overflow queue of the component ring and
+ * wakes up all waiting threads.
+ *
+ * NOTE: comp->messages_lock will be used */
 static void
 gst_omx_component_send_message (GstOMXComponent * comp, GstOMXMessage * msg)
 {
   g_mutex_lock (&comp->messages_lock);
-  if (msg)
-    g_queue_push_tail (&comp->messages, msg);
-  g_cond_broadcast (&comp->messages_cond);
+  if (msg) {
+    g_queue_push_tail (&comp->ring.overflow, msg);
+    g_atomic_int_inc (&comp->ring.n_overflow);
+  }
+  gst_omx_component_broadcast (comp, NULL);
   g_mutex_unlock (&comp->messages_lock);
 }
 
-/* NOTE: Call with comp->lock, comp->messages_lock will be used */
+/* Called from the OMX event callback. Neither allocates nor locks unless
+ * the ring is full or somebody is waiting.
+ *
+ * NOTE: comp->messages_lock might be used */
+static void
+gst_omx_component_post_message (GstOMXComponent * comp,
+    const GstOMXMessage * msg)
+{
+  GstOMXMessageRing *ring = &comp->ring;
+
+  if (g_atomic_int_get (&ring->n_overflow) > 0
+      || !gst_omx_message_ring_push (ring, msg)) {
+    GST_DEBUG_OBJECT (comp->parent, "%s queueing message in overflow queue",
+        comp->name);
+    gst_omx_component_send_message (comp, g_slice_dup (GstOMXMessage, msg));
+    return;
+  }
+
+  gst_omx_component_wake (comp, NULL);
+}
+
+/* Called from the OMX buffer callbacks. Links buf into the done list of
+ * its port and only wakes up threads waiting on that port or the
+ * component. Never allocates and only locks if somebody is waiting.
+ *
+ * NOTE: comp->messages_lock might be used */
+static void
+gst_omx_port_post_done_buffer (GstOMXPort * port, GstOMXBuffer * buf,
+    GstOMXBufferDoneState state)
+{
+  GstOMXComponent *comp = port->comp;
+  GstOMXBuffer *head;
+
+  if (buf->done_state != GST_OMX_BUFFER_DONE_NONE) {
+    GST_ERROR_OBJECT (comp->parent, "%s port %u buffer %p returned twice",
+        comp->name, port->index, buf);
+    return;
+  }
+
+  buf->done_state = state;
+  do {
+    head = g_atomic_pointer_get (&port->done_head);
+    buf->done_next = head;
+  } while (!g_atomic_pointer_compare_and_exchange (&port->done_head, head,
+          buf));
+
+  gst_omx_component_wake (comp, port);
+}
+
+/* Returns the wake sequence to pass to the wait functions. It has to be
+ * taken before checking the condition that is waited for, so that no
+ * change after the check is missed */
+static gint
+gst_omx_component_get_wake_seq (GstOMXComponent * comp)
+{
+  return g_atomic_int_get (&comp->wake_seq);
+}
+
+/* Waits on the condition of port, or of the component if port is NULL,
+ * unless a message is pending for it already or something changed since
+ * seq was taken. lock is released while waiting.
+ *
+ * NOTE: Call with lock, comp->messages_lock will be used */
 static gboolean
-gst_omx_component_wait_message (GstOMXComponent * comp, GstClockTime timeout)
+gst_omx_component_wait_cond (GstOMXComponent * comp, GstOMXPort * port,
+    GMutex * lock, gint seq, GstClockTime timeout)
 {
-  gboolean signalled;
+  gboolean signalled, pending;
   gint64 wait_until = -1;
+  GCond *cond;
+  gint *n_waiters;
+  guint i;
 
   if (timeout != GST_CLOCK_TIME_NONE) {
     gint64 add = timeout / (GST_SECOND / G_TIME_SPAN_SECOND);
@@ -475,22 +978,80 @@ gst_omx_component_wait_message (GstOMXComponent * comp, GstClockTime timeout)
     GST_DEBUG_OBJECT (comp->parent, "%s waiting for signal", comp->name);
   }
 
+  if (port) {
+    cond = &port->cond;
+    n_waiters = &port->n_waiters;
+  } else {
+    cond = &comp->messages_cond;
+    n_waiters = &comp->n_waiters;
+  }
+
+  /* Register as waiter before checking for pending messages, producers
+   * check the waiters after publishing theirs */
   g_mutex_lock (&comp->messages_lock);
-  g_mutex_unlock (&comp->lock);
+  g_atomic_int_inc (n_waiters);
 
-  if (!g_queue_is_empty (&comp->messages)) {
+  pending = g_atomic_int_get (&comp->wake_seq) != seq;
+  pending |= !gst_omx_message_ring_is_empty (&comp->ring);
+  if (port) {
+    pending |= gst_omx_port_has_done_buffers (port);
+  } else {
+    for (i = 0; !pending && i < comp->ports->len; i++) {
+      GstOMXPort *tmp = g_ptr_array_index (comp->ports, i);
+
+      pending = gst_omx_port_has_done_buffers (tmp);
+    }
+  }
+  g_mutex_unlock (lock);
+
+  if (pending) {
     signalled = TRUE;
   } else if (timeout == GST_CLOCK_TIME_NONE) {
-    g_cond_wait (&comp->messages_cond, &comp->messages_lock);
+    g_cond_wait (cond, &comp->messages_lock);
     signalled = TRUE;
   } else {
-    signalled =
-        g_cond_wait_until (&comp->messages_cond, &comp->messages_lock,
-        wait_until);
+    signalled = g_cond_wait_until (cond, &comp->messages_lock, wait_until);
   }
 
+  g_atomic_int_add (n_waiters, -1);
   g_mutex_unlock (&comp->messages_lock);
-  g_mutex_lock (&comp->lock);
+  g_mutex_lock (lock);
+
+  return signalled;
+}
+
+/* NOTE: Call with comp->lock, comp->messages_lock will be used */
+static gboolean
+gst_omx_component_wait_message (GstOMXComponent * comp, gint seq,
+    GstClockTime timeout)
+{
+  return gst_omx_component_wait_cond (comp, NULL, &comp->lock, seq, timeout);
+}
+
+/* Only wakes up for messages of port and component events.
+ *
+ * NOTE: Call with port->lock, comp->messages_lock will be used */
+static gboolean
+gst_omx_port_wait_message (GstOMXPort * port, gint seq, GstClockTime timeout)
+{
+  return gst_omx_component_wait_cond (port->comp, port, &port->lock, seq,
+      timeout);
+}
+
+/* Like gst_omx_port_wait_message() but accounts the time spent waiting
+ * in the port stats.
+ *
+ * NOTE: Must be called with port->lock */
+static gboolean
+gst_omx_port_wait_message_timed (GstOMXPort * port, gint seq,
+    GstClockTime timeout)
+{
+  GstClockTime start;
+  gboolean signalled;
+
+  start = gst_util_get_timestamp ();
+  signalled = gst_omx_port_wait_message (port, seq, timeout);
+  port->stats.acquire_wait_time += gst_util_get_timestamp () - start;
 
   return signalled;
 }
@@ -618,6 +1179,13 @@ log_omx_api_trace_event (GstOMXComponent * comp, OMX_EVENTTYPE event,
 {
 #ifndef GST_DISABLE_GST_DEBUG
   GstStructure *s;
+#endif
+
+  if (GST_OMX_TRACE_ENABLED ())
+    gst_omx_trace_record (GST_OMX_TRACE_EVENT, comp, OMX_ALL, NULL, 0, 0,
+        event, data1, data2);
+
+#ifndef GST_DISABLE_GST_DEBUG
 
   /* Don't bother creating useless structs if not needed */
   if (gst_debug_category_get_threshold (OMX_API_TRACE) < GST_LEVEL_DEBUG)
@@ -655,41 +1223,41 @@ EventHandler (OMX_HANDLETYPE hComponent, OMX_PTR pAppData, OMX_EVENTTYPE eEvent,
 
       switch (cmd) {
         case OMX_CommandStateSet:{
-          GstOMXMessage *msg = g_slice_new (GstOMXMessage);
+          GstOMXMessage msg;
 
-          msg->type = GST_OMX_MESSAGE_STATE_SET;
-          msg->content.state_set.state = nData2;
+          msg.type = GST_OMX_MESSAGE_STATE_SET;
+          msg.content.state_set.state = nData2;
 
           GST_DEBUG_OBJECT (comp->parent, "%s state change to %s finished",
               comp->name,
-              gst_omx_state_to_string (msg->content.state_set.state));
+              gst_omx_state_to_string (msg.content.state_set.state));
 
-          gst_omx_component_send_message (comp, msg);
+          gst_omx_component_post_message (comp, &msg);
           break;
         }
         case OMX_CommandFlush:{
-          GstOMXMessage *msg = g_slice_new (GstOMXMessage);
+          GstOMXMessage msg;
 
-          msg->type = GST_OMX_MESSAGE_FLUSH;
-          msg->content.flush.port = nData2;
+          msg.type = GST_OMX_MESSAGE_FLUSH;
+          msg.content.flush.port = nData2;
           GST_DEBUG_OBJECT (comp->parent, "%s port %u flushed", comp->name,
-              (guint) msg->content.flush.port);
+              (guint) msg.content.flush.port);
 
-          gst_omx_component_send_message (comp, msg);
+          gst_omx_component_post_message (comp, &msg);
           break;
         }
         case OMX_CommandPortEnable:
         case OMX_CommandPortDisable:{
-          GstOMXMessage *msg = g_slice_new (GstOMXMessage);
+          GstOMXMessage msg;
 
-          msg->type = GST_OMX_MESSAGE_PORT_ENABLE;
-          msg->content.port_enable.port = nData2;
-          msg->content.port_enable.enable = (cmd == OMX_CommandPortEnable);
+          msg.type = GST_OMX_MESSAGE_PORT_ENABLE;
+          msg.content.port_enable.port = nData2;
+          msg.content.port_enable.enable = (cmd == OMX_CommandPortEnable);
           GST_DEBUG_OBJECT (comp->parent, "%s port %u %s", comp->name,
-              (guint) msg->content.port_enable.port,
-              (msg->content.port_enable.enable ? "enabled" : "disabled"));
+              (guint) msg.content.port_enable.port,
+              (msg.content.port_enable.enable ? "enabled" : "disabled"));
 
-          gst_omx_component_send_message (comp, msg);
+          gst_omx_component_post_message (comp, &msg);
           break;
         }
         default:
@@ -699,7 +1267,7 @@ EventHandler (OMX_HANDLETYPE hComponent, OMX_PTR pAppData, OMX_EVENTTYPE eEvent,
     }
     case OMX_EventError:
     {
-      GstOMXMessage *msg;
+      GstOMXMessage msg;
       OMX_ERRORTYPE error_type = nData1;
 
       /* Yes, this really happens... */
@@ -715,20 +1283,18 @@ EventHandler (OMX_HANDLETYPE hComponent, OMX_PTR pAppData, OMX_EVENTTYPE eEvent,
         break;
       }
 
-      msg = g_slice_new (GstOMXMessage);
-
-      msg->type = GST_OMX_MESSAGE_ERROR;
-      msg->content.error.error = error_type;
+      msg.type = GST_OMX_MESSAGE_ERROR;
+      msg.content.error.error = error_type;
       GST_ERROR_OBJECT (comp->parent, "%s got error: %s (0x%08x)", comp->name,
-          gst_omx_error_to_string (msg->content.error.error),
-          msg->content.error.error);
+          gst_omx_error_to_string (msg.content.error.error),
+          msg.content.error.error);
 
-      gst_omx_component_send_message (comp, msg);
+      gst_omx_component_post_message (comp, &msg);
       break;
     }
     case OMX_EventPortSettingsChanged:
     {
-      GstOMXMessage *msg = g_slice_new (GstOMXMessage);
+      GstOMXMessage msg;
       OMX_U32 index;
 
       if (!(comp->hacks &
@@ -745,28 +1311,27 @@ EventHandler (OMX_HANDLETYPE hComponent, OMX_PTR pAppData, OMX_EVENTTYPE eEvent,
         index = 1;
 
 
-      msg->type = GST_OMX_MESSAGE_PORT_SETTINGS_CHANGED;
-      msg->content.port_settings_changed.port = index;
+      msg.type = GST_OMX_MESSAGE_PORT_SETTINGS_CHANGED;
+      msg.content.port_settings_changed.port = index;
       GST_DEBUG_OBJECT (comp->parent, "%s settings changed (port index: %u)",
-          comp->name, (guint) msg->content.port_settings_changed.port);
+          comp->name, (guint) msg.content.port_settings_changed.port);
 
-      gst_omx_component_send_message (comp, msg);
+      gst_omx_component_post_message (comp, &msg);
       break;
     }
     case OMX_EventBufferFlag:{
-      GstOMXMessage *msg;
+      GstOMXMessage msg;
 
-      msg = g_slice_new (GstOMXMessage);
 
-      msg->type = GST_OMX_MESSAGE_BUFFER_FLAG;
-      msg->content.buffer_flag.port = nData1;
-      msg->content.buffer_flag.flags = nData2;
+      msg.type = GST_OMX_MESSAGE_BUFFER_FLAG;
+      msg.content.buffer_flag.port = nData1;
+      msg.content.buffer_flag.flags = nData2;
       GST_DEBUG_OBJECT (comp->parent, "%s port %u got buffer flags 0x%08x (%s)",
-          comp->name, (guint) msg->content.buffer_flag.port,
-          (guint) msg->content.buffer_flag.flags,
-          gst_omx_buffer_flags_to_string (msg->content.buffer_flag.flags));
+          comp->name, (guint) msg.content.buffer_flag.port,
+          (guint) msg.content.buffer_flag.flags,
+          gst_omx_buffer_flags_to_string (msg.content.buffer_flag.flags));
 
-      gst_omx_component_send_message (comp, msg);
+      gst_omx_component_post_message (comp, &msg);
       break;
     }
     case OMX_EventPortFormatDetected:
@@ -804,11 +1369,19 @@ gst_omx_buffer_unmap (GstOMXBuffer * buffer)
 }
 
 static void
-log_omx_api_trace_buffer (GstOMXComponent * comp, const gchar * event,
-    GstOMXBuffer * buf)
+log_omx_api_trace_buffer (GstOMXComponent * comp, GstOMXTraceType type,
+    const gchar * event, GstOMXBuffer * buf)
 {
 #ifndef GST_DISABLE_GST_DEBUG
   GstStructure *s;
+#endif
+
+  if (GST_OMX_TRACE_ENABLED () && buf)
+    gst_omx_trace_record (type, comp, buf->port->index, buf->omx_buf,
+        GST_OMX_GET_TICKS (buf->omx_buf->nTimeStamp), buf->omx_buf->nFlags,
+        buf->omx_buf->nFilledLen, 0, 0);
+
+#ifndef GST_DISABLE_GST_DEBUG
 
   /* Don't bother creating useless structs if not needed */
   if (gst_debug_category_get_threshold (OMX_API_TRACE) < GST_LEVEL_TRACE)
@@ -854,7 +1427,6 @@ EmptyBufferDone (OMX_HANDLETYPE hComponent, OMX_PTR pAppData,
 {
   GstOMXBuffer *buf;
   GstOMXComponent *comp;
-  GstOMXMessage *msg;
 
   buf = pBuffer->pAppPrivate;
   if (!buf) {
@@ -871,18 +1443,12 @@ EmptyBufferDone (OMX_HANDLETYPE hComponent, OMX_PTR pAppData,
 
   comp = buf->port->comp;
 
-  msg = g_slice_new (GstOMXMessage);
-  msg->type = GST_OMX_MESSAGE_BUFFER_DONE;
-  msg->content.buffer_done.component = hComponent;
-  msg->content.buffer_done.app_data = pAppData;
-  msg->content.buffer_done.buffer = pBuffer;
-  msg->content.buffer_done.empty = OMX_TRUE;
-
-  log_omx_api_trace_buffer (comp, "EmptyBufferDone", buf);
+  log_omx_api_trace_buffer (comp, GST_OMX_TRACE_EMPTY_BUFFER_DONE,
+      "EmptyBufferDone", buf);
   GST_LOG_OBJECT (comp->parent, "%s port %u emptied buffer %p (%p)",
       comp->name, buf->port->index, buf, buf->omx_buf->pBuffer);
 
-  gst_omx_component_send_message (comp, msg);
+  gst_omx_port_post_done_buffer (buf->port, buf, GST_OMX_BUFFER_DONE_EMPTIED);
 
   return OMX_ErrorNone;
 }
@@ -893,7 +1459,6 @@ FillBufferDone (OMX_HANDLETYPE hComponent, OMX_PTR pAppData,
 {
   GstOMXBuffer *buf;
   GstOMXComponent *comp;
-  GstOMXMessage *msg;
 
   buf = pBuffer->pAppPrivate;
   if (!buf) {
@@ -910,18 +1475,12 @@ FillBufferDone (OMX_HANDLETYPE hComponent, OMX_PTR pAppData,
 
   comp = buf->port->comp;
 
-  msg = g_slice_new (GstOMXMessage);
-  msg->type = GST_OMX_MESSAGE_BUFFER_DONE;
-  msg->content.buffer_done.component = hComponent;
-  msg->content.buffer_done.app_data = pAppData;
-  msg->content.buffer_done.buffer = pBuffer;
-  msg->content.buffer_done.empty = OMX_FALSE;
-
-  log_omx_api_trace_buffer (comp, "FillBufferDone", buf);
+  log_omx_api_trace_buffer (comp, GST_OMX_TRACE_FILL_BUFFER_DONE,
+      "FillBufferDone", buf);
   GST_LOG_OBJECT (comp->parent, "%s port %u filled buffer %p (%p)", comp->name,
       buf->port->index, buf, buf->omx_buf->pBuffer);
 
-  gst_omx_component_send_message (comp, msg);
+  gst_omx_port_post_done_buffer (buf->port, buf, GST_OMX_BUFFER_DONE_FILLED);
 
   return OMX_ErrorNone;
 }
@@ -932,6 +1491,259 @@ static OMX_CALLBACKTYPE callbacks =
 GST_DEFINE_MINI_OBJECT_TYPE (GstOMXComponent, gst_omx_component);
 
 static void gst_omx_component_free (GstOMXComponent * comp);
+static void gst_omx_component_free_ports (GstOMXComponent * comp);
+
+/* Components released in Loaded state are kept around for up to
+ * idle-time milliseconds and handed out again by gst_omx_component_new()
+ * for the same core, component name, role and hacks. This saves the
+ * GetHandle/FreeHandle round-trip, which is expensive on some platforms,
+ * when pipelines are torn down and rebuilt quickly.
+ *
+ * The OpenMAX IL specification does not require components to forget
+ * the parameters set by the previous user when going back to Loaded, so
+ * only components known to do that are cached.
+ *
+ * Configured by the [component-cache] group of gstomx.conf:
+ *   idle-time=<ms>       0 (the default) disables the cache
+ *   max-components=<n>   oldest components are unloaded first, default 4
+ *   components=<names>   ';' separated list of the components that reset
+ *                        all their parameters in Loaded state, no other
+ *                        component is cached
+ *
+ * Everything still cached is unloaded together with the plugin.
+ */
+#define GST_OMX_COMPONENT_CACHE_GROUP "component-cache"
+
+G_LOCK_DEFINE_STATIC (component_cache);
+/* Contains GstOMXComponent*, oldest release first */
+static GQueue component_cache = G_QUEUE_INIT;
+static GstClockTime component_cache_idle_time = 0;
+static guint component_cache_max_components = 4;
+static GstClock *component_cache_clock = NULL;
+static GstClockID component_cache_timer = NULL;
+static gchar **component_cache_components = NULL;
+
+static void
+gst_omx_component_cache_configure (GKeyFile * config)
+{
+  GError *err = NULL;
+  gint val;
+
+  if (!g_key_file_has_group (config, GST_OMX_COMPONENT_CACHE_GROUP))
+    return;
+
+  val = g_key_file_get_integer (config, GST_OMX_COMPONENT_CACHE_GROUP,
+      "idle-time", &err);
+  if (err) {
+    if (!g_error_matches (err, G_KEY_FILE_ERROR,
+            G_KEY_FILE_ERROR_KEY_NOT_FOUND))
+      GST_WARNING ("Invalid component cache idle-time: %s", err->message);
+    g_clear_error (&err);
+  } else if (val > 0) {
+    component_cache_idle_time = val * GST_MSECOND;
+  }
+
+  val = g_key_file_get_integer (config, GST_OMX_COMPONENT_CACHE_GROUP,
+      "max-components", &err);
+  if (err) {
+    if (!g_error_matches (err, G_KEY_FILE_ERROR,
+            G_KEY_FILE_ERROR_KEY_NOT_FOUND))
+      GST_WARNING ("Invalid component cache max-components: %s",
+          err->message);
+    g_clear_error (&err);
+  } else if (val >= 0) {
+    component_cache_max_components = val;
+  }
+
+  component_cache_components =
+      g_key_file_get_string_list (config, GST_OMX_COMPONENT_CACHE_GROUP,
+      "components", NULL, NULL);
+
+  GST_INFO ("Component cache: idle time %" GST_TIME_FORMAT
+      ", max %u components", GST_TIME_ARGS (component_cache_idle_time),
+      component_cache_max_components);
+}
+
+static gboolean gst_omx_component_cache_timeout (GstClock * clock,
+    GstClockTime time, GstClockID id, gpointer user_data);
+
+/* NOTE: Must be called with the component cache lock */
+static void
+gst_omx_component_cache_schedule_unlocked (void)
+{
+  GstOMXComponent *oldest;
+
+  if (component_cache_timer)
+    return;
+
+  oldest = g_queue_peek_head (&component_cache);
+  if (!oldest)
+    return;
+
+  component_cache_timer =
+      gst_clock_new_single_shot_id (component_cache_clock,
+      oldest->release_time + component_cache_idle_time);
+  gst_clock_id_wait_async (component_cache_timer,
+      gst_omx_component_cache_timeout, NULL, NULL);
+}
+
+static gboolean
+gst_omx_component_cache_timeout (GstClock * clock, GstClockTime time,
+    GstClockID id, gpointer user_data)
+{
+  GstOMXComponent *comp;
+  GList *expired = NULL;
+
+  G_LOCK (component_cache);
+  if (component_cache_timer == id) {
+    gst_clock_id_unref (component_cache_timer);
+    component_cache_timer = NULL;
+  }
+
+  while ((comp = g_queue_peek_head (&component_cache))
+      && comp->release_time + component_cache_idle_time <= time) {
+    g_queue_pop_head (&component_cache);
+    expired = g_list_prepend (expired, comp);
+  }
+  gst_omx_component_cache_schedule_unlocked ();
+  G_UNLOCK (component_cache);
+
+  /* Unload outside the cache lock, FreeHandle might take a while */
+  g_list_free_full (expired, (GDestroyNotify) gst_omx_component_unref);
+
+  return TRUE;
+}
+
+/* Unloads all cached components and stops the expiry timer */
+static void
+gst_omx_component_cache_clear (void)
+{
+  GList *cached;
+
+  G_LOCK (component_cache);
+  if (component_cache_timer) {
+    gst_clock_id_unschedule (component_cache_timer);
+    gst_clock_id_unref (component_cache_timer);
+    component_cache_timer = NULL;
+  }
+  cached = component_cache.head;
+  g_queue_init (&component_cache);
+  /* Nothing is cached from now on */
+  component_cache_idle_time = 0;
+  G_UNLOCK (component_cache);
+
+  g_list_free_full (cached, (GDestroyNotify) gst_omx_component_unref);
+
+  if (component_cache_clock) {
+    gst_object_unref (component_cache_clock);
+    component_cache_clock = NULL;
+  }
+  g_strfreev (component_cache_components);
+  component_cache_components = NULL;
+}
+
+static GstOMXComponent *
+gst_omx_component_cache_take (GstOMXCore * core, const gchar * component_name,
+    const gchar * component_role, guint64 hacks)
+{
+  GstOMXComponent *comp = NULL;
+  GList *l;
+
+  if (component_cache_idle_time == 0)
+    return NULL;
+
+  G_LOCK (component_cache);
+  /* Prefer the most recently released component */
+  for (l = component_cache.tail; l; l = l->prev) {
+    GstOMXComponent *tmp = l->data;
+
+    if (tmp->core == core && tmp->hacks == hacks
+        && g_strcmp0 (tmp->component_name, component_name) == 0
+        && g_strcmp0 (tmp->component_role, component_role) == 0) {
+      g_queue_delete_link (&component_cache, l);
+      tmp->cached = FALSE;
+      comp = tmp;
+      break;
+    }
+  }
+  G_UNLOCK (component_cache);
+
+  return comp;
+}
+
+/* Called when the last reference to comp is dropped. Returns FALSE if
+ * comp was moved to the component cache instead of being freed */
+static gboolean
+gst_omx_component_dispose (GstOMXComponent * comp)
+{
+  GstOMXComponent *evicted = NULL;
+  gboolean reusable;
+  gint i, n;
+
+  /* Evicted from the cache */
+  if (comp->cached)
+    return TRUE;
+
+  if (component_cache_idle_time == 0 || component_cache_max_components == 0)
+    return TRUE;
+
+  if (!component_cache_components
+      || !g_strv_contains ((const gchar * const *) component_cache_components,
+          comp->component_name))
+    return TRUE;
+
+  g_mutex_lock (&comp->lock);
+  gst_omx_component_handle_messages (comp);
+  reusable = comp->state == OMX_StateLoaded
+      && comp->pending_state == OMX_StateInvalid
+      && comp->last_error == OMX_ErrorNone;
+  g_mutex_unlock (&comp->lock);
+
+  n = comp->ports->len;
+  for (i = 0; reusable && i < n; i++) {
+    GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+
+    if (port->buffers)
+      reusable = FALSE;
+  }
+
+  if (!reusable)
+    return TRUE;
+
+  GST_INFO_OBJECT (comp->parent, "Keeping component %p %s loaded for reuse",
+      comp, comp->name);
+
+  /* The next user adds its ports again */
+  gst_omx_component_free_ports (comp);
+  comp->ports = g_ptr_array_new ();
+  comp->n_in_ports = 0;
+  comp->n_out_ports = 0;
+
+  g_list_free (comp->pending_reconfigure_outports);
+  comp->pending_reconfigure_outports = NULL;
+
+  gst_object_unref (comp->parent);
+  comp->parent = NULL;
+
+  /* Resurrect, the cache owns this reference now */
+  gst_mini_object_ref (GST_MINI_OBJECT_CAST (comp));
+
+  G_LOCK (component_cache);
+  if (!component_cache_clock)
+    component_cache_clock = gst_system_clock_obtain ();
+  comp->release_time = gst_clock_get_time (component_cache_clock);
+  comp->cached = TRUE;
+  g_queue_push_tail (&component_cache, comp);
+  if (component_cache.length > component_cache_max_components)
+    evicted = g_queue_pop_head (&component_cache);
+  gst_omx_component_cache_schedule_unlocked ();
+  G_UNLOCK (component_cache);
+
+  if (evicted)
+    gst_omx_component_unref (evicted);
+
+  return FALSE;
+}
 
 /* NOTE: Uses comp->lock and comp->messages_lock */
 GstOMXComponent *
@@ -947,11 +1759,28 @@ gst_omx_component_new (GstObject * parent, const gchar * core_name,
   if (!core)
     return NULL;
 
+  comp = gst_omx_component_cache_take (core, component_name, component_role,
+      hacks);
+  if (comp) {
+    /* The cached component still holds its own core reference */
+    gst_omx_core_release (core);
+    comp->parent = gst_object_ref (parent);
+    comp->stats_interval = 0;
+    GST_DEBUG_OBJECT (parent, "Reusing cached component handle %p (%s)",
+        comp->handle, component_name);
+    return comp;
+  }
+
   comp = g_slice_new0 (GstOMXComponent);
   comp->core = core;
 
+  /* Callbacks might already be called while getting the handle */
+  comp->ports = g_ptr_array_new ();
+  gst_omx_message_ring_init (&comp->ring, GST_OMX_COMPONENT_RING_SIZE);
+
   gst_mini_object_init (GST_MINI_OBJECT_CAST (comp), 0,
-      gst_omx_component_get_type (), NULL, NULL,
+      gst_omx_component_get_type (), NULL,
+      (GstMiniObjectDisposeFunction) gst_omx_component_dispose,
       (GstMiniObjectFreeFunction) gst_omx_component_free);
 
   if ((dot = g_strrstr (component_name, ".")))
@@ -968,16 +1797,20 @@ gst_omx_component_new (GstObject * parent, const gchar * core_name,
         component_name, core_name, err);
     gst_omx_core_release (core);
     g_free (comp->name);
+    g_ptr_array_unref (comp->ports);
+    gst_omx_message_ring_clear (&comp->ring);
     g_slice_free (GstOMXComponent, comp);
     return NULL;
   }
   GST_DEBUG_OBJECT (parent,
       "Successfully got component handle %p (%s) from core '%s'", comp->handle,
       component_name, core_name);
+  gst_omx_trace_component (comp, component_name);
   comp->parent = gst_object_ref (parent);
   comp->hacks = hacks;
+  comp->component_name = g_strdup (component_name);
+  comp->component_role = g_strdup (component_role);
 
-  comp->ports = g_ptr_array_new ();
   comp->n_in_ports = 0;
   comp->n_out_ports = 0;
 
@@ -985,7 +1818,6 @@ gst_omx_component_new (GstObject * parent, const gchar * core_name,
   g_mutex_init (&comp->messages_lock);
   g_cond_init (&comp->messages_cond);
 
-  g_queue_init (&comp->messages);
   comp->pending_state = OMX_StateInvalid;
   comp->last_error = OMX_ErrorNone;
 
@@ -1022,14 +1854,10 @@ gst_omx_component_new (GstObject * parent, const gchar * core_name,
 
 /* NOTE: Uses comp->messages_lock */
 static void
-gst_omx_component_free (GstOMXComponent * comp)
+gst_omx_component_free_ports (GstOMXComponent * comp)
 {
   gint i, n;
 
-  g_return_if_fail (comp != NULL);
-
-  GST_INFO_OBJECT (comp->parent, "Unloading component %p %s", comp, comp->name);
-
   if (comp->ports) {
     n = comp->ports->len;
     for (i = 0; i < n; i++) {
@@ -1039,23 +1867,39 @@ gst_omx_component_free (GstOMXComponent * comp)
       g_assert (port->buffers == NULL);
       g_assert (g_queue_get_length (&port->pending_buffers) == 0);
 
+      g_cond_clear (&port->cond);
+      g_mutex_clear (&port->lock);
       g_slice_free (GstOMXPort, port);
     }
     g_ptr_array_unref (comp->ports);
     comp->ports = NULL;
   }
+}
+
+static void
+gst_omx_component_free (GstOMXComponent * comp)
+{
+  g_return_if_fail (comp != NULL);
+
+  GST_INFO_OBJECT (comp->parent, "Unloading component %p %s", comp, comp->name);
+
+  gst_omx_component_free_ports (comp);
 
   comp->core->free_handle (comp->handle);
   gst_omx_core_release (comp->core);
 
-  gst_omx_component_flush_messages (comp);
+  gst_omx_message_ring_clear (&comp->ring);
 
   g_cond_clear (&comp->messages_cond);
   g_mutex_clear (&comp->messages_lock);
   g_mutex_clear (&comp->lock);
 
-  gst_object_unref (comp->parent);
+  if (comp->parent)
+    gst_object_unref (comp->parent);
 
+  g_list_free (comp->pending_reconfigure_outports);
+  g_free (comp->component_name);
+  g_free (comp->component_role);
   g_free (comp->name);
   comp->name = NULL;
 
@@ -1117,6 +1961,13 @@ log_omx_api_trace_send_command (GstOMXComponent * comp, OMX_COMMANDTYPE cmd,
 {
 #ifndef GST_DISABLE_GST_DEBUG
   GstStructure *s;
+#endif
+
+  if (GST_OMX_TRACE_ENABLED ())
+    gst_omx_trace_record (GST_OMX_TRACE_SEND_COMMAND, comp, OMX_ALL, NULL, 0,
+        0, cmd, param, 0);
+
+#ifndef GST_DISABLE_GST_DEBUG
 
   /* Don't bother creating useless structs if not needed */
   if (gst_debug_category_get_threshold (OMX_API_TRACE) < GST_LEVEL_DEBUG)
@@ -1182,7 +2033,7 @@ gst_omx_component_set_state (GstOMXComponent * comp, OMX_STATETYPE state)
   if ((old_state == OMX_StateExecuting || old_state == OMX_StatePause)
       && state < old_state) {
     g_list_free (comp->pending_reconfigure_outports);
-    comp->pending_reconfigure_outports = NULL;
+    g_atomic_pointer_set (&comp->pending_reconfigure_outports, NULL);
     /* Notify all inports that are still waiting */
     gst_omx_component_send_message (comp, NULL);
   }
@@ -1197,7 +2048,8 @@ done:
   if (err != OMX_ErrorNone && comp->last_error == OMX_ErrorNone) {
     GST_ERROR_OBJECT (comp->parent,
         "Last operation returned an error. Setting last_error manually.");
-    comp->last_error = err;
+    g_atomic_int_set ((gint *) & comp->last_error, err);
+    gst_omx_component_wake (comp, NULL);
   }
 
   g_mutex_unlock (&comp->lock);
@@ -1217,6 +2069,7 @@ gst_omx_component_get_state (GstOMXComponent * comp, GstClockTime timeout)
 {
   OMX_STATETYPE ret;
   gboolean signalled = TRUE;
+  gint seq;
 
   g_return_val_if_fail (comp != NULL, OMX_StateInvalid);
 
@@ -1225,6 +2078,7 @@ gst_omx_component_get_state (GstOMXComponent * comp, GstClockTime timeout)
   g_mutex_lock (&comp->lock);
 
   gst_omx_component_handle_messages (comp);
+  seq = gst_omx_component_get_wake_seq (comp);
 
   if (comp->last_error != OMX_ErrorNone) {
     GST_ERROR_OBJECT (comp->parent, "Component %s in error state: %s (0x%08x)",
@@ -1241,9 +2095,10 @@ gst_omx_component_get_state (GstOMXComponent * comp, GstClockTime timeout)
   while (signalled && comp->last_error == OMX_ErrorNone
       && comp->pending_state != OMX_StateInvalid) {
 
-    signalled = gst_omx_component_wait_message (comp, timeout);
+    signalled = gst_omx_component_wait_message (comp, seq, timeout);
     if (signalled)
       gst_omx_component_handle_messages (comp);
+    seq = gst_omx_component_get_wake_seq (comp);
   };
 
   if (signalled) {
@@ -1275,6 +2130,44 @@ done:
   return ret;
 }
 
+/* Waits until the state changes started on all n_comps components with
+ * gst_omx_component_set_state() are finished. These proceed in parallel,
+ * so all components share the same timeout instead of being waited for
+ * one after another with their own timeout each.
+ *
+ * Returns TRUE if no component failed or timed out.
+ *
+ * NOTE: Uses comp->lock and comp->messages_lock of each component */
+gboolean
+gst_omx_components_wait_state (GstOMXComponent ** comps, guint n_comps,
+    GstClockTime timeout)
+{
+  gint64 wait_until = -1;
+  gboolean ret = TRUE;
+  guint i;
+
+  g_return_val_if_fail (comps != NULL || n_comps == 0, FALSE);
+
+  if (timeout != GST_CLOCK_TIME_NONE)
+    wait_until = g_get_monotonic_time () +
+        timeout / (GST_SECOND / G_TIME_SPAN_SECOND);
+
+  for (i = 0; i < n_comps; i++) {
+    GstClockTime remaining = GST_CLOCK_TIME_NONE;
+
+    g_return_val_if_fail (comps[i] != NULL, FALSE);
+
+    if (wait_until != -1)
+      remaining = MAX (wait_until - g_get_monotonic_time (), 0) *
+          (GST_SECOND / G_TIME_SPAN_SECOND);
+
+    if (gst_omx_component_get_state (comps[i], remaining) == OMX_StateInvalid)
+      ret = FALSE;
+  }
+
+  return ret;
+}
+
 GstOMXPort *
 gst_omx_component_add_port (GstOMXComponent * comp, guint32 index)
 {
@@ -1311,6 +2204,9 @@ gst_omx_component_add_port (GstOMXComponent * comp, guint32 index)
 
   port->tunneled = FALSE;
 
+  g_mutex_init (&port->lock);
+  g_cond_init (&port->cond);
+
   port->port_def = port_def;
 
   g_queue_init (&port->pending_buffers);
@@ -1326,7 +2222,10 @@ gst_omx_component_add_port (GstOMXComponent * comp, guint32 index)
   else
     comp->n_out_ports++;
 
+  /* The stats might be sampled concurrently */
+  g_mutex_lock (&comp->lock);
   g_ptr_array_add (comp->ports, port);
+  g_mutex_unlock (&comp->lock);
 
   return port;
 }
@@ -1373,6 +2272,195 @@ gst_omx_component_get_last_error_string (GstOMXComponent * comp)
   return gst_omx_error_to_string (gst_omx_component_get_last_error (comp));
 }
 
+/* NOTE: Call with comp->lock, which protects port->buffers against being
+ * (de)allocated, uses port->lock */
+static GstStructure *
+gst_omx_port_get_stats_unlocked (GstOMXPort * port)
+{
+  GstOMXPortStats stats;
+  GstStructure *s;
+  GValue histogram = G_VALUE_INIT;
+  guint n_buffers = 0, n_in_component = 0, n_pending;
+  gint i;
+
+  g_mutex_lock (&port->lock);
+  stats = port->stats;
+  if (port->buffers) {
+    n_buffers = port->buffers->len;
+    for (i = 0; i < n_buffers; i++) {
+      GstOMXBuffer *buf = g_ptr_array_index (port->buffers, i);
+
+      if (buf->used)
+        n_in_component++;
+    }
+  }
+  n_pending = g_queue_get_length (&port->pending_buffers);
+  g_mutex_unlock (&port->lock);
+
+  g_value_init (&histogram, GST_TYPE_ARRAY);
+  for (i = 0; i < GST_OMX_PORT_STATS_HISTOGRAM_SIZE; i++) {
+    GValue v = G_VALUE_INIT;
+
+    g_value_init (&v, G_TYPE_UINT64);
+    g_value_set_uint64 (&v, stats.residency_histogram[i]);
+    gst_value_array_append_value (&histogram, &v);
+    g_value_unset (&v);
+  }
+
+  s = gst_structure_new ("GstOMXPortStats",
+      "index", G_TYPE_UINT, (guint) port->index,
+      "direction", G_TYPE_STRING,
+      (port->port_def.eDir == OMX_DirInput ? "input" : "output"),
+      "buffers", G_TYPE_UINT, n_buffers,
+      "buffers-in-component", G_TYPE_UINT, n_in_component,
+      "buffers-pending", G_TYPE_UINT, n_pending,
+      "buffers-in-gstreamer", G_TYPE_UINT,
+      n_buffers - n_in_component - n_pending,
+      "submitted", G_TYPE_UINT64, stats.n_submitted,
+      "returned", G_TYPE_UINT64, stats.n_returned,
+      "flushes", G_TYPE_UINT64, stats.n_flushes,
+      "reconfigures", G_TYPE_UINT64, stats.n_reconfigures,
+      "acquire-wait-time", G_TYPE_UINT64, stats.acquire_wait_time,
+      "residency-min", G_TYPE_UINT64, stats.residency_min,
+      "residency-avg", G_TYPE_UINT64,
+      (stats.n_returned ? stats.residency_total / stats.n_returned : 0),
+      "residency-max", G_TYPE_UINT64, stats.residency_max, NULL);
+  gst_structure_take_value (s, "residency-histogram", &histogram);
+
+  return s;
+}
+
+/* NOTE: Uses comp->lock and port->lock */
+GstStructure *
+gst_omx_port_get_stats (GstOMXPort * port)
+{
+  GstStructure *s;
+
+  g_return_val_if_fail (port != NULL, NULL);
+
+  g_mutex_lock (&port->comp->lock);
+  s = gst_omx_port_get_stats_unlocked (port);
+  g_mutex_unlock (&port->comp->lock);
+
+  return s;
+}
+
+/* NOTE: Uses comp->lock and port->lock of all ports */
+GstStructure *
+gst_omx_component_get_stats (GstOMXComponent * comp)
+{
+  GstStructure *s;
+  gint i, n;
+
+  g_return_val_if_fail (comp != NULL, NULL);
+
+  s = gst_structure_new ("GstOMXStats",
+      "component", G_TYPE_STRING, comp->name, NULL);
+
+  g_mutex_lock (&comp->lock);
+  n = comp->ports->len;
+  for (i = 0; i < n; i++) {
+    GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+    GstStructure *port_stats;
+    gchar *name;
+
+    port_stats = gst_omx_port_get_stats_unlocked (port);
+    name = g_strdup_printf ("port-%u", (guint) port->index);
+    gst_structure_set (s, name, GST_TYPE_STRUCTURE, port_stats, NULL);
+    g_free (name);
+    gst_structure_free (port_stats);
+  }
+  g_mutex_unlock (&comp->lock);
+
+  return s;
+}
+
+/* Posts the stats of comp as element message on the bus every interval
+ * while buffers are acquired, 0 disables this.
+ *
+ * NOTE: Uses comp->messages_lock */
+void
+gst_omx_component_set_stats_interval (GstOMXComponent * comp,
+    GstClockTime interval)
+{
+  g_return_if_fail (comp != NULL);
+
+  g_mutex_lock (&comp->messages_lock);
+  comp->stats_interval = interval;
+  comp->stats_last_posted = gst_util_get_timestamp ();
+  g_mutex_unlock (&comp->messages_lock);
+}
+
+/* Installs the "stats" and "stats-interval" properties every element
+ * exposes, handled with gst_omx_get_stats_property() and the element's
+ * own stats interval */
+void
+gst_omx_install_stats_properties (GObjectClass * gobject_class,
+    guint stats_prop_id, guint stats_interval_prop_id)
+{
+  g_object_class_install_property (gobject_class, stats_prop_id,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Buffer and timing statistics of the OpenMAX component and its ports",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, stats_interval_prop_id,
+      g_param_spec_uint ("stats-interval", "Statistics interval",
+          "Interval in milliseconds for posting the statistics as element "
+          "messages on the bus (0 = disabled)",
+          0, G_MAXUINT, GST_OMX_STATS_INTERVAL_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+}
+
+/* Sets value to the stats of the component in *comp, or NULL if element
+ * has none. *comp is only read with the object lock of element held as
+ * the stats property might be read concurrently to closing it */
+void
+gst_omx_get_stats_property (GstObject * element, GstOMXComponent ** comp,
+    GValue * value)
+{
+  GstOMXComponent *tmp = NULL;
+
+  GST_OBJECT_LOCK (element);
+  if (*comp)
+    tmp = gst_omx_component_ref (*comp);
+  GST_OBJECT_UNLOCK (element);
+
+  if (tmp) {
+    g_value_take_boxed (value, gst_omx_component_get_stats (tmp));
+    gst_omx_component_unref (tmp);
+  } else {
+    g_value_set_boxed (value, NULL);
+  }
+}
+
+/* NOTE: Uses comp->messages_lock */
+static void
+gst_omx_component_maybe_post_stats (GstOMXComponent * comp)
+{
+  GstClockTime now;
+  gboolean post = FALSE;
+
+  /* Unlocked check first, this is called for every acquired buffer */
+  if (comp->stats_interval == 0)
+    return;
+
+  now = gst_util_get_timestamp ();
+
+  g_mutex_lock (&comp->messages_lock);
+  if (comp->stats_interval != 0
+      && now >= comp->stats_last_posted + comp->stats_interval) {
+    comp->stats_last_posted = now;
+    post = TRUE;
+  }
+  g_mutex_unlock (&comp->messages_lock);
+
+  if (post)
+    gst_element_post_message (GST_ELEMENT_CAST (comp->parent),
+        gst_message_new_element (comp->parent,
+            gst_omx_component_get_stats (comp)));
+}
+
 #ifndef GST_DISABLE_GST_DEBUG
 static const gchar *
 omx_index_type_to_str (OMX_INDEXTYPE index)
@@ -1873,12 +2961,18 @@ omx_index_type_to_str (OMX_INDEXTYPE index)
 #endif /* GST_DISABLE_GST_DEBUG */
 
 static void
-log_omx_api_trace_call (GstOMXComponent * comp, const gchar * function,
-    OMX_INDEXTYPE index, GstDebugLevel level)
+log_omx_api_trace_call (GstOMXComponent * comp, GstOMXTraceType type,
+    const gchar * function, OMX_INDEXTYPE index, GstDebugLevel level)
 {
 #ifndef GST_DISABLE_GST_DEBUG
   GstStructure *s;
   const gchar *index_name;
+#endif
+
+  if (GST_OMX_TRACE_ENABLED ())
+    gst_omx_trace_record (type, comp, OMX_ALL, NULL, 0, 0, index, 0, 0);
+
+#ifndef GST_DISABLE_GST_DEBUG
 
   /* Don't bother creating useless structs if not needed */
   if (gst_debug_category_get_threshold (OMX_API_TRACE) < level)
@@ -1909,7 +3003,8 @@ gst_omx_component_get_parameter (GstOMXComponent * comp, OMX_INDEXTYPE index,
 
   GST_DEBUG_OBJECT (comp->parent, "Getting %s parameter at index 0x%08x",
       comp->name, index);
-  log_omx_api_trace_call (comp, "GetParameter", index, GST_LEVEL_LOG);
+  log_omx_api_trace_call (comp, GST_OMX_TRACE_GET_PARAMETER, "GetParameter",
+      index, GST_LEVEL_LOG);
   err = OMX_GetParameter (comp->handle, index, param);
   DEBUG_IF_OK (comp->parent, err, "Got %s parameter at index 0x%08x: %s "
       "(0x%08x)", comp->name, index, gst_omx_error_to_string (err), err);
@@ -1917,6 +3012,71 @@ gst_omx_component_get_parameter (GstOMXComponent * comp, OMX_INDEXTYPE index,
   return err;
 }
 
+/* TRUE for the parameters that apply to the whole component, their
+ * structures have no nPortIndex */
+static gboolean
+gst_omx_index_is_component_wide (OMX_INDEXTYPE index)
+{
+  switch (index) {
+    case OMX_IndexParamPriorityMgmt:
+    case OMX_IndexParamAudioInit:
+    case OMX_IndexParamImageInit:
+    case OMX_IndexParamVideoInit:
+    case OMX_IndexParamOtherInit:
+    case OMX_IndexParamContentURI:
+    case OMX_IndexParamStandardComponentRole:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+/* Makes the next gst_omx_port_update_port_definition() query the port
+ * definitions that setting param at index could have changed: the ones
+ * of the port in its nPortIndex, or of all ports if it has none.
+ *
+ * NOTE: Uses comp->lock and port->lock */
+static void
+gst_omx_component_invalidate_port_definitions (GstOMXComponent * comp,
+    OMX_INDEXTYPE index, gconstpointer param)
+{
+  /* All structures of port parameters start like this one */
+  const OMX_PARAM_PORTDEFINITIONTYPE *header = param;
+  GstOMXPort *target = NULL;
+  gint i, n;
+
+  g_mutex_lock (&comp->lock);
+  n = comp->ports->len;
+
+  if (!gst_omx_index_is_component_wide (index)
+      && header->nSize > G_STRUCT_OFFSET (OMX_PARAM_PORTDEFINITIONTYPE,
+          nPortIndex)) {
+    for (i = 0; !target && i < n; i++) {
+      GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+
+      if (port->index == header->nPortIndex)
+        target = port;
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+
+    /* Parameters of an input port can change the definition of the
+     * output ports too, e.g. the output frame size of a decoder follows
+     * its input port */
+    if (target && port != target
+        && !(target->port_def.eDir == OMX_DirInput
+            && port->port_def.eDir == OMX_DirOutput))
+      continue;
+
+    g_mutex_lock (&port->lock);
+    port->port_def_cookie++;
+    g_mutex_unlock (&port->lock);
+  }
+  g_mutex_unlock (&comp->lock);
+}
+
 /* comp->lock must be unlocked while calling this */
 OMX_ERRORTYPE
 gst_omx_component_set_parameter (GstOMXComponent * comp, OMX_INDEXTYPE index,
@@ -1930,11 +3090,14 @@ gst_omx_component_set_parameter (GstOMXComponent * comp, OMX_INDEXTYPE index,
   GST_DEBUG_OBJECT (comp->parent, "Setting %s parameter at index 0x%08x",
       comp->name, index);
 
-  log_omx_api_trace_call (comp, "SetParameter", index, GST_LEVEL_DEBUG);
+  log_omx_api_trace_call (comp, GST_OMX_TRACE_SET_PARAMETER, "SetParameter",
+      index, GST_LEVEL_DEBUG);
   err = OMX_SetParameter (comp->handle, index, param);
   DEBUG_IF_OK (comp->parent, err, "Set %s parameter at index 0x%08x: %s "
       "(0x%08x)", comp->name, index, gst_omx_error_to_string (err), err);
 
+  gst_omx_component_invalidate_port_definitions (comp, index, param);
+
   return err;
 }
 
@@ -1950,7 +3113,8 @@ gst_omx_component_get_config (GstOMXComponent * comp, OMX_INDEXTYPE index,
 
   GST_DEBUG_OBJECT (comp->parent, "Getting %s configuration at index 0x%08x",
       comp->name, index);
-  log_omx_api_trace_call (comp, "GetConfig", index, GST_LEVEL_LOG);
+  log_omx_api_trace_call (comp, GST_OMX_TRACE_GET_CONFIG, "GetConfig",
+      index, GST_LEVEL_LOG);
   err = OMX_GetConfig (comp->handle, index, config);
   DEBUG_IF_OK (comp->parent, err, "Got %s parameter at index 0x%08x: %s "
       "(0x%08x)", comp->name, index, gst_omx_error_to_string (err), err);
@@ -1970,11 +3134,32 @@ gst_omx_component_set_config (GstOMXComponent * comp, OMX_INDEXTYPE index,
 
   GST_DEBUG_OBJECT (comp->parent, "Setting %s configuration at index 0x%08x",
       comp->name, index);
-  log_omx_api_trace_call (comp, "SetConfig", index, GST_LEVEL_DEBUG);
+  log_omx_api_trace_call (comp, GST_OMX_TRACE_SET_CONFIG, "SetConfig",
+      index, GST_LEVEL_DEBUG);
   err = OMX_SetConfig (comp->handle, index, config);
   DEBUG_IF_OK (comp->parent, err, "Set %s parameter at index 0x%08x: %s "
       "(0x%08x)", comp->name, index, gst_omx_error_to_string (err), err);
 
+  gst_omx_component_invalidate_port_definitions (comp, index, config);
+
+  return err;
+}
+
+/* Looks up the index of a vendor extension of the component */
+OMX_ERRORTYPE
+gst_omx_component_get_extension_index (GstOMXComponent * comp,
+    const gchar * name, OMX_INDEXTYPE * index)
+{
+  OMX_ERRORTYPE err;
+
+  g_return_val_if_fail (comp != NULL, OMX_ErrorUndefined);
+  g_return_val_if_fail (name != NULL, OMX_ErrorUndefined);
+  g_return_val_if_fail (index != NULL, OMX_ErrorUndefined);
+
+  err = OMX_GetExtensionIndex (comp->handle, (OMX_STRING) name, index);
+  DEBUG_IF_OK (comp->parent, err, "Got %s extension index for %s: %s "
+      "(0x%08x)", comp->name, name, gst_omx_error_to_string (err), err);
+
   return err;
 }
 
@@ -2074,32 +3259,34 @@ gst_omx_close_tunnel (GstOMXPort * port1, GstOMXPort * port2)
   return err;
 }
 
+/* NOTE: Uses port->lock */
 OMX_ERRORTYPE
 gst_omx_port_get_port_definition (GstOMXPort * port,
     OMX_PARAM_PORTDEFINITIONTYPE * port_def)
 {
-  GstOMXComponent *comp;
   OMX_ERRORTYPE err;
 
   g_return_val_if_fail (port != NULL, OMX_ErrorBadParameter);
 
-  comp = port->comp;
-
-  GST_OMX_INIT_STRUCT (port_def);
-  port_def->nPortIndex = port->index;
+  err = gst_omx_port_update_port_definition (port, NULL);
 
-  err = gst_omx_component_get_parameter (comp, OMX_IndexParamPortDefinition,
-      port_def);
+  g_mutex_lock (&port->lock);
+  *port_def = port->port_def;
+  g_mutex_unlock (&port->lock);
 
   return err;
 }
 
+/* NOTE: Uses port->lock */
 OMX_ERRORTYPE
 gst_omx_port_update_port_definition (GstOMXPort * port,
     OMX_PARAM_PORTDEFINITIONTYPE * port_def)
 {
-  OMX_ERRORTYPE err_get, err_set = OMX_ErrorNone;
+  OMX_ERRORTYPE err_get = OMX_ErrorNone, err_set = OMX_ErrorNone;
+  OMX_PARAM_PORTDEFINITIONTYPE tmp;
   GstOMXComponent *comp;
+  gboolean cached;
+  gint cookie;
 
   g_return_val_if_fail (port != NULL, FALSE);
 
@@ -2109,8 +3296,26 @@ gst_omx_port_update_port_definition (GstOMXPort * port,
     err_set =
         gst_omx_component_set_parameter (comp, OMX_IndexParamPortDefinition,
         port_def);
-  err_get = gst_omx_component_get_parameter (comp, OMX_IndexParamPortDefinition,
-      &port->port_def);
+
+  g_mutex_lock (&port->lock);
+  tmp = port->port_def;
+  cookie = port->port_def_cookie;
+  cached = cookie == port->cached_port_def_cookie;
+  g_mutex_unlock (&port->lock);
+
+  /* Only query the component if something could have changed since
+   * the last time */
+  if (!cached) {
+    err_get =
+        gst_omx_component_get_parameter (comp, OMX_IndexParamPortDefinition,
+        &tmp);
+
+    g_mutex_lock (&port->lock);
+    port->port_def = tmp;
+    if (err_get == OMX_ErrorNone)
+      port->cached_port_def_cookie = cookie;
+    g_mutex_unlock (&port->lock);
+  }
 
   DEBUG_IF_OK (comp->parent, err_set,
       "Updated %s port %u definition: %s (0x%08x)", comp->name, port->index,
@@ -2122,31 +3327,82 @@ gst_omx_port_update_port_definition (GstOMXPort * port,
     return err_get;
 }
 
-/* NOTE: Uses comp->lock and comp->messages_lock */
+/* TRUE if gst_omx_port_acquire_buffer() would return the head of
+ * pending_buffers right away.
+ *
+ * NOTE: Call with port->lock, after the messages were handled */
+static gboolean
+gst_omx_port_can_take_pending_buffer (GstOMXPort * port)
+{
+  GstOMXComponent *comp = port->comp;
+
+  if (g_queue_is_empty (&port->pending_buffers))
+    return FALSE;
+
+  if (gst_omx_component_peek_last_error (comp) != OMX_ErrorNone
+      || port->flushing)
+    return FALSE;
+
+  if (port->port_def.eDir == OMX_DirInput
+      && (g_atomic_pointer_get (&comp->pending_reconfigure_outports)
+          || port->settings_cookie != port->configured_settings_cookie))
+    return FALSE;
+
+  return TRUE;
+}
+
+/* NOTE: Uses port->lock and comp->messages_lock, comp->lock only if
+ * component events are pending */
 GstOMXAcquireBufferReturn
 gst_omx_port_acquire_buffer (GstOMXPort * port, GstOMXBuffer ** buf,
     GstOMXWait wait)
+{
+  guint n_bufs;
+
+  g_return_val_if_fail (buf != NULL, GST_OMX_ACQUIRE_BUFFER_ERROR);
+
+  *buf = NULL;
+
+  return gst_omx_port_acquire_buffers (port, buf, 1, &n_bufs, wait);
+}
+
+/* Acquires up to max_bufs buffers in one go. The first one is acquired
+ * exactly like gst_omx_port_acquire_buffer() does, the others only if
+ * they are already pending and would be returned by it right away.
+ * n_bufs is only non-zero if GST_OMX_ACQUIRE_BUFFER_OK is returned.
+ *
+ * NOTE: Uses port->lock and comp->messages_lock, comp->lock only if
+ * component events are pending */
+GstOMXAcquireBufferReturn
+gst_omx_port_acquire_buffers (GstOMXPort * port, GstOMXBuffer ** bufs,
+    guint max_bufs, guint * n_bufs, GstOMXWait wait)
 {
   GstOMXAcquireBufferReturn ret = GST_OMX_ACQUIRE_BUFFER_ERROR;
   GstOMXComponent *comp;
   OMX_ERRORTYPE err;
   GstOMXBuffer *_buf = NULL;
   gint64 timeout = GST_CLOCK_TIME_NONE;
+  guint n = 0;
+  gint seq;
+
+  g_return_val_if_fail (n_bufs != NULL, GST_OMX_ACQUIRE_BUFFER_ERROR);
+
+  *n_bufs = 0;
 
   g_return_val_if_fail (port != NULL, GST_OMX_ACQUIRE_BUFFER_ERROR);
   g_return_val_if_fail (!port->tunneled, GST_OMX_ACQUIRE_BUFFER_ERROR);
-  g_return_val_if_fail (buf != NULL, GST_OMX_ACQUIRE_BUFFER_ERROR);
-
-  *buf = NULL;
+  g_return_val_if_fail (bufs != NULL, GST_OMX_ACQUIRE_BUFFER_ERROR);
+  g_return_val_if_fail (max_bufs > 0, GST_OMX_ACQUIRE_BUFFER_ERROR);
 
   comp = port->comp;
 
-  g_mutex_lock (&comp->lock);
-  GST_DEBUG_OBJECT (comp->parent, "Acquiring %s buffer from port %u",
-      comp->name, port->index);
+  g_mutex_lock (&port->lock);
+  GST_DEBUG_OBJECT (comp->parent, "Acquiring up to %u %s buffers from port %u",
+      max_bufs, comp->name, port->index);
 
 retry:
-  gst_omx_component_handle_messages (comp);
+  gst_omx_port_handle_messages (port);
+  seq = gst_omx_component_get_wake_seq (comp);
 
   /* If we are in the case where we waited for a buffer after EOS,
    * make sure we don't do that again */
@@ -2154,7 +3410,7 @@ retry:
     timeout = -2;
 
   /* Check if the component is in an error state */
-  if ((err = comp->last_error) != OMX_ErrorNone) {
+  if ((err = gst_omx_component_peek_last_error (comp)) != OMX_ErrorNone) {
     GST_ERROR_OBJECT (comp->parent, "Component %s is in error state: %s",
         comp->name, gst_omx_error_to_string (err));
     ret = GST_OMX_ACQUIRE_BUFFER_ERROR;
@@ -2175,14 +3431,17 @@ retry:
    * or buffers are returned to be filled as usual.
    */
   if (port->port_def.eDir == OMX_DirInput) {
-    if (comp->pending_reconfigure_outports) {
-      gst_omx_component_handle_messages (comp);
-      while (comp->pending_reconfigure_outports &&
-          (err = comp->last_error) == OMX_ErrorNone && !port->flushing) {
+    if (g_atomic_pointer_get (&comp->pending_reconfigure_outports)) {
+      gst_omx_port_handle_messages (port);
+      seq = gst_omx_component_get_wake_seq (comp);
+      while (g_atomic_pointer_get (&comp->pending_reconfigure_outports) &&
+          (err = gst_omx_component_peek_last_error (comp)) == OMX_ErrorNone
+          && !port->flushing) {
         GST_DEBUG_OBJECT (comp->parent,
             "Waiting for %s output ports to reconfigure", comp->name);
-        gst_omx_component_wait_message (comp, GST_CLOCK_TIME_NONE);
-        gst_omx_component_handle_messages (comp);
+        gst_omx_port_wait_message_timed (port, seq, GST_CLOCK_TIME_NONE);
+        gst_omx_port_handle_messages (port);
+        seq = gst_omx_component_get_wake_seq (comp);
       }
       goto retry;
     }
@@ -2260,7 +3519,7 @@ retry:
         comp->name, port->index);
 
     if (wait == GST_OMX_WAIT) {
-      gst_omx_component_wait_message (comp,
+      gst_omx_port_wait_message_timed (port, seq,
           timeout == -2 ? GST_CLOCK_TIME_NONE : timeout);
 
       /* And now check everything again and maybe get a buffer */
@@ -2277,41 +3536,39 @@ retry:
   ret = GST_OMX_ACQUIRE_BUFFER_OK;
 
 done:
-  g_mutex_unlock (&comp->lock);
+  if (_buf) {
+    bufs[n++] = _buf;
+
+    while (n < max_bufs && gst_omx_port_can_take_pending_buffer (port))
+      bufs[n++] = g_queue_pop_head (&port->pending_buffers);
+  }
+  g_mutex_unlock (&port->lock);
+
+  *n_bufs = n;
 
   if (_buf) {
     g_assert (_buf == _buf->omx_buf->pAppPrivate);
-    *buf = _buf;
   }
 
-  GST_DEBUG_OBJECT (comp->parent, "Acquired buffer %p (%p) from %s port %u: %d",
-      _buf, (_buf ? _buf->omx_buf->pBuffer : NULL), comp->name, port->index,
-      ret);
+  GST_DEBUG_OBJECT (comp->parent, "Acquired %u buffers, first %p (%p) from "
+      "%s port %u: %d", n, _buf, (_buf ? _buf->omx_buf->pBuffer : NULL),
+      comp->name, port->index, ret);
+
+  gst_omx_component_maybe_post_stats (comp);
 
   return ret;
 }
 
-/* NOTE: Uses comp->lock and comp->messages_lock */
-OMX_ERRORTYPE
-gst_omx_port_release_buffer (GstOMXPort * port, GstOMXBuffer * buf)
+/* NOTE: Call with port->lock, after the messages were handled */
+static OMX_ERRORTYPE
+gst_omx_port_release_buffer_unlocked (GstOMXPort * port, GstOMXBuffer * buf)
 {
-  GstOMXComponent *comp;
+  GstOMXComponent *comp = port->comp;
   OMX_ERRORTYPE err = OMX_ErrorNone;
 
-  g_return_val_if_fail (port != NULL, OMX_ErrorUndefined);
-  g_return_val_if_fail (!port->tunneled, OMX_ErrorUndefined);
-  g_return_val_if_fail (buf != NULL, OMX_ErrorUndefined);
-  g_return_val_if_fail (buf->port == port, OMX_ErrorUndefined);
-
-  comp = port->comp;
-
-  g_mutex_lock (&comp->lock);
-
   GST_DEBUG_OBJECT (comp->parent, "Releasing buffer %p (%p) to %s port %u",
       buf, buf->omx_buf->pBuffer, comp->name, port->index);
 
-  gst_omx_component_handle_messages (comp);
-
   if (port->port_def.eDir == OMX_DirOutput) {
     /* Reset all flags, some implementations don't
      * reset them themselves and the flags are not
@@ -2320,12 +3577,12 @@ gst_omx_port_release_buffer (GstOMXPort * port, GstOMXBuffer * buf)
     gst_omx_buffer_reset (buf);
   }
 
-  if ((err = comp->last_error) != OMX_ErrorNone) {
+  if ((err = gst_omx_component_peek_last_error (comp)) != OMX_ErrorNone) {
     GST_ERROR_OBJECT (comp->parent, "Component %s is in error state: %s "
         "(0x%08x)", comp->name, gst_omx_error_to_string (err), err);
     g_queue_push_tail (&port->pending_buffers, buf);
     gst_omx_component_send_message (comp, NULL);
-    goto done;
+    return err;
   }
 
   if (port->flushing || port->disabled_pending || !port->port_def.bEnabled) {
@@ -2334,7 +3591,7 @@ gst_omx_port_release_buffer (GstOMXPort * port, GstOMXBuffer * buf)
         comp->name, port->index);
     g_queue_push_tail (&port->pending_buffers, buf);
     gst_omx_component_send_message (comp, NULL);
-    goto done;
+    return OMX_ErrorNone;
   }
 
   g_assert (buf == buf->omx_buf->pAppPrivate);
@@ -2342,46 +3599,101 @@ gst_omx_port_release_buffer (GstOMXPort * port, GstOMXBuffer * buf)
   /* FIXME: What if the settings cookies don't match? */
 
   buf->used = TRUE;
+  buf->submit_time = gst_util_get_timestamp ();
+  port->stats.n_submitted++;
 
   if (port->port_def.eDir == OMX_DirInput) {
-    log_omx_api_trace_buffer (comp, "EmptyThisBuffer", buf);
+    log_omx_api_trace_buffer (comp, GST_OMX_TRACE_EMPTY_THIS_BUFFER,
+        "EmptyThisBuffer", buf);
     err = OMX_EmptyThisBuffer (comp->handle, buf->omx_buf);
   } else {
-    log_omx_api_trace_buffer (comp, "FillThisBuffer", buf);
+    log_omx_api_trace_buffer (comp, GST_OMX_TRACE_FILL_THIS_BUFFER,
+        "FillThisBuffer", buf);
     err = OMX_FillThisBuffer (comp->handle, buf->omx_buf);
   }
-  DEBUG_IF_OK (comp->parent, err, "Released buffer %p to %s port %u: %s "
-      "(0x%08x)", buf, comp->name, port->index, gst_omx_error_to_string (err),
-      err);
+  DEBUG_IF_OK (comp->parent, err, "Released buffer %p to %s port %u: %s "
+      "(0x%08x)", buf, comp->name, port->index, gst_omx_error_to_string (err),
+      err);
+
+  return err;
+}
+
+/* NOTE: Uses port->lock and comp->messages_lock, comp->lock only if
+ * component events are pending */
+OMX_ERRORTYPE
+gst_omx_port_release_buffer (GstOMXPort * port, GstOMXBuffer * buf)
+{
+  return gst_omx_port_release_buffers (port, &buf, 1);
+}
+
+/* Releases all n_bufs buffers in one go. All of them are released even
+ * if one of them fails, the first error is returned.
+ *
+ * NOTE: Uses port->lock and comp->messages_lock, comp->lock only if
+ * component events are pending */
+OMX_ERRORTYPE
+gst_omx_port_release_buffers (GstOMXPort * port, GstOMXBuffer ** bufs,
+    guint n_bufs)
+{
+  OMX_ERRORTYPE err = OMX_ErrorNone, tmp;
+  guint i;
+
+  g_return_val_if_fail (port != NULL, OMX_ErrorUndefined);
+  g_return_val_if_fail (!port->tunneled, OMX_ErrorUndefined);
+  g_return_val_if_fail (bufs != NULL || n_bufs == 0, OMX_ErrorUndefined);
+
+  for (i = 0; i < n_bufs; i++) {
+    g_return_val_if_fail (bufs[i] != NULL, OMX_ErrorUndefined);
+    g_return_val_if_fail (bufs[i]->port == port, OMX_ErrorUndefined);
+  }
+
+  if (n_bufs == 0)
+    return OMX_ErrorNone;
+
+  g_mutex_lock (&port->lock);
+
+  gst_omx_port_handle_messages (port);
+
+  for (i = 0; i < n_bufs; i++) {
+    tmp = gst_omx_port_release_buffer_unlocked (port, bufs[i]);
+    if (err == OMX_ErrorNone)
+      err = tmp;
+  }
 
-done:
-  gst_omx_component_handle_messages (comp);
-  g_mutex_unlock (&comp->lock);
+  gst_omx_port_handle_messages (port);
+  g_mutex_unlock (&port->lock);
 
   return err;
 }
 
-/* NOTE: Must be called while holding comp->lock */
+/* NOTE: Must be called while holding comp->lock, uses port->lock */
 static gboolean
 should_wait_until_flushed (GstOMXPort * port)
 {
-  if (!port->flushed)
-    /* Flush command hasn't been completed yet by OMX */
-    return TRUE;
+  gboolean ret = FALSE;
 
-  if (port->buffers) {
+  g_mutex_lock (&port->lock);
+
+  if (!port->flushed) {
+    /* Flush command hasn't been completed yet by OMX */
+    ret = TRUE;
+  } else if (port->buffers) {
     guint i;
 
     /* Wait for all the buffers used by OMX to be released */
     for (i = 0; i < port->buffers->len; i++) {
       GstOMXBuffer *buf = g_ptr_array_index (port->buffers, i);
 
-      if (buf->used)
-        return TRUE;
+      if (buf->used) {
+        ret = TRUE;
+        break;
+      }
     }
   }
 
-  return FALSE;
+  g_mutex_unlock (&port->lock);
+
+  return ret;
 }
 
 /* NOTE: Uses comp->lock and comp->messages_lock */
@@ -2415,16 +3727,23 @@ gst_omx_port_set_flushing (GstOMXPort * port, GstClockTime timeout,
     goto done;
   }
 
+  /* Only reached if flushing changes, so this counts the transitions */
+  g_mutex_lock (&port->lock);
   port->flushing = flush;
+  if (flush) {
+    port->flushed = FALSE;
+    port->stats.n_flushes++;
+  }
+  g_mutex_unlock (&port->lock);
+
   if (flush) {
     gboolean signalled;
     OMX_ERRORTYPE last_error;
+    gint seq;
 
     gst_omx_component_send_message (comp, NULL);
 
     /* Now flush the port */
-    port->flushed = FALSE;
-
     err =
         gst_omx_component_send_command (comp, OMX_CommandFlush, port->index,
         NULL);
@@ -2461,10 +3780,12 @@ gst_omx_port_set_flushing (GstOMXPort * port, GstClockTime timeout,
     signalled = TRUE;
     last_error = OMX_ErrorNone;
     gst_omx_component_handle_messages (comp);
+    seq = gst_omx_component_get_wake_seq (comp);
     while (should_wait_until_flushed (port)) {
-      signalled = gst_omx_component_wait_message (comp, timeout);
+      signalled = gst_omx_component_wait_message (comp, seq, timeout);
       if (signalled)
         gst_omx_component_handle_messages (comp);
+      seq = gst_omx_component_get_wake_seq (comp);
 
       last_error = comp->last_error;
 
@@ -2472,7 +3793,9 @@ gst_omx_port_set_flushing (GstOMXPort * port, GstClockTime timeout,
         /* Something gone wrong or we timed out */
         break;
     }
+    g_mutex_lock (&port->lock);
     port->flushed = FALSE;
+    g_mutex_unlock (&port->lock);
 
     GST_DEBUG_OBJECT (comp->parent, "%s port %d flushed", comp->name,
         port->index);
@@ -2491,7 +3814,9 @@ gst_omx_port_set_flushing (GstOMXPort * port, GstClockTime timeout,
   }
 
   /* Reset EOS flag */
+  g_mutex_lock (&port->lock);
   port->eos = FALSE;
+  g_mutex_unlock (&port->lock);
 
 done:
   gst_omx_port_update_port_definition (port, NULL);
@@ -2505,6 +3830,149 @@ done:
   return err;
 }
 
+/* Sets all ports of the component to flushing or not, without the
+ * component having to leave its state. The ports are flushed with a single
+ * OMX_CommandFlush for OMX_ALL, or with one command per port sent at once
+ * if the component doesn't support that, and are waited for together.
+ *
+ * NOTE: Uses comp->lock and comp->messages_lock */
+OMX_ERRORTYPE
+gst_omx_component_set_flushing (GstOMXComponent * comp, GstClockTime timeout,
+    gboolean flush)
+{
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+  gboolean changed = FALSE;
+  gint i, n;
+
+  g_return_val_if_fail (comp != NULL, OMX_ErrorUndefined);
+
+  g_mutex_lock (&comp->lock);
+
+  GST_DEBUG_OBJECT (comp->parent, "Setting %s ports to %sflushing",
+      comp->name, (flush ? "" : "not "));
+
+  gst_omx_component_handle_messages (comp);
+
+  if ((err = comp->last_error) != OMX_ErrorNone) {
+    GST_ERROR_OBJECT (comp->parent, "Component %s is in error state: %s "
+        "(0x%08x)", comp->name, gst_omx_error_to_string (err), err);
+    goto done;
+  }
+
+  n = (comp->ports ? comp->ports->len : 0);
+  for (i = 0; i < n; i++) {
+    GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+
+    g_mutex_lock (&port->lock);
+    if (port->flushing != flush) {
+      port->flushing = flush;
+      if (flush)
+        port->stats.n_flushes++;
+      changed = TRUE;
+    }
+    if (flush)
+      port->flushed = FALSE;
+    g_mutex_unlock (&port->lock);
+  }
+
+  if (flush && changed) {
+    gboolean signalled, waiting;
+    OMX_ERRORTYPE last_error;
+    gint seq;
+
+    gst_omx_component_send_message (comp, NULL);
+
+    err = gst_omx_component_send_command (comp, OMX_CommandFlush, OMX_ALL,
+        NULL);
+    if (err != OMX_ErrorNone) {
+      GST_DEBUG_OBJECT (comp->parent,
+          "%s can't flush all ports at once: %s (0x%08x)", comp->name,
+          gst_omx_error_to_string (err), err);
+
+      for (i = 0; i < n; i++) {
+        GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+
+        err =
+            gst_omx_component_send_command (comp, OMX_CommandFlush,
+            port->index, NULL);
+        if (err != OMX_ErrorNone) {
+          GST_ERROR_OBJECT (comp->parent,
+              "Error sending flush command to %s port %u: %s (0x%08x)",
+              comp->name, port->index, gst_omx_error_to_string (err), err);
+          goto done;
+        }
+      }
+    }
+
+    /* Retry until timeout or until an error happend or until all
+     * buffers were released by the component and the flush commands
+     * completed on all ports */
+    signalled = TRUE;
+    last_error = OMX_ErrorNone;
+    gst_omx_component_handle_messages (comp);
+    do {
+      seq = gst_omx_component_get_wake_seq (comp);
+      waiting = FALSE;
+      for (i = 0; i < n && !waiting; i++)
+        waiting = should_wait_until_flushed (g_ptr_array_index (comp->ports,
+                i));
+
+      if (!waiting)
+        break;
+
+      signalled = gst_omx_component_wait_message (comp, seq, timeout);
+      if (signalled)
+        gst_omx_component_handle_messages (comp);
+
+      last_error = comp->last_error;
+    } while (signalled && last_error == OMX_ErrorNone);
+
+    for (i = 0; i < n; i++) {
+      GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+
+      g_mutex_lock (&port->lock);
+      port->flushed = FALSE;
+      g_mutex_unlock (&port->lock);
+    }
+
+    if (last_error != OMX_ErrorNone) {
+      GST_ERROR_OBJECT (comp->parent,
+          "Got error while flushing %s: %s (0x%08x)", comp->name,
+          gst_omx_error_to_string (last_error), last_error);
+      err = last_error;
+      goto done;
+    } else if (!signalled) {
+      GST_ERROR_OBJECT (comp->parent, "Timeout while flushing %s",
+          comp->name);
+      err = OMX_ErrorTimeout;
+      goto done;
+    }
+
+    GST_DEBUG_OBJECT (comp->parent, "%s ports flushed", comp->name);
+  }
+
+  /* Reset EOS flags */
+  for (i = 0; i < n; i++) {
+    GstOMXPort *port = g_ptr_array_index (comp->ports, i);
+
+    g_mutex_lock (&port->lock);
+    port->eos = FALSE;
+    g_mutex_unlock (&port->lock);
+  }
+
+done:
+  for (i = 0; i < n; i++)
+    gst_omx_port_update_port_definition (g_ptr_array_index (comp->ports, i),
+        NULL);
+
+  DEBUG_IF_OK (comp->parent, err, "Set %s ports to %sflushing: %s (0x%08x)",
+      comp->name, (flush ? "" : "not "), gst_omx_error_to_string (err), err);
+  gst_omx_component_handle_messages (comp);
+  g_mutex_unlock (&comp->lock);
+
+  return err;
+}
+
 /* NOTE: Uses comp->lock and comp->messages_lock */
 gboolean
 gst_omx_port_is_flushing (GstOMXPort * port)
@@ -2537,6 +4005,7 @@ gst_omx_port_allocate_buffers_unlocked (GstOMXPort * port,
 {
   GstOMXComponent *comp;
   OMX_ERRORTYPE err = OMX_ErrorNone;
+  OMX_U32 size;
   gint i;
   const GList *l;
 
@@ -2568,9 +4037,14 @@ gst_omx_port_allocate_buffers_unlocked (GstOMXPort * port,
   g_return_val_if_fail (n == port->port_def.nBufferCountActual,
       OMX_ErrorBadParameter);
 
+  /* Only the buffers allocated by the component can be made bigger */
+  size = port->port_def.nBufferSize;
+  if (!buffers && !images)
+    size = MAX (size, port->min_buffer_size);
+
   GST_INFO_OBJECT (comp->parent,
       "Allocating %d buffers of size %" G_GSIZE_FORMAT " for %s port %u", n,
-      (size_t) port->port_def.nBufferSize, comp->name, (guint) port->index);
+      (size_t) size, comp->name, (guint) port->index);
 
   if (!port->buffers)
     port->buffers = g_ptr_array_sized_new (n);
@@ -2598,7 +4072,7 @@ gst_omx_port_allocate_buffers_unlocked (GstOMXPort * port,
     } else {
       err =
           OMX_AllocateBuffer (comp->handle, &buf->omx_buf, port->index, buf,
-          port->port_def.nBufferSize);
+          size);
       buf->eglimage = FALSE;
     }
 
@@ -2621,7 +4095,9 @@ gst_omx_port_allocate_buffers_unlocked (GstOMXPort * port,
     g_assert (buf->omx_buf->pAppPrivate == buf);
 
     /* In the beginning all buffers are not owned by the component */
+    g_mutex_lock (&port->lock);
     g_queue_push_tail (&port->pending_buffers, buf);
+    g_mutex_unlock (&port->lock);
     if (buffers || images)
       l = l->next;
   }
@@ -2871,6 +4347,7 @@ gst_omx_port_deallocate_buffers_unlocked (GstOMXPort * port)
    * were all released from the port, either by flushing
    * the port or by disabling it.
    */
+  g_mutex_lock (&port->lock);
   n = port->buffers->len;
   for (i = 0; i < n; i++) {
     GstOMXBuffer *buf = g_ptr_array_index (port->buffers, i);
@@ -2908,6 +4385,7 @@ gst_omx_port_deallocate_buffers_unlocked (GstOMXPort * port)
   g_queue_clear (&port->pending_buffers);
   g_ptr_array_unref (port->buffers);
   port->buffers = NULL;
+  g_mutex_unlock (&port->lock);
 
   gst_omx_component_handle_messages (comp);
 
@@ -2935,12 +4413,77 @@ gst_omx_port_deallocate_buffers (GstOMXPort * port)
   return err;
 }
 
+/* NOTE: Uses comp->lock */
+void
+gst_omx_port_set_min_buffer_size (GstOMXPort * port, guint32 size)
+{
+  g_return_if_fail (port != NULL);
+
+  g_mutex_lock (&port->comp->lock);
+  port->min_buffer_size = size;
+  g_mutex_unlock (&port->comp->lock);
+}
+
+/* Checks if the buffers of the port still fit its definition after the
+ * component changed the port settings, so the port doesn't have to be
+ * disabled to allocate new ones.
+ * NOTE: Uses comp->lock and comp->messages_lock */
+gboolean
+gst_omx_port_can_reuse_buffers (GstOMXPort * port)
+{
+  GstOMXComponent *comp;
+  gboolean ret = FALSE;
+  gint i, n;
+
+  g_return_val_if_fail (port != NULL, FALSE);
+
+  comp = port->comp;
+
+  g_mutex_lock (&comp->lock);
+  gst_omx_component_handle_messages (comp);
+
+  if (comp->last_error != OMX_ErrorNone)
+    goto done;
+
+  n = port->buffers ? port->buffers->len : 0;
+  if (n == 0)
+    goto done;
+
+  gst_omx_port_update_port_definition (port, NULL);
+
+  if (n != port->port_def.nBufferCountActual) {
+    GST_DEBUG_OBJECT (comp->parent,
+        "%s port %u needs %u buffers but has %d", comp->name, port->index,
+        (guint) port->port_def.nBufferCountActual, n);
+    goto done;
+  }
+
+  for (i = 0; i < n; i++) {
+    GstOMXBuffer *buf = g_ptr_array_index (port->buffers, i);
+
+    if (buf->eglimage || buf->omx_buf->nAllocLen < port->port_def.nBufferSize) {
+      GST_DEBUG_OBJECT (comp->parent,
+          "%s port %u needs buffers of size %u", comp->name, port->index,
+          (guint) port->port_def.nBufferSize);
+      goto done;
+    }
+  }
+
+  ret = TRUE;
+
+done:
+  g_mutex_unlock (&comp->lock);
+
+  return ret;
+}
+
 /* NOTE: Must be called while holding comp->lock, uses comp->messages_lock */
 static OMX_ERRORTYPE
 gst_omx_port_set_enabled_unlocked (GstOMXPort * port, gboolean enabled)
 {
   GstOMXComponent *comp;
   OMX_ERRORTYPE err = OMX_ErrorNone;
+  gboolean pending;
 
   comp = port->comp;
 
@@ -2952,7 +4495,11 @@ gst_omx_port_set_enabled_unlocked (GstOMXPort * port, gboolean enabled)
     goto done;
   }
 
-  if (port->enabled_pending || port->disabled_pending) {
+  g_mutex_lock (&port->lock);
+  pending = port->enabled_pending || port->disabled_pending;
+  g_mutex_unlock (&port->lock);
+
+  if (pending) {
     GST_ERROR_OBJECT (comp->parent, "%s port %d enabled/disabled pending "
         "already", comp->name, port->index);
 #if OMX_VERSION_MINOR == 2
@@ -2971,10 +4518,13 @@ gst_omx_port_set_enabled_unlocked (GstOMXPort * port, gboolean enabled)
   if (! !port->port_def.bEnabled == ! !enabled)
     goto done;
 
+  g_mutex_lock (&port->lock);
   if (enabled)
     port->enabled_pending = TRUE;
   else
     port->disabled_pending = TRUE;
+  port->port_def_cookie++;
+  g_mutex_unlock (&port->lock);
 
   if (enabled)
     err =
@@ -3010,6 +4560,20 @@ done:
   return err;
 }
 
+/* NOTE: Uses port->lock */
+static gboolean
+gst_omx_port_has_buffers_in_use (GstOMXPort * port)
+{
+  gboolean ret;
+
+  g_mutex_lock (&port->lock);
+  ret = port->buffers
+      && port->buffers->len > g_queue_get_length (&port->pending_buffers);
+  g_mutex_unlock (&port->lock);
+
+  return ret;
+}
+
 static OMX_ERRORTYPE
 gst_omx_port_wait_buffers_released_unlocked (GstOMXPort * port,
     GstClockTime timeout)
@@ -3018,6 +4582,7 @@ gst_omx_port_wait_buffers_released_unlocked (GstOMXPort * port,
   OMX_ERRORTYPE err = OMX_ErrorNone;
   OMX_ERRORTYPE last_error;
   gboolean signalled;
+  gint seq;
 
   comp = port->comp;
 
@@ -3033,9 +4598,7 @@ gst_omx_port_wait_buffers_released_unlocked (GstOMXPort * port,
       "buffers", comp->name, port->index);
 
   if (timeout == 0) {
-    if (!port->flushed || (port->buffers
-            && port->buffers->len >
-            g_queue_get_length (&port->pending_buffers)))
+    if (!port->flushed || gst_omx_port_has_buffers_in_use (port))
       err = OMX_ErrorTimeout;
     goto done;
   }
@@ -3044,13 +4607,14 @@ gst_omx_port_wait_buffers_released_unlocked (GstOMXPort * port,
   signalled = TRUE;
   last_error = OMX_ErrorNone;
   gst_omx_component_handle_messages (comp);
-  while (signalled && last_error == OMX_ErrorNone && (port->buffers
-          && port->buffers->len >
-          g_queue_get_length (&port->pending_buffers))) {
-    signalled = gst_omx_component_wait_message (comp, timeout);
+  seq = gst_omx_component_get_wake_seq (comp);
+  while (signalled && last_error == OMX_ErrorNone
+      && gst_omx_port_has_buffers_in_use (port)) {
+    signalled = gst_omx_component_wait_message (comp, seq, timeout);
     if (signalled)
       gst_omx_component_handle_messages (comp);
     last_error = comp->last_error;
+    seq = gst_omx_component_get_wake_seq (comp);
   }
 
   if (last_error != OMX_ErrorNone) {
@@ -3094,15 +4658,143 @@ gst_omx_port_wait_buffers_released (GstOMXPort * port, GstClockTime timeout)
   return err;
 }
 
+/* Goes through the done list of port as the buffer might be released to
+ * its pool while port->lock is held, e.g. when the component emptied the
+ * last buffer referencing it.
+ *
+ * NOTE: comp->messages_lock might be used */
 void
 gst_omx_port_requeue_buffer (GstOMXPort * port, GstOMXBuffer * buf)
 {
-  g_mutex_lock (&port->comp->lock);
-  g_queue_push_tail (&port->pending_buffers, buf);
-  g_mutex_unlock (&port->comp->lock);
+  /* awakes gst_omx_port_acquire_buffer() */
+  gst_omx_port_post_done_buffer (port, buf, GST_OMX_BUFFER_DONE_REQUEUED);
+}
+
+/* The component needs nBufferCountMin buffers to keep running, so only
+ * the ones beyond are kept out of it by a batch */
+static guint
+gst_omx_port_get_batch_size (GstOMXPort * port)
+{
+  guint spare = 0;
+
+  if (port->port_def.nBufferCountActual > port->port_def.nBufferCountMin)
+    spare =
+        port->port_def.nBufferCountActual - port->port_def.nBufferCountMin;
+
+  return CLAMP (spare, 1, GST_OMX_BUFFER_BATCH_SIZE);
+}
+
+/* Hands out the buffers of batch one by one and only acquires new ones
+ * from port, after releasing the ones queued with
+ * gst_omx_port_release_batched_buffer(), once all were handed out.
+ * Batched buffers are not handed out anymore once the port is flushing
+ * or the component is in error state.
+ *
+ * NOTE: Uses port->lock and comp->messages_lock only when refilling
+ * batch, comp->lock only if component events are pending */
+GstOMXAcquireBufferReturn
+gst_omx_port_acquire_batched_buffer (GstOMXPort * port,
+    GstOMXBufferBatch * batch, GstOMXBuffer ** buf, GstOMXWait wait)
+{
+  GstOMXAcquireBufferReturn ret;
+  OMX_ERRORTYPE err;
+
+  g_return_val_if_fail (port != NULL, GST_OMX_ACQUIRE_BUFFER_ERROR);
+  g_return_val_if_fail (batch != NULL, GST_OMX_ACQUIRE_BUFFER_ERROR);
+  g_return_val_if_fail (buf != NULL, GST_OMX_ACQUIRE_BUFFER_ERROR);
+
+  *buf = NULL;
+
+  if (batch->next < batch->n_acquired) {
+    if (!g_atomic_int_get (&port->flushing)
+        && gst_omx_component_peek_last_error (port->comp) == OMX_ErrorNone) {
+      *buf = batch->acquired[batch->next++];
+      return GST_OMX_ACQUIRE_BUFFER_OK;
+    }
+
+    gst_omx_port_return_batched_buffers (port, batch);
+  }
+
+  if (batch->n_released > 0) {
+    err = gst_omx_port_release_buffers (port, batch->released,
+        batch->n_released);
+    batch->n_released = 0;
+    if (err != OMX_ErrorNone)
+      GST_ERROR_OBJECT (port->comp->parent, "Failed to release batched "
+          "buffers to %s port %u: %s (0x%08x)", port->comp->name, port->index,
+          gst_omx_error_to_string (err), err);
+  }
+
+  batch->next = 0;
+  batch->size = gst_omx_port_get_batch_size (port);
+  ret = gst_omx_port_acquire_buffers (port, batch->acquired, batch->size,
+      &batch->n_acquired, wait);
+  if (ret == GST_OMX_ACQUIRE_BUFFER_OK)
+    *buf = batch->acquired[batch->next++];
+
+  return ret;
+}
+
+/* Queues buf to be released together with the other buffers of batch,
+ * only releases them right away if the queue is full. The acquired buffers
+ * not handed out yet count too, so that the batch never keeps more than
+ * its size out of the component.
+ *
+ * NOTE: Uses port->lock and comp->messages_lock only when the queue is
+ * full, comp->lock only if component events are pending */
+OMX_ERRORTYPE
+gst_omx_port_release_batched_buffer (GstOMXPort * port,
+    GstOMXBufferBatch * batch, GstOMXBuffer * buf)
+{
+  OMX_ERRORTYPE err;
+
+  g_return_val_if_fail (port != NULL, OMX_ErrorUndefined);
+  g_return_val_if_fail (batch != NULL, OMX_ErrorUndefined);
+  g_return_val_if_fail (buf != NULL, OMX_ErrorUndefined);
+
+  batch->released[batch->n_released++] = buf;
+  if (batch->n_released + batch->n_acquired - batch->next <
+      MAX (batch->size, 1))
+    return OMX_ErrorNone;
+
+  err = gst_omx_port_release_buffers (port, batch->released,
+      batch->n_released);
+  batch->n_released = 0;
+
+  return err;
+}
+
+/* Releases the queued buffers of batch and puts the ones that were not
+ * handed out yet back in front of the pending buffers of port, in their
+ * original order. Must be called before flushing the port is finished
+ * or its buffers are deallocated.
+ *
+ * NOTE: Uses port->lock and comp->messages_lock, comp->lock only if
+ * component events are pending */
+void
+gst_omx_port_return_batched_buffers (GstOMXPort * port,
+    GstOMXBufferBatch * batch)
+{
+  g_return_if_fail (port != NULL);
+  g_return_if_fail (batch != NULL);
+
+  if (batch->n_released > 0) {
+    gst_omx_port_release_buffers (port, batch->released, batch->n_released);
+    batch->n_released = 0;
+  }
+
+  if (batch->next < batch->n_acquired) {
+    g_mutex_lock (&port->lock);
+    while (batch->n_acquired > batch->next)
+      g_queue_push_head (&port->pending_buffers,
+          batch->acquired[--batch->n_acquired]);
+    g_mutex_unlock (&port->lock);
+
+    gst_omx_component_send_message (port->comp, NULL);
+  }
 
-  /* awake gst_omx_port_acquire_buffer() */
-  gst_omx_component_send_message (port->comp, NULL);
+  batch->next = 0;
+  batch->n_acquired = 0;
 }
 
 /* NOTE: Uses comp->lock and comp->messages_lock */
@@ -3136,6 +4828,8 @@ gst_omx_port_populate_unlocked (GstOMXPort * port)
 
   gst_omx_component_handle_messages (comp);
 
+  g_mutex_lock (&port->lock);
+
   if (port->flushing || port->disabled_pending || !port->port_def.bEnabled) {
     GST_DEBUG_OBJECT (comp->parent, "%s port %u is flushing or disabled",
         comp->name, port->index);
@@ -3161,7 +4855,11 @@ gst_omx_port_populate_unlocked (GstOMXPort * port)
        */
       gst_omx_buffer_reset (buf);
 
-      log_omx_api_trace_buffer (comp, "FillThisBuffer", buf);
+      buf->submit_time = gst_util_get_timestamp ();
+      port->stats.n_submitted++;
+
+      log_omx_api_trace_buffer (comp, GST_OMX_TRACE_FILL_THIS_BUFFER,
+          "FillThisBuffer", buf);
       err = OMX_FillThisBuffer (comp->handle, buf->omx_buf);
 
       if (err != OMX_ErrorNone) {
@@ -3177,6 +4875,8 @@ gst_omx_port_populate_unlocked (GstOMXPort * port)
   }
 
 done:
+  g_mutex_unlock (&port->lock);
+
   gst_omx_port_update_port_definition (port, NULL);
 
   DEBUG_IF_OK (comp->parent, err, "Populated %s port %u: %s (0x%08x)",
@@ -3201,6 +4901,20 @@ gst_omx_port_populate (GstOMXPort * port)
   return err;
 }
 
+/* NOTE: Must be called while holding comp->lock, uses port->lock */
+static gboolean
+gst_omx_port_is_enabling (GstOMXPort * port, gboolean enabled)
+{
+  gboolean ret;
+
+  g_mutex_lock (&port->lock);
+  ret = ! !port->port_def.bEnabled != ! !enabled || port->enabled_pending
+      || port->disabled_pending;
+  g_mutex_unlock (&port->lock);
+
+  return ret;
+}
+
 /* NOTE: Must be called while holding comp->lock, uses comp->messages_lock */
 static OMX_ERRORTYPE
 gst_omx_port_wait_enabled_unlocked (GstOMXPort * port, GstClockTime timeout)
@@ -3210,18 +4924,21 @@ gst_omx_port_wait_enabled_unlocked (GstOMXPort * port, GstClockTime timeout)
   gboolean signalled;
   OMX_ERRORTYPE last_error;
   gboolean enabled;
+  gint seq;
 
   comp = port->comp;
 
   /* Check the current port status */
   gst_omx_port_update_port_definition (port, NULL);
 
+  g_mutex_lock (&port->lock);
   if (port->enabled_pending)
     enabled = TRUE;
   else if (port->disabled_pending)
     enabled = FALSE;
   else
     enabled = port->port_def.bEnabled;
+  g_mutex_unlock (&port->lock);
 
   gst_omx_component_handle_messages (comp);
 
@@ -3245,17 +4962,20 @@ gst_omx_port_wait_enabled_unlocked (GstOMXPort * port, GstClockTime timeout)
   last_error = OMX_ErrorNone;
   gst_omx_port_update_port_definition (port, NULL);
   gst_omx_component_handle_messages (comp);
+  seq = gst_omx_component_get_wake_seq (comp);
   while (signalled && last_error == OMX_ErrorNone &&
-      (! !port->port_def.bEnabled != ! !enabled || port->enabled_pending
-          || port->disabled_pending)) {
-    signalled = gst_omx_component_wait_message (comp, timeout);
+      gst_omx_port_is_enabling (port, enabled)) {
+    signalled = gst_omx_component_wait_message (comp, seq, timeout);
     if (signalled)
       gst_omx_component_handle_messages (comp);
     last_error = comp->last_error;
+    seq = gst_omx_component_get_wake_seq (comp);
     gst_omx_port_update_port_definition (port, NULL);
   }
+  g_mutex_lock (&port->lock);
   port->enabled_pending = FALSE;
   port->disabled_pending = FALSE;
+  g_mutex_unlock (&port->lock);
 
   if (!signalled) {
     GST_ERROR_OBJECT (comp->parent,
@@ -3272,7 +4992,9 @@ gst_omx_port_wait_enabled_unlocked (GstOMXPort * port, GstClockTime timeout)
   } else {
     if (enabled) {
       /* Reset EOS flag */
+      g_mutex_lock (&port->lock);
       port->eos = FALSE;
+      g_mutex_unlock (&port->lock);
     }
   }
 
@@ -3339,15 +5061,18 @@ gst_omx_port_mark_reconfigured (GstOMXPort * port)
   if ((err = comp->last_error) != OMX_ErrorNone)
     goto done;
 
+  g_mutex_lock (&port->lock);
   port->configured_settings_cookie = port->settings_cookie;
+  port->stats.n_reconfigures++;
+  g_mutex_unlock (&port->lock);
 
   if (port->port_def.eDir == OMX_DirOutput) {
     GList *l;
 
     for (l = comp->pending_reconfigure_outports; l; l = l->next) {
       if (l->data == (gpointer) port) {
-        comp->pending_reconfigure_outports =
-            g_list_delete_link (comp->pending_reconfigure_outports, l);
+        g_atomic_pointer_set (&comp->pending_reconfigure_outports,
+            g_list_delete_link (comp->pending_reconfigure_outports, l));
         break;
       }
     }
@@ -3833,6 +5558,10 @@ gst_omx_parse_hacks (gchar ** hacks)
       hacks_flags |= GST_OMX_HACK_PASS_COLOR_FORMAT_TO_DECODER;
     else if (g_str_equal (*hacks, "ensure-buffer-count-actual"))
       hacks_flags |= GST_OMX_HACK_ENSURE_BUFFER_COUNT_ACTUAL;
+    else if (g_str_equal (*hacks, "flush-requires-pause"))
+      hacks_flags |= GST_OMX_HACK_FLUSH_REQUIRES_PAUSE;
+    else if (g_str_equal (*hacks, "no-decode-only"))
+      hacks_flags |= GST_OMX_HACK_NO_DECODE_ONLY;
     else
       GST_WARNING ("Unknown hack: %s", *hacks);
     hacks++;
@@ -3850,11 +5579,27 @@ gst_omx_set_default_role (GstOMXClassData * class_data,
     class_data->component_role = default_role;
 }
 
+/* Finds the GstOMXClassData of g_class */
+static GstOMXClassData *
+gst_omx_get_class_data (gpointer g_class)
+{
+  int i;
+
+  for (i = 0; i < G_N_ELEMENTS (base_types); i++) {
+    GType gtype = base_types[i].get_type ();
+
+    if (G_TYPE_CHECK_CLASS_TYPE (g_class, gtype))
+      return (GstOMXClassData *) (((guint8 *) g_class) + base_types[i].offset);
+  }
+
+  return NULL;
+}
+
 static void
 _class_init (gpointer g_class, gpointer data)
 {
   GstElementClass *element_class = GST_ELEMENT_CLASS (g_class);
-  GstOMXClassData *class_data = NULL;
+  GstOMXClassData *class_data;
   GKeyFile *config;
   const gchar *element_name = data;
   GError *err;
@@ -3864,22 +5609,11 @@ _class_init (gpointer g_class, gpointer data)
   GstPadTemplate *templ;
   GstCaps *caps;
   gchar **hacks;
-  int i;
 
   if (!element_name)
     return;
 
-  /* Find the GstOMXClassData for this class */
-  for (i = 0; i < G_N_ELEMENTS (base_types); i++) {
-    GType gtype = base_types[i].get_type ();
-
-    if (G_TYPE_CHECK_CLASS_TYPE (g_class, gtype)) {
-      class_data = (GstOMXClassData *)
-          (((guint8 *) g_class) + base_types[i].offset);
-      break;
-    }
-  }
-
+  class_data = gst_omx_get_class_data (g_class);
   g_assert (class_data != NULL);
 
   config = gst_omx_get_configuration ();
@@ -3893,6 +5627,9 @@ _class_init (gpointer g_class, gpointer data)
   g_assert (component_name != NULL);
   class_data->component_name = component_name;
 
+  class_data->core_preload =
+      g_key_file_get_boolean (config, element_name, "core-preload", NULL);
+
   /* If this fails we simply don't set a role */
   if ((component_role =
           g_key_file_get_string (config, element_name, "component-role",
@@ -3999,6 +5736,26 @@ _class_init (gpointer g_class, gpointer data)
   }
 }
 
+static void
+_instance_init (GTypeInstance * instance, gpointer g_class)
+{
+  GstOMXClassData *class_data = gst_omx_get_class_data (g_class);
+
+  /* Not done from plugin_init, which also runs when only scanning the
+   * plugin, but as soon as the first element using the core exists */
+  if (class_data && class_data->core_preload)
+    gst_omx_core_preload (class_data->core_name);
+}
+
+/* Called when the plugin is unloaded from gst_deinit() */
+static void
+gst_omx_plugin_unload (gpointer user_data)
+{
+  /* The cached components keep their cores loaded too */
+  gst_omx_component_cache_clear ();
+  gst_omx_core_unload_preloaded ();
+}
+
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
@@ -4020,6 +5777,8 @@ plugin_init (GstPlugin * plugin)
   GST_DEBUG_CATEGORY_INIT (OMX_API_TRACE, "OMX_API_TRACE", 0,
       "gst-omx performace");
 
+  gst_omx_trace_init ();
+
   /* Read configuration file gstomx.conf from the preferred
    * configuration directories */
   env_config_dir = g_strdup (g_getenv (*env_config_name));
@@ -4066,6 +5825,13 @@ plugin_init (GstPlugin * plugin)
     goto done;
   }
 
+  gst_omx_component_cache_configure (config);
+
+  /* Everything still loaded is unloaded together with the plugin */
+  g_object_set_qdata_full (G_OBJECT (plugin),
+      g_quark_from_static_string ("gst-omx-unload"), GINT_TO_POINTER (TRUE),
+      gst_omx_plugin_unload);
+
   /* Initialize all types */
   for (i = 0; i < G_N_ELEMENTS (types); i++)
     types[i] ();
@@ -4078,6 +5844,10 @@ plugin_init (GstPlugin * plugin)
     gchar *type_name, *core_name, *component_name;
     gint rank;
 
+    /* Global settings, not an element */
+    if (g_str_equal (elements[i], GST_OMX_COMPONENT_CACHE_GROUP))
+      continue;
+
     GST_DEBUG ("Registering element '%s'", elements[i]);
 
     err = NULL;
@@ -4151,6 +5921,7 @@ plugin_init (GstPlugin * plugin)
     type_info.instance_size = type_query.instance_size;
     type_info.class_init = _class_init;
     type_info.class_data = g_strdup (elements[i]);
+    type_info.instance_init = _instance_init;
     type_name = g_strdup_printf ("%s-%s", g_type_name (type), elements[i]);
     if (g_type_from_name (type_name) != G_TYPE_INVALID) {
       GST_ERROR ("Type '%s' already exists for element '%s'", type_name,
@@ -123,6 +123,9 @@ G_BEGIN_DECLS
  * retrieved from OMX yet. */
 #define GST_OMX_PROP_OMX_DEFAULT G_MAXUINT32
 
+/* Default of the "stats-interval" property of all elements, disabled */
+#define GST_OMX_STATS_INTERVAL_DEFAULT (0)
+
 /* OMX_StateInvalid does not exist in 1.2.0 spec. The initial state is now
  * StateLoaded. Problem is that gst-omx still needs an initial state different
  * than StateLoaded. Otherwise gst_omx_component_set_state(StateLoaded) will
@@ -207,6 +210,16 @@ G_BEGIN_DECLS
  */
 #define GST_OMX_HACK_ENSURE_BUFFER_COUNT_ACTUAL          G_GUINT64_CONSTANT (0x0000000000002000)
 
+/* If the component has to be paused to flush its ports, and can't flush
+ * them all at once while executing.
+ */
+#define GST_OMX_HACK_FLUSH_REQUIRES_PAUSE                G_GUINT64_CONSTANT (0x0000000000004000)
+
+/* If the component doesn't use buffers with OMX_BUFFERFLAG_DECODEONLY for
+ * reference, or fails to decode them.
+ */
+#define GST_OMX_HACK_NO_DECODE_ONLY                      G_GUINT64_CONSTANT (0x0000000000008000)
+
 typedef struct _GstOMXCore GstOMXCore;
 typedef struct _GstOMXPort GstOMXPort;
 typedef enum _GstOMXPortDirection GstOMXPortDirection;
@@ -214,6 +227,10 @@ typedef struct _GstOMXComponent GstOMXComponent;
 typedef struct _GstOMXBuffer GstOMXBuffer;
 typedef struct _GstOMXClassData GstOMXClassData;
 typedef struct _GstOMXMessage GstOMXMessage;
+typedef struct _GstOMXMessageSlot GstOMXMessageSlot;
+typedef struct _GstOMXMessageRing GstOMXMessageRing;
+typedef struct _GstOMXBufferBatch GstOMXBufferBatch;
+typedef struct _GstOMXPortStats GstOMXPortStats;
 
 typedef enum {
   /* Everything good and the buffer is valid */
@@ -231,14 +248,21 @@ typedef enum {
 } GstOMXAcquireBufferReturn;
 
 struct _GstOMXCore {
-  /* Handle to the OpenMAX IL core shared library */
+  /* Handle to the OpenMAX IL core shared library,
+   * NULL until the core was loaded. LOCK */
   GModule *module;
 
   /* Current number of users, transitions from/to 0
-   * call init/deinit */
+   * call init/deinit. Held while loading and initialising */
   GMutex lock;
   gint user_count; /* LOCK */
 
+  /* Whether preloading was started, and whether it holds one
+   * reference until the plugin is unloaded. Protected by the
+   * global core_handles lock */
+  gboolean preload_started;
+  gboolean preloaded;
+
   /* OpenMAX core library functions, protected with LOCK */
   OMX_ERRORTYPE (*init) (void);
   OMX_ERRORTYPE (*deinit) (void);
@@ -255,9 +279,17 @@ typedef enum {
   GST_OMX_MESSAGE_PORT_ENABLE,
   GST_OMX_MESSAGE_PORT_SETTINGS_CHANGED,
   GST_OMX_MESSAGE_BUFFER_FLAG,
-  GST_OMX_MESSAGE_BUFFER_DONE,
 } GstOMXMessageType;
 
+/* What the component did with a buffer it returned */
+typedef enum {
+  GST_OMX_BUFFER_DONE_NONE,
+  GST_OMX_BUFFER_DONE_EMPTIED,
+  GST_OMX_BUFFER_DONE_FILLED,
+  /* Released by the pool managing the buffers of the port */
+  GST_OMX_BUFFER_DONE_REQUEUED,
+} GstOMXBufferDoneState;
+
 typedef enum {
   GST_OMX_COMPONENT_TYPE_SINK,
   GST_OMX_COMPONENT_TYPE_SOURCE,
@@ -300,22 +332,82 @@ struct _GstOMXMessage {
       OMX_U32 port;
       OMX_U32 flags;
     } buffer_flag;
-    struct {
-      OMX_HANDLETYPE component;
-      OMX_PTR app_data;
-      OMX_BUFFERHEADERTYPE *buffer;
-      OMX_BOOL empty;
-    } buffer_done;
   } content;
 };
 
+/* One entry of the component's message ring. seq is the sequence
+ * number of the ring position this slot can currently be written
+ * (seq == pos) or read (seq == pos + 1) at. */
+struct _GstOMXMessageSlot {
+  gint seq;
+  GstOMXMessage msg;
+};
+
+/* Bounded multi-producer/single-consumer ring the OMX callbacks post
+ * their messages to without locking or allocating. Producers claim
+ * slots by atomically advancing tail, the consumer reads them from head.
+ *
+ * Messages that did not fit are queued in overflow, protected by the
+ * component's messages_lock. As long as it is not empty all new messages
+ * are queued there too to keep their order. */
+struct _GstOMXMessageRing {
+  GstOMXMessageSlot *slots;
+  guint size; /* Power of two */
+  gint head; /* atomic, only changed by the consumer */
+  gint tail; /* atomic */
+
+  GQueue overflow; /* Queue of GstOMXMessages */
+  gint n_overflow; /* atomic */
+};
+
+/* Number of buckets of the in-component residency histogram. Bucket i
+ * counts buffers the component kept for less than 2^i ms, the last
+ * bucket all buffers kept longer */
+#define GST_OMX_PORT_STATS_HISTOGRAM_SIZE 8
+
+/* Runtime statistics of a port, all times in nanoseconds */
+struct _GstOMXPortStats {
+  guint64 n_submitted; /* {Empty,Fill}ThisBuffer calls */
+  guint64 n_returned;  /* Buffers given back by the component */
+  guint64 n_flushes;
+  guint64 n_reconfigures;
+  /* Time spent waiting in gst_omx_port_acquire_buffer() */
+  GstClockTime acquire_wait_time;
+  /* Time between submitting a buffer and getting it back */
+  GstClockTime residency_min, residency_max, residency_total;
+  guint64 residency_histogram[GST_OMX_PORT_STATS_HISTOGRAM_SIZE];
+};
+
 struct _GstOMXPort {
   GstOMXComponent *comp;
   guint32 index;
 
   gboolean tunneled;
 
+  /* Protects port_def, pending_buffers, the flags and settings cookies
+   * below and the used flag of the port's buffers. These are used by
+   * gst_omx_port_acquire_buffer() and gst_omx_port_release_buffer(),
+   * which only take this lock unless component events are pending.
+   *
+   * Locking order: comp->lock -> lock -> comp->messages_lock */
+  GMutex lock;
+
+  /* Buffers returned by the component and not handled yet, linked
+   * in reverse order through their done_next. Pushed to lock-free by
+   * the OMX callbacks, taken as a whole with lock held */
+  GstOMXBuffer *done_head; /* atomic */
+  /* Signalled with comp->messages_lock for messages of this port
+   * and all component events */
+  GCond cond;
+  gint n_waiters; /* atomic */
+
   OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  /* port_def is only queried from the component again if these differ.
+   * port_def_cookie is increased when the port settings changed, a
+   * parameter or configuration of the port, of an input port or of the
+   * whole component was set or the port was enabled/disabled */
+  gint port_def_cookie;
+  gint cached_port_def_cookie;
   GPtrArray *buffers; /* Contains GstOMXBuffer* */
   GQueue pending_buffers; /* Contains GstOMXBuffer* */
   gboolean flushing;
@@ -332,6 +424,13 @@ struct _GstOMXPort {
    */
   gint settings_cookie;
   gint configured_settings_cookie;
+
+  /* Buffers allocated by the component are at least this big, e.g. to
+   * keep fitting the port settings when the resolution of a stream
+   * changes. Protected by comp->lock */
+  guint32 min_buffer_size;
+
+  GstOMXPortStats stats; /* lock */
 };
 
 struct _GstOMXComponent {
@@ -350,23 +449,47 @@ struct _GstOMXComponent {
   GPtrArray *ports; /* Contains GstOMXPort* */
   gint n_in_ports, n_out_ports;
 
-  /* Locking order: lock -> messages_lock
+  /* Locking order: lock -> port->lock -> messages_lock
    *
    * Never hold lock while waiting for messages_cond
-   * Always check that messages is empty before waiting */
+   * Always check that no message is pending before waiting */
   GMutex lock;
 
-  GQueue messages; /* Queue of GstOMXMessages */
+  /* Component events, consumed with lock held. Buffer completions
+   * are linked into the done list of their port */
+  GstOMXMessageRing ring;
+
   GMutex messages_lock;
   GCond messages_cond;
+  /* Number of threads waiting on messages_cond. Producers only take
+   * messages_lock to signal if this is not zero */
+  gint n_waiters; /* atomic */
+  /* Increased whenever something waiters could wait for changed, like a
+   * message posted or handled. Waiters read it before checking their
+   * condition and don't sleep if it changed since */
+  gint wake_seq; /* atomic */
 
   OMX_STATETYPE state;
   /* OMX_StateInvalid if no pending state */
   OMX_STATETYPE pending_state;
-  /* OMX_ErrorNone usually, if different nothing will work */
+  /* OMX_ErrorNone usually, if different nothing will work.
+   * Written with lock, can be read atomically without */
   OMX_ERRORTYPE last_error;
 
+  /* Changed with lock, can be checked for NULL atomically without */
   GList *pending_reconfigure_outports;
+
+  /* Interval for posting the stats as element messages, 0 if disabled.
+   * Protected by messages_lock */
+  GstClockTime stats_interval;
+  GstClockTime stats_last_posted;
+
+  /* Used by the component cache to match and expire released
+   * components, protected by the cache lock */
+  gchar *component_name;
+  gchar *component_role;
+  gboolean cached;
+  GstClockTime release_time;
 };
 
 struct _GstOMXBuffer {
@@ -392,6 +515,34 @@ struct _GstOMXBuffer {
   GstBuffer *input_buffer;
   gboolean input_buffer_mapped;
   GstMapInfo map;
+
+  /* When the buffer was last passed to the component, for the stats */
+  GstClockTime submit_time;
+
+  /* Completion slot, set by the OMX callbacks until the buffer is
+   * moved from the port's done list to pending_buffers */
+  GstOMXBuffer *done_next;
+  GstOMXBufferDoneState done_state;
+};
+
+/* Maximum number of buffers moved per port lock round-trip by a
+ * GstOMXBufferBatch */
+#define GST_OMX_BUFFER_BATCH_SIZE 8
+
+/* Buffers acquired from or to be released to a port in one go but
+ * processed one by one by the streaming thread. Only accessed by that
+ * thread, initialize with zeros. */
+struct _GstOMXBufferBatch {
+  /* Number of buffers batched at most, limited to the buffers the port
+   * has beyond nBufferCountMin. Updated when acquiring */
+  guint size;
+
+  GstOMXBuffer *acquired[GST_OMX_BUFFER_BATCH_SIZE];
+  guint n_acquired;
+  guint next; /* Next acquired buffer to hand out */
+
+  GstOMXBuffer *released[GST_OMX_BUFFER_BATCH_SIZE];
+  guint n_released;
 };
 
 struct _GstOMXClassData {
@@ -406,6 +557,9 @@ struct _GstOMXClassData {
 
   guint64 hacks;
 
+  /* Whether the core is initialised when the first element exists */
+  gboolean core_preload;
+
   GstOmxComponentType type;
 };
 
@@ -429,10 +583,17 @@ void              gst_omx_component_unref (GstOMXComponent * comp);
 
 OMX_ERRORTYPE     gst_omx_component_set_state (GstOMXComponent * comp, OMX_STATETYPE state);
 OMX_STATETYPE     gst_omx_component_get_state (GstOMXComponent * comp, GstClockTime timeout);
+gboolean          gst_omx_components_wait_state (GstOMXComponent ** comps, guint n_comps, GstClockTime timeout);
+OMX_ERRORTYPE     gst_omx_component_set_flushing (GstOMXComponent * comp, GstClockTime timeout, gboolean flush);
 
 OMX_ERRORTYPE     gst_omx_component_get_last_error (GstOMXComponent * comp);
 const gchar *     gst_omx_component_get_last_error_string (GstOMXComponent * comp);
 
+GstStructure *    gst_omx_component_get_stats (GstOMXComponent * comp);
+void              gst_omx_component_set_stats_interval (GstOMXComponent * comp, GstClockTime interval);
+void              gst_omx_install_stats_properties (GObjectClass * gobject_class, guint stats_prop_id, guint stats_interval_prop_id);
+void              gst_omx_get_stats_property (GstObject * element, GstOMXComponent ** comp, GValue * value);
+
 GstOMXPort *      gst_omx_component_add_port (GstOMXComponent * comp, guint32 index);
 GstOMXPort *      gst_omx_component_get_port (GstOMXComponent * comp, guint32 index);
 
@@ -441,6 +602,7 @@ OMX_ERRORTYPE     gst_omx_component_set_parameter (GstOMXComponent * comp, OMX_I
 
 OMX_ERRORTYPE     gst_omx_component_get_config (GstOMXComponent * comp, OMX_INDEXTYPE index, gpointer config);
 OMX_ERRORTYPE     gst_omx_component_set_config (GstOMXComponent * comp, OMX_INDEXTYPE index, gpointer config);
+OMX_ERRORTYPE     gst_omx_component_get_extension_index (GstOMXComponent * comp, const gchar * name, OMX_INDEXTYPE * index);
 
 OMX_ERRORTYPE     gst_omx_setup_tunnel (GstOMXPort * port1, GstOMXPort * port2);
 OMX_ERRORTYPE     gst_omx_close_tunnel (GstOMXPort * port1, GstOMXPort * port2);
@@ -451,6 +613,8 @@ OMX_ERRORTYPE     gst_omx_port_update_port_definition (GstOMXPort *port, OMX_PAR
 
 GstOMXAcquireBufferReturn gst_omx_port_acquire_buffer (GstOMXPort *port, GstOMXBuffer **buf, GstOMXWait wait);
 OMX_ERRORTYPE     gst_omx_port_release_buffer (GstOMXPort *port, GstOMXBuffer *buf);
+GstOMXAcquireBufferReturn gst_omx_port_acquire_buffers (GstOMXPort *port, GstOMXBuffer **bufs, guint max_bufs, guint *n_bufs, GstOMXWait wait);
+OMX_ERRORTYPE     gst_omx_port_release_buffers (GstOMXPort *port, GstOMXBuffer **bufs, guint n_bufs);
 
 OMX_ERRORTYPE     gst_omx_port_set_flushing (GstOMXPort *port, GstClockTime timeout, gboolean flush);
 gboolean          gst_omx_port_is_flushing (GstOMXPort *port);
@@ -459,12 +623,19 @@ OMX_ERRORTYPE     gst_omx_port_allocate_buffers (GstOMXPort *port);
 OMX_ERRORTYPE     gst_omx_port_use_buffers (GstOMXPort *port, const GList *buffers);
 OMX_ERRORTYPE     gst_omx_port_use_eglimages (GstOMXPort *port, const GList *images);
 OMX_ERRORTYPE     gst_omx_port_deallocate_buffers (GstOMXPort *port);
+void              gst_omx_port_set_min_buffer_size (GstOMXPort *port, guint32 size);
+gboolean          gst_omx_port_can_reuse_buffers (GstOMXPort *port);
 OMX_ERRORTYPE     gst_omx_port_populate (GstOMXPort *port);
 OMX_ERRORTYPE     gst_omx_port_wait_buffers_released (GstOMXPort * port, GstClockTime timeout);
 void              gst_omx_port_requeue_buffer (GstOMXPort * port, GstOMXBuffer * buf);
+GstOMXAcquireBufferReturn gst_omx_port_acquire_batched_buffer (GstOMXPort * port, GstOMXBufferBatch * batch, GstOMXBuffer ** buf, GstOMXWait wait);
+OMX_ERRORTYPE     gst_omx_port_release_batched_buffer (GstOMXPort * port, GstOMXBufferBatch * batch, GstOMXBuffer * buf);
+void              gst_omx_port_return_batched_buffers (GstOMXPort * port, GstOMXBufferBatch * batch);
 
 OMX_ERRORTYPE     gst_omx_port_mark_reconfigured (GstOMXPort * port);
 
+GstStructure *    gst_omx_port_get_stats (GstOMXPort * port);
+
 OMX_ERRORTYPE     gst_omx_port_set_enabled (GstOMXPort * port, gboolean enabled);
 OMX_ERRORTYPE     gst_omx_port_wait_enabled (GstOMXPort * port, GstClockTime timeout);
 gboolean          gst_omx_port_is_enabled (GstOMXPort * port);
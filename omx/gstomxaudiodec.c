@@ -54,7 +54,9 @@ static GstFlowReturn gst_omx_audio_dec_drain (GstOMXAudioDec * self);
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_STATS,
+  PROP_STATS_INTERVAL,
 };
 
 /* class initialization */
@@ -67,6 +69,41 @@ enum
 G_DEFINE_ABSTRACT_TYPE_WITH_CODE (GstOMXAudioDec, gst_omx_audio_dec,
     GST_TYPE_AUDIO_DECODER, DEBUG_INIT);
 
+static void
+gst_omx_audio_dec_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstOMXAudioDec *self = GST_OMX_AUDIO_DEC (object);
+
+  switch (prop_id) {
+    case PROP_STATS_INTERVAL:
+      self->stats_interval = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_omx_audio_dec_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstOMXAudioDec *self = GST_OMX_AUDIO_DEC (object);
+
+  switch (prop_id) {
+    case PROP_STATS:
+      gst_omx_get_stats_property (GST_OBJECT (self), &self->dec, value);
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, self->stats_interval);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_omx_audio_dec_class_init (GstOMXAudioDecClass * klass)
 {
@@ -75,6 +112,11 @@ gst_omx_audio_dec_class_init (GstOMXAudioDecClass * klass)
   GstAudioDecoderClass *audio_decoder_class = GST_AUDIO_DECODER_CLASS (klass);
 
   gobject_class->finalize = gst_omx_audio_dec_finalize;
+  gobject_class->set_property = gst_omx_audio_dec_set_property;
+  gobject_class->get_property = gst_omx_audio_dec_get_property;
+
+  gst_omx_install_stats_properties (gobject_class, PROP_STATS,
+      PROP_STATS_INTERVAL);
 
   element_class->change_state =
       GST_DEBUG_FUNCPTR (gst_omx_audio_dec_change_state);
@@ -110,6 +152,8 @@ gst_omx_audio_dec_init (GstOMXAudioDec * self)
   g_cond_init (&self->drain_cond);
 
   self->output_adapter = gst_adapter_new ();
+
+  self->stats_interval = GST_OMX_STATS_INTERVAL_DEFAULT;
 }
 
 static gboolean
@@ -117,19 +161,29 @@ gst_omx_audio_dec_open (GstAudioDecoder * decoder)
 {
   GstOMXAudioDec *self = GST_OMX_AUDIO_DEC (decoder);
   GstOMXAudioDecClass *klass = GST_OMX_AUDIO_DEC_GET_CLASS (self);
+  GstOMXComponent *dec;
+  GstOMXPort *in_port, *out_port;
   gint in_port_index, out_port_index;
 
   GST_DEBUG_OBJECT (self, "Opening decoder");
 
-  self->dec =
+  dec =
       gst_omx_component_new (GST_OBJECT_CAST (self), klass->cdata.core_name,
       klass->cdata.component_name, klass->cdata.component_role,
       klass->cdata.hacks);
   self->started = FALSE;
 
-  if (!self->dec)
+  if (!dec)
     return FALSE;
 
+  /* The stats property might be read concurrently */
+  GST_OBJECT_LOCK (self);
+  self->dec = dec;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_omx_component_set_stats_interval (self->dec,
+      self->stats_interval * GST_MSECOND);
+
   if (gst_omx_component_get_state (self->dec,
           GST_CLOCK_TIME_NONE) != OMX_StateLoaded)
     return FALSE;
@@ -159,8 +213,12 @@ gst_omx_audio_dec_open (GstAudioDecoder * decoder)
       out_port_index = param.nStartPortNumber + 1;
     }
   }
-  self->dec_in_port = gst_omx_component_add_port (self->dec, in_port_index);
-  self->dec_out_port = gst_omx_component_add_port (self->dec, out_port_index);
+  in_port = gst_omx_component_add_port (self->dec, in_port_index);
+  out_port = gst_omx_component_add_port (self->dec, out_port_index);
+  GST_OBJECT_LOCK (self);
+  self->dec_in_port = in_port;
+  self->dec_out_port = out_port;
+  GST_OBJECT_UNLOCK (self);
 
   if (!self->dec_in_port || !self->dec_out_port)
     return FALSE;
@@ -197,17 +255,22 @@ static gboolean
 gst_omx_audio_dec_close (GstAudioDecoder * decoder)
 {
   GstOMXAudioDec *self = GST_OMX_AUDIO_DEC (decoder);
+  GstOMXComponent *dec;
 
   GST_DEBUG_OBJECT (self, "Closing decoder");
 
   if (!gst_omx_audio_dec_shutdown (self))
     return FALSE;
 
+  /* The stats property might be read concurrently */
+  GST_OBJECT_LOCK (self);
   self->dec_in_port = NULL;
   self->dec_out_port = NULL;
-  if (self->dec)
-    gst_omx_component_unref (self->dec);
+  dec = self->dec;
   self->dec = NULL;
+  GST_OBJECT_UNLOCK (self);
+  if (dec)
+    gst_omx_component_unref (dec);
 
   self->started = FALSE;
 
@@ -303,7 +366,8 @@ gst_omx_audio_dec_loop (GstOMXAudioDec * self)
   OMX_ERRORTYPE err;
   gint spf;
 
-  acq_return = gst_omx_port_acquire_buffer (port, &buf, GST_OMX_WAIT);
+  acq_return = gst_omx_port_acquire_batched_buffer (port, &self->out_batch,
+      &buf, GST_OMX_WAIT);
   if (acq_return == GST_OMX_ACQUIRE_BUFFER_ERROR) {
     goto component_error;
   } else if (acq_return == GST_OMX_ACQUIRE_BUFFER_FLUSHING) {
@@ -570,7 +634,7 @@ gst_omx_audio_dec_loop (GstOMXAudioDec * self)
   GST_DEBUG_OBJECT (self, "Finished frame: %s", gst_flow_get_name (flow_ret));
 
   if (buf) {
-    err = gst_omx_port_release_buffer (port, buf);
+    err = gst_omx_port_release_batched_buffer (port, &self->out_batch, buf);
     if (err != OMX_ErrorNone)
       goto release_error;
   }
@@ -767,6 +831,8 @@ gst_omx_audio_dec_stop (GstAudioDecoder * decoder)
 
   gst_pad_stop_task (GST_AUDIO_DECODER_SRC_PAD (decoder));
 
+  gst_omx_port_return_batched_buffers (self->dec_out_port, &self->out_batch);
+
   if (gst_omx_component_get_state (self->dec, 0) > OMX_StateIdle)
     gst_omx_component_set_state (self->dec, OMX_StateIdle);
 
@@ -1014,6 +1080,8 @@ gst_omx_audio_dec_flush (GstAudioDecoder * decoder, gboolean hard)
   GST_DEBUG_OBJECT (self, "Flushing -- task stopped");
   GST_AUDIO_DECODER_STREAM_LOCK (self);
 
+  gst_omx_port_return_batched_buffers (self->dec_out_port, &self->out_batch);
+
   /* 3) Resume components */
   gst_omx_component_set_state (self->dec, OMX_StateExecuting);
   gst_omx_component_get_state (self->dec, GST_CLOCK_TIME_NONE);
@@ -79,6 +79,13 @@ struct _GstOMXAudioDec
   GstAdapter *output_adapter;
 
   GstFlowReturn downstream_flow_ret;
+
+  /* properties */
+  guint stats_interval;
+
+  /* Output buffers acquired from the component in one go, only used
+   * by the srcpad loop while it is running */
+  GstOMXBufferBatch out_batch;
 };
 
 struct _GstOMXAudioDecClass
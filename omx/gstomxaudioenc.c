@@ -51,7 +51,9 @@ static GstFlowReturn gst_omx_audio_enc_drain (GstOMXAudioEnc * self);
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_STATS,
+  PROP_STATS_INTERVAL,
 };
 
 /* class initialization */
@@ -65,6 +67,41 @@ enum
 G_DEFINE_ABSTRACT_TYPE_WITH_CODE (GstOMXAudioEnc, gst_omx_audio_enc,
     GST_TYPE_AUDIO_ENCODER, do_init);
 
+static void
+gst_omx_audio_enc_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstOMXAudioEnc *self = GST_OMX_AUDIO_ENC (object);
+
+  switch (prop_id) {
+    case PROP_STATS_INTERVAL:
+      self->stats_interval = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_omx_audio_enc_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstOMXAudioEnc *self = GST_OMX_AUDIO_ENC (object);
+
+  switch (prop_id) {
+    case PROP_STATS:
+      gst_omx_get_stats_property (GST_OBJECT (self), &self->enc, value);
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, self->stats_interval);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_omx_audio_enc_class_init (GstOMXAudioEncClass * klass)
 {
@@ -73,6 +110,11 @@ gst_omx_audio_enc_class_init (GstOMXAudioEncClass * klass)
   GstAudioEncoderClass *audio_encoder_class = GST_AUDIO_ENCODER_CLASS (klass);
 
   gobject_class->finalize = gst_omx_audio_enc_finalize;
+  gobject_class->set_property = gst_omx_audio_enc_set_property;
+  gobject_class->get_property = gst_omx_audio_enc_get_property;
+
+  gst_omx_install_stats_properties (gobject_class, PROP_STATS,
+      PROP_STATS_INTERVAL);
 
   element_class->change_state =
       GST_DEBUG_FUNCPTR (gst_omx_audio_enc_change_state);
@@ -100,6 +142,8 @@ gst_omx_audio_enc_init (GstOMXAudioEnc * self)
 {
   g_mutex_init (&self->drain_lock);
   g_cond_init (&self->drain_cond);
+
+  self->stats_interval = GST_OMX_STATS_INTERVAL_DEFAULT;
 }
 
 static gboolean
@@ -107,17 +151,27 @@ gst_omx_audio_enc_open (GstAudioEncoder * encoder)
 {
   GstOMXAudioEnc *self = GST_OMX_AUDIO_ENC (encoder);
   GstOMXAudioEncClass *klass = GST_OMX_AUDIO_ENC_GET_CLASS (self);
+  GstOMXComponent *enc;
+  GstOMXPort *in_port, *out_port;
   gint in_port_index, out_port_index;
 
-  self->enc =
+  enc =
       gst_omx_component_new (GST_OBJECT_CAST (self), klass->cdata.core_name,
       klass->cdata.component_name, klass->cdata.component_role,
       klass->cdata.hacks);
   self->started = FALSE;
 
-  if (!self->enc)
+  if (!enc)
     return FALSE;
 
+  /* The stats property might be read concurrently */
+  GST_OBJECT_LOCK (self);
+  self->enc = enc;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_omx_component_set_stats_interval (self->enc,
+      self->stats_interval * GST_MSECOND);
+
   if (gst_omx_component_get_state (self->enc,
           GST_CLOCK_TIME_NONE) != OMX_StateLoaded)
     return FALSE;
@@ -148,8 +202,12 @@ gst_omx_audio_enc_open (GstAudioEncoder * encoder)
     }
   }
 
-  self->enc_in_port = gst_omx_component_add_port (self->enc, in_port_index);
-  self->enc_out_port = gst_omx_component_add_port (self->enc, out_port_index);
+  in_port = gst_omx_component_add_port (self->enc, in_port_index);
+  out_port = gst_omx_component_add_port (self->enc, out_port_index);
+  GST_OBJECT_LOCK (self);
+  self->enc_in_port = in_port;
+  self->enc_out_port = out_port;
+  GST_OBJECT_UNLOCK (self);
 
   if (!self->enc_in_port || !self->enc_out_port)
     return FALSE;
@@ -185,17 +243,22 @@ static gboolean
 gst_omx_audio_enc_close (GstAudioEncoder * encoder)
 {
   GstOMXAudioEnc *self = GST_OMX_AUDIO_ENC (encoder);
+  GstOMXComponent *enc;
 
   GST_DEBUG_OBJECT (self, "Closing encoder");
 
   if (!gst_omx_audio_enc_shutdown (self))
     return FALSE;
 
+  /* The stats property might be read concurrently */
+  GST_OBJECT_LOCK (self);
   self->enc_in_port = NULL;
   self->enc_out_port = NULL;
-  if (self->enc)
-    gst_omx_component_unref (self->enc);
+  enc = self->enc;
   self->enc = NULL;
+  GST_OBJECT_UNLOCK (self);
+  if (enc)
+    gst_omx_component_unref (enc);
 
   return TRUE;
 }
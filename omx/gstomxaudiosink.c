@@ -48,7 +48,9 @@ enum
 {
   PROP_0,
   PROP_MUTE,
-  PROP_VOLUME
+  PROP_VOLUME,
+  PROP_STATS,
+  PROP_STATS_INTERVAL
 };
 
 #define gst_omx_audio_sink_parent_class parent_class
@@ -250,19 +252,29 @@ gst_omx_audio_sink_open (GstAudioSink * audiosink)
 {
   GstOMXAudioSink *self = GST_OMX_AUDIO_SINK (audiosink);
   GstOMXAudioSinkClass *klass = GST_OMX_AUDIO_SINK_GET_CLASS (self);
+  GstOMXComponent *comp;
+  GstOMXPort *in_port, *out_port;
   gint port_index;
   OMX_ERRORTYPE err;
 
   GST_DEBUG_OBJECT (self, "Opening audio sink");
 
-  self->comp =
+  comp =
       gst_omx_component_new (GST_OBJECT_CAST (self), klass->cdata.core_name,
       klass->cdata.component_name, klass->cdata.component_role,
       klass->cdata.hacks);
 
-  if (!self->comp)
+  if (!comp)
     return FALSE;
 
+  /* The stats property might be read concurrently */
+  GST_OBJECT_LOCK (self);
+  self->comp = comp;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_omx_component_set_stats_interval (self->comp,
+      self->stats_interval * GST_MSECOND);
+
   if (gst_omx_component_get_state (self->comp,
           GST_CLOCK_TIME_NONE) != OMX_StateLoaded)
     return FALSE;
@@ -288,7 +300,7 @@ gst_omx_audio_sink_open (GstAudioSink * audiosink)
       port_index = param.nStartPortNumber + 0;
     }
   }
-  self->in_port = gst_omx_component_add_port (self->comp, port_index);
+  in_port = gst_omx_component_add_port (self->comp, port_index);
 
   port_index = klass->cdata.out_port_index;
 
@@ -311,7 +323,11 @@ gst_omx_audio_sink_open (GstAudioSink * audiosink)
       port_index = param.nStartPortNumber + 1;
     }
   }
-  self->out_port = gst_omx_component_add_port (self->comp, port_index);
+  out_port = gst_omx_component_add_port (self->comp, port_index);
+  GST_OBJECT_LOCK (self);
+  self->in_port = in_port;
+  self->out_port = out_port;
+  GST_OBJECT_UNLOCK (self);
 
   if (!self->in_port || !self->out_port)
     return FALSE;
@@ -339,6 +355,7 @@ static gboolean
 gst_omx_audio_sink_close (GstAudioSink * audiosink)
 {
   GstOMXAudioSink *self = GST_OMX_AUDIO_SINK (audiosink);
+  GstOMXComponent *comp;
   OMX_STATETYPE state;
 
   GST_DEBUG_OBJECT (self, "Closing audio sink");
@@ -350,16 +367,21 @@ gst_omx_audio_sink_close (GstAudioSink * audiosink)
       gst_omx_component_get_state (self->comp, 5 * GST_SECOND);
     }
     gst_omx_component_set_state (self->comp, OMX_StateLoaded);
+    gst_omx_port_return_batched_buffers (self->in_port, &self->in_batch);
     gst_omx_port_deallocate_buffers (self->in_port);
     if (state > OMX_StateLoaded)
       gst_omx_component_get_state (self->comp, 5 * GST_SECOND);
   }
 
+  /* The stats property might be read concurrently */
+  GST_OBJECT_LOCK (self);
   self->in_port = NULL;
   self->out_port = NULL;
-  if (self->comp)
-    gst_omx_component_unref (self->comp);
+  comp = self->comp;
   self->comp = NULL;
+  GST_OBJECT_UNLOCK (self);
+  if (comp)
+    gst_omx_component_unref (comp);
 
   GST_DEBUG_OBJECT (self, "Closed audio sink");
 
@@ -724,6 +746,10 @@ gst_omx_audio_sink_unprepare (GstAudioSink * audiosink)
     goto failed;
   }
 
+  GST_OMX_AUDIO_SINK_LOCK (self);
+  gst_omx_port_return_batched_buffers (self->in_port, &self->in_batch);
+  GST_OMX_AUDIO_SINK_UNLOCK (self);
+
   err = gst_omx_port_deallocate_buffers (self->in_port);
   if (err != OMX_ErrorNone) {
     GST_ERROR_OBJECT (self, "Couldn't deallocate buffers: %s (0x%08x)",
@@ -760,7 +786,8 @@ gst_omx_audio_sink_acquire_buffer (GstOMXAudioSink * self)
   GstOMXBuffer *buf = NULL;
 
   while (!buf) {
-    acq_ret = gst_omx_port_acquire_buffer (port, &buf, GST_OMX_WAIT);
+    acq_ret = gst_omx_port_acquire_batched_buffer (port, &self->in_batch,
+        &buf, GST_OMX_WAIT);
     if (acq_ret == GST_OMX_ACQUIRE_BUFFER_ERROR) {
       goto component_error;
     } else if (acq_ret == GST_OMX_ACQUIRE_BUFFER_FLUSHING) {
@@ -928,6 +955,7 @@ gst_omx_audio_sink_reset (GstAudioSink * audiosink)
   gst_omx_component_set_state (self->comp, state);
   gst_omx_component_get_state (self->comp, GST_CLOCK_TIME_NONE);
 
+  gst_omx_port_return_batched_buffers (self->in_port, &self->in_batch);
   gst_omx_port_set_flushing (self->in_port, 5 * GST_SECOND, FALSE);
 
   GST_OMX_AUDIO_SINK_UNLOCK (self);
@@ -1074,6 +1102,9 @@ gst_omx_audio_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (self);
       break;
     }
+    case PROP_STATS_INTERVAL:
+      self->stats_interval = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1097,6 +1128,12 @@ gst_omx_audio_sink_get_property (GObject * object, guint prop_id,
       g_value_set_double (value, self->volume);
       GST_OBJECT_UNLOCK (self);
       break;
+    case PROP_STATS:
+      gst_omx_get_stats_property (GST_OBJECT (self), &self->comp, value);
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, self->stats_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1192,6 +1229,9 @@ gst_omx_audio_sink_class_init (GstOMXAudioSinkClass * klass)
           0.0, VOLUME_MAX_DOUBLE, DEFAULT_PROP_VOLUME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  gst_omx_install_stats_properties (gobject_class, PROP_STATS,
+      PROP_STATS_INTERVAL);
+
   element_class->change_state =
       GST_DEBUG_FUNCPTR (gst_omx_audio_sink_change_state);
 
@@ -1218,6 +1258,7 @@ gst_omx_audio_sink_init (GstOMXAudioSink * self)
 
   self->mute = DEFAULT_PROP_MUTE;
   self->volume = DEFAULT_PROP_VOLUME;
+  self->stats_interval = GST_OMX_STATS_INTERVAL_DEFAULT;
 
   /* For the Raspberry PI there's a big hw buffer and 400 ms seems a good
    * size for our ringbuffer. OpenSL ES Sink also allocates a buffer of 400 ms
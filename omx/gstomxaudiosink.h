@@ -84,6 +84,12 @@ struct _GstOMXAudioSink
   guint buffer_size;
   guint samples;
 
+  guint stats_interval;
+
+  /* Input buffers acquired from the component in one go,
+   * protected by lock */
+  GstOMXBufferBatch in_batch;
+
   GMutex lock;
 };
 
@@ -25,6 +25,8 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
 #include "gstomxbufferpool.h"
 #include "gstomxvideo.h"
 
@@ -33,6 +35,9 @@
 GST_DEBUG_CATEGORY_STATIC (gst_omx_buffer_pool_debug_category);
 #define GST_CAT_DEFAULT gst_omx_buffer_pool_debug_category
 
+/* Layout cookie of the pool the video meta of a buffer was last updated for */
+static GQuark gst_omx_buffer_pool_layout_quark;
+
 enum
 {
   SIG_ALLOCATE,
@@ -203,7 +208,8 @@ gst_omx_buffer_pool_stop (GstBufferPool * bpool)
 
   pool->add_videometa = FALSE;
   pool->deactivated = TRUE;
-  pool->port->using_pool = TRUE;
+  /* Buffers allocated on the port from now on are not ours */
+  pool->port->using_pool = FALSE;
 
   return GST_BUFFER_POOL_CLASS (gst_omx_buffer_pool_parent_class)->stop (bpool);
 }
@@ -305,6 +311,119 @@ wrong_video_caps:
   }
 }
 
+/* Computes where the component puts the planes of the frames of
+ * pool->video_info and if they have to be copied for downstream */
+static void
+gst_omx_buffer_pool_update_layout (GstOMXBufferPool * pool)
+{
+  const guint nstride = pool->port->port_def.format.video.nStride;
+  const guint nslice = pool->port->port_def.format.video.nSliceHeight;
+  gsize *offset = pool->offset;
+  gint *stride = pool->stride;
+
+  memset (pool->offset, 0, sizeof (pool->offset));
+  memset (pool->stride, 0, sizeof (pool->stride));
+  stride[0] = nstride;
+
+  switch (GST_VIDEO_INFO_FORMAT (&pool->video_info)) {
+    case GST_VIDEO_FORMAT_ABGR:
+    case GST_VIDEO_FORMAT_ARGB:
+    case GST_VIDEO_FORMAT_RGB16:
+    case GST_VIDEO_FORMAT_BGR16:
+    case GST_VIDEO_FORMAT_YUY2:
+    case GST_VIDEO_FORMAT_UYVY:
+    case GST_VIDEO_FORMAT_YVYU:
+    case GST_VIDEO_FORMAT_GRAY8:
+      break;
+    case GST_VIDEO_FORMAT_I420:
+      stride[1] = nstride / 2;
+      offset[1] = offset[0] + stride[0] * nslice;
+      stride[2] = nstride / 2;
+      offset[2] = offset[1] + (stride[1] * nslice / 2);
+      break;
+    case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_NV12_10LE32:
+    case GST_VIDEO_FORMAT_NV16:
+    case GST_VIDEO_FORMAT_NV16_10LE32:
+      stride[1] = nstride;
+      offset[1] = offset[0] + stride[0] * nslice;
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+
+  if (pool->add_videometa) {
+    pool->need_copy = FALSE;
+  } else {
+    GstVideoInfo info;
+    gboolean need_copy = FALSE;
+    gint i;
+
+    gst_video_info_init (&info);
+    gst_video_info_set_format (&info,
+        GST_VIDEO_INFO_FORMAT (&pool->video_info),
+        GST_VIDEO_INFO_WIDTH (&pool->video_info),
+        GST_VIDEO_INFO_HEIGHT (&pool->video_info));
+
+    for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&pool->video_info); i++) {
+      if (info.stride[i] != stride[i] || info.offset[i] != offset[i]) {
+        GST_DEBUG_OBJECT (pool,
+            "Need to copy output frames because of stride/offset mismatch: plane %d stride %d (expected: %d) offset %"
+            G_GSIZE_FORMAT " (expected: %" G_GSIZE_FORMAT
+            ") nStride: %d nSliceHeight: %d ", i, stride[i], info.stride[i],
+            offset[i], info.offset[i], nstride, nslice);
+
+        need_copy = TRUE;
+        break;
+      }
+    }
+
+    pool->need_copy = need_copy;
+  }
+}
+
+/* Describes the current layout of the frames on buf, which is one of the
+ * buffers wrapping the memory of the component */
+static void
+gst_omx_buffer_pool_update_video_meta (GstOMXBufferPool * pool,
+    GstBuffer * buf)
+{
+  GstVideoMeta *meta;
+  GstVideoAlignment align;
+  gint i;
+
+  meta = gst_buffer_get_video_meta (buf);
+
+  if (!meta) {
+    /* We always add the videometa. It's the job of the user
+     * to copy the buffer if pool->need_copy is TRUE
+     */
+    if (!pool->need_copy && !pool->add_videometa)
+      return;
+
+    meta = gst_buffer_add_video_meta_full (buf, GST_VIDEO_FRAME_FLAG_NONE,
+        GST_VIDEO_INFO_FORMAT (&pool->video_info),
+        GST_VIDEO_INFO_WIDTH (&pool->video_info),
+        GST_VIDEO_INFO_HEIGHT (&pool->video_info),
+        GST_VIDEO_INFO_N_PLANES (&pool->video_info), pool->offset,
+        pool->stride);
+  } else {
+    /* The port settings changed while keeping its buffers */
+    meta->format = GST_VIDEO_INFO_FORMAT (&pool->video_info);
+    meta->width = GST_VIDEO_INFO_WIDTH (&pool->video_info);
+    meta->height = GST_VIDEO_INFO_HEIGHT (&pool->video_info);
+    meta->n_planes = GST_VIDEO_INFO_N_PLANES (&pool->video_info);
+    for (i = 0; i < GST_VIDEO_MAX_PLANES; i++) {
+      meta->offset[i] = pool->offset[i];
+      meta->stride[i] = pool->stride[i];
+    }
+  }
+
+  if (gst_omx_video_get_port_padding (pool->port, &pool->video_info, &align))
+    gst_video_meta_set_alignment (meta, align);
+}
+
 static GstFlowReturn
 gst_omx_buffer_pool_alloc_buffer (GstBufferPool * bpool,
     GstBuffer ** buffer, GstBufferPoolAcquireParams * params)
@@ -343,86 +462,12 @@ gst_omx_buffer_pool_alloc_buffer (GstBufferPool * bpool,
 
     pool->need_copy = FALSE;
   } else {
-    const guint nstride = pool->port->port_def.format.video.nStride;
-    const guint nslice = pool->port->port_def.format.video.nSliceHeight;
-    gsize offset[GST_VIDEO_MAX_PLANES] = { 0, };
-    gint stride[GST_VIDEO_MAX_PLANES] = { nstride, 0, };
-
     buf = gst_buffer_new ();
 
-    switch (GST_VIDEO_INFO_FORMAT (&pool->video_info)) {
-      case GST_VIDEO_FORMAT_ABGR:
-      case GST_VIDEO_FORMAT_ARGB:
-      case GST_VIDEO_FORMAT_RGB16:
-      case GST_VIDEO_FORMAT_BGR16:
-      case GST_VIDEO_FORMAT_YUY2:
-      case GST_VIDEO_FORMAT_UYVY:
-      case GST_VIDEO_FORMAT_YVYU:
-      case GST_VIDEO_FORMAT_GRAY8:
-        break;
-      case GST_VIDEO_FORMAT_I420:
-        stride[1] = nstride / 2;
-        offset[1] = offset[0] + stride[0] * nslice;
-        stride[2] = nstride / 2;
-        offset[2] = offset[1] + (stride[1] * nslice / 2);
-        break;
-      case GST_VIDEO_FORMAT_NV12:
-      case GST_VIDEO_FORMAT_NV12_10LE32:
-      case GST_VIDEO_FORMAT_NV16:
-      case GST_VIDEO_FORMAT_NV16_10LE32:
-        stride[1] = nstride;
-        offset[1] = offset[0] + stride[0] * nslice;
-        break;
-      default:
-        g_assert_not_reached ();
-        break;
-    }
-
-    if (pool->add_videometa) {
-      pool->need_copy = FALSE;
-    } else {
-      GstVideoInfo info;
-      gboolean need_copy = FALSE;
-      gint i;
-
-      gst_video_info_init (&info);
-      gst_video_info_set_format (&info,
-          GST_VIDEO_INFO_FORMAT (&pool->video_info),
-          GST_VIDEO_INFO_WIDTH (&pool->video_info),
-          GST_VIDEO_INFO_HEIGHT (&pool->video_info));
-
-      for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&pool->video_info); i++) {
-        if (info.stride[i] != stride[i] || info.offset[i] != offset[i]) {
-          GST_DEBUG_OBJECT (pool,
-              "Need to copy output frames because of stride/offset mismatch: plane %d stride %d (expected: %d) offset %"
-              G_GSIZE_FORMAT " (expected: %" G_GSIZE_FORMAT
-              ") nStride: %d nSliceHeight: %d ", i, stride[i], info.stride[i],
-              offset[i], info.offset[i], nstride, nslice);
-
-          need_copy = TRUE;
-          break;
-        }
-      }
-
-      pool->need_copy = need_copy;
-    }
-
-    if (pool->need_copy || pool->add_videometa) {
-      /* We always add the videometa. It's the job of the user
-       * to copy the buffer if pool->need_copy is TRUE
-       */
-      GstVideoMeta *meta;
-      GstVideoAlignment align;
-
-      meta = gst_buffer_add_video_meta_full (buf, GST_VIDEO_FRAME_FLAG_NONE,
-          GST_VIDEO_INFO_FORMAT (&pool->video_info),
-          GST_VIDEO_INFO_WIDTH (&pool->video_info),
-          GST_VIDEO_INFO_HEIGHT (&pool->video_info),
-          GST_VIDEO_INFO_N_PLANES (&pool->video_info), offset, stride);
-
-      if (gst_omx_video_get_port_padding (pool->port, &pool->video_info,
-              &align))
-        gst_video_meta_set_alignment (meta, align);
+    /* Buffers of encoded frames have no layout */
+    if (GST_VIDEO_INFO_FORMAT (&pool->video_info) != GST_VIDEO_FORMAT_UNKNOWN) {
+      gst_omx_buffer_pool_update_layout (pool);
+      gst_omx_buffer_pool_update_video_meta (pool, buf);
     }
   }
 
@@ -540,6 +585,18 @@ gst_omx_buffer_pool_acquire_buffer (GstBufferPool * bpool,
   if (ret == GST_FLOW_OK) {
     /* attach the acquired memory on it */
     gst_buffer_append_memory (*buffer, mem);
+
+    if (pool->port->port_def.eDir == OMX_DirOutput && !pool->other_pool
+        && pool->layout_cookie !=
+        GPOINTER_TO_INT (gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST
+                (*buffer), gst_omx_buffer_pool_layout_quark))) {
+      GST_OBJECT_LOCK (pool);
+      gst_omx_buffer_pool_update_video_meta (pool, *buffer);
+      gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (*buffer),
+          gst_omx_buffer_pool_layout_quark,
+          GINT_TO_POINTER (pool->layout_cookie), NULL);
+      GST_OBJECT_UNLOCK (pool);
+    }
   } else {
     gst_memory_unref (mem);
   }
@@ -644,6 +701,9 @@ gst_omx_buffer_pool_class_init (GstOMXBufferPoolClass * klass)
   signals[SIG_ALLOCATE] = g_signal_new ("allocate",
       G_TYPE_FROM_CLASS (gobject_class), G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
       G_TYPE_BOOLEAN, 0);
+
+  gst_omx_buffer_pool_layout_quark =
+      g_quark_from_static_string ("GstOMXBufferPoolLayout");
 }
 
 static void
@@ -672,3 +732,34 @@ gst_omx_buffer_pool_new (GstElement * element, GstOMXComponent * component,
 
   return GST_BUFFER_POOL (pool);
 }
+
+/* Switches the pool to the frames of caps after the settings of its port
+ * changed while keeping the buffers of the port. The video metas are
+ * updated when the buffers are acquired the next time */
+gboolean
+gst_omx_buffer_pool_update_caps (GstOMXBufferPool * pool, GstCaps * caps,
+    gboolean add_videometa)
+{
+  GstVideoInfo info;
+
+  g_return_val_if_fail (GST_IS_OMX_BUFFER_POOL (pool), FALSE);
+  g_return_val_if_fail (pool->other_pool == NULL, FALSE);
+
+  if (!gst_video_info_from_caps (&info, caps)) {
+    GST_WARNING_OBJECT (pool,
+        "failed getting geometry from caps %" GST_PTR_FORMAT, caps);
+    return FALSE;
+  }
+
+  GST_OBJECT_LOCK (pool);
+  gst_caps_replace (&pool->caps, caps);
+  pool->video_info = info;
+  pool->add_videometa = add_videometa;
+  gst_omx_buffer_pool_update_layout (pool);
+  pool->layout_cookie++;
+  GST_OBJECT_UNLOCK (pool);
+
+  GST_DEBUG_OBJECT (pool, "Updated caps to %" GST_PTR_FORMAT, caps);
+
+  return TRUE;
+}
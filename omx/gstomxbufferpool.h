@@ -59,6 +59,11 @@ struct _GstOMXBufferPool
   gboolean add_videometa;
   gboolean need_copy;
   GstVideoInfo video_info;
+  /* Layout of the frames in the memory of the port */
+  gsize offset[GST_VIDEO_MAX_PLANES];
+  gint stride[GST_VIDEO_MAX_PLANES];
+  /* Increased when the caps are updated without reallocating */
+  gint layout_cookie;
 
   /* Owned by element, element has to stop this pool before
    * it destroys component or port */
@@ -95,6 +100,7 @@ struct _GstOMXBufferPoolClass
 GType gst_omx_buffer_pool_get_type (void);
 
 GstBufferPool *gst_omx_buffer_pool_new (GstElement * element, GstOMXComponent * component, GstOMXPort * port, GstOMXBufferMode output_mode);
+gboolean gst_omx_buffer_pool_update_caps (GstOMXBufferPool * pool, GstCaps * caps, gboolean add_videometa);
 
 G_END_DECLS
 
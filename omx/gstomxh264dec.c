@@ -35,6 +35,10 @@ static gboolean gst_omx_h264_dec_is_format_change (GstOMXVideoDec * dec,
     GstOMXPort * port, GstVideoCodecState * state);
 static gboolean gst_omx_h264_dec_set_format (GstOMXVideoDec * dec,
     GstOMXPort * port, GstVideoCodecState * state);
+static gboolean gst_omx_h264_dec_is_disposable (GstOMXVideoDec * dec,
+    GstBuffer * buffer);
+static gboolean gst_omx_h264_dec_parse_stream_info (GstOMXVideoDec * dec,
+    GstBuffer * buffer, guint * width, guint * height, guint * dpb_size);
 
 enum
 {
@@ -74,6 +78,10 @@ gst_omx_h264_dec_class_init (GstOMXH264DecClass * klass)
   videodec_class->is_format_change =
       GST_DEBUG_FUNCPTR (gst_omx_h264_dec_is_format_change);
   videodec_class->set_format = GST_DEBUG_FUNCPTR (gst_omx_h264_dec_set_format);
+  videodec_class->is_disposable =
+      GST_DEBUG_FUNCPTR (gst_omx_h264_dec_is_disposable);
+  videodec_class->parse_stream_info =
+      GST_DEBUG_FUNCPTR (gst_omx_h264_dec_parse_stream_info);
 
   videodec_class->cdata.default_sink_template_caps = SINK_CAPS;
 
@@ -214,3 +222,80 @@ gst_omx_h264_dec_set_format (GstOMXVideoDec * dec, GstOMXPort * port,
 
   return TRUE;
 }
+
+/* All slices of a picture have the same nal_ref_idc, which is 0 if no
+ * other picture refers to it */
+static gboolean
+gst_omx_h264_dec_is_disposable (GstOMXVideoDec * dec, GstBuffer * buffer)
+{
+  GstMapInfo map;
+  gssize offset = 0;
+  gboolean disposable = FALSE;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return FALSE;
+
+  while ((offset =
+          gst_omx_video_find_start_code (map.data, map.size, offset)) >= 0
+      && (gsize) offset < map.size) {
+    guint8 nal_ref_idc = (map.data[offset] >> 5) & 0x3;
+    guint8 nal_unit_type = map.data[offset] & 0x1f;
+
+    /* Coded slice of a non-IDR picture, slice data partition A or coded
+     * slice of an IDR picture */
+    if (nal_unit_type == 1 || nal_unit_type == 2 || nal_unit_type == 5) {
+      disposable = nal_unit_type != 5 && nal_ref_idc == 0;
+      break;
+    }
+  }
+
+  gst_buffer_unmap (buffer, &map);
+
+  return disposable;
+}
+
+/* The SPS is either the first one of the avcC codec_data or comes before
+ * the first slice in byte-stream format */
+static gboolean
+gst_omx_h264_dec_parse_stream_info (GstOMXVideoDec * dec, GstBuffer * buffer,
+    guint * width, guint * height, guint * dpb_size)
+{
+  GstMapInfo map;
+  gssize offset = 0;
+  gboolean ret = FALSE;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return FALSE;
+
+  if (map.size > 8 && map.data[0] == 1) {
+    gsize sps_size = GST_READ_UINT16_BE (map.data + 6);
+
+    /* numOfSequenceParameterSets */
+    if ((map.data[5] & 0x1f) > 0 && 8 + sps_size <= map.size)
+      ret = gst_omx_h264_utils_parse_sps (map.data + 8, sps_size, width,
+          height, dpb_size);
+    goto done;
+  }
+
+  while ((offset =
+          gst_omx_video_find_start_code (map.data, map.size, offset)) >= 0
+      && (gsize) offset < map.size) {
+    guint8 nal_unit_type = map.data[offset] & 0x1f;
+
+    if (nal_unit_type == 7) {
+      gsize end = gst_omx_video_find_nal_end (map.data, map.size, offset);
+
+      ret = gst_omx_h264_utils_parse_sps (map.data + offset, end - offset,
+          width, height, dpb_size);
+      break;
+    }
+
+    if (nal_unit_type >= 1 && nal_unit_type <= 5)
+      break;
+  }
+
+done:
+  gst_buffer_unmap (buffer, &map);
+
+  return ret;
+}
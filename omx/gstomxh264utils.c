@@ -23,6 +23,7 @@
 #endif
 
 #include "gstomxh264utils.h"
+#include "gstomxvideo.h"
 
 typedef struct
 {
@@ -129,3 +130,204 @@ gst_omx_h264_utils_get_level_from_str (const gchar * level)
 
   return OMX_VIDEO_AVCLevelMax;
 }
+
+/* MaxDpbMbs of Table A-1 */
+static guint
+get_max_dpb_mbs (guint8 profile_idc, guint8 constraint_flags,
+    guint8 level_idc)
+{
+  switch (level_idc) {
+    case 9:
+    case 10:
+      return 396;
+    case 11:
+      /* Level 1b of the Baseline, Constrained Baseline and Main profiles */
+      if ((constraint_flags & 0x10) && (profile_idc == 66
+              || profile_idc == 77))
+        return 396;
+      return 900;
+    case 12:
+    case 13:
+    case 20:
+      return 2376;
+    case 21:
+      return 4752;
+    case 22:
+    case 30:
+      return 8100;
+    case 31:
+      return 18000;
+    case 32:
+      return 20480;
+    case 40:
+    case 41:
+      return 32768;
+    case 42:
+      return 34816;
+    case 50:
+      return 110400;
+    case 51:
+    case 52:
+      return 184320;
+    case 60:
+    case 61:
+    case 62:
+      return 696320;
+    default:
+      return 0;
+  }
+}
+
+static gboolean
+skip_scaling_list (GstBitReader * br, guint size)
+{
+  gint32 last_scale = 8, next_scale = 8, delta_scale;
+  guint i;
+
+  for (i = 0; i < size; i++) {
+    if (next_scale != 0) {
+      GST_OMX_VIDEO_READ_SE (br, delta_scale);
+      next_scale = (last_scale + delta_scale + 256) % 256;
+    }
+    if (next_scale != 0)
+      last_scale = next_scale;
+  }
+
+  return TRUE;
+
+failed:
+  return FALSE;
+}
+
+/* Parses the picture size and the DPB size in frames from the sequence
+ * parameter set NAL unit in data, 7.3.2.1.1. The DPB size is derived from
+ * the level as the VUI is not parsed */
+gboolean
+gst_omx_h264_utils_parse_sps (const guint8 * data, gsize size,
+    guint * width, guint * height, guint * dpb_size)
+{
+  GstBitReader br;
+  guint8 *rbsp;
+  gsize rbsp_size;
+  guint8 profile_idc, constraint_flags, level_idc;
+  guint chroma_format_idc = 1, separate_colour_plane_flag = 0;
+  guint pic_order_cnt_type, max_num_ref_frames, frame_mbs_only_flag;
+  guint pic_width_in_mbs, pic_height_in_map_units, frame_height_in_mbs;
+  guint crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+  guint crop_unit_x = 1, crop_unit_y, max_dpb_mbs, dpb;
+  guint i, n, flag;
+
+  if (size < 4 || (data[0] & 0x1f) != 7)
+    return FALSE;
+
+  rbsp = gst_omx_video_nal_to_rbsp (data + 1, size - 1, &rbsp_size);
+  gst_bit_reader_init (&br, rbsp, rbsp_size);
+
+  GST_OMX_VIDEO_READ_BITS (&br, profile_idc, 8);
+  GST_OMX_VIDEO_READ_BITS (&br, constraint_flags, 8);
+  GST_OMX_VIDEO_READ_BITS (&br, level_idc, 8);
+  /* seq_parameter_set_id */
+  GST_OMX_VIDEO_SKIP_UE (&br);
+
+  if (profile_idc == 100 || profile_idc == 110 || profile_idc == 122
+      || profile_idc == 244 || profile_idc == 44 || profile_idc == 83
+      || profile_idc == 86 || profile_idc == 118 || profile_idc == 128
+      || profile_idc == 138 || profile_idc == 139 || profile_idc == 134
+      || profile_idc == 135) {
+    GST_OMX_VIDEO_READ_UE (&br, chroma_format_idc);
+    if (chroma_format_idc == 3)
+      GST_OMX_VIDEO_READ_BITS (&br, separate_colour_plane_flag, 1);
+    /* bit_depth_luma_minus8, bit_depth_chroma_minus8 */
+    GST_OMX_VIDEO_SKIP_UE (&br);
+    GST_OMX_VIDEO_SKIP_UE (&br);
+    /* qpprime_y_zero_transform_bypass_flag */
+    GST_OMX_VIDEO_SKIP_BITS (&br, 1);
+    /* seq_scaling_matrix_present_flag */
+    GST_OMX_VIDEO_READ_BITS (&br, flag, 1);
+    if (flag) {
+      for (i = 0; i < (chroma_format_idc != 3 ? 8 : 12); i++) {
+        GST_OMX_VIDEO_READ_BITS (&br, flag, 1);
+        if (flag && !skip_scaling_list (&br, i < 6 ? 16 : 64))
+          goto failed;
+      }
+    }
+  }
+
+  /* log2_max_frame_num_minus4 */
+  GST_OMX_VIDEO_SKIP_UE (&br);
+  GST_OMX_VIDEO_READ_UE (&br, pic_order_cnt_type);
+  if (pic_order_cnt_type == 0) {
+    /* log2_max_pic_order_cnt_lsb_minus4 */
+    GST_OMX_VIDEO_SKIP_UE (&br);
+  } else if (pic_order_cnt_type == 1) {
+    /* delta_pic_order_always_zero_flag */
+    GST_OMX_VIDEO_SKIP_BITS (&br, 1);
+    /* offset_for_non_ref_pic, offset_for_top_to_bottom_field */
+    GST_OMX_VIDEO_SKIP_UE (&br);
+    GST_OMX_VIDEO_SKIP_UE (&br);
+    /* num_ref_frames_in_pic_order_cnt_cycle */
+    GST_OMX_VIDEO_READ_UE (&br, n);
+    if (n > 255)
+      goto failed;
+    /* offset_for_ref_frame */
+    for (i = 0; i < n; i++)
+      GST_OMX_VIDEO_SKIP_UE (&br);
+  }
+
+  GST_OMX_VIDEO_READ_UE (&br, max_num_ref_frames);
+  /* gaps_in_frame_num_value_allowed_flag */
+  GST_OMX_VIDEO_SKIP_BITS (&br, 1);
+  GST_OMX_VIDEO_READ_UE (&br, pic_width_in_mbs);
+  GST_OMX_VIDEO_READ_UE (&br, pic_height_in_map_units);
+  pic_width_in_mbs++;
+  pic_height_in_map_units++;
+  GST_OMX_VIDEO_READ_BITS (&br, frame_mbs_only_flag, 1);
+  if (!frame_mbs_only_flag) {
+    /* mb_adaptive_frame_field_flag */
+    GST_OMX_VIDEO_SKIP_BITS (&br, 1);
+  }
+  /* direct_8x8_inference_flag */
+  GST_OMX_VIDEO_SKIP_BITS (&br, 1);
+  /* frame_cropping_flag */
+  GST_OMX_VIDEO_READ_BITS (&br, flag, 1);
+  if (flag) {
+    GST_OMX_VIDEO_READ_UE (&br, crop_left);
+    GST_OMX_VIDEO_READ_UE (&br, crop_right);
+    GST_OMX_VIDEO_READ_UE (&br, crop_top);
+    GST_OMX_VIDEO_READ_UE (&br, crop_bottom);
+  }
+
+  g_free (rbsp);
+
+  /* Larger than any level allows */
+  if (pic_width_in_mbs > 2048 || pic_height_in_map_units > 2048)
+    return FALSE;
+
+  frame_height_in_mbs = (2 - frame_mbs_only_flag) * pic_height_in_map_units;
+
+  /* Table 6-1, monochrome and separate planes are cropped in luma samples */
+  crop_unit_y = 2 - frame_mbs_only_flag;
+  if (chroma_format_idc != 0 && !separate_colour_plane_flag) {
+    crop_unit_x = chroma_format_idc == 3 ? 1 : 2;
+    crop_unit_y *= chroma_format_idc == 1 ? 2 : 1;
+  }
+
+  if (((guint64) crop_left + crop_right) * crop_unit_x >= pic_width_in_mbs * 16
+      || ((guint64) crop_top + crop_bottom) * crop_unit_y >=
+      frame_height_in_mbs * 16)
+    return FALSE;
+
+  *width = pic_width_in_mbs * 16 - (crop_left + crop_right) * crop_unit_x;
+  *height = frame_height_in_mbs * 16 - (crop_top + crop_bottom) * crop_unit_y;
+
+  /* A.3.1 h) and A.3.2 f) */
+  max_dpb_mbs = get_max_dpb_mbs (profile_idc, constraint_flags, level_idc);
+  dpb = max_dpb_mbs / (pic_width_in_mbs * frame_height_in_mbs);
+  *dpb_size = CLAMP (MAX (dpb, max_num_ref_frames), 1, 16);
+
+  return TRUE;
+
+failed:
+  g_free (rbsp);
+  return FALSE;
+}
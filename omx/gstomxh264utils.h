@@ -32,5 +32,8 @@ OMX_VIDEO_AVCLEVELTYPE gst_omx_h264_utils_get_level_from_str (const gchar *
 
 const gchar * gst_omx_h264_utils_get_profile_from_enum (OMX_VIDEO_AVCPROFILETYPE e);
 
+gboolean gst_omx_h264_utils_parse_sps (const guint8 * data, gsize size,
+    guint * width, guint * height, guint * dpb_size);
+
 G_END_DECLS
 #endif /* __GST_OMX_H264_UTILS_H__ */
@@ -36,6 +36,13 @@ static gboolean gst_omx_h265_dec_is_format_change (GstOMXVideoDec * dec,
     GstOMXPort * port, GstVideoCodecState * state);
 static gboolean gst_omx_h265_dec_set_format (GstOMXVideoDec * dec,
     GstOMXPort * port, GstVideoCodecState * state);
+static gboolean gst_omx_h265_dec_is_disposable (GstOMXVideoDec * dec,
+    GstBuffer * buffer);
+static void gst_omx_h265_dec_parse_headers (GstOMXVideoDec * dec,
+    GstBuffer * buffer);
+static gboolean gst_omx_h265_dec_parse_stream_info (GstOMXVideoDec * dec,
+    GstBuffer * buffer, guint * width, guint * height, guint * dpb_size);
+static gboolean gst_omx_h265_dec_stop (GstVideoDecoder * decoder);
 
 enum
 {
@@ -69,12 +76,21 @@ G_DEFINE_TYPE_WITH_CODE (GstOMXH265Dec, gst_omx_h265_dec,
 static void
 gst_omx_h265_dec_class_init (GstOMXH265DecClass * klass)
 {
+  GstVideoDecoderClass *gstvideodec_class = GST_VIDEO_DECODER_CLASS (klass);
   GstOMXVideoDecClass *videodec_class = GST_OMX_VIDEO_DEC_CLASS (klass);
   GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
 
   videodec_class->is_format_change =
       GST_DEBUG_FUNCPTR (gst_omx_h265_dec_is_format_change);
   videodec_class->set_format = GST_DEBUG_FUNCPTR (gst_omx_h265_dec_set_format);
+  videodec_class->is_disposable =
+      GST_DEBUG_FUNCPTR (gst_omx_h265_dec_is_disposable);
+  videodec_class->parse_headers =
+      GST_DEBUG_FUNCPTR (gst_omx_h265_dec_parse_headers);
+  videodec_class->parse_stream_info =
+      GST_DEBUG_FUNCPTR (gst_omx_h265_dec_parse_stream_info);
+
+  gstvideodec_class->stop = GST_DEBUG_FUNCPTR (gst_omx_h265_dec_stop);
 
   videodec_class->cdata.default_sink_template_caps = SINK_CAPS;
 
@@ -90,6 +106,86 @@ gst_omx_h265_dec_class_init (GstOMXH265DecClass * klass)
 static void
 gst_omx_h265_dec_init (GstOMXH265Dec * self)
 {
+  self->sps_max_sub_layers_minus1 = -1;
+}
+
+static gboolean
+gst_omx_h265_dec_stop (GstVideoDecoder * decoder)
+{
+  GstOMXH265Dec *self = GST_OMX_H265_DEC (decoder);
+
+  self->sps_max_sub_layers_minus1 = -1;
+
+  return
+      GST_VIDEO_DECODER_CLASS (gst_omx_h265_dec_parent_class)->stop (decoder);
+}
+
+/* Finds the SPS NAL unit in data, either in the NAL unit arrays of hvcC
+ * codec_data or before the first slice in byte-stream format */
+static gboolean
+gst_omx_h265_dec_find_sps (const guint8 * data, gsize size,
+    gsize * sps_offset, gsize * sps_size)
+{
+  gssize offset = 0;
+
+  if (size > 23 && data[0] == 1) {
+    guint i, j, n_arrays = data[22];
+    gsize pos = 23;
+
+    for (i = 0; i < n_arrays && pos + 3 <= size; i++) {
+      guint8 nal_unit_type = data[pos] & 0x3f;
+      guint n_nalus = GST_READ_UINT16_BE (data + pos + 1);
+
+      pos += 3;
+      for (j = 0; j < n_nalus && pos + 2 <= size; j++) {
+        gsize nalu_size = GST_READ_UINT16_BE (data + pos);
+
+        pos += 2;
+        if (pos + nalu_size > size)
+          return FALSE;
+
+        if (nal_unit_type == 33) {
+          *sps_offset = pos;
+          *sps_size = nalu_size;
+          return TRUE;
+        }
+        pos += nalu_size;
+      }
+    }
+    return FALSE;
+  }
+
+  while ((offset = gst_omx_video_find_start_code (data, size, offset)) >= 0
+      && (gsize) offset < size) {
+    guint8 nal_unit_type = (data[offset] >> 1) & 0x3f;
+
+    if (nal_unit_type == 33) {
+      *sps_offset = offset;
+      *sps_size = gst_omx_video_find_nal_end (data, size, offset) - offset;
+      return TRUE;
+    }
+
+    if (nal_unit_type < 32)
+      break;
+  }
+
+  return FALSE;
+}
+
+/* Updates the sub-layer count from the SPS in data, if any */
+static void
+gst_omx_h265_dec_update_sub_layers (GstOMXH265Dec * self, const guint8 * data,
+    gsize size)
+{
+  gsize sps_offset, sps_size;
+  guint max_sub_layers_minus1;
+
+  if (gst_omx_h265_dec_find_sps (data, size, &sps_offset, &sps_size)
+      && gst_omx_h265_utils_parse_sps_max_sub_layers (data + sps_offset,
+          sps_size, &max_sub_layers_minus1)) {
+    GST_LOG_OBJECT (self, "SPS has %u sub-layers", max_sub_layers_minus1 + 1);
+    self->sps_max_sub_layers_minus1 = max_sub_layers_minus1;
+  }
 }
 
 static gboolean
@@ -196,11 +292,23 @@ static gboolean
 gst_omx_h265_dec_set_format (GstOMXVideoDec * dec, GstOMXPort * port,
     GstVideoCodecState * state)
 {
+  GstOMXH265Dec *self = GST_OMX_H265_DEC (dec);
   GstOMXVideoDecClass *klass = GST_OMX_VIDEO_DEC_GET_CLASS (dec);
   OMX_PARAM_PORTDEFINITIONTYPE port_def;
   OMX_ERRORTYPE err;
   const GstStructure *s;
 
+  /* Until the SPS of the new stream is known no frame is disposable */
+  self->sps_max_sub_layers_minus1 = -1;
+  if (state->codec_data) {
+    GstMapInfo map;
+
+    if (gst_buffer_map (state->codec_data, &map, GST_MAP_READ)) {
+      gst_omx_h265_dec_update_sub_layers (self, map.data, map.size);
+      gst_buffer_unmap (state->codec_data, &map);
+    }
+  }
+
   gst_omx_port_get_port_definition (port, &port_def);
   port_def.format.video.eCompressionFormat =
       (OMX_VIDEO_CODINGTYPE) OMX_VIDEO_CodingHEVC;
@@ -209,7 +317,7 @@ gst_omx_h265_dec_set_format (GstOMXVideoDec * dec, GstOMXPort * port,
     return FALSE;
 
   if (klass->cdata.hacks & GST_OMX_HACK_PASS_PROFILE_TO_DECODER) {
-    if (!set_profile_and_level (GST_OMX_H265_DEC (dec), state))
+    if (!set_profile_and_level (self, state))
       return FALSE;
   }
 
@@ -222,3 +330,78 @@ gst_omx_h265_dec_set_format (GstOMXVideoDec * dec, GstOMXPort * port,
 
   return TRUE;
 }
+
+/* The SPS can only change with an IRAP picture, which the parser marks as a
+ * sync point, so it is looked for in the header and sync frames only */
+static void
+gst_omx_h265_dec_parse_headers (GstOMXVideoDec * dec, GstBuffer * buffer)
+{
+  GstOMXH265Dec *self = GST_OMX_H265_DEC (dec);
+  GstMapInfo map;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return;
+
+  gst_omx_h265_dec_update_sub_layers (self, map.data, map.size);
+
+  gst_buffer_unmap (buffer, &map);
+}
+
+/* Sub-layer non-reference pictures (TRAIL_N, TSA_N, STSA_N, RADL_N, RASL_N
+ * and the reserved even types) are only referred to by pictures of higher
+ * sub-layers, so they are dropped only if they belong to the highest
+ * sub-layer of the SPS, i.e. TemporalId == sps_max_sub_layers_minus1 */
+static gboolean
+gst_omx_h265_dec_is_disposable (GstOMXVideoDec * dec, GstBuffer * buffer)
+{
+  GstOMXH265Dec *self = GST_OMX_H265_DEC (dec);
+  GstMapInfo map;
+  gssize offset = 0;
+  gboolean disposable = FALSE;
+
+  if (self->sps_max_sub_layers_minus1 < 0)
+    return FALSE;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return FALSE;
+
+  while ((offset =
+          gst_omx_video_find_start_code (map.data, map.size, offset)) >= 0
+      && (gsize) offset + 1 < map.size) {
+    guint8 nal_unit_type = (map.data[offset] >> 1) & 0x3f;
+    guint8 temporal_id_plus1 = map.data[offset + 1] & 0x7;
+
+    /* First VCL NAL unit of the picture */
+    if (nal_unit_type < 32 && temporal_id_plus1 > 0) {
+      disposable = nal_unit_type <= 14 && (nal_unit_type & 1) == 0
+          && temporal_id_plus1 - 1 == self->sps_max_sub_layers_minus1;
+      break;
+    }
+  }
+
+  gst_buffer_unmap (buffer, &map);
+
+  return disposable;
+}
+
+/* The SPS is either in the NAL unit arrays of the hvcC codec_data or comes
+ * before the first slice in byte-stream format */
+static gboolean
+gst_omx_h265_dec_parse_stream_info (GstOMXVideoDec * dec, GstBuffer * buffer,
+    guint * width, guint * height, guint * dpb_size)
+{
+  GstMapInfo map;
+  gsize sps_offset, sps_size;
+  gboolean ret = FALSE;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return FALSE;
+
+  if (gst_omx_h265_dec_find_sps (map.data, map.size, &sps_offset, &sps_size))
+    ret = gst_omx_h265_utils_parse_sps (map.data + sps_offset, sps_size,
+        width, height, dpb_size);
+
+  gst_buffer_unmap (buffer, &map);
+
+  return ret;
+}
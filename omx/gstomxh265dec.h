@@ -46,6 +46,10 @@ typedef struct _GstOMXH265DecClass GstOMXH265DecClass;
 struct _GstOMXH265Dec
 {
   GstOMXVideoDec parent;
+
+  /* sps_max_sub_layers_minus1 of the current SPS, -1 if none was seen
+   * since the last format change */
+  gint sps_max_sub_layers_minus1;
 };
 
 struct _GstOMXH265DecClass
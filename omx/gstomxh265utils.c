@@ -24,6 +24,7 @@
 #endif
 
 #include "gstomxh265utils.h"
+#include "gstomxvideo.h"
 
 typedef struct
 {
@@ -136,3 +137,121 @@ gst_omx_h265_utils_get_level_from_str (const gchar * level, const gchar * tier)
 
   return OMX_VIDEO_HEVCLevelUnknown;
 }
+
+/* Parses sps_max_sub_layers_minus1 from the sequence parameter set NAL
+ * unit in data. It is in the first byte after the NAL unit header, which
+ * can't contain emulation prevention bytes, 7.3.2.2.1 */
+gboolean
+gst_omx_h265_utils_parse_sps_max_sub_layers (const guint8 * data, gsize size,
+    guint * max_sub_layers_minus1)
+{
+  if (size < 3 || ((data[0] >> 1) & 0x3f) != 33)
+    return FALSE;
+
+  *max_sub_layers_minus1 = (data[2] >> 1) & 0x7;
+
+  return *max_sub_layers_minus1 <= 6;
+}
+
+/* Parses the picture size and the DPB size in pictures of the highest
+ * sub-layer from the sequence parameter set NAL unit in data, 7.3.2.2.1 */
+gboolean
+gst_omx_h265_utils_parse_sps (const guint8 * data, gsize size,
+    guint * width, guint * height, guint * dpb_size)
+{
+  GstBitReader br;
+  guint8 *rbsp;
+  gsize rbsp_size;
+  guint max_sub_layers_minus1, chroma_format_idc;
+  guint separate_colour_plane_flag = 0;
+  guint pic_width, pic_height, sub_layer_ordering_info_present_flag;
+  guint conf_left = 0, conf_right = 0, conf_top = 0, conf_bottom = 0;
+  guint sub_width_c = 1, sub_height_c = 1, max_dec_pic_buffering_minus1 = 0;
+  gboolean profile_present[8], level_present[8];
+  guint i, flag;
+
+  if (size < 4 || ((data[0] >> 1) & 0x3f) != 33)
+    return FALSE;
+
+  rbsp = gst_omx_video_nal_to_rbsp (data + 2, size - 2, &rbsp_size);
+  gst_bit_reader_init (&br, rbsp, rbsp_size);
+
+  /* sps_video_parameter_set_id */
+  GST_OMX_VIDEO_SKIP_BITS (&br, 4);
+  GST_OMX_VIDEO_READ_BITS (&br, max_sub_layers_minus1, 3);
+  if (max_sub_layers_minus1 > 6)
+    goto failed;
+  /* sps_temporal_id_nesting_flag */
+  GST_OMX_VIDEO_SKIP_BITS (&br, 1);
+
+  /* profile_tier_level (1, sps_max_sub_layers_minus1), 7.3.3 */
+  GST_OMX_VIDEO_SKIP_BITS (&br, 96);
+  for (i = 0; i < max_sub_layers_minus1; i++) {
+    GST_OMX_VIDEO_READ_BITS (&br, profile_present[i], 1);
+    GST_OMX_VIDEO_READ_BITS (&br, level_present[i], 1);
+  }
+  if (max_sub_layers_minus1 > 0)
+    GST_OMX_VIDEO_SKIP_BITS (&br, 2 * (8 - max_sub_layers_minus1));
+  for (i = 0; i < max_sub_layers_minus1; i++) {
+    if (profile_present[i])
+      GST_OMX_VIDEO_SKIP_BITS (&br, 88);
+    if (level_present[i])
+      GST_OMX_VIDEO_SKIP_BITS (&br, 8);
+  }
+
+  /* sps_seq_parameter_set_id */
+  GST_OMX_VIDEO_SKIP_UE (&br);
+  GST_OMX_VIDEO_READ_UE (&br, chroma_format_idc);
+  if (chroma_format_idc == 3)
+    GST_OMX_VIDEO_READ_BITS (&br, separate_colour_plane_flag, 1);
+  GST_OMX_VIDEO_READ_UE (&br, pic_width);
+  GST_OMX_VIDEO_READ_UE (&br, pic_height);
+  /* conformance_window_flag */
+  GST_OMX_VIDEO_READ_BITS (&br, flag, 1);
+  if (flag) {
+    GST_OMX_VIDEO_READ_UE (&br, conf_left);
+    GST_OMX_VIDEO_READ_UE (&br, conf_right);
+    GST_OMX_VIDEO_READ_UE (&br, conf_top);
+    GST_OMX_VIDEO_READ_UE (&br, conf_bottom);
+  }
+  /* bit_depth_luma_minus8, bit_depth_chroma_minus8,
+   * log2_max_pic_order_cnt_lsb_minus4 */
+  GST_OMX_VIDEO_SKIP_UE (&br);
+  GST_OMX_VIDEO_SKIP_UE (&br);
+  GST_OMX_VIDEO_SKIP_UE (&br);
+  GST_OMX_VIDEO_READ_BITS (&br, sub_layer_ordering_info_present_flag, 1);
+  for (i = sub_layer_ordering_info_present_flag ? 0 : max_sub_layers_minus1;
+      i <= max_sub_layers_minus1; i++) {
+    GST_OMX_VIDEO_READ_UE (&br, max_dec_pic_buffering_minus1);
+    /* sps_max_num_reorder_pics, sps_max_latency_increase_plus1 */
+    GST_OMX_VIDEO_SKIP_UE (&br);
+    GST_OMX_VIDEO_SKIP_UE (&br);
+  }
+
+  g_free (rbsp);
+
+  /* Larger than any level allows */
+  if (pic_width == 0 || pic_height == 0 || pic_width > 16888
+      || pic_height > 16888 || max_dec_pic_buffering_minus1 > 15)
+    return FALSE;
+
+  /* Table 6-1 */
+  if (!separate_colour_plane_flag) {
+    sub_width_c = chroma_format_idc == 1 || chroma_format_idc == 2 ? 2 : 1;
+    sub_height_c = chroma_format_idc == 1 ? 2 : 1;
+  }
+
+  if (((guint64) conf_left + conf_right) * sub_width_c >= pic_width
+      || ((guint64) conf_top + conf_bottom) * sub_height_c >= pic_height)
+    return FALSE;
+
+  *width = pic_width - (conf_left + conf_right) * sub_width_c;
+  *height = pic_height - (conf_top + conf_bottom) * sub_height_c;
+  *dpb_size = max_dec_pic_buffering_minus1 + 1;
+
+  return TRUE;
+
+failed:
+  g_free (rbsp);
+  return FALSE;
+}
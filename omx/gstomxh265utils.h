@@ -33,5 +33,11 @@ OMX_VIDEO_HEVCLEVELTYPE gst_omx_h265_utils_get_level_from_str (const gchar *
 
 const gchar * gst_omx_h265_utils_get_profile_from_enum (OMX_VIDEO_HEVCPROFILETYPE e);
 
+gboolean gst_omx_h265_utils_parse_sps (const guint8 * data, gsize size,
+    guint * width, guint * height, guint * dpb_size);
+
+gboolean gst_omx_h265_utils_parse_sps_max_sub_layers (const guint8 * data,
+    gsize size, guint * max_sub_layers_minus1);
+
 G_END_DECLS
 #endif /* __GST_OMX_H265_UTILS_H__ */
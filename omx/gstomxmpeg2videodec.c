@@ -34,6 +34,10 @@ static gboolean gst_omx_mpeg2_video_dec_is_format_change (GstOMXVideoDec * dec,
     GstOMXPort * port, GstVideoCodecState * state);
 static gboolean gst_omx_mpeg2_video_dec_set_format (GstOMXVideoDec * dec,
     GstOMXPort * port, GstVideoCodecState * state);
+static gboolean gst_omx_mpeg2_video_dec_is_disposable (GstOMXVideoDec * dec,
+    GstBuffer * buffer);
+static gboolean gst_omx_mpeg2_video_dec_parse_stream_info (GstOMXVideoDec *
+    dec, GstBuffer * buffer, guint * width, guint * height, guint * dpb_size);
 
 enum
 {
@@ -59,6 +63,10 @@ gst_omx_mpeg2_video_dec_class_init (GstOMXMPEG2VideoDecClass * klass)
       GST_DEBUG_FUNCPTR (gst_omx_mpeg2_video_dec_is_format_change);
   videodec_class->set_format =
       GST_DEBUG_FUNCPTR (gst_omx_mpeg2_video_dec_set_format);
+  videodec_class->is_disposable =
+      GST_DEBUG_FUNCPTR (gst_omx_mpeg2_video_dec_is_disposable);
+  videodec_class->parse_stream_info =
+      GST_DEBUG_FUNCPTR (gst_omx_mpeg2_video_dec_parse_stream_info);
 
   videodec_class->cdata.default_sink_template_caps = "video/mpeg, "
       "mpegversion=(int) [1, 2], "
@@ -99,3 +107,74 @@ gst_omx_mpeg2_video_dec_set_format (GstOMXVideoDec * dec, GstOMXPort * port,
 
   return ret;
 }
+
+/* B pictures are never referred to by other pictures */
+static gboolean
+gst_omx_mpeg2_video_dec_is_disposable (GstOMXVideoDec * dec,
+    GstBuffer * buffer)
+{
+  GstMapInfo map;
+  gssize offset = 0;
+  gboolean disposable = FALSE;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return FALSE;
+
+  while ((offset =
+          gst_omx_video_find_start_code (map.data, map.size, offset)) >= 0
+      && (gsize) offset + 2 < map.size) {
+    guint8 start_code = map.data[offset];
+
+    /* Picture header: 10 bits temporal_reference followed by 3 bits
+     * picture_coding_type */
+    if (start_code == 0x00) {
+      disposable = ((map.data[offset + 2] >> 3) & 0x7) == 3;
+      break;
+    }
+
+    /* Slices only follow the picture header */
+    if (start_code <= 0xaf)
+      break;
+  }
+
+  gst_buffer_unmap (buffer, &map);
+
+  return disposable;
+}
+
+/* The sequence header starts with 12 bits horizontal_size_value and 12 bits
+ * vertical_size_value. B pictures are predicted from the two previous
+ * reference pictures */
+static gboolean
+gst_omx_mpeg2_video_dec_parse_stream_info (GstOMXVideoDec * dec,
+    GstBuffer * buffer, guint * width, guint * height, guint * dpb_size)
+{
+  GstMapInfo map;
+  gssize offset = 0;
+  gboolean ret = FALSE;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return FALSE;
+
+  while ((offset =
+          gst_omx_video_find_start_code (map.data, map.size, offset)) >= 0
+      && (gsize) offset + 3 < map.size) {
+    const guint8 *data = map.data + offset;
+
+    if (data[0] == 0xb3) {
+      *width = (data[1] << 4) | (data[2] >> 4);
+      *height = ((data[2] & 0xf) << 8) | data[3];
+      *dpb_size = 2;
+      ret = *width > 0 && *height > 0;
+      break;
+    }
+
+    /* The sequence header comes first */
+    if (data[0] <= 0xaf)
+      break;
+  }
+
+  gst_buffer_unmap (buffer, &map);
+
+  return ret;
+}
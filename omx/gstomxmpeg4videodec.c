@@ -34,6 +34,10 @@ static gboolean gst_omx_mpeg4_video_dec_is_format_change (GstOMXVideoDec * dec,
     GstOMXPort * port, GstVideoCodecState * state);
 static gboolean gst_omx_mpeg4_video_dec_set_format (GstOMXVideoDec * dec,
     GstOMXPort * port, GstVideoCodecState * state);
+static gboolean gst_omx_mpeg4_video_dec_is_disposable (GstOMXVideoDec * dec,
+    GstBuffer * buffer);
+static gboolean gst_omx_mpeg4_video_dec_parse_stream_info (GstOMXVideoDec *
+    dec, GstBuffer * buffer, guint * width, guint * height, guint * dpb_size);
 
 enum
 {
@@ -60,6 +64,10 @@ gst_omx_mpeg4_video_dec_class_init (GstOMXMPEG4VideoDecClass * klass)
       GST_DEBUG_FUNCPTR (gst_omx_mpeg4_video_dec_is_format_change);
   videodec_class->set_format =
       GST_DEBUG_FUNCPTR (gst_omx_mpeg4_video_dec_set_format);
+  videodec_class->is_disposable =
+      GST_DEBUG_FUNCPTR (gst_omx_mpeg4_video_dec_is_disposable);
+  videodec_class->parse_stream_info =
+      GST_DEBUG_FUNCPTR (gst_omx_mpeg4_video_dec_parse_stream_info);
 
   videodec_class->cdata.default_sink_template_caps = "video/mpeg, "
       "mpegversion=(int) 4, "
@@ -100,3 +108,124 @@ gst_omx_mpeg4_video_dec_set_format (GstOMXVideoDec * dec, GstOMXPort * port,
 
   return ret;
 }
+
+/* B-VOPs are never referred to by other VOPs. Packed bitstreams put a
+ * B-VOP after a P-VOP, so only the first VOP of the buffer is checked */
+static gboolean
+gst_omx_mpeg4_video_dec_is_disposable (GstOMXVideoDec * dec,
+    GstBuffer * buffer)
+{
+  GstMapInfo map;
+  gssize offset = 0;
+  gboolean disposable = FALSE;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return FALSE;
+
+  while ((offset =
+          gst_omx_video_find_start_code (map.data, map.size, offset)) >= 0
+      && (gsize) offset + 1 < map.size) {
+    /* VOP header: 2 bits vop_coding_type */
+    if (map.data[offset] == 0xb6) {
+      disposable = (map.data[offset + 1] >> 6) == 2;
+      break;
+    }
+  }
+
+  gst_buffer_unmap (buffer, &map);
+
+  return disposable;
+}
+
+/* Reads the size of a rectangular video object layer, 6.2.3 */
+static gboolean
+parse_vol (const guint8 * data, gsize size, guint * width, guint * height)
+{
+  GstBitReader br;
+  guint flag, aspect_ratio_info, shape, resolution;
+
+  gst_bit_reader_init (&br, data, size);
+
+  /* random_accessible_vol, video_object_type_indication */
+  GST_OMX_VIDEO_SKIP_BITS (&br, 9);
+  /* is_object_layer_identifier */
+  GST_OMX_VIDEO_READ_BITS (&br, flag, 1);
+  if (flag) {
+    /* video_object_layer_verid, video_object_layer_priority */
+    GST_OMX_VIDEO_SKIP_BITS (&br, 7);
+  }
+  GST_OMX_VIDEO_READ_BITS (&br, aspect_ratio_info, 4);
+  if (aspect_ratio_info == 0xf) {
+    /* par_width, par_height */
+    GST_OMX_VIDEO_SKIP_BITS (&br, 16);
+  }
+  /* vol_control_parameters */
+  GST_OMX_VIDEO_READ_BITS (&br, flag, 1);
+  if (flag) {
+    /* chroma_format, low_delay */
+    GST_OMX_VIDEO_SKIP_BITS (&br, 3);
+    /* vbv_parameters */
+    GST_OMX_VIDEO_READ_BITS (&br, flag, 1);
+    if (flag)
+      GST_OMX_VIDEO_SKIP_BITS (&br, 79);
+  }
+  GST_OMX_VIDEO_READ_BITS (&br, shape, 2);
+  if (shape != 0)
+    goto failed;
+  /* marker_bit */
+  GST_OMX_VIDEO_SKIP_BITS (&br, 1);
+  GST_OMX_VIDEO_READ_BITS (&br, resolution, 16);
+  if (resolution == 0)
+    goto failed;
+  /* marker_bit */
+  GST_OMX_VIDEO_SKIP_BITS (&br, 1);
+  /* fixed_vop_rate */
+  GST_OMX_VIDEO_READ_BITS (&br, flag, 1);
+  if (flag)
+    GST_OMX_VIDEO_SKIP_BITS (&br, MAX (g_bit_storage (resolution - 1), 1));
+  /* marker_bit */
+  GST_OMX_VIDEO_SKIP_BITS (&br, 1);
+  GST_OMX_VIDEO_READ_BITS (&br, *width, 13);
+  /* marker_bit */
+  GST_OMX_VIDEO_SKIP_BITS (&br, 1);
+  GST_OMX_VIDEO_READ_BITS (&br, *height, 13);
+
+  return *width > 0 && *height > 0;
+
+failed:
+  return FALSE;
+}
+
+/* The video object layer header comes before the first VOP, B-VOPs are
+ * predicted from the two previous reference VOPs */
+static gboolean
+gst_omx_mpeg4_video_dec_parse_stream_info (GstOMXVideoDec * dec,
+    GstBuffer * buffer, guint * width, guint * height, guint * dpb_size)
+{
+  GstMapInfo map;
+  gssize offset = 0;
+  gboolean ret = FALSE;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return FALSE;
+
+  while ((offset =
+          gst_omx_video_find_start_code (map.data, map.size, offset)) >= 0
+      && (gsize) offset < map.size) {
+    guint8 start_code = map.data[offset];
+
+    if (start_code >= 0x20 && start_code <= 0x2f) {
+      ret = parse_vol (map.data + offset + 1, map.size - offset - 1, width,
+          height);
+      *dpb_size = 2;
+      break;
+    }
+
+    if (start_code == 0xb6)
+      break;
+  }
+
+  gst_buffer_unmap (buffer, &map);
+
+  return ret;
+}
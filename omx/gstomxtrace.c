@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "gstomxtrace.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_omx_trace_debug_category);
+#define GST_CAT_DEFAULT gst_omx_trace_debug_category
+
+typedef struct
+{
+  guint mask;
+  gint head;                    /* atomic, next record to write */
+  GstOMXTraceRecord records[1];
+} GstOMXTraceRing;
+
+gpointer gst_omx_trace_ring = NULL;
+
+/* Written by gst_omx_trace_component(), slots are reused after
+ * GST_OMX_TRACE_MAX_COMPONENTS registrations. A slot points to its
+ * storage once that is written completely, and is NULL while being
+ * (re)written */
+static GstOMXTraceComponent trace_component_storage
+    [GST_OMX_TRACE_MAX_COMPONENTS];
+static GstOMXTraceComponent *trace_components[GST_OMX_TRACE_MAX_COMPONENTS];
+static gint trace_n_components = 0;     /* atomic */
+
+/* Precomputed so the signal handler doesn't have to allocate */
+static gchar trace_filename[4096];
+
+#ifdef G_OS_UNIX
+/* Handler installed before ours, chained up to */
+static struct sigaction trace_old_action;
+#endif
+
+static GPrivate trace_thread_id;
+
+static guint32
+gst_omx_trace_thread_id (void)
+{
+  gpointer id = g_private_get (&trace_thread_id);
+
+  if (G_UNLIKELY (!id)) {
+#ifdef __linux__
+    id = GUINT_TO_POINTER ((guint32) syscall (SYS_gettid));
+#else
+    static gint next_id = 0;
+
+    id = GUINT_TO_POINTER (g_atomic_int_add (&next_id, 1) + 1);
+#endif
+    g_private_set (&trace_thread_id, id);
+  }
+
+  return GPOINTER_TO_UINT (id);
+}
+
+static void
+gst_omx_trace_fill_header (GstOMXTraceHeader * header)
+{
+  GstOMXTraceRing *ring = gst_omx_trace_ring;
+
+  memset (header, 0, sizeof (*header));
+  memcpy (header->magic, GST_OMX_TRACE_MAGIC, sizeof (header->magic));
+  header->version = GST_OMX_TRACE_VERSION;
+  header->record_size = sizeof (GstOMXTraceRecord);
+  header->n_components = MIN (g_atomic_int_get (&trace_n_components),
+      GST_OMX_TRACE_MAX_COMPONENTS);
+  header->n_records = ring->mask + 1;
+#ifdef G_OS_UNIX
+  header->pid = getpid ();
+#endif
+}
+
+/* Returns the component in slot idx, or an empty one if the slot is
+ * being written */
+static const GstOMXTraceComponent *
+gst_omx_trace_get_component (guint idx)
+{
+  static const GstOMXTraceComponent empty = { 0, };
+  const GstOMXTraceComponent *c;
+
+  c = g_atomic_pointer_get (&trace_components[idx]);
+
+  return c ? c : &empty;
+}
+
+#ifdef G_OS_UNIX
+static gboolean
+write_all (int fd, gconstpointer data, gsize size)
+{
+  const guint8 *p = data;
+
+  while (size > 0) {
+    gssize n = write (fd, p, size);
+
+    if (n < 0)
+      return FALSE;
+    p += n;
+    size -= n;
+  }
+
+  return TRUE;
+}
+
+/* Only uses async-signal-safe functions */
+static void
+gst_omx_trace_write_fd (int fd)
+{
+  GstOMXTraceRing *ring = gst_omx_trace_ring;
+  GstOMXTraceHeader header;
+  guint i;
+
+  gst_omx_trace_fill_header (&header);
+  if (!write_all (fd, &header, sizeof (header)))
+    return;
+
+  for (i = 0; i < header.n_components; i++) {
+    if (!write_all (fd, gst_omx_trace_get_component (i),
+            sizeof (GstOMXTraceComponent)))
+      return;
+  }
+
+  write_all (fd, ring->records, header.n_records * sizeof (GstOMXTraceRecord));
+}
+
+static void
+gst_omx_trace_signal_handler (int signum, siginfo_t * info, void *context)
+{
+  int fd;
+
+  fd = open (trace_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    gst_omx_trace_write_fd (fd);
+    close (fd);
+  }
+
+  if (trace_old_action.sa_flags & SA_SIGINFO) {
+    if (trace_old_action.sa_sigaction)
+      trace_old_action.sa_sigaction (signum, info, context);
+  } else if (trace_old_action.sa_handler != SIG_DFL
+      && trace_old_action.sa_handler != SIG_IGN) {
+    trace_old_action.sa_handler (signum);
+  }
+}
+#endif
+
+void
+gst_omx_trace_init (void)
+{
+  GstOMXTraceRing *ring;
+  const gchar *env;
+  guint64 n_records;
+  guint size;
+
+  GST_DEBUG_CATEGORY_INIT (gst_omx_trace_debug_category, "omxtrace", 0,
+      "gst-omx binary trace");
+
+  if (gst_omx_trace_ring)
+    return;
+
+  env = g_getenv ("GST_OMX_TRACE");
+  if (!env || !*env)
+    return;
+
+  n_records = g_ascii_strtoull (env, NULL, 10);
+  if (n_records == 0)
+    return;
+  if (n_records == 1)
+    n_records = GST_OMX_TRACE_DEFAULT_RECORDS;
+
+  /* Round up to a power of two, at most 16M records (1 GB) */
+  n_records = MIN (n_records, 1 << 24);
+  for (size = 1; size < n_records; size <<= 1);
+
+  env = g_getenv ("GST_OMX_TRACE_FILE");
+  if (env && *env) {
+    g_strlcpy (trace_filename, env, sizeof (trace_filename));
+  } else {
+    gchar *name, *path;
+
+#ifdef G_OS_UNIX
+    name = g_strdup_printf ("gst-omx-trace-%d.bin", (gint) getpid ());
+#else
+    name = g_strdup ("gst-omx-trace.bin");
+#endif
+    path = g_build_filename (g_get_tmp_dir (), name, NULL);
+    g_strlcpy (trace_filename, path, sizeof (trace_filename));
+    g_free (path);
+    g_free (name);
+  }
+
+  ring = g_malloc0 (sizeof (GstOMXTraceRing) +
+      (size - 1) * sizeof (GstOMXTraceRecord));
+  ring->mask = size - 1;
+  g_atomic_pointer_set (&gst_omx_trace_ring, ring);
+
+  GST_INFO ("Binary OMX trace enabled with %u records, dumped to %s", size,
+      trace_filename);
+
+#ifdef G_OS_UNIX
+  /* The signal handler is process-wide, so only installed on request */
+  env = g_getenv ("GST_OMX_TRACE_SIGNAL");
+  if (env && g_ascii_strtoull (env, NULL, 10) != 0) {
+    struct sigaction sa;
+
+    memset (&sa, 0, sizeof (sa));
+    sa.sa_sigaction = gst_omx_trace_signal_handler;
+    sigemptyset (&sa.sa_mask);
+    sa.sa_flags = SA_RESTART | SA_SIGINFO;
+    if (sigaction (SIGUSR2, &sa, &trace_old_action) == 0)
+      GST_INFO ("Dumping the binary OMX trace on SIGUSR2");
+    else
+      GST_WARNING ("Failed to install the SIGUSR2 handler");
+  }
+#endif
+}
+
+/* Writes the current content of the trace ring to filename, or to
+ * GST_OMX_TRACE_FILE if NULL */
+gboolean
+gst_omx_trace_dump (const gchar * filename, GError ** error)
+{
+  GstOMXTraceRing *ring = gst_omx_trace_ring;
+  GstOMXTraceHeader header;
+  GByteArray *data;
+  gboolean ret;
+  guint i;
+
+  if (!ring) {
+    g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "Tracing is not enabled");
+    return FALSE;
+  }
+
+  gst_omx_trace_fill_header (&header);
+
+  data = g_byte_array_sized_new (sizeof (header) +
+      header.n_components * sizeof (GstOMXTraceComponent) +
+      header.n_records * sizeof (GstOMXTraceRecord));
+  g_byte_array_append (data, (const guint8 *) &header, sizeof (header));
+  for (i = 0; i < header.n_components; i++)
+    g_byte_array_append (data,
+        (const guint8 *) gst_omx_trace_get_component (i),
+        sizeof (GstOMXTraceComponent));
+  g_byte_array_append (data, (const guint8 *) ring->records,
+      header.n_records * sizeof (GstOMXTraceRecord));
+
+  ret = g_file_set_contents (filename ? filename : trace_filename,
+      (const gchar *) data->data, data->len, error);
+  g_byte_array_unref (data);
+
+  return ret;
+}
+
+void
+gst_omx_trace_component (gconstpointer component, const gchar * name)
+{
+  GstOMXTraceComponent *c;
+  gint idx;
+
+  if (!gst_omx_trace_ring)
+    return;
+
+  idx = g_atomic_int_add (&trace_n_components, 1) %
+      GST_OMX_TRACE_MAX_COMPONENTS;
+
+  /* Hidden from dumps until it is written completely */
+  g_atomic_pointer_set (&trace_components[idx], NULL);
+
+  c = &trace_component_storage[idx];
+  c->component = (guint64) (gsize) component;
+  c->timestamp = g_get_monotonic_time ();
+  g_strlcpy (c->name, name, sizeof (c->name));
+
+  g_atomic_pointer_set (&trace_components[idx], c);
+}
+
+void
+gst_omx_trace_record (GstOMXTraceType type, gconstpointer component,
+    guint32 port, gconstpointer buffer, guint64 pts, guint32 flags,
+    guint32 data1, guint32 data2, guint32 data3)
+{
+  GstOMXTraceRing *ring = gst_omx_trace_ring;
+  GstOMXTraceRecord *rec;
+  guint idx;
+
+  if (!ring)
+    return;
+
+  idx = (guint) g_atomic_int_add (&ring->head, 1);
+  rec = &ring->records[idx & ring->mask];
+
+  /* Mark as incomplete while writing, a concurrent dump skips it */
+  g_atomic_int_set ((gint *) & rec->seq, 0);
+
+  rec->type = type;
+  rec->timestamp = g_get_monotonic_time ();
+  rec->component = (guint64) (gsize) component;
+  rec->buffer = (guint64) (gsize) buffer;
+  rec->pts = pts;
+  rec->thread = gst_omx_trace_thread_id ();
+  rec->port = port;
+  rec->flags = flags;
+  rec->data1 = data1;
+  rec->data2 = data2;
+  rec->data3 = data3;
+
+  g_atomic_int_set ((gint *) & rec->seq, (gint) (idx + 1));
+}
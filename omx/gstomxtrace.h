@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifndef __GST_OMX_TRACE_H__
+#define __GST_OMX_TRACE_H__
+
+/* Only depends on GLib, also used by tools/omxtrace2json */
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Binary trace of the OpenMAX IL calls and callbacks of all components of
+ * the process, cheap enough to be left enabled in production.
+ *
+ * Enabled by setting GST_OMX_TRACE to the number of records to keep (or
+ * to 1 for the default). The last records are written to GST_OMX_TRACE_FILE
+ * (default: <tmpdir>/gst-omx-trace-<pid>.bin) when calling
+ * gst_omx_trace_dump(), and on SIGUSR2 if GST_OMX_TRACE_SIGNAL is set to 1.
+ * A previously installed SIGUSR2 handler is still called.
+ *
+ * File layout, all in host byte order:
+ *   GstOMXTraceHeader
+ *   GstOMXTraceComponent * n_components
+ *   GstOMXTraceRecord * n_records (not sorted, order by seq)
+ */
+
+#define GST_OMX_TRACE_MAGIC "GSTOMXTR"
+#define GST_OMX_TRACE_VERSION 1
+#define GST_OMX_TRACE_DEFAULT_RECORDS (65536)
+#define GST_OMX_TRACE_MAX_COMPONENTS (256)
+
+typedef enum {
+  GST_OMX_TRACE_EMPTY_THIS_BUFFER = 1,
+  GST_OMX_TRACE_FILL_THIS_BUFFER,
+  GST_OMX_TRACE_EMPTY_BUFFER_DONE,
+  GST_OMX_TRACE_FILL_BUFFER_DONE,
+  GST_OMX_TRACE_EVENT,          /* data1: event, data2: nData1, data3: nData2 */
+  GST_OMX_TRACE_SEND_COMMAND,   /* data1: command, data2: param */
+  GST_OMX_TRACE_GET_PARAMETER,  /* data1: index */
+  GST_OMX_TRACE_SET_PARAMETER,
+  GST_OMX_TRACE_GET_CONFIG,
+  GST_OMX_TRACE_SET_CONFIG,
+} GstOMXTraceType;
+
+typedef struct _GstOMXTraceHeader GstOMXTraceHeader;
+typedef struct _GstOMXTraceComponent GstOMXTraceComponent;
+typedef struct _GstOMXTraceRecord GstOMXTraceRecord;
+
+struct _GstOMXTraceHeader {
+  gchar magic[8];
+  guint32 version;
+  guint32 record_size;
+  guint32 n_components;
+  guint32 n_records;
+  guint64 pid;
+};
+
+/* Components are identified by their address, which can be reused. A
+ * record belongs to the latest component registered before it */
+struct _GstOMXTraceComponent {
+  guint64 component;
+  guint64 timestamp;
+  gchar name[48];
+};
+
+struct _GstOMXTraceRecord {
+  /* 0 while being written, index in the ring + 1 otherwise */
+  guint32 seq;
+  guint32 type; /* GstOMXTraceType */
+  guint64 timestamp; /* monotonic, in microseconds */
+  guint64 component;
+  guint64 buffer; /* OMX_BUFFERHEADERTYPE, 0 if none */
+  guint64 pts; /* nTimeStamp of the buffer in OMX ticks */
+  guint32 thread;
+  guint32 port;
+  guint32 flags; /* nFlags of the buffer */
+  guint32 data1; /* nFilledLen for buffers, see GstOMXTraceType otherwise */
+  guint32 data2;
+  guint32 data3;
+};
+
+G_STATIC_ASSERT (sizeof (GstOMXTraceRecord) == 64);
+
+/* NULL if tracing is disabled */
+extern gpointer gst_omx_trace_ring;
+
+#define GST_OMX_TRACE_ENABLED() G_UNLIKELY (gst_omx_trace_ring != NULL)
+
+void      gst_omx_trace_init (void);
+gboolean  gst_omx_trace_dump (const gchar * filename, GError ** error);
+
+void      gst_omx_trace_component (gconstpointer component, const gchar * name);
+void      gst_omx_trace_record (GstOMXTraceType type, gconstpointer component,
+              guint32 port, gconstpointer buffer, guint64 pts, guint32 flags,
+              guint32 data1, guint32 data2, guint32 data3);
+
+G_END_DECLS
+
+#endif /* __GST_OMX_TRACE_H__ */
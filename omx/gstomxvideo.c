@@ -180,14 +180,154 @@ gst_omx_video_negotiation_map_free (GstOMXVideoNegotiationMap * m)
   g_slice_free (GstOMXVideoNegotiationMap, m);
 }
 
+typedef struct
+{
+  GstOMXVideoFrameIndex *index;
+  GstVideoCodecFrame *frame;
+  GstClockTime pts;
+} GstOMXVideoFrameIndexEntry;
+
+void
+gst_omx_video_frame_index_init (GstOMXVideoFrameIndex * index)
+{
+  g_mutex_init (&index->lock);
+  index->entries = g_ptr_array_new ();
+}
+
+void
+gst_omx_video_frame_index_clear (GstOMXVideoFrameIndex * index)
+{
+  guint i;
+
+  /* Only called from finalize, frames still alive, if any, will then only
+   * free their entry */
+  g_mutex_lock (&index->lock);
+  for (i = 0; i < index->entries->len; i++) {
+    GstOMXVideoFrameIndexEntry *entry = g_ptr_array_index (index->entries, i);
+
+    entry->index = NULL;
+  }
+  g_ptr_array_free (index->entries, TRUE);
+  index->entries = NULL;
+  g_mutex_unlock (&index->lock);
+
+  g_mutex_clear (&index->lock);
+}
+
+/* Returns the position of the first entry with a PTS > pts if upper is
+ * TRUE, >= pts otherwise.
+ * NOTE: Must be called with index->lock */
+static guint
+gst_omx_video_frame_index_search (GstOMXVideoFrameIndex * index,
+    GstClockTime pts, gboolean upper)
+{
+  guint lo = 0, hi = index->entries->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    GstOMXVideoFrameIndexEntry *entry =
+        g_ptr_array_index (index->entries, mid);
+
+    if (entry->pts < pts || (upper && entry->pts == pts))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+static void
+gst_omx_video_frame_index_entry_free (GstOMXVideoFrameIndexEntry * entry)
+{
+  GstOMXVideoFrameIndex *index = entry->index;
+  guint i;
+
+  if (!index)
+    goto done;
+
+  g_mutex_lock (&index->lock);
+  for (i = gst_omx_video_frame_index_search (index, entry->pts, FALSE);
+      i < index->entries->len; i++) {
+    if (g_ptr_array_index (index->entries, i) == entry) {
+      g_ptr_array_remove_index (index->entries, i);
+      break;
+    }
+  }
+  g_mutex_unlock (&index->lock);
+
+done:
+  g_slice_free (GstOMXVideoFrameIndexEntry, entry);
+}
+
+/* Invalid PTS sort last as GST_CLOCK_TIME_NONE is the largest value. Adding a
+ * frame which is already indexed, e.g. when receiving its subframes, does
+ * nothing. */
+void
+gst_omx_video_frame_index_add (GstOMXVideoFrameIndex * index,
+    GstVideoCodecFrame * frame)
+{
+  GstOMXVideoFrameIndexEntry *entry;
+
+  if (gst_video_codec_frame_get_user_data (frame))
+    return;
+
+  entry = g_slice_new (GstOMXVideoFrameIndexEntry);
+  entry->index = index;
+  entry->frame = frame;
+  entry->pts = frame->pts;
+
+  g_mutex_lock (&index->lock);
+  g_ptr_array_insert (index->entries,
+      gst_omx_video_frame_index_search (index, entry->pts, TRUE), entry);
+  g_mutex_unlock (&index->lock);
+
+  gst_video_codec_frame_set_user_data (frame, entry,
+      (GDestroyNotify) gst_omx_video_frame_index_entry_free);
+}
+
+/* Returns a new reference on every frame with a PTS older than timestamp, or
+ * with an invalid PTS if timestamp is invalid.
+ * NOTE: Must be called with the base class stream lock so the frames can't
+ * be finished, and freed, concurrently */
+GList *
+gst_omx_video_frame_index_get_older (GstOMXVideoFrameIndex * index,
+    GstClockTime timestamp)
+{
+  GList *frames = NULL;
+  guint i, start, end;
+
+  g_mutex_lock (&index->lock);
+  if (GST_CLOCK_TIME_IS_VALID (timestamp)) {
+    start = 0;
+    end = gst_omx_video_frame_index_search (index, timestamp, FALSE);
+  } else {
+    start = gst_omx_video_frame_index_search (index, GST_CLOCK_TIME_NONE,
+        FALSE);
+    end = index->entries->len;
+  }
+
+  for (i = end; i > start; i--) {
+    GstOMXVideoFrameIndexEntry *entry =
+        g_ptr_array_index (index->entries, i - 1);
+
+    frames = g_list_prepend (frames, gst_video_codec_frame_ref (entry->frame));
+  }
+  g_mutex_unlock (&index->lock);
+
+  return frames;
+}
+
+/* NOTE: Must be called with the base class stream lock so the returned
+ * frame can't be finished, and freed, concurrently */
 GstVideoCodecFrame *
 gst_omx_video_find_nearest_frame (GstElement * element, GstOMXBuffer * buf,
-    GList * frames)
+    GstOMXVideoFrameIndex * index)
 {
   GstVideoCodecFrame *best = NULL;
   GstClockTimeDiff best_diff = G_MAXINT64;
   GstClockTime timestamp;
-  GList *l;
+  guint candidates[3], i, n = 0, pos;
 
   timestamp =
       gst_util_uint64_scale (GST_OMX_GET_TICKS (buf->omx_buf->nTimeStamp),
@@ -196,8 +336,24 @@ gst_omx_video_find_nearest_frame (GstElement * element, GstOMXBuffer * buf,
   GST_LOG_OBJECT (element, "look for ts %" GST_TIME_FORMAT,
       GST_TIME_ARGS (timestamp));
 
-  for (l = frames; l; l = l->next) {
-    GstVideoCodecFrame *tmp = l->data;
+  g_mutex_lock (&index->lock);
+
+  /* The nearest frame with a valid PTS is either the last one before
+   * timestamp or the first one after. Frames without PTS are considered as
+   * well, the first of them as they are otherwise identical. */
+  pos = gst_omx_video_frame_index_search (index, timestamp, FALSE);
+  if (pos > 0)
+    candidates[n++] = pos - 1;
+  if (pos < index->entries->len)
+    candidates[n++] = pos;
+  pos = gst_omx_video_frame_index_search (index, GST_CLOCK_TIME_NONE, FALSE);
+  if (pos < index->entries->len && (n == 0 || candidates[n - 1] != pos))
+    candidates[n++] = pos;
+
+  for (i = 0; i < n; i++) {
+    GstOMXVideoFrameIndexEntry *entry =
+        g_ptr_array_index (index->entries, candidates[i]);
+    GstVideoCodecFrame *tmp = entry->frame;
     GstClockTimeDiff diff = ABS (GST_CLOCK_DIFF (timestamp, tmp->pts));
 
     GST_LOG_OBJECT (element,
@@ -207,15 +363,15 @@ gst_omx_video_find_nearest_frame (GstElement * element, GstOMXBuffer * buf,
     if (diff < best_diff) {
       best = tmp;
       best_diff = diff;
-
-      if (diff == 0)
-        break;
     }
   }
 
-  if (best) {
+  if (best)
     gst_video_codec_frame_ref (best);
 
+  g_mutex_unlock (&index->lock);
+
+  if (best) {
     /* OMX timestamps are in microseconds while gst ones are in nanoseconds.
      * So if the difference between them is higher than 1 microsecond we likely
      * picked the wrong frame. */
@@ -228,9 +384,6 @@ gst_omx_video_find_nearest_frame (GstElement * element, GstOMXBuffer * buf,
   } else
     GST_WARNING_OBJECT (element, "No best frame has been found");
 
-  g_list_foreach (frames, (GFunc) gst_video_codec_frame_unref, NULL);
-  g_list_free (frames);
-
   return best;
 }
 
@@ -354,3 +507,108 @@ gst_omx_video_get_port_padding (GstOMXPort * port, GstVideoInfo * info_orig,
 
   return TRUE;
 }
+
+/* Returns the offset of the first byte following the next 0x000001 start
+ * code prefix found from offset on, or -1 if there is none */
+gssize
+gst_omx_video_find_start_code (const guint8 * data, gsize size, gsize offset)
+{
+  gsize i;
+
+  for (i = offset; i + 3 <= size; i++) {
+    /* No start code can begin at i, i + 1 or i + 2 */
+    if (data[i + 2] > 1)
+      i += 2;
+    else if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1)
+      return i + 3;
+  }
+
+  return -1;
+}
+
+/* Returns the offset at which the NAL unit starting at offset ends, which is
+ * the beginning of the next start code or size */
+gsize
+gst_omx_video_find_nal_end (const guint8 * data, gsize size, gsize offset)
+{
+  gssize next = gst_omx_video_find_start_code (data, size, offset);
+
+  if (next < 0)
+    return size;
+
+  /* The zero_byte of a 4 bytes start code belongs to the next NAL too */
+  next -= 3;
+  if ((gsize) next > offset && data[next - 1] == 0)
+    next--;
+
+  return next;
+}
+
+/* Copies the NAL unit without its emulation prevention bytes, the returned
+ * data have to be freed with g_free() */
+guint8 *
+gst_omx_video_nal_to_rbsp (const guint8 * data, gsize size, gsize * rbsp_size)
+{
+  guint8 *rbsp = g_malloc (MAX (size, 1));
+  guint zeros = 0;
+  gsize i, n = 0;
+
+  for (i = 0; i < size; i++) {
+    /* 0x000003 is followed by a byte <= 0x03 in the NAL unit */
+    if (zeros >= 2 && data[i] == 0x03) {
+      zeros = 0;
+      continue;
+    }
+
+    zeros = data[i] == 0 ? zeros + 1 : 0;
+    rbsp[n++] = data[i];
+  }
+
+  *rbsp_size = n;
+
+  return rbsp;
+}
+
+/* Reads an unsigned Exp-Golomb code, ue(v) */
+gboolean
+gst_omx_video_read_ue (GstBitReader * br, guint32 * value)
+{
+  guint leading_zeros = 0;
+  guint8 bit;
+  guint32 suffix;
+
+  while (TRUE) {
+    if (!gst_bit_reader_get_bits_uint8 (br, &bit, 1))
+      return FALSE;
+    if (bit)
+      break;
+    if (++leading_zeros > 31)
+      return FALSE;
+  }
+
+  if (leading_zeros == 0) {
+    *value = 0;
+    return TRUE;
+  }
+
+  if (!gst_bit_reader_get_bits_uint32 (br, &suffix, leading_zeros))
+    return FALSE;
+
+  *value = (1u << leading_zeros) - 1 + suffix;
+
+  return TRUE;
+}
+
+/* Reads a signed Exp-Golomb code, se(v) */
+gboolean
+gst_omx_video_read_se (GstBitReader * br, gint32 * value)
+{
+  guint32 code;
+
+  if (!gst_omx_video_read_ue (br, &code))
+    return FALSE;
+
+  *value = (code & 1) ? (gint32) ((code >> 1) + 1) : -(gint32) (code >> 1);
+
+  return TRUE;
+}
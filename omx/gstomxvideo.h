@@ -29,6 +29,7 @@
 #include <gst/video/video.h>
 #include <gst/video/gstvideodecoder.h>
 #include <gst/video/gstvideoencoder.h>
+#include <gst/base/gstbitreader.h>
 
 #include "gstomx.h"
 
@@ -47,6 +48,20 @@ typedef struct
   OMX_COLOR_FORMATTYPE type;
 } GstOMXVideoNegotiationMap;
 
+typedef struct _GstOMXVideoFrameIndex GstOMXVideoFrameIndex;
+
+/* Pending codec frames sorted by PTS, so the frame matching an output
+ * buffer can be found without walking all of them. Frames are added in
+ * ::handle_frame() and remove themselves from the index when they are
+ * freed, the index doesn't hold a reference on them. */
+struct _GstOMXVideoFrameIndex
+{
+  GMutex lock;
+  /* GstOMXVideoFrameIndexEntry, sorted by PTS then insertion order.
+   * Protected by lock */
+  GPtrArray *entries;
+};
+
 GstVideoFormat
 gst_omx_video_get_format_from_omx (OMX_COLOR_FORMATTYPE omx_colorformat);
 
@@ -59,8 +74,16 @@ GstCaps * gst_omx_video_get_caps_for_map(GList * map);
 void
 gst_omx_video_negotiation_map_free (GstOMXVideoNegotiationMap * m);
 
+void gst_omx_video_frame_index_init (GstOMXVideoFrameIndex * index);
+void gst_omx_video_frame_index_clear (GstOMXVideoFrameIndex * index);
+void gst_omx_video_frame_index_add (GstOMXVideoFrameIndex * index,
+    GstVideoCodecFrame * frame);
+GList * gst_omx_video_frame_index_get_older (GstOMXVideoFrameIndex * index,
+    GstClockTime timestamp);
+
 GstVideoCodecFrame *
-gst_omx_video_find_nearest_frame (GstElement * element, GstOMXBuffer * buf, GList * frames);
+gst_omx_video_find_nearest_frame (GstElement * element, GstOMXBuffer * buf,
+    GstOMXVideoFrameIndex * index);
 
 OMX_U32 gst_omx_video_calculate_framerate_q16 (GstVideoInfo * info);
 
@@ -69,6 +92,50 @@ gboolean gst_omx_video_is_equal_framerate_q16 (OMX_U32 q16_a, OMX_U32 q16_b);
 gboolean gst_omx_video_get_port_padding (GstOMXPort * port, GstVideoInfo * info_orig,
     GstVideoAlignment * align);
 
+gssize gst_omx_video_find_start_code (const guint8 * data, gsize size,
+    gsize offset);
+gsize gst_omx_video_find_nal_end (const guint8 * data, gsize size,
+    gsize offset);
+
+/* Used by the header parsers, they jump to their failed label when the
+ * data end before the value */
+#define GST_OMX_VIDEO_READ_BITS(br, val, nbits) G_STMT_START { \
+  guint32 _tmp; \
+  if (!gst_bit_reader_get_bits_uint32 ((br), &_tmp, (nbits))) \
+    goto failed; \
+  (val) = _tmp; \
+} G_STMT_END
+
+#define GST_OMX_VIDEO_READ_UE(br, val) G_STMT_START { \
+  guint32 _tmp; \
+  if (!gst_omx_video_read_ue ((br), &_tmp)) \
+    goto failed; \
+  (val) = _tmp; \
+} G_STMT_END
+
+#define GST_OMX_VIDEO_READ_SE(br, val) G_STMT_START { \
+  gint32 _tmp; \
+  if (!gst_omx_video_read_se ((br), &_tmp)) \
+    goto failed; \
+  (val) = _tmp; \
+} G_STMT_END
+
+#define GST_OMX_VIDEO_SKIP_UE(br) G_STMT_START { \
+  guint32 _tmp; \
+  if (!gst_omx_video_read_ue ((br), &_tmp)) \
+    goto failed; \
+} G_STMT_END
+
+#define GST_OMX_VIDEO_SKIP_BITS(br, nbits) G_STMT_START { \
+  if (!gst_bit_reader_skip ((br), (nbits))) \
+    goto failed; \
+} G_STMT_END
+
+guint8 * gst_omx_video_nal_to_rbsp (const guint8 * data, gsize size,
+    gsize * rbsp_size);
+gboolean gst_omx_video_read_ue (GstBitReader * br, guint32 * value);
+gboolean gst_omx_video_read_se (GstBitReader * br, gint32 * value);
+
 G_END_DECLS
 
 #endif /* __GST_OMX_VIDEO_H__ */
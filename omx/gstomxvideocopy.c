@@ -0,0 +1,973 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_COPY_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define HAVE_COPY_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include "gstomxvideocopy.h"
+
+/* Planes bigger than this are copied with non-temporal stores, if
+ * available. Such a copy would evict most of the cache anyway and its
+ * destination isn't read again by us, e.g. a 4K luma plane */
+#define NON_TEMPORAL_THRESHOLD (4 * 1024 * 1024)
+
+/* Planes bigger than this are split in bands of lines copied in parallel
+ * by the copy pool, if any. 1080p planes and below stay single-threaded */
+#define PARALLEL_THRESHOLD (2 * 1024 * 1024)
+
+#define MAX_THREADS (16)
+#define AUTO_MAX_THREADS (4)
+
+typedef void (*CopyPlaneFunc) (guint8 * dest, gint dest_stride,
+    const guint8 * src, gint src_stride, gsize width, guint height,
+    gboolean stream);
+
+typedef struct
+{
+  const gchar *name;
+  CopyPlaneFunc func;
+} CopyPlaneImpl;
+
+static void
+copy_plane_c (guint8 * dest, gint dest_stride, const guint8 * src,
+    gint src_stride, gsize width, guint height, gboolean stream)
+{
+  guint h;
+
+  if (dest_stride == src_stride && width == (gsize) src_stride) {
+    memcpy (dest, src, width * height);
+    return;
+  }
+
+  for (h = 0; h < height; h++) {
+    memcpy (dest, src, width);
+    dest += dest_stride;
+    src += src_stride;
+  }
+}
+
+#ifdef HAVE_COPY_X86
+/* Loads are unaligned, stores are aligned on the destination which is
+ * what the non-temporal stores require */
+__attribute__ ((target ("sse2")))
+static void
+copy_plane_sse2 (guint8 * dest, gint dest_stride, const guint8 * src,
+    gint src_stride, gsize width, guint height, gboolean stream)
+{
+  guint h;
+
+  for (h = 0; h < height; h++) {
+    guint8 *d = dest;
+    const guint8 *s = src;
+    gsize n = width, head;
+
+    head = MIN (n, (16 - ((guintptr) d & 15)) & 15);
+    memcpy (d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    if (stream) {
+      for (; n >= 64; n -= 64, s += 64, d += 64) {
+        __m128i a = _mm_loadu_si128 ((const __m128i *) s);
+        __m128i b = _mm_loadu_si128 ((const __m128i *) (s + 16));
+        __m128i c = _mm_loadu_si128 ((const __m128i *) (s + 32));
+        __m128i e = _mm_loadu_si128 ((const __m128i *) (s + 48));
+
+        _mm_stream_si128 ((__m128i *) d, a);
+        _mm_stream_si128 ((__m128i *) (d + 16), b);
+        _mm_stream_si128 ((__m128i *) (d + 32), c);
+        _mm_stream_si128 ((__m128i *) (d + 48), e);
+      }
+    } else {
+      for (; n >= 64; n -= 64, s += 64, d += 64) {
+        __m128i a = _mm_loadu_si128 ((const __m128i *) s);
+        __m128i b = _mm_loadu_si128 ((const __m128i *) (s + 16));
+        __m128i c = _mm_loadu_si128 ((const __m128i *) (s + 32));
+        __m128i e = _mm_loadu_si128 ((const __m128i *) (s + 48));
+
+        _mm_store_si128 ((__m128i *) d, a);
+        _mm_store_si128 ((__m128i *) (d + 16), b);
+        _mm_store_si128 ((__m128i *) (d + 32), c);
+        _mm_store_si128 ((__m128i *) (d + 48), e);
+      }
+    }
+
+    for (; n >= 16; n -= 16, s += 16, d += 16)
+      _mm_store_si128 ((__m128i *) d, _mm_loadu_si128 ((const __m128i *) s));
+    memcpy (d, s, n);
+
+    dest += dest_stride;
+    src += src_stride;
+  }
+
+  if (stream)
+    _mm_sfence ();
+}
+
+__attribute__ ((target ("avx2")))
+static void
+copy_plane_avx2 (guint8 * dest, gint dest_stride, const guint8 * src,
+    gint src_stride, gsize width, guint height, gboolean stream)
+{
+  guint h;
+
+  for (h = 0; h < height; h++) {
+    guint8 *d = dest;
+    const guint8 *s = src;
+    gsize n = width, head;
+
+    head = MIN (n, (32 - ((guintptr) d & 31)) & 31);
+    memcpy (d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    if (stream) {
+      for (; n >= 128; n -= 128, s += 128, d += 128) {
+        __m256i a = _mm256_loadu_si256 ((const __m256i *) s);
+        __m256i b = _mm256_loadu_si256 ((const __m256i *) (s + 32));
+        __m256i c = _mm256_loadu_si256 ((const __m256i *) (s + 64));
+        __m256i e = _mm256_loadu_si256 ((const __m256i *) (s + 96));
+
+        _mm256_stream_si256 ((__m256i *) d, a);
+        _mm256_stream_si256 ((__m256i *) (d + 32), b);
+        _mm256_stream_si256 ((__m256i *) (d + 64), c);
+        _mm256_stream_si256 ((__m256i *) (d + 96), e);
+      }
+    } else {
+      for (; n >= 128; n -= 128, s += 128, d += 128) {
+        __m256i a = _mm256_loadu_si256 ((const __m256i *) s);
+        __m256i b = _mm256_loadu_si256 ((const __m256i *) (s + 32));
+        __m256i c = _mm256_loadu_si256 ((const __m256i *) (s + 64));
+        __m256i e = _mm256_loadu_si256 ((const __m256i *) (s + 96));
+
+        _mm256_store_si256 ((__m256i *) d, a);
+        _mm256_store_si256 ((__m256i *) (d + 32), b);
+        _mm256_store_si256 ((__m256i *) (d + 64), c);
+        _mm256_store_si256 ((__m256i *) (d + 96), e);
+      }
+    }
+
+    for (; n >= 32; n -= 32, s += 32, d += 32)
+      _mm256_store_si256 ((__m256i *) d,
+          _mm256_loadu_si256 ((const __m256i *) s));
+    memcpy (d, s, n);
+
+    dest += dest_stride;
+    src += src_stride;
+  }
+
+  if (stream)
+    _mm_sfence ();
+}
+#endif
+
+#ifdef HAVE_COPY_NEON
+/* There is no intrinsic for non-temporal stores (STNP) so stream is
+ * ignored */
+static void
+copy_plane_neon (guint8 * dest, gint dest_stride, const guint8 * src,
+    gint src_stride, gsize width, guint height, gboolean stream)
+{
+  guint h;
+
+  for (h = 0; h < height; h++) {
+    guint8 *d = dest;
+    const guint8 *s = src;
+    gsize n = width;
+
+    for (; n >= 64; n -= 64, s += 64, d += 64) {
+      uint8x16_t a = vld1q_u8 (s);
+      uint8x16_t b = vld1q_u8 (s + 16);
+      uint8x16_t c = vld1q_u8 (s + 32);
+      uint8x16_t e = vld1q_u8 (s + 48);
+
+      vst1q_u8 (d, a);
+      vst1q_u8 (d + 16, b);
+      vst1q_u8 (d + 32, c);
+      vst1q_u8 (d + 48, e);
+    }
+    for (; n >= 16; n -= 16, s += 16, d += 16)
+      vst1q_u8 (d, vld1q_u8 (s));
+    memcpy (d, s, n);
+
+    dest += dest_stride;
+    src += src_stride;
+  }
+}
+#endif
+
+/* Sorted by preference */
+static const CopyPlaneImpl copy_plane_impls[] = {
+#ifdef HAVE_COPY_X86
+  {"avx2", copy_plane_avx2},
+  {"sse2", copy_plane_sse2},
+#endif
+#ifdef HAVE_COPY_NEON
+  {"neon", copy_plane_neon},
+#endif
+  {"c", copy_plane_c},
+};
+
+static gboolean
+copy_plane_impl_supported (const CopyPlaneImpl * impl)
+{
+#ifdef HAVE_COPY_X86
+  __builtin_cpu_init ();
+  if (impl->func == copy_plane_avx2)
+    return __builtin_cpu_supports ("avx2");
+  if (impl->func == copy_plane_sse2)
+    return __builtin_cpu_supports ("sse2");
+#endif
+
+  return TRUE;
+}
+
+/* GST_OMX_VIDEO_COPY can be set to the name of an implementation to
+ * compare them */
+static gpointer
+copy_plane_impl_select (gpointer data)
+{
+  const gchar *env = g_getenv ("GST_OMX_VIDEO_COPY");
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (copy_plane_impls); i++) {
+    const CopyPlaneImpl *impl = &copy_plane_impls[i];
+
+    if (env && !g_str_equal (env, impl->name))
+      continue;
+    if (copy_plane_impl_supported (impl))
+      return (gpointer) impl;
+  }
+
+  return (gpointer) & copy_plane_impls[G_N_ELEMENTS (copy_plane_impls) - 1];
+}
+
+static const CopyPlaneImpl *
+copy_plane_impl_get (void)
+{
+  static GOnce once = G_ONCE_INIT;
+
+  return g_once (&once, copy_plane_impl_select, NULL);
+}
+
+struct _GstOMXVideoCopyPool
+{
+  gint refcount;
+  /* NULL if single-threaded */
+  GThreadPool *workers;
+  guint n_threads;
+  /* Lazy copies not done nor dropped yet, atomic */
+  gint n_lazy;
+};
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  guint pending;
+} CopyBandsDone;
+
+typedef struct
+{
+  CopyPlaneFunc func;
+  guint8 *dest;
+  gint dest_stride;
+  const guint8 *src;
+  gint src_stride;
+  gsize width;
+  guint height;
+  gboolean stream;
+  CopyBandsDone *done;
+} CopyBand;
+
+static void
+copy_band_run (CopyBand * band)
+{
+  band->func (band->dest, band->dest_stride, band->src, band->src_stride,
+      band->width, band->height, band->stream);
+}
+
+static void
+copy_pool_worker (CopyBand * band, GstOMXVideoCopyPool * pool)
+{
+  CopyBandsDone *done = band->done;
+
+  copy_band_run (band);
+
+  g_mutex_lock (&done->lock);
+  if (--done->pending == 0)
+    g_cond_signal (&done->cond);
+  g_mutex_unlock (&done->lock);
+}
+
+/* Creates a pool of threads to split the copies of large planes. n_threads
+ * includes the calling thread, 0 picks a number depending on the number
+ * of CPUs. The copy functions also accept a NULL pool, in which case they
+ * are single-threaded and never lazy */
+GstOMXVideoCopyPool *
+gst_omx_video_copy_pool_new (guint n_threads)
+{
+  GstOMXVideoCopyPool *pool;
+
+  if (n_threads == 0)
+    n_threads = MIN (g_get_num_processors (), AUTO_MAX_THREADS);
+  n_threads = CLAMP (n_threads, 1, MAX_THREADS);
+
+  pool = g_slice_new0 (GstOMXVideoCopyPool);
+  pool->refcount = 1;
+  pool->n_threads = 1;
+
+  /* Not exclusive so no thread is started before the first plane above
+   * PARALLEL_THRESHOLD is copied, and the threads are shared with the
+   * other pools and kept around by GLib only while they are used */
+  if (n_threads > 1) {
+    pool->workers = g_thread_pool_new ((GFunc) copy_pool_worker, pool,
+        n_threads - 1, FALSE, NULL);
+    pool->n_threads = n_threads;
+  }
+
+  return pool;
+}
+
+GstOMXVideoCopyPool *
+gst_omx_video_copy_pool_ref (GstOMXVideoCopyPool * pool)
+{
+  g_atomic_int_inc (&pool->refcount);
+
+  return pool;
+}
+
+/* The pool is kept alive by the pending lazy copies */
+void
+gst_omx_video_copy_pool_unref (GstOMXVideoCopyPool * pool)
+{
+  if (!g_atomic_int_dec_and_test (&pool->refcount))
+    return;
+
+  if (pool->workers)
+    g_thread_pool_free (pool->workers, FALSE, TRUE);
+  g_slice_free (GstOMXVideoCopyPool, pool);
+}
+
+guint
+gst_omx_video_copy_pool_get_n_threads (GstOMXVideoCopyPool * pool)
+{
+  return pool ? pool->n_threads : 1;
+}
+
+/* Copies height lines of width bytes */
+static void
+copy_plane (GstOMXVideoCopyPool * pool, guint8 * dest, gint dest_stride,
+    const guint8 * src, gint src_stride, gsize width, guint height)
+{
+  CopyPlaneFunc func = copy_plane_impl_get ()->func;
+  CopyBand bands[MAX_THREADS];
+  CopyBandsDone done;
+  gsize size = width * height;
+  guint i, n;
+
+  n = pool && pool->workers && size >= PARALLEL_THRESHOLD ?
+      MIN (pool->n_threads, height) : 1;
+
+  for (i = 0; i < n; i++) {
+    guint start = (guint64) height * i / n;
+    guint end = (guint64) height * (i + 1) / n;
+
+    bands[i].func = func;
+    bands[i].dest = dest + (gsize) start * dest_stride;
+    bands[i].dest_stride = dest_stride;
+    bands[i].src = src + (gsize) start * src_stride;
+    bands[i].src_stride = src_stride;
+    bands[i].width = width;
+    bands[i].height = end - start;
+    bands[i].stream = size > NON_TEMPORAL_THRESHOLD;
+    bands[i].done = &done;
+  }
+
+  if (n == 1) {
+    copy_band_run (&bands[0]);
+    return;
+  }
+
+  g_mutex_init (&done.lock);
+  g_cond_init (&done.cond);
+  done.pending = n - 1;
+
+  for (i = 1; i < n; i++)
+    g_thread_pool_push (pool->workers, &bands[i], NULL);
+
+  /* The first band is copied by the calling thread */
+  copy_band_run (&bands[0]);
+
+  g_mutex_lock (&done.lock);
+  while (done.pending > 0)
+    g_cond_wait (&done.cond, &done.lock);
+  g_mutex_unlock (&done.lock);
+
+  g_mutex_clear (&done.lock);
+  g_cond_clear (&done.cond);
+}
+
+/* Returns the name of the plane copy implementation used on this CPU */
+const gchar *
+gst_omx_video_copy_get_implementation (void)
+{
+  return copy_plane_impl_get ()->name;
+}
+
+/* Copies a decoded frame of one of GST_OMX_VIDEO_DEC_SUPPORTED_FORMATS
+ * from an OpenMAX buffer with different strides */
+gboolean
+gst_omx_video_copy_from_omx (GstOMXVideoCopyPool * pool, GstVideoFrame * frame,
+    const guint8 * src, guint nstride, guint nslice)
+{
+  const GstVideoInfo *vinfo = &frame->info;
+  guint src_stride[GST_VIDEO_MAX_PLANES] = { nstride, 0, };
+  guint src_size[GST_VIDEO_MAX_PLANES] = { nstride * nslice, 0, };
+  gint dst_width[GST_VIDEO_MAX_PLANES] = { 0, };
+  gint dst_height[GST_VIDEO_MAX_PLANES] =
+      { GST_VIDEO_INFO_FIELD_HEIGHT (vinfo), 0, };
+  guint p;
+
+  switch (GST_VIDEO_INFO_FORMAT (vinfo)) {
+    case GST_VIDEO_FORMAT_ABGR:
+    case GST_VIDEO_FORMAT_ARGB:
+      dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo) * 4;
+      break;
+    case GST_VIDEO_FORMAT_RGB16:
+    case GST_VIDEO_FORMAT_BGR16:
+    case GST_VIDEO_FORMAT_YUY2:
+    case GST_VIDEO_FORMAT_UYVY:
+    case GST_VIDEO_FORMAT_YVYU:
+      dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo) * 2;
+      break;
+    case GST_VIDEO_FORMAT_GRAY8:
+      dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo);
+      break;
+    case GST_VIDEO_FORMAT_I420:
+      dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo);
+      src_stride[1] = nstride / 2;
+      src_size[1] = (src_stride[1] * nslice) / 2;
+      dst_width[1] = GST_VIDEO_INFO_WIDTH (vinfo) / 2;
+      dst_height[1] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo) / 2;
+      src_stride[2] = nstride / 2;
+      src_size[2] = (src_stride[1] * nslice) / 2;
+      dst_width[2] = GST_VIDEO_INFO_WIDTH (vinfo) / 2;
+      dst_height[2] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo) / 2;
+      break;
+    case GST_VIDEO_FORMAT_NV12:
+      dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo);
+      src_stride[1] = nstride;
+      src_size[1] = src_stride[1] * nslice / 2;
+      dst_width[1] = GST_VIDEO_INFO_WIDTH (vinfo);
+      dst_height[1] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo) / 2;
+      break;
+    case GST_VIDEO_FORMAT_NV16:
+      dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo);
+      src_stride[1] = nstride;
+      src_size[1] = src_stride[1] * nslice;
+      dst_width[1] = GST_VIDEO_INFO_WIDTH (vinfo);
+      dst_height[1] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo);
+      break;
+    case GST_VIDEO_FORMAT_NV12_10LE32:
+      /* Need ((width + 2) / 3) 32-bits words */
+      dst_width[0] = (GST_VIDEO_INFO_WIDTH (vinfo) + 2) / 3 * 4;
+      dst_width[1] = dst_width[0];
+      src_stride[1] = nstride;
+      src_size[1] = src_stride[1] * nslice / 2;
+      dst_height[1] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo) / 2;
+      break;
+    case GST_VIDEO_FORMAT_NV16_10LE32:
+      /* Need ((width + 2) / 3) 32-bits words */
+      dst_width[0] = (GST_VIDEO_INFO_WIDTH (vinfo) + 2) / 3 * 4;
+      dst_width[1] = dst_width[0];
+      src_stride[1] = nstride;
+      src_size[1] = src_stride[1] * nslice;
+      dst_height[1] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo);
+      break;
+    default:
+      g_return_val_if_reached (FALSE);
+  }
+
+  for (p = 0; p < GST_VIDEO_INFO_N_PLANES (vinfo); p++) {
+    copy_plane (pool, GST_VIDEO_FRAME_PLANE_DATA (frame, p),
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, p), src, src_stride[p],
+        dst_width[p], dst_height[p]);
+    src += src_size[p];
+  }
+
+  return TRUE;
+}
+
+static gboolean
+copy_plane_to_omx (GstOMXVideoCopyPool * pool, GstVideoFrame * frame, guint i,
+    guint8 * dest, gsize dest_size, guint nstride, guint nslice,
+    gsize * filled)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  guint8 *dest_end = dest + dest_size;
+  guint8 *src;
+  gint src_stride, dest_stride;
+  gint height, width;
+
+  src_stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, i);
+  dest_stride = nstride;
+  /* XXX: Try this if no stride was set */
+  if (dest_stride == 0)
+    dest_stride = src_stride;
+
+  if (i == 1)
+    dest += nslice * nstride;
+
+  src = GST_VIDEO_FRAME_COMP_DATA (frame, i);
+  height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, i);
+  width = GST_VIDEO_FRAME_COMP_WIDTH (frame, i) * (i == 0 ? 1 : 2);
+
+  if (GST_VIDEO_FORMAT_INFO_BITS (finfo) == 10)
+    /* Need ((width + 2) / 3) 32-bits words */
+    width = (width + 2) / 3 * 4;
+
+  if (dest + dest_stride * height > dest_end)
+    return FALSE;
+
+  copy_plane (pool, dest, dest_stride, src, src_stride, width, height);
+
+  /* nFilledLen should include the vertical padding in each slice (spec 3.1.3.7.1) */
+  *filled += GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, i, nslice) * nstride;
+
+  return TRUE;
+}
+
+/* Copies a raw frame of one of GST_OMX_VIDEO_ENC_SUPPORTED_FORMATS to an
+ * OpenMAX buffer of dest_size bytes with different strides. Returns FALSE
+ * if the buffer is too small */
+gboolean
+gst_omx_video_copy_to_omx (GstOMXVideoCopyPool * pool, GstVideoFrame * frame,
+    guint8 * dest, gsize dest_size, guint nstride, guint nslice,
+    gsize * filled)
+{
+  gint i, height, width;
+
+  *filled = 0;
+
+  switch (GST_VIDEO_FRAME_FORMAT (frame)) {
+    case GST_VIDEO_FORMAT_I420:
+      for (i = 0; i < 3; i++) {
+        guint8 *src, *d;
+        gint src_stride, dest_stride;
+
+        if (i == 0) {
+          dest_stride = nstride;
+        } else {
+          dest_stride = nstride / 2;
+        }
+
+        src_stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, i);
+        /* XXX: Try this if no stride was set */
+        if (dest_stride == 0)
+          dest_stride = src_stride;
+
+        d = dest;
+        if (i > 0)
+          d += nslice * nstride;
+        if (i == 2)
+          d += (nslice / 2) * (nstride / 2);
+
+        src = GST_VIDEO_FRAME_COMP_DATA (frame, i);
+        height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, i);
+        width = GST_VIDEO_FRAME_COMP_WIDTH (frame, i);
+
+        if (d + dest_stride * height > dest + dest_size)
+          return FALSE;
+
+        copy_plane (pool, d, dest_stride, src, src_stride, width, height);
+
+        /* nFilledLen should include the vertical padding in each slice (spec 3.1.3.7.1) */
+        if (i == 0)
+          *filled += nslice * nstride;
+        else
+          *filled += (nslice / 2) * (nstride / 2);
+      }
+      return TRUE;
+    case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_NV16:
+    case GST_VIDEO_FORMAT_NV12_10LE32:
+    case GST_VIDEO_FORMAT_NV16_10LE32:
+      for (i = 0; i < 2; i++) {
+        if (!copy_plane_to_omx (pool, frame, i, dest, dest_size, nstride,
+                nslice, filled))
+          return FALSE;
+      }
+      return TRUE;
+    case GST_VIDEO_FORMAT_GRAY8:
+      return copy_plane_to_omx (pool, frame, 0, dest, dest_size, nstride,
+          nslice, filled);
+    default:
+      g_return_val_if_reached (FALSE);
+  }
+}
+
+/* Returns the number of bytes of the lines of plane p and sets comp to its
+ * first component, or returns 0 if the plane isn't made of lines */
+static gsize
+plane_line_size (const GstVideoFrame * frame, guint p, guint * comp)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  gsize width;
+  guint c;
+
+  for (c = 0; GST_VIDEO_FORMAT_INFO_PLANE (finfo, c) != p; c++);
+  *comp = c;
+
+  width = GST_VIDEO_FRAME_COMP_WIDTH (frame, c) *
+      GST_VIDEO_FRAME_COMP_PSTRIDE (frame, c);
+  if (GST_VIDEO_FORMAT_INFO_BITS (finfo) == 10 && width == 0)
+    /* Packed NV12_10LE32/NV16_10LE32, ((width + 2) / 3) 32-bits words */
+    width = (GST_VIDEO_FRAME_COMP_WIDTH (frame, c) * (p == 0 ? 1 : 2)
+        + 2) / 3 * 4;
+
+  return width;
+}
+
+static gboolean
+frame_is_raster (const GstVideoFrame * frame)
+{
+  guint p, c;
+
+  for (p = 0; p < GST_VIDEO_FRAME_N_PLANES (frame); p++) {
+    if (plane_line_size (frame, p, &c) == 0)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Copies frame to data laid out as described by info */
+static void
+copy_frame_to_data (GstOMXVideoCopyPool * pool, const GstVideoFrame * frame,
+    const GstVideoInfo * info, guint8 * data)
+{
+  guint p, c;
+
+  for (p = 0; p < GST_VIDEO_FRAME_N_PLANES (frame); p++) {
+    gsize width = plane_line_size (frame, p, &c);
+
+    copy_plane (pool, data + GST_VIDEO_INFO_PLANE_OFFSET (info, p),
+        GST_VIDEO_INFO_PLANE_STRIDE (info, p),
+        GST_VIDEO_FRAME_PLANE_DATA (frame, p),
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, p), width,
+        GST_VIDEO_FRAME_COMP_HEIGHT (frame, c));
+  }
+}
+
+/* Returns a buffer of at least size bytes for a copy, recycled from
+ * out_pool if possible. Unless wait is TRUE a new buffer is allocated
+ * instead of waiting for out_pool to have one available */
+static GstBuffer *
+acquire_copy_buffer (GstBufferPool * out_pool, gsize size, gboolean wait)
+{
+  GstBufferPoolAcquireParams params = { 0, };
+  GstBuffer *buf = NULL;
+
+  if (!wait)
+    params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+
+  if (out_pool
+      && gst_buffer_pool_acquire_buffer (out_pool, &buf,
+          &params) == GST_FLOW_OK) {
+    if (gst_buffer_get_size (buf) >= size)
+      return buf;
+    gst_buffer_unref (buf);
+  }
+
+  return gst_buffer_new_and_alloc (size);
+}
+
+/* Copies buf into a buffer from out_pool, or newly allocated if NULL, with
+ * the default layout of info, e.g. when buf is from a pool that needs to
+ * get it back. Consumes buf */
+GstBuffer *
+gst_omx_video_copy_buffer (GstOMXVideoCopyPool * pool,
+    GstBufferPool * out_pool, const GstVideoInfo * info, GstBuffer * buf)
+{
+  GstVideoInfo out_info, tmp_info;
+  GstBuffer *tmpbuf;
+  GstVideoFrame out_frame, tmp_frame;
+
+  out_info = *info;
+  tmp_info = *info;
+
+  tmpbuf = acquire_copy_buffer (out_pool, out_info.size, TRUE);
+
+  gst_video_frame_map (&out_frame, &out_info, buf, GST_MAP_READ);
+  gst_video_frame_map (&tmp_frame, &tmp_info, tmpbuf, GST_MAP_WRITE);
+
+  /* The frames handle the stride/offset/etc from the source buffer */
+  if (frame_is_raster (&out_frame))
+    copy_frame_to_data (pool, &out_frame, &tmp_frame.info,
+        GST_VIDEO_FRAME_PLANE_DATA (&tmp_frame, 0) -
+        GST_VIDEO_FRAME_PLANE_OFFSET (&tmp_frame, 0));
+  else
+    gst_video_frame_copy (&tmp_frame, &out_frame);
+
+  gst_video_frame_unmap (&out_frame);
+  gst_video_frame_unmap (&tmp_frame);
+
+  /* It doesn't copy buffer flags so do it manually. */
+  gst_buffer_copy_into (tmpbuf, buf, GST_BUFFER_COPY_FLAGS, 0, -1);
+
+  gst_buffer_unref (buf);
+
+  return tmpbuf;
+}
+
+/* Memory copying a video buffer the first time it is mapped */
+
+#define GST_OMX_VIDEO_COPY_MEMORY_TYPE "OMXVideoCopy"
+
+typedef struct
+{
+  GstMemory mem;
+
+  GMutex lock;
+  GstOMXVideoCopyPool *pool;
+  GstBufferPool *out_pool;
+  GstVideoInfo info;
+  /* Buffer to copy, until the memory is mapped. Protected by lock */
+  GstBuffer *src;
+  /* The copy, once the memory has been mapped. Protected by lock */
+  GstBuffer *dest;
+} GstOMXVideoCopyMemory;
+
+typedef GstAllocator GstOMXVideoCopyAllocator;
+typedef GstAllocatorClass GstOMXVideoCopyAllocatorClass;
+
+GType gst_omx_video_copy_allocator_get_type (void);
+G_DEFINE_TYPE (GstOMXVideoCopyAllocator, gst_omx_video_copy_allocator,
+    GST_TYPE_ALLOCATOR);
+
+/* Releases src, and the OMX buffer it wraps.
+ * NOTE: Must be called with mem->lock */
+static void
+gst_omx_video_copy_memory_release_src (GstOMXVideoCopyMemory * mem)
+{
+  gst_buffer_unref (mem->src);
+  mem->src = NULL;
+  g_atomic_int_add (&mem->pool->n_lazy, -1);
+}
+
+/* Copies src to dest, unless done already. The destination buffer is
+ * allocated if out_pool has none available as this might be called from
+ * any thread, including the one that would return buffers to out_pool.
+ * NOTE: Must be called with mem->lock */
+static gboolean
+gst_omx_video_copy_memory_ensure_dest (GstOMXVideoCopyMemory * mem)
+{
+  GstVideoFrame frame;
+  GstMapInfo map;
+
+  if (mem->dest)
+    return TRUE;
+
+  mem->dest = acquire_copy_buffer (mem->out_pool,
+      GST_VIDEO_INFO_SIZE (&mem->info), FALSE);
+  if (!gst_buffer_map (mem->dest, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (mem->dest);
+    mem->dest = NULL;
+    return FALSE;
+  }
+
+  if (gst_video_frame_map (&frame, &mem->info, mem->src, GST_MAP_READ)) {
+    copy_frame_to_data (mem->pool, &frame, &mem->info, map.data);
+    gst_video_frame_unmap (&frame);
+  } else {
+    memset (map.data, 0, GST_VIDEO_INFO_SIZE (&mem->info));
+  }
+  gst_buffer_unmap (mem->dest, &map);
+
+  gst_omx_video_copy_memory_release_src (mem);
+
+  return TRUE;
+}
+
+/* Maps the copy with the flags of info, the map of the copy is kept in
+ * the user data of info until unmapped */
+static gpointer
+gst_omx_video_copy_memory_map_full (GstMemory * mem, GstMapInfo * info,
+    gsize maxsize)
+{
+  GstOMXVideoCopyMemory *cmem = (GstOMXVideoCopyMemory *) mem;
+  GstMapInfo *dest_map;
+  gpointer data = NULL;
+
+  g_mutex_lock (&cmem->lock);
+  if (!gst_omx_video_copy_memory_ensure_dest (cmem))
+    goto done;
+
+  dest_map = g_slice_new (GstMapInfo);
+  if (!gst_buffer_map (cmem->dest, dest_map, info->flags)) {
+    g_slice_free (GstMapInfo, dest_map);
+    goto done;
+  }
+
+  info->user_data[0] = dest_map;
+  data = dest_map->data;
+
+done:
+  g_mutex_unlock (&cmem->lock);
+
+  return data;
+}
+
+static void
+gst_omx_video_copy_memory_unmap_full (GstMemory * mem, GstMapInfo * info)
+{
+  GstOMXVideoCopyMemory *cmem = (GstOMXVideoCopyMemory *) mem;
+  GstMapInfo *dest_map = info->user_data[0];
+
+  gst_buffer_unmap (cmem->dest, dest_map);
+  g_slice_free (GstMapInfo, dest_map);
+}
+
+static GstMemory *
+gst_omx_video_copy_memory_copy (GstMemory * mem, gssize offset, gssize size)
+{
+  GstMemory *copy;
+  GstMapInfo map;
+
+  if (size == -1)
+    size = mem->size > offset ? mem->size - offset : 0;
+
+  if (!gst_memory_map (mem, &map, GST_MAP_READ))
+    return NULL;
+
+  copy = gst_allocator_alloc (NULL, size, NULL);
+  gst_memory_fill (copy, 0, map.data + offset, size);
+  gst_memory_unmap (mem, &map);
+
+  return copy;
+}
+
+static void
+gst_omx_video_copy_allocator_free (GstAllocator * allocator, GstMemory * mem)
+{
+  GstOMXVideoCopyMemory *cmem = (GstOMXVideoCopyMemory *) mem;
+
+  /* Dropped without having been mapped */
+  if (cmem->src)
+    gst_omx_video_copy_memory_release_src (cmem);
+
+  if (cmem->dest)
+    gst_buffer_unref (cmem->dest);
+  if (cmem->out_pool)
+    gst_object_unref (cmem->out_pool);
+  gst_omx_video_copy_pool_unref (cmem->pool);
+  g_mutex_clear (&cmem->lock);
+  g_slice_free (GstOMXVideoCopyMemory, cmem);
+}
+
+static void
+gst_omx_video_copy_allocator_class_init (GstOMXVideoCopyAllocatorClass * klass)
+{
+  klass->free = gst_omx_video_copy_allocator_free;
+}
+
+static void
+gst_omx_video_copy_allocator_init (GstOMXVideoCopyAllocator * allocator)
+{
+  allocator->mem_type = GST_OMX_VIDEO_COPY_MEMORY_TYPE;
+  allocator->mem_map_full = gst_omx_video_copy_memory_map_full;
+  allocator->mem_unmap_full = gst_omx_video_copy_memory_unmap_full;
+  allocator->mem_copy = gst_omx_video_copy_memory_copy;
+
+  GST_OBJECT_FLAG_SET (allocator, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+}
+
+static gpointer
+gst_omx_video_copy_allocator_new (gpointer data)
+{
+  GstAllocator *allocator;
+
+  allocator = g_object_new (gst_omx_video_copy_allocator_get_type (), NULL);
+  gst_object_ref_sink (allocator);
+  GST_OBJECT_FLAG_SET (allocator, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+
+  return allocator;
+}
+
+/* Same as gst_omx_video_copy_buffer() but the copy is only done when the
+ * returned buffer is mapped, buf is released right after or when the
+ * returned buffer is freed. The buffer from out_pool is only acquired at
+ * that time too, or allocated if none is available. This way frames never
+ * looked at downstream, e.g. dropped, cost nothing.
+ *
+ * As buf stays in use until then, the copy is done right away if there
+ * are already max_pending lazy copies on pool, or if pool is NULL */
+GstBuffer *
+gst_omx_video_copy_buffer_lazy (GstOMXVideoCopyPool * pool,
+    GstBufferPool * out_pool, const GstVideoInfo * info, GstBuffer * buf,
+    guint max_pending)
+{
+  static GOnce allocator_once = G_ONCE_INIT;
+  GstOMXVideoCopyMemory *mem;
+  GstBuffer *outbuf;
+
+  if (!pool || g_atomic_int_add (&pool->n_lazy, 1) >= (gint) max_pending) {
+    if (pool)
+      g_atomic_int_add (&pool->n_lazy, -1);
+    return gst_omx_video_copy_buffer (pool, out_pool, info, buf);
+  }
+
+  /* gst_video_frame_copy() is needed for anything else than lines */
+  if (GST_VIDEO_FORMAT_INFO_IS_TILED (info->finfo)) {
+    g_atomic_int_add (&pool->n_lazy, -1);
+    return gst_omx_video_copy_buffer (pool, out_pool, info, buf);
+  }
+
+  mem = g_slice_new0 (GstOMXVideoCopyMemory);
+  gst_memory_init (GST_MEMORY_CAST (mem), GST_MEMORY_FLAG_NO_SHARE,
+      g_once (&allocator_once, gst_omx_video_copy_allocator_new, NULL), NULL,
+      GST_VIDEO_INFO_SIZE (info), 0, 0, GST_VIDEO_INFO_SIZE (info));
+  g_mutex_init (&mem->lock);
+  mem->pool = gst_omx_video_copy_pool_ref (pool);
+  mem->out_pool = out_pool ? gst_object_ref (out_pool) : NULL;
+  mem->info = *info;
+  mem->src = buf;
+
+  outbuf = gst_buffer_new ();
+  gst_buffer_append_memory (outbuf, GST_MEMORY_CAST (mem));
+  gst_buffer_copy_into (outbuf, buf, GST_BUFFER_COPY_FLAGS, 0, -1);
+
+  return outbuf;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifndef __GST_OMX_VIDEO_COPY_H__
+#define __GST_OMX_VIDEO_COPY_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+G_BEGIN_DECLS
+
+/* Copies between GStreamer video frames and OpenMAX buffers laid out with
+ * nStride and nSliceHeight when zero-copy is not possible. They don't
+ * depend on anything OpenMAX specific so they can be benchmarked in
+ * isolation, see tests/benchmarks/omxvideocopy.c */
+
+typedef struct _GstOMXVideoCopyPool GstOMXVideoCopyPool;
+
+GstOMXVideoCopyPool * gst_omx_video_copy_pool_new (guint n_threads);
+
+GstOMXVideoCopyPool * gst_omx_video_copy_pool_ref (GstOMXVideoCopyPool * pool);
+
+void        gst_omx_video_copy_pool_unref (GstOMXVideoCopyPool * pool);
+
+guint       gst_omx_video_copy_pool_get_n_threads (GstOMXVideoCopyPool * pool);
+
+gboolean    gst_omx_video_copy_from_omx (GstOMXVideoCopyPool * pool,
+                GstVideoFrame * frame, const guint8 * src, guint nstride,
+                guint nslice);
+
+gboolean    gst_omx_video_copy_to_omx (GstOMXVideoCopyPool * pool,
+                GstVideoFrame * frame, guint8 * dest, gsize dest_size,
+                guint nstride, guint nslice, gsize * filled);
+
+GstBuffer * gst_omx_video_copy_buffer (GstOMXVideoCopyPool * pool,
+                GstBufferPool * out_pool, const GstVideoInfo * info,
+                GstBuffer * buf);
+
+GstBuffer * gst_omx_video_copy_buffer_lazy (GstOMXVideoCopyPool * pool,
+                GstBufferPool * out_pool, const GstVideoInfo * info,
+                GstBuffer * buf, guint max_pending);
+
+const gchar * gst_omx_video_copy_get_implementation (void);
+
+G_END_DECLS
+
+#endif /* __GST_OMX_VIDEO_COPY_H__ */
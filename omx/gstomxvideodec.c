@@ -50,6 +50,7 @@
 
 #include "gstomxbufferpool.h"
 #include "gstomxvideo.h"
+#include "gstomxvideocopy.h"
 #include "gstomxvideodec.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_omx_video_dec_debug_category);
@@ -88,9 +89,33 @@ enum
 {
   PROP_0,
   PROP_INTERNAL_ENTROPY_BUFFERS,
+  PROP_STATS,
+  PROP_STATS_INTERVAL,
+  PROP_N_COPY_THREADS,
+  PROP_MAX_WIDTH,
+  PROP_MAX_HEIGHT,
+  PROP_KEYFRAMES_ONLY,
 };
 
 #define GST_OMX_VIDEO_DEC_INTERNAL_ENTROPY_BUFFERS_DEFAULT (5)
+#define GST_OMX_VIDEO_DEC_N_COPY_THREADS_DEFAULT (0)
+#define GST_OMX_VIDEO_DEC_MAX_WIDTH_DEFAULT (0)
+#define GST_OMX_VIDEO_DEC_MAX_HEIGHT_DEFAULT (0)
+#define GST_OMX_VIDEO_DEC_KEYFRAMES_ONLY_DEFAULT (FALSE)
+
+/* Android extension to keep the output buffers on resolution changes */
+#define GST_OMX_VIDEO_DEC_ADAPTIVE_PLAYBACK_EXTENSION \
+  "OMX.google.android.index.prepareForAdaptivePlayback"
+
+typedef struct
+{
+  OMX_U32 nSize;
+  OMX_VERSIONTYPE nVersion;
+  OMX_U32 nPortIndex;
+  OMX_BOOL bEnable;
+  OMX_U32 nMaxFrameWidth;
+  OMX_U32 nMaxFrameHeight;
+} GstOMXVideoDecAdaptivePlaybackParams;
 
 /* class initialization */
 
@@ -106,9 +131,7 @@ static void
 gst_omx_video_dec_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
-#ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
   GstOMXVideoDec *self = GST_OMX_VIDEO_DEC (object);
-#endif
 
   switch (prop_id) {
 #ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
@@ -116,6 +139,21 @@ gst_omx_video_dec_set_property (GObject * object, guint prop_id,
       self->internal_entropy_buffers = g_value_get_uint (value);
       break;
 #endif
+    case PROP_STATS_INTERVAL:
+      self->stats_interval = g_value_get_uint (value);
+      break;
+    case PROP_N_COPY_THREADS:
+      self->n_copy_threads = g_value_get_uint (value);
+      break;
+    case PROP_MAX_WIDTH:
+      self->max_width = g_value_get_uint (value);
+      break;
+    case PROP_MAX_HEIGHT:
+      self->max_height = g_value_get_uint (value);
+      break;
+    case PROP_KEYFRAMES_ONLY:
+      self->keyframes_only = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -126,9 +164,7 @@ static void
 gst_omx_video_dec_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec)
 {
-#ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
   GstOMXVideoDec *self = GST_OMX_VIDEO_DEC (object);
-#endif
 
   switch (prop_id) {
 #ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
@@ -136,6 +172,24 @@ gst_omx_video_dec_get_property (GObject * object, guint prop_id,
       g_value_set_uint (value, self->internal_entropy_buffers);
       break;
 #endif
+    case PROP_STATS:
+      gst_omx_get_stats_property (GST_OBJECT (self), &self->dec, value);
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, self->stats_interval);
+      break;
+    case PROP_N_COPY_THREADS:
+      g_value_set_uint (value, self->n_copy_threads);
+      break;
+    case PROP_MAX_WIDTH:
+      g_value_set_uint (value, self->max_width);
+      break;
+    case PROP_MAX_HEIGHT:
+      g_value_set_uint (value, self->max_height);
+      break;
+    case PROP_KEYFRAMES_ONLY:
+      g_value_set_boolean (value, self->keyframes_only);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -164,6 +218,43 @@ gst_omx_video_dec_class_init (GstOMXVideoDecClass * klass)
           GST_PARAM_MUTABLE_READY));
 #endif
 
+  gst_omx_install_stats_properties (gobject_class, PROP_STATS,
+      PROP_STATS_INTERVAL);
+
+  g_object_class_install_property (gobject_class, PROP_N_COPY_THREADS,
+      g_param_spec_uint ("n-copy-threads", "Number of copy threads",
+          "Number of threads copying large frames when they can't be shared "
+          "with the OpenMAX component (0 = automatic, 1 = single-threaded)",
+          0, 16, GST_OMX_VIDEO_DEC_N_COPY_THREADS_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_WIDTH,
+      g_param_spec_uint ("max-width", "Maximum width",
+          "Maximum width of the stream for adaptive playback, the output "
+          "buffers are kept when the resolution changes within "
+          "max-width x max-height (0 = disabled)",
+          0, G_MAXUINT, GST_OMX_VIDEO_DEC_MAX_WIDTH_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_HEIGHT,
+      g_param_spec_uint ("max-height", "Maximum height",
+          "Maximum height of the stream for adaptive playback, the output "
+          "buffers are kept when the resolution changes within "
+          "max-width x max-height (0 = disabled)",
+          0, G_MAXUINT, GST_OMX_VIDEO_DEC_MAX_HEIGHT_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_KEYFRAMES_ONLY,
+      g_param_spec_boolean ("keyframes-only", "Keyframes only",
+          "Only decode the sync frames and drop all others before they reach "
+          "the component, using as few output buffers as possible",
+          GST_OMX_VIDEO_DEC_KEYFRAMES_ONLY_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   element_class->change_state =
       GST_DEBUG_FUNCPTR (gst_omx_video_dec_change_state);
 
@@ -206,6 +297,11 @@ gst_omx_video_dec_init (GstOMXVideoDec * self)
   self->internal_entropy_buffers =
       GST_OMX_VIDEO_DEC_INTERNAL_ENTROPY_BUFFERS_DEFAULT;
 #endif
+  self->stats_interval = GST_OMX_STATS_INTERVAL_DEFAULT;
+  self->n_copy_threads = GST_OMX_VIDEO_DEC_N_COPY_THREADS_DEFAULT;
+  self->max_width = GST_OMX_VIDEO_DEC_MAX_WIDTH_DEFAULT;
+  self->max_height = GST_OMX_VIDEO_DEC_MAX_HEIGHT_DEFAULT;
+  self->keyframes_only = GST_OMX_VIDEO_DEC_KEYFRAMES_ONLY_DEFAULT;
 
   gst_video_decoder_set_packetized (GST_VIDEO_DECODER (self), TRUE);
   gst_video_decoder_set_use_default_pad_acceptcaps (GST_VIDEO_DECODER_CAST
@@ -214,6 +310,7 @@ gst_omx_video_dec_init (GstOMXVideoDec * self)
 
   g_mutex_init (&self->drain_lock);
   g_cond_init (&self->drain_cond);
+  gst_omx_video_frame_index_init (&self->frame_index);
 }
 
 #ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
@@ -260,19 +357,29 @@ gst_omx_video_dec_open (GstVideoDecoder * decoder)
 {
   GstOMXVideoDec *self = GST_OMX_VIDEO_DEC (decoder);
   GstOMXVideoDecClass *klass = GST_OMX_VIDEO_DEC_GET_CLASS (self);
+  GstOMXComponent *dec;
+  GstOMXPort *in_port, *out_port;
   gint in_port_index, out_port_index;
 
   GST_DEBUG_OBJECT (self, "Opening decoder");
 
-  self->dec =
+  dec =
       gst_omx_component_new (GST_OBJECT_CAST (self), klass->cdata.core_name,
       klass->cdata.component_name, klass->cdata.component_role,
       klass->cdata.hacks);
   self->started = FALSE;
 
-  if (!self->dec)
+  if (!dec)
     return FALSE;
 
+  /* The stats property might be read concurrently */
+  GST_OBJECT_LOCK (self);
+  self->dec = dec;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_omx_component_set_stats_interval (self->dec,
+      self->stats_interval * GST_MSECOND);
+
   if (gst_omx_component_get_state (self->dec,
           GST_CLOCK_TIME_NONE) != OMX_StateLoaded)
     return FALSE;
@@ -302,8 +409,12 @@ gst_omx_video_dec_open (GstVideoDecoder * decoder)
       out_port_index = param.nStartPortNumber + 1;
     }
   }
-  self->dec_in_port = gst_omx_component_add_port (self->dec, in_port_index);
-  self->dec_out_port = gst_omx_component_add_port (self->dec, out_port_index);
+  in_port = gst_omx_component_add_port (self->dec, in_port_index);
+  out_port = gst_omx_component_add_port (self->dec, out_port_index);
+  GST_OBJECT_LOCK (self);
+  self->dec_in_port = in_port;
+  self->dec_out_port = out_port;
+  GST_OBJECT_UNLOCK (self);
 
 #ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
   GST_DEBUG_OBJECT (self, "Configure decoder output to export dmabuf");
@@ -370,10 +481,33 @@ gst_omx_video_dec_open (GstVideoDecoder * decoder)
   return TRUE;
 }
 
+static gboolean
+gst_omx_video_dec_deallocate_input_buffers (GstOMXVideoDec * self)
+{
+  gboolean in_pool_used = self->in_pool_used;
+
+  self->in_pool_used = FALSE;
+
+  if (self->in_port_pool) {
+    /* Pool will free buffers when stopping, once upstream released them */
+    gst_buffer_pool_set_active (self->in_port_pool, FALSE);
+    gst_object_unref (self->in_port_pool);
+    self->in_port_pool = NULL;
+  }
+
+  if (in_pool_used)
+    return TRUE;
+
+  return gst_omx_port_deallocate_buffers (self->dec_in_port) == OMX_ErrorNone;
+}
+
 static gboolean
 gst_omx_video_dec_shutdown (GstOMXVideoDec * self)
 {
   OMX_STATETYPE state;
+#if defined (USE_OMX_TARGET_RPI) && defined (HAVE_GST_GL)
+  GstOMXComponent *comps[] = { self->egl_render, self->dec };
+#endif
 
   GST_DEBUG_OBJECT (self, "Shutting down decoder");
 
@@ -383,18 +517,18 @@ gst_omx_video_dec_shutdown (GstOMXVideoDec * self)
     if (state > OMX_StateIdle) {
       gst_omx_component_set_state (self->egl_render, OMX_StateIdle);
       gst_omx_component_set_state (self->dec, OMX_StateIdle);
-      gst_omx_component_get_state (self->egl_render, 5 * GST_SECOND);
-      gst_omx_component_get_state (self->dec, 1 * GST_SECOND);
+      gst_omx_components_wait_state (comps, G_N_ELEMENTS (comps),
+          5 * GST_SECOND);
     }
     gst_omx_component_set_state (self->egl_render, OMX_StateLoaded);
     gst_omx_component_set_state (self->dec, OMX_StateLoaded);
 
-    gst_omx_port_deallocate_buffers (self->dec_in_port);
+    gst_omx_video_dec_deallocate_input_buffers (self);
     gst_omx_video_dec_deallocate_output_buffers (self);
     gst_omx_close_tunnel (self->dec_out_port, self->egl_in_port);
     if (state > OMX_StateLoaded) {
-      gst_omx_component_get_state (self->egl_render, 5 * GST_SECOND);
-      gst_omx_component_get_state (self->dec, 1 * GST_SECOND);
+      gst_omx_components_wait_state (comps, G_N_ELEMENTS (comps),
+          5 * GST_SECOND);
     }
   }
 
@@ -409,7 +543,7 @@ gst_omx_video_dec_shutdown (GstOMXVideoDec * self)
       gst_omx_component_get_state (self->dec, 5 * GST_SECOND);
     }
     gst_omx_component_set_state (self->dec, OMX_StateLoaded);
-    gst_omx_port_deallocate_buffers (self->dec_in_port);
+    gst_omx_video_dec_deallocate_input_buffers (self);
     gst_omx_video_dec_deallocate_output_buffers (self);
     if (state > OMX_StateLoaded) {
       if (self->dec_out_port->buffers)
@@ -429,17 +563,22 @@ static gboolean
 gst_omx_video_dec_close (GstVideoDecoder * decoder)
 {
   GstOMXVideoDec *self = GST_OMX_VIDEO_DEC (decoder);
+  GstOMXComponent *dec;
 
   GST_DEBUG_OBJECT (self, "Closing decoder");
 
   if (!gst_omx_video_dec_shutdown (self))
     return FALSE;
 
+  /* The stats property might be read concurrently */
+  GST_OBJECT_LOCK (self);
   self->dec_in_port = NULL;
   self->dec_out_port = NULL;
-  if (self->dec)
-    gst_omx_component_unref (self->dec);
+  dec = self->dec;
   self->dec = NULL;
+  GST_OBJECT_UNLOCK (self);
+  if (dec)
+    gst_omx_component_unref (dec);
 
 #if defined (USE_OMX_TARGET_RPI) && defined (HAVE_GST_GL)
   self->egl_in_port = NULL;
@@ -463,6 +602,7 @@ gst_omx_video_dec_finalize (GObject * object)
 
   g_mutex_clear (&self->drain_lock);
   g_cond_clear (&self->drain_cond);
+  gst_omx_video_frame_index_clear (&self->frame_index);
 
   G_OBJECT_CLASS (gst_omx_video_dec_parent_class)->finalize (object);
 }
@@ -572,95 +712,10 @@ gst_omx_video_dec_fill_buffer (GstOMXVideoDec * self,
 
   /* Different strides */
   if (gst_video_frame_map (&frame, vinfo, outbuf, GST_MAP_WRITE)) {
-    const guint nstride = port_def->format.video.nStride;
-    const guint nslice = port_def->format.video.nSliceHeight;
-    guint src_stride[GST_VIDEO_MAX_PLANES] = { nstride, 0, };
-    guint src_size[GST_VIDEO_MAX_PLANES] = { nstride * nslice, 0, };
-    gint dst_width[GST_VIDEO_MAX_PLANES] = { 0, };
-    gint dst_height[GST_VIDEO_MAX_PLANES] =
-        { GST_VIDEO_INFO_FIELD_HEIGHT (vinfo), 0, };
-    const guint8 *src;
-    guint p;
-
-    switch (GST_VIDEO_INFO_FORMAT (vinfo)) {
-      case GST_VIDEO_FORMAT_ABGR:
-      case GST_VIDEO_FORMAT_ARGB:
-        dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo) * 4;
-        break;
-      case GST_VIDEO_FORMAT_RGB16:
-      case GST_VIDEO_FORMAT_BGR16:
-      case GST_VIDEO_FORMAT_YUY2:
-      case GST_VIDEO_FORMAT_UYVY:
-      case GST_VIDEO_FORMAT_YVYU:
-        dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo) * 2;
-        break;
-      case GST_VIDEO_FORMAT_GRAY8:
-        dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo);
-        break;
-      case GST_VIDEO_FORMAT_I420:
-        dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo);
-        src_stride[1] = nstride / 2;
-        src_size[1] = (src_stride[1] * nslice) / 2;
-        dst_width[1] = GST_VIDEO_INFO_WIDTH (vinfo) / 2;
-        dst_height[1] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo) / 2;
-        src_stride[2] = nstride / 2;
-        src_size[2] = (src_stride[1] * nslice) / 2;
-        dst_width[2] = GST_VIDEO_INFO_WIDTH (vinfo) / 2;
-        dst_height[2] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo) / 2;
-        break;
-      case GST_VIDEO_FORMAT_NV12:
-        dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo);
-        src_stride[1] = nstride;
-        src_size[1] = src_stride[1] * nslice / 2;
-        dst_width[1] = GST_VIDEO_INFO_WIDTH (vinfo);
-        dst_height[1] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo) / 2;
-        break;
-      case GST_VIDEO_FORMAT_NV16:
-        dst_width[0] = GST_VIDEO_INFO_WIDTH (vinfo);
-        src_stride[1] = nstride;
-        src_size[1] = src_stride[1] * nslice;
-        dst_width[1] = GST_VIDEO_INFO_WIDTH (vinfo);
-        dst_height[1] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo);
-        break;
-      case GST_VIDEO_FORMAT_NV12_10LE32:
-        /* Need ((width + 2) / 3) 32-bits words */
-        dst_width[0] = (GST_VIDEO_INFO_WIDTH (vinfo) + 2) / 3 * 4;
-        dst_width[1] = dst_width[0];
-        src_stride[1] = nstride;
-        src_size[1] = src_stride[1] * nslice / 2;
-        dst_height[1] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo) / 2;
-        break;
-      case GST_VIDEO_FORMAT_NV16_10LE32:
-        /* Need ((width + 2) / 3) 32-bits words */
-        dst_width[0] = (GST_VIDEO_INFO_WIDTH (vinfo) + 2) / 3 * 4;
-        dst_width[1] = dst_width[0];
-        src_stride[1] = nstride;
-        src_size[1] = src_stride[1] * nslice;
-        dst_height[1] = GST_VIDEO_INFO_FIELD_HEIGHT (vinfo);
-        break;
-      default:
-        g_assert_not_reached ();
-        break;
-    }
-
-    src = inbuf->omx_buf->pBuffer + inbuf->omx_buf->nOffset;
-    for (p = 0; p < GST_VIDEO_INFO_N_PLANES (vinfo); p++) {
-      const guint8 *data;
-      guint8 *dst;
-      guint h;
-
-      dst = GST_VIDEO_FRAME_PLANE_DATA (&frame, p);
-      data = src;
-      for (h = 0; h < dst_height[p]; h++) {
-        memcpy (dst, data, dst_width[p]);
-        dst += GST_VIDEO_FRAME_PLANE_STRIDE (&frame, p);
-        data += src_stride[p];
-      }
-      src += src_size[p];
-    }
-
+    ret = gst_omx_video_copy_from_omx (self->copy_pool, &frame,
+        inbuf->omx_buf->pBuffer + inbuf->omx_buf->nOffset,
+        port_def->format.video.nStride, port_def->format.video.nSliceHeight);
     gst_video_frame_unmap (&frame);
-    ret = TRUE;
   } else {
     GST_ERROR_OBJECT (self, "Can't map output buffer to frame");
     goto done;
@@ -747,6 +802,110 @@ out:
   return NULL;
 }
 
+/* Makes the buffers the component allocates for port big enough for
+ * frames of max-width x max-height, so they can be kept when the resolution
+ * changes */
+static void
+gst_omx_video_dec_presize_port_buffers (GstOMXVideoDec * self,
+    GstOMXPort * port)
+{
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  guint64 size = 0;
+
+  gst_omx_port_get_port_definition (port, &port_def);
+
+  if (self->adaptive_playback && port_def.format.video.nFrameWidth > 0
+      && port_def.format.video.nFrameHeight > 0) {
+    size = gst_util_uint64_scale (port_def.nBufferSize,
+        (guint64) self->max_width * self->max_height,
+        (guint64) port_def.format.video.nFrameWidth *
+        port_def.format.video.nFrameHeight);
+    size = MIN (size, G_MAXUINT32);
+
+    GST_DEBUG_OBJECT (self, "Allocating buffers of at least %" G_GUINT64_FORMAT
+        " bytes for port %u", size, (guint) port->index);
+  }
+
+  gst_omx_port_set_min_buffer_size (port, size);
+}
+
+/* Configures the output port for the picture size and the DPB size found in
+ * the headers of buffer, so its buffers can be allocated before the
+ * component parsed the stream and don't need to be reallocated once it
+ * reports the same settings */
+static void
+gst_omx_video_dec_presize_output_port (GstOMXVideoDec * self,
+    GstBuffer * buffer)
+{
+  GstOMXVideoDecClass *klass = GST_OMX_VIDEO_DEC_GET_CLASS (self);
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  guint width = 0, height = 0, dpb_size = 0;
+  OMX_ERRORTYPE err;
+
+  if (!klass->parse_stream_info)
+    return;
+
+  /* The settings of the output port can only be changed while it has no
+   * buffers */
+  if (gst_omx_component_get_state (self->dec,
+          GST_CLOCK_TIME_NONE) != OMX_StateLoaded
+      && gst_omx_port_is_enabled (self->dec_out_port))
+    return;
+
+  if (!klass->parse_stream_info (self, buffer, &width, &height, &dpb_size)) {
+    GST_DEBUG_OBJECT (self, "No stream headers found");
+    return;
+  }
+
+  GST_DEBUG_OBJECT (self, "Stream headers: %ux%u, DPB of %u frames", width,
+      height, dpb_size);
+
+  /* Interlaced frames are output as separate fields, like the frame height
+   * of the input port set in ::set_format() */
+  if (self->input_state
+      && GST_VIDEO_INFO_IS_INTERLACED (&self->input_state->info))
+    height = GST_ROUND_UP_2 (height / 2);
+
+  gst_omx_port_get_port_definition (self->dec_out_port, &port_def);
+  port_def.format.video.nFrameWidth = width;
+  port_def.format.video.nFrameHeight = height;
+  err = gst_omx_port_update_port_definition (self->dec_out_port, &port_def);
+  if (err != OMX_ErrorNone) {
+    GST_INFO_OBJECT (self, "Failed to set the output size: %s (0x%08x)",
+        gst_omx_error_to_string (err), err);
+    return;
+  }
+
+  /* The component updated its minimum for the new size */
+  gst_omx_port_get_port_definition (self->dec_out_port, &port_def);
+  if (dpb_size + 1 > port_def.nBufferCountActual) {
+    port_def.nBufferCountActual =
+        MAX (dpb_size + 1, port_def.nBufferCountMin);
+    err = gst_omx_port_update_port_definition (self->dec_out_port, &port_def);
+    if (err != OMX_ErrorNone) {
+      GST_INFO_OBJECT (self, "Failed to configure %u output buffers: %s "
+          "(0x%08x)", (guint) port_def.nBufferCountActual,
+          gst_omx_error_to_string (err), err);
+      return;
+    }
+  }
+
+  self->dpb_size = dpb_size;
+  self->out_presized = TRUE;
+}
+
+/* The component may not know the DPB size of the stream yet if the output
+ * port is allocated from the stream headers */
+static guint
+gst_omx_video_dec_get_min_output_buffers (GstOMXVideoDec * self,
+    GstOMXPort * port)
+{
+  if (self->dpb_size == 0)
+    return port->port_def.nBufferCountMin;
+
+  return MAX (port->port_def.nBufferCountMin, self->dpb_size + 1);
+}
+
 static OMX_ERRORTYPE
 gst_omx_video_dec_allocate_output_buffers (GstOMXVideoDec * self)
 {
@@ -766,8 +925,20 @@ gst_omx_video_dec_allocate_output_buffers (GstOMXVideoDec * self)
   port = self->dec_out_port;
 #endif
 
+  gst_omx_video_dec_presize_port_buffers (self, port);
+
   pool = gst_video_decoder_get_buffer_pool (GST_VIDEO_DECODER (self));
-  if (pool) {
+  if (pool && self->keyframes_only
+#if defined (HAVE_GST_GL)
+      && !self->eglimage
+#endif
+      ) {
+    /* Sync frames are not referred to, the output frames are copied so
+     * the component can decode with the fewest buffers */
+    gst_caps_replace (&caps, NULL);
+    min = max = port->port_def.nBufferCountMin;
+    GST_DEBUG_OBJECT (self, "Only decoding keyframes, using %u buffers", min);
+  } else if (pool) {
     GstAllocator *allocator;
 
     config = gst_buffer_pool_get_config (pool);
@@ -785,7 +956,7 @@ gst_omx_video_dec_allocate_output_buffers (GstOMXVideoDec * self)
     }
 
     /* Need at least 4 buffers for anything meaningful */
-    min = MAX (min + port->port_def.nBufferCountMin, 4);
+    min = MAX (min + gst_omx_video_dec_get_min_output_buffers (self, port), 4);
     if (max == 0) {
       max = min;
     } else if (max < min) {
@@ -814,7 +985,7 @@ gst_omx_video_dec_allocate_output_buffers (GstOMXVideoDec * self)
         (allocator ? allocator->mem_type : "(null)"));
   } else {
     gst_caps_replace (&caps, NULL);
-    min = max = port->port_def.nBufferCountMin;
+    min = max = gst_omx_video_dec_get_min_output_buffers (self, port);
     GST_DEBUG_OBJECT (self, "No pool available, not negotiated yet");
   }
 
@@ -1209,9 +1380,28 @@ done:
   return err;
 }
 
+/* Gives the output buffers batched by the srcpad loop back to the port.
+ * Must be called before the output port is populated or its buffers are
+ * deallocated, while the loop is not running */
+static void
+gst_omx_video_dec_return_output_batch (GstOMXVideoDec * self)
+{
+  GstOMXPort *port;
+
+#if defined (USE_OMX_TARGET_RPI) && defined (HAVE_GST_GL)
+  port = self->eglimage ? self->egl_out_port : self->dec_out_port;
+#else
+  port = self->dec_out_port;
+#endif
+
+  gst_omx_port_return_batched_buffers (port, &self->out_batch);
+}
+
 static gboolean
 gst_omx_video_dec_deallocate_output_buffers (GstOMXVideoDec * self)
 {
+  gst_omx_video_dec_return_output_batch (self);
+
   if (self->out_port_pool) {
     /* Pool will free buffers when stopping */
     gst_buffer_pool_set_active (self->out_port_pool, FALSE);
@@ -1308,16 +1498,89 @@ add_caps_gl_memory_feature (GstCaps * caps)
 }
 #endif
 
+/* With adaptive playback the port can keep the size of the largest frames,
+ * the visible part is given by the output crop then */
+static void
+gst_omx_video_dec_get_output_crop (GstOMXVideoDec * self, guint * width,
+    guint * height)
+{
+  OMX_CONFIG_RECTTYPE crop;
+
+  if (!self->adaptive_playback)
+    return;
+
+  GST_OMX_INIT_STRUCT (&crop);
+  crop.nPortIndex = self->dec_out_port->index;
+
+  if (gst_omx_component_get_config (self->dec,
+          OMX_IndexConfigCommonOutputCrop, &crop) != OMX_ErrorNone)
+    return;
+
+  /* The planes are described by their stride and offset only, so the crop
+   * has to start at the top-left corner */
+  if (crop.nLeft != 0 || crop.nTop != 0 || crop.nWidth == 0
+      || crop.nHeight == 0 || crop.nWidth > *width || crop.nHeight > *height)
+    return;
+
+  *width = crop.nWidth;
+  *height = crop.nHeight;
+}
+
+/* Sets the output state for the current definition of the output port.
+ * Must be called with the STREAM_LOCK */
+static GstVideoCodecState *
+gst_omx_video_dec_set_output_state_from_port (GstOMXVideoDec * self,
+    GstVideoInterlaceMode interlace_mode)
+{
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  GstVideoFormat format;
+  guint width, frame_height;
+
+  gst_omx_port_get_port_definition (self->dec_out_port, &port_def);
+  g_assert (port_def.format.video.eCompressionFormat == OMX_VIDEO_CodingUnused);
+
+  format =
+      gst_omx_video_get_format_from_omx (port_def.format.video.eColorFormat);
+
+  if (format == GST_VIDEO_FORMAT_UNKNOWN) {
+    GST_ERROR_OBJECT (self, "Unsupported color format: %d",
+        port_def.format.video.eColorFormat);
+    return NULL;
+  }
+
+  width = port_def.format.video.nFrameWidth;
+  frame_height = port_def.format.video.nFrameHeight;
+  gst_omx_video_dec_get_output_crop (self, &width, &frame_height);
+
+  /* OMX's frame height is actually the field height in alternate mode
+   * while it's always the full frame height in gst. */
+  if (interlace_mode == GST_VIDEO_INTERLACE_MODE_ALTERNATE ||
+      interlace_mode == GST_VIDEO_INTERLACE_MODE_INTERLEAVED) {
+    frame_height *= 2;
+    /* Decoder outputs interlaced content using the alternate mode */
+    interlace_mode = GST_VIDEO_INTERLACE_MODE_ALTERNATE;
+  }
+
+  GST_DEBUG_OBJECT (self,
+      "Setting output state: format %s (%d), width %u, height %u",
+      gst_video_format_to_string (format),
+      port_def.format.video.eColorFormat, width, frame_height);
+
+  return gst_video_decoder_set_interlaced_output_state (GST_VIDEO_DECODER
+      (self), format, interlace_mode, width, frame_height, self->input_state);
+}
+
 static OMX_ERRORTYPE
 gst_omx_video_dec_reconfigure_output_port (GstOMXVideoDec * self)
 {
   GstOMXPort *port;
   OMX_ERRORTYPE err;
   GstVideoCodecState *state;
-  OMX_PARAM_PORTDEFINITIONTYPE port_def;
-  GstVideoFormat format;
   GstVideoInterlaceMode interlace_mode;
+#if defined (HAVE_GST_GL)
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
   guint frame_height;
+#endif
 
   /* At this point the decoder output port is disabled */
   interlace_mode = gst_omx_video_dec_get_output_interlace_info (self);
@@ -1537,41 +1800,13 @@ gst_omx_video_dec_reconfigure_output_port (GstOMXVideoDec * self)
   /* Update caps */
   GST_VIDEO_DECODER_STREAM_LOCK (self);
 
-  gst_omx_port_get_port_definition (port, &port_def);
-  g_assert (port_def.format.video.eCompressionFormat == OMX_VIDEO_CodingUnused);
-
-  format =
-      gst_omx_video_get_format_from_omx (port_def.format.video.eColorFormat);
-
-  if (format == GST_VIDEO_FORMAT_UNKNOWN) {
-    GST_ERROR_OBJECT (self, "Unsupported color format: %d",
-        port_def.format.video.eColorFormat);
+  state = gst_omx_video_dec_set_output_state_from_port (self, interlace_mode);
+  if (!state) {
     GST_VIDEO_DECODER_STREAM_UNLOCK (self);
     err = OMX_ErrorUndefined;
     goto done;
   }
 
-  frame_height = port_def.format.video.nFrameHeight;
-  /* OMX's frame height is actually the field height in alternate mode
-   * while it's always the full frame height in gst. */
-  if (interlace_mode == GST_VIDEO_INTERLACE_MODE_ALTERNATE ||
-      interlace_mode == GST_VIDEO_INTERLACE_MODE_INTERLEAVED) {
-    frame_height *= 2;
-    /* Decoder outputs interlaced content using the alternate mode */
-    interlace_mode = GST_VIDEO_INTERLACE_MODE_ALTERNATE;
-  }
-
-  GST_DEBUG_OBJECT (self,
-      "Setting output state: format %s (%d), width %u, height %u",
-      gst_video_format_to_string (format),
-      port_def.format.video.eColorFormat,
-      (guint) port_def.format.video.nFrameWidth, frame_height);
-
-  state =
-      gst_video_decoder_set_interlaced_output_state (GST_VIDEO_DECODER (self),
-      format, interlace_mode, port_def.format.video.nFrameWidth,
-      frame_height, self->input_state);
-
   if (!gst_video_decoder_negotiate (GST_VIDEO_DECODER (self))) {
     gst_video_codec_state_unref (state);
     GST_ERROR_OBJECT (self, "Failed to negotiate");
@@ -1615,98 +1850,226 @@ done:
   return err;
 }
 
-static void
-gst_omx_video_dec_clean_older_frames (GstOMXVideoDec * self,
-    GstOMXBuffer * buf, GList * frames)
+/* Checks if the output port can keep its buffers for its new settings
+ * instead of being disabled to reallocate them */
+static gboolean
+gst_omx_video_dec_can_reuse_output_buffers (GstOMXVideoDec * self,
+    GstOMXPort * port)
 {
-  GList *l;
-  GstClockTime timestamp;
+  if (!self->adaptive_playback)
+    return FALSE;
 
-  timestamp =
-      gst_util_uint64_scale (GST_OMX_GET_TICKS (buf->omx_buf->nTimeStamp),
-      GST_SECOND, OMX_TICKS_PER_SECOND);
+#if defined (HAVE_GST_GL)
+  if (self->eglimage)
+    return FALSE;
+#endif
 
-  if (GST_CLOCK_TIME_IS_VALID (timestamp)) {
-    /* We could release all frames stored with pts < timestamp since the
-     * decoder will likely output frames in display order */
-    for (l = frames; l; l = l->next) {
-      GstVideoCodecFrame *tmp = l->data;
-
-      if (tmp->pts < timestamp) {
-        GST_LOG_OBJECT (self,
-            "discarding ghost frame %p (#%d) PTS:%" GST_TIME_FORMAT " DTS:%"
-            GST_TIME_FORMAT, tmp, tmp->system_frame_number,
-            GST_TIME_ARGS (tmp->pts), GST_TIME_ARGS (tmp->dts));
-        gst_video_decoder_release_frame (GST_VIDEO_DECODER (self), tmp);
-      } else {
-        gst_video_codec_frame_unref (tmp);
-      }
+  /* The buffers from downstream were allocated for the previous caps */
+  if (self->out_port_pool
+      && GST_OMX_BUFFER_POOL (self->out_port_pool)->other_pool)
+    return FALSE;
+
+  if (!gst_omx_port_is_enabled (port))
+    return FALSE;
+
+  return gst_omx_port_can_reuse_buffers (port);
+}
+
+/* Applies the new settings of the output port while keeping its buffers,
+ * only the caps and the layout of the frames change */
+static OMX_ERRORTYPE
+gst_omx_video_dec_reconfigure_output_port_in_place (GstOMXVideoDec * self,
+    GstOMXPort * port)
+{
+  GstVideoCodecState *state;
+  gboolean use_buffers, negotiated;
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+
+  GST_DEBUG_OBJECT (self, "Keeping the output buffers for the new settings");
+
+  GST_VIDEO_DECODER_STREAM_LOCK (self);
+
+  state = gst_omx_video_dec_set_output_state_from_port (self,
+      gst_omx_video_dec_get_output_interlace_info (self));
+  if (!state) {
+    GST_VIDEO_DECODER_STREAM_UNLOCK (self);
+    return OMX_ErrorUndefined;
+  }
+
+  /* Downstream buffers can't be used without reallocating the port */
+  use_buffers = self->use_buffers;
+  negotiated = gst_video_decoder_negotiate (GST_VIDEO_DECODER (self));
+  self->use_buffers = use_buffers;
+
+  if (!negotiated) {
+    GST_ERROR_OBJECT (self, "Failed to negotiate");
+    err = OMX_ErrorUndefined;
+    goto done;
+  }
+
+  if (self->out_port_pool) {
+    GstBufferPool *pool;
+    GstStructure *config;
+    gboolean add_videometa = FALSE;
+
+    pool = gst_video_decoder_get_buffer_pool (GST_VIDEO_DECODER (self));
+    if (pool) {
+      config = gst_buffer_pool_get_config (pool);
+      add_videometa = gst_buffer_pool_config_has_option (config,
+          GST_BUFFER_POOL_OPTION_VIDEO_META);
+      gst_structure_free (config);
+
+      /* Only the internal pool is used, as after allocating the buffers */
+      gst_buffer_pool_set_active (pool, FALSE);
+      gst_object_unref (pool);
     }
-  } else {
-    /* We will release all frames with invalid timestamp because we don't even
-     * know if they will be output some day. */
-    for (l = frames; l; l = l->next) {
-      GstVideoCodecFrame *tmp = l->data;
-
-      if (!GST_CLOCK_TIME_IS_VALID (tmp->pts)) {
-        GST_LOG_OBJECT (self,
-            "discarding frame %p (#%d) with invalid PTS:%" GST_TIME_FORMAT
-            " DTS:%" GST_TIME_FORMAT, tmp, tmp->system_frame_number,
-            GST_TIME_ARGS (tmp->pts), GST_TIME_ARGS (tmp->dts));
-        gst_video_decoder_release_frame (GST_VIDEO_DECODER (self), tmp);
-      } else {
-        gst_video_codec_frame_unref (tmp);
-      }
+
+    if (!gst_omx_buffer_pool_update_caps (GST_OMX_BUFFER_POOL
+            (self->out_port_pool), state->caps, add_videometa)) {
+      err = OMX_ErrorUndefined;
+      goto done;
     }
   }
 
-  g_list_free (frames);
+done:
+  gst_video_codec_state_unref (state);
+  GST_VIDEO_DECODER_STREAM_UNLOCK (self);
+
+  if (err == OMX_ErrorNone)
+    err = gst_omx_port_mark_reconfigured (port);
+
+  return err;
 }
 
-/* copy_frame() will consume @outpuf resulting in the buffer being released to
- * the pool and so reset fields such as outbuf->omx_buf->nFlags.
- * Make sure to handle them all before. */
+/* Copies outbuf, from the output pool, once downstream maps it so frames
+ * that are never looked at don't cost a copy. Only the buffers the
+ * component doesn't need to make progress can be held by such copies */
 static GstBuffer *
-copy_frame (const GstVideoInfo * info, GstBuffer * outbuf)
+gst_omx_video_dec_copy_output_buffer (GstOMXVideoDec * self, GstOMXPort * port,
+    GstBuffer * outbuf)
 {
-  GstVideoInfo out_info, tmp_info;
-  GstBuffer *tmpbuf;
-  GstVideoFrame out_frame, tmp_frame;
-
-  out_info = *info;
-  tmp_info = *info;
+  GstBufferPool *copy_out_pool = NULL;
+  GstBuffer *copy;
+  guint max_pending = 0;
 
-  tmpbuf = gst_buffer_new_and_alloc (out_info.size);
+  if (port->port_def.nBufferCountActual > port->port_def.nBufferCountMin)
+    max_pending =
+        port->port_def.nBufferCountActual - port->port_def.nBufferCountMin;
 
-  gst_video_frame_map (&out_frame, &out_info, outbuf, GST_MAP_READ);
-  gst_video_frame_map (&tmp_frame, &tmp_info, tmpbuf, GST_MAP_WRITE);
-  gst_video_frame_copy (&tmp_frame, &out_frame);
-  gst_video_frame_unmap (&out_frame);
-  gst_video_frame_unmap (&tmp_frame);
+  GST_OBJECT_LOCK (self);
+  if (self->copy_out_pool)
+    copy_out_pool = gst_object_ref (self->copy_out_pool);
+  GST_OBJECT_UNLOCK (self);
 
-  /* Use gst_video_frame_copy() to copy the content of the buffer so it
-   * will handle the stride/offset/etc from the source buffer.
-   * It doesn't copy buffer flags so do it manually. */
-  gst_buffer_copy_into (tmpbuf, outbuf, GST_BUFFER_COPY_FLAGS, 0, -1);
+  copy = gst_omx_video_copy_buffer_lazy (self->copy_pool, copy_out_pool,
+      &GST_OMX_BUFFER_POOL (self->out_port_pool)->video_info, outbuf,
+      max_pending);
 
-  gst_buffer_unref (outbuf);
+  if (copy_out_pool)
+    gst_object_unref (copy_out_pool);
 
-  return tmpbuf;
+  return copy;
 }
 
+/* Sets up the pool for the frames copied out of the OMX output buffers, with
+ * the allocator and alignment from downstream, or releases it if query is
+ * NULL. Nothing is allocated until a copy is needed */
 static void
-gst_omx_video_dec_pause_loop (GstOMXVideoDec * self, GstFlowReturn flow_ret)
+gst_omx_video_dec_set_copy_out_pool (GstOMXVideoDec * self, GstQuery * query)
 {
-  g_mutex_lock (&self->drain_lock);
-  if (self->draining) {
-    self->draining = FALSE;
-    g_cond_broadcast (&self->drain_cond);
-  }
-  gst_pad_pause_task (GST_VIDEO_DECODER_SRC_PAD (self));
-  self->downstream_flow_ret = flow_ret;
-  self->started = FALSE;
-  g_mutex_unlock (&self->drain_lock);
-}
+  GstBufferPool *pool = NULL, *old_pool;
+  GstCaps *caps = NULL;
+  GstVideoInfo info;
+
+  if (query)
+    gst_query_parse_allocation (query, &caps, NULL);
+
+  if (caps && gst_video_info_from_caps (&info, caps)
+      && gst_caps_features_is_equal (gst_caps_get_features (caps, 0),
+          GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY)) {
+    GstStructure *config;
+    GstAllocator *allocator = NULL;
+    GstAllocationParams params;
+
+    if (gst_query_get_n_allocation_params (query) > 0)
+      gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
+    else
+      gst_allocation_params_init (&params);
+
+    pool = gst_video_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_set_params (config, caps, info.size, 0, 0);
+    gst_buffer_pool_config_set_allocator (config, allocator, &params);
+
+    if (!gst_buffer_pool_set_config (pool, config)
+        || !gst_buffer_pool_set_active (pool, TRUE)) {
+      GST_WARNING_OBJECT (self, "Failed to set up pool for copied frames");
+      gst_object_unref (pool);
+      pool = NULL;
+    }
+
+    if (allocator)
+      gst_object_unref (allocator);
+  }
+
+  GST_OBJECT_LOCK (self);
+  old_pool = self->copy_out_pool;
+  self->copy_out_pool = pool;
+  GST_OBJECT_UNLOCK (self);
+
+  /* Copies still around are freed once returned */
+  if (old_pool) {
+    gst_buffer_pool_set_active (old_pool, FALSE);
+    gst_object_unref (old_pool);
+  }
+}
+
+static void
+gst_omx_video_dec_clean_older_frames (GstOMXVideoDec * self,
+    GstOMXBuffer * buf)
+{
+  GList *frames, *l;
+  GstClockTime timestamp;
+
+  timestamp =
+      gst_util_uint64_scale (GST_OMX_GET_TICKS (buf->omx_buf->nTimeStamp),
+      GST_SECOND, OMX_TICKS_PER_SECOND);
+
+  /* We could release all frames stored with pts < timestamp since the
+   * decoder will likely output frames in display order. If the timestamp is
+   * invalid we will release all frames with invalid timestamp because we
+   * don't even know if they will be output some day. */
+  GST_VIDEO_DECODER_STREAM_LOCK (self);
+  frames = gst_omx_video_frame_index_get_older (&self->frame_index, timestamp);
+
+  for (l = frames; l; l = l->next) {
+    GstVideoCodecFrame *tmp = l->data;
+
+    GST_LOG_OBJECT (self,
+        "discarding %s frame %p (#%d) PTS:%" GST_TIME_FORMAT " DTS:%"
+        GST_TIME_FORMAT, GST_CLOCK_TIME_IS_VALID (timestamp) ? "ghost" :
+        "invalid PTS", tmp, tmp->system_frame_number,
+        GST_TIME_ARGS (tmp->pts), GST_TIME_ARGS (tmp->dts));
+    gst_video_decoder_release_frame (GST_VIDEO_DECODER (self), tmp);
+  }
+  GST_VIDEO_DECODER_STREAM_UNLOCK (self);
+
+  g_list_free (frames);
+}
+
+static void
+gst_omx_video_dec_pause_loop (GstOMXVideoDec * self, GstFlowReturn flow_ret)
+{
+  g_mutex_lock (&self->drain_lock);
+  if (self->draining) {
+    self->draining = FALSE;
+    g_cond_broadcast (&self->drain_cond);
+  }
+  gst_pad_pause_task (GST_VIDEO_DECODER_SRC_PAD (self));
+  self->downstream_flow_ret = flow_ret;
+  self->started = FALSE;
+  g_mutex_unlock (&self->drain_lock);
+}
 
 #ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
 static void
@@ -1736,7 +2099,8 @@ gst_omx_video_dec_loop (GstOMXVideoDec * self)
   port = self->dec_out_port;
 #endif
 
-  acq_return = gst_omx_port_acquire_buffer (port, &buf, GST_OMX_WAIT);
+  acq_return = gst_omx_port_acquire_batched_buffer (port, &self->out_batch,
+      &buf, GST_OMX_WAIT);
   if (acq_return == GST_OMX_ACQUIRE_BUFFER_ERROR) {
     goto component_error;
   } else if (acq_return == GST_OMX_ACQUIRE_BUFFER_FLUSHING) {
@@ -1753,6 +2117,16 @@ gst_omx_video_dec_loop (GstOMXVideoDec * self)
 
     GST_DEBUG_OBJECT (self, "Port settings have changed, updating caps");
 
+    if (acq_return == GST_OMX_ACQUIRE_BUFFER_RECONFIGURE
+        && gst_omx_video_dec_can_reuse_output_buffers (self, port)) {
+      err = gst_omx_video_dec_reconfigure_output_port_in_place (self, port);
+      if (err != OMX_ErrorNone)
+        goto reconfigure_error;
+
+      /* Now get a buffer */
+      return;
+    }
+
     /* Reallocate all buffers */
     if (acq_return == GST_OMX_ACQUIRE_BUFFER_RECONFIGURE
         && gst_omx_port_is_enabled (port)) {
@@ -1779,6 +2153,7 @@ gst_omx_video_dec_loop (GstOMXVideoDec * self)
         goto reconfigure_error;
     } else {
       GstVideoInterlaceMode interlace_mode;
+      guint width, height;
 
       /* Just update caps */
       GST_VIDEO_DECODER_STREAM_LOCK (self);
@@ -1800,18 +2175,19 @@ gst_omx_video_dec_loop (GstOMXVideoDec * self)
         goto caps_failed;
       }
 
+      width = port_def.format.video.nFrameWidth;
+      height = port_def.format.video.nFrameHeight;
+      gst_omx_video_dec_get_output_crop (self, &width, &height);
+
       GST_DEBUG_OBJECT (self,
           "Setting output state: format %s (%d), width %u, height %u",
           gst_video_format_to_string (format),
-          port_def.format.video.eColorFormat,
-          (guint) port_def.format.video.nFrameWidth,
-          (guint) port_def.format.video.nFrameHeight);
+          port_def.format.video.eColorFormat, width, height);
       interlace_mode = gst_omx_video_dec_get_output_interlace_info (self);
 
       state =
           gst_video_decoder_set_interlaced_output_state (GST_VIDEO_DECODER
-          (self), format, interlace_mode, port_def.format.video.nFrameWidth,
-          port_def.format.video.nFrameHeight, self->input_state);
+          (self), format, interlace_mode, width, height, self->input_state);
 
       /* Take framerate and pixel-aspect-ratio from sinkpad caps */
 
@@ -1850,8 +2226,10 @@ gst_omx_video_dec_loop (GstOMXVideoDec * self)
       gst_omx_buffer_flags_to_string (buf->omx_buf->nFlags),
       (guint64) GST_OMX_GET_TICKS (buf->omx_buf->nTimeStamp));
 
+  GST_VIDEO_DECODER_STREAM_LOCK (self);
   frame = gst_omx_video_find_nearest_frame (GST_ELEMENT_CAST (self), buf,
-      gst_video_decoder_get_frames (GST_VIDEO_DECODER (self)));
+      &self->frame_index);
+  GST_VIDEO_DECODER_STREAM_UNLOCK (self);
 
   /* So we have a timestamped OMX buffer and get, or not, corresponding frame.
    * Assuming decoder output frames in display order, frames preceding this
@@ -1859,8 +2237,7 @@ gst_omx_video_dec_loop (GstOMXVideoDec * self)
    * stream, corrupted input data...
    * In any cases, not likely to be seen again. so drop it before they pile up
    * and use all the memory. */
-  gst_omx_video_dec_clean_older_frames (self, buf,
-      gst_video_decoder_get_frames (GST_VIDEO_DECODER (self)));
+  gst_omx_video_dec_clean_older_frames (self, buf);
 
   if (!frame && (buf->omx_buf->nFilledLen > 0 || buf->eglimage)) {
     GstBuffer *outbuf = NULL;
@@ -1898,9 +2275,7 @@ gst_omx_video_dec_loop (GstOMXVideoDec * self)
 #endif
 
       if (GST_OMX_BUFFER_POOL (self->out_port_pool)->need_copy)
-        outbuf =
-            copy_frame (&GST_OMX_BUFFER_POOL (self->out_port_pool)->video_info,
-            outbuf);
+        outbuf = gst_omx_video_dec_copy_output_buffer (self, port, outbuf);
 
       buf = NULL;
     } else {
@@ -1948,9 +2323,7 @@ gst_omx_video_dec_loop (GstOMXVideoDec * self)
 #endif
 
       if (GST_OMX_BUFFER_POOL (self->out_port_pool)->need_copy)
-        outbuf =
-            copy_frame (&GST_OMX_BUFFER_POOL (self->out_port_pool)->video_info,
-            outbuf);
+        outbuf = gst_omx_video_dec_copy_output_buffer (self, port, outbuf);
 
       frame->output_buffer = outbuf;
 
@@ -1993,7 +2366,7 @@ gst_omx_video_dec_loop (GstOMXVideoDec * self)
   GST_DEBUG_OBJECT (self, "Finished frame: %s", gst_flow_get_name (flow_ret));
 
   if (buf) {
-    err = gst_omx_port_release_buffer (port, buf);
+    err = gst_omx_port_release_batched_buffer (port, &self->out_batch, buf);
     if (err != OMX_ErrorNone)
       goto release_error;
   }
@@ -2127,6 +2500,10 @@ gst_omx_video_dec_start (GstVideoDecoder * decoder)
   self->last_upstream_ts = 0;
   self->downstream_flow_ret = GST_FLOW_OK;
   self->use_buffers = FALSE;
+  self->copy_pool = gst_omx_video_copy_pool_new (self->n_copy_threads);
+  GST_DEBUG_OBJECT (self, "Copying large frames with %u threads (%s)",
+      gst_omx_video_copy_pool_get_n_threads (self->copy_pool),
+      gst_omx_video_copy_get_implementation ());
 
   return TRUE;
 }
@@ -2150,6 +2527,8 @@ gst_omx_video_dec_stop (GstVideoDecoder * decoder)
 
   gst_pad_stop_task (GST_VIDEO_DECODER_SRC_PAD (decoder));
 
+  gst_omx_video_dec_return_output_batch (self);
+
   if (gst_omx_component_get_state (self->dec, 0) > OMX_StateIdle)
     gst_omx_component_set_state (self->dec, OMX_StateIdle);
 #if defined (USE_OMX_TARGET_RPI) && defined (HAVE_GST_GL)
@@ -2159,15 +2538,22 @@ gst_omx_video_dec_stop (GstVideoDecoder * decoder)
 
   self->downstream_flow_ret = GST_FLOW_FLUSHING;
   self->started = FALSE;
+  self->adaptive_playback = FALSE;
 
   g_mutex_lock (&self->drain_lock);
   self->draining = FALSE;
   g_cond_broadcast (&self->drain_cond);
   g_mutex_unlock (&self->drain_lock);
 
-  gst_omx_component_get_state (self->dec, 5 * GST_SECOND);
 #if defined (USE_OMX_TARGET_RPI) && defined (HAVE_GST_GL)
-  gst_omx_component_get_state (self->egl_render, 1 * GST_SECOND);
+  {
+    GstOMXComponent *comps[] = { self->dec, self->egl_render };
+
+    gst_omx_components_wait_state (comps, G_N_ELEMENTS (comps),
+        5 * GST_SECOND);
+  }
+#else
+  gst_omx_component_get_state (self->dec, 5 * GST_SECOND);
 #endif
 
   gst_buffer_replace (&self->codec_data, NULL);
@@ -2176,6 +2562,9 @@ gst_omx_video_dec_stop (GstVideoDecoder * decoder)
     gst_video_codec_state_unref (self->input_state);
   self->input_state = NULL;
 
+  g_clear_pointer (&self->copy_pool, gst_omx_video_copy_pool_unref);
+  gst_omx_video_dec_set_copy_out_pool (self, NULL);
+
   GST_DEBUG_OBJECT (self, "Stopped decoder");
 
   return TRUE;
@@ -2366,7 +2755,7 @@ gst_omx_video_dec_disable (GstOMXVideoDec * self)
     if (gst_omx_port_wait_buffers_released (self->dec_in_port,
             5 * GST_SECOND) != OMX_ErrorNone)
       return FALSE;
-    if (gst_omx_port_deallocate_buffers (self->dec_in_port) != OMX_ErrorNone)
+    if (!gst_omx_video_dec_deallocate_input_buffers (self))
       return FALSE;
     if (gst_omx_port_wait_enabled (self->dec_in_port,
             1 * GST_SECOND) != OMX_ErrorNone)
@@ -2390,11 +2779,13 @@ gst_omx_video_dec_disable (GstOMXVideoDec * self)
       if (egl_state > OMX_StateLoaded || egl_state == OMX_StateInvalid) {
 
         if (egl_state > OMX_StateIdle) {
+          GstOMXComponent *comps[] = { self->egl_render, self->dec };
+
           gst_omx_component_set_state (self->egl_render, OMX_StateIdle);
           gst_omx_component_set_state (self->dec, OMX_StateIdle);
-          egl_state = gst_omx_component_get_state (self->egl_render,
+          gst_omx_components_wait_state (comps, G_N_ELEMENTS (comps),
               5 * GST_SECOND);
-          gst_omx_component_get_state (self->dec, 1 * GST_SECOND);
+          egl_state = gst_omx_component_get_state (self->egl_render, 0);
         }
         gst_omx_component_set_state (self->egl_render, OMX_StateLoaded);
         gst_omx_component_set_state (self->dec, OMX_StateLoaded);
@@ -2519,6 +2910,49 @@ gst_omx_video_dec_ensure_nb_in_buffers (GstOMXVideoDec * self)
   return TRUE;
 }
 
+static gboolean
+gst_omx_video_dec_set_to_idle (GstOMXVideoDec * self)
+{
+  GstOMXVideoDecClass *klass = GST_OMX_VIDEO_DEC_GET_CLASS (self);
+
+  if (!gst_omx_video_dec_ensure_nb_in_buffers (self))
+    return FALSE;
+
+  if (!(klass->cdata.hacks & GST_OMX_HACK_NO_DISABLE_OUTPORT)) {
+    /* Disable output port */
+    if (gst_omx_port_set_enabled (self->dec_out_port, FALSE) != OMX_ErrorNone)
+      return FALSE;
+
+    if (gst_omx_port_wait_enabled (self->dec_out_port,
+            1 * GST_SECOND) != OMX_ErrorNone)
+      return FALSE;
+
+    if (gst_omx_component_set_state (self->dec,
+            OMX_StateIdle) != OMX_ErrorNone)
+      return FALSE;
+
+    /* Need to allocate buffers to reach Idle state */
+    if (!gst_omx_video_dec_allocate_in_buffers (self))
+      return FALSE;
+  } else {
+    if (gst_omx_component_set_state (self->dec,
+            OMX_StateIdle) != OMX_ErrorNone)
+      return FALSE;
+
+    /* Need to allocate buffers to reach Idle state */
+    if (!gst_omx_video_dec_allocate_in_buffers (self))
+      return FALSE;
+    if (gst_omx_port_allocate_buffers (self->dec_out_port) != OMX_ErrorNone)
+      return FALSE;
+  }
+
+  if (gst_omx_component_get_state (self->dec,
+          GST_CLOCK_TIME_NONE) != OMX_StateIdle)
+    return FALSE;
+
+  return TRUE;
+}
+
 static gboolean
 gst_omx_video_dec_enable (GstOMXVideoDec * self, GstBuffer * input)
 {
@@ -2526,8 +2960,10 @@ gst_omx_video_dec_enable (GstOMXVideoDec * self, GstBuffer * input)
 
   GST_DEBUG_OBJECT (self, "Enabling component");
 
-  self->input_allocation = gst_omx_video_dec_pick_input_allocation_mode (self,
-      input);
+  /* Upstream is filling the buffers of our input pool */
+  if (!self->in_pool_used)
+    self->input_allocation =
+        gst_omx_video_dec_pick_input_allocation_mode (self, input);
 
   if (self->disabled) {
     if (!gst_omx_video_dec_ensure_nb_in_buffers (self))
@@ -2557,41 +2993,13 @@ gst_omx_video_dec_enable (GstOMXVideoDec * self, GstBuffer * input)
     if (!gst_omx_video_dec_negotiate (self))
       GST_LOG_OBJECT (self, "Negotiation failed, will get output format later");
 
-    if (!gst_omx_video_dec_ensure_nb_in_buffers (self))
-      return FALSE;
-
-    if (!(klass->cdata.hacks & GST_OMX_HACK_NO_DISABLE_OUTPORT)) {
-      /* Disable output port */
-      if (gst_omx_port_set_enabled (self->dec_out_port, FALSE) != OMX_ErrorNone)
-        return FALSE;
-
-      if (gst_omx_port_wait_enabled (self->dec_out_port,
-              1 * GST_SECOND) != OMX_ErrorNone)
-        return FALSE;
-
-      if (gst_omx_component_set_state (self->dec,
-              OMX_StateIdle) != OMX_ErrorNone)
-        return FALSE;
-
-      /* Need to allocate buffers to reach Idle state */
-      if (!gst_omx_video_dec_allocate_in_buffers (self))
-        return FALSE;
-    } else {
-      if (gst_omx_component_set_state (self->dec,
-              OMX_StateIdle) != OMX_ErrorNone)
-        return FALSE;
-
-      /* Need to allocate buffers to reach Idle state */
-      if (!gst_omx_video_dec_allocate_in_buffers (self))
-        return FALSE;
-      if (gst_omx_port_allocate_buffers (self->dec_out_port) != OMX_ErrorNone)
+    /* If the input pool is active we already allocated buffers and set the
+     * component to Idle. */
+    if (!self->in_pool_used) {
+      if (!gst_omx_video_dec_set_to_idle (self))
         return FALSE;
     }
 
-    if (gst_omx_component_get_state (self->dec,
-            GST_CLOCK_TIME_NONE) != OMX_StateIdle)
-      return FALSE;
-
     if (gst_omx_component_set_state (self->dec,
             OMX_StateExecuting) != OMX_ErrorNone)
       return FALSE;
@@ -2612,6 +3020,14 @@ gst_omx_video_dec_enable (GstOMXVideoDec * self, GstBuffer * input)
     return FALSE;
   }
 
+  /* The output port is already set up for the stream, allocate its buffers
+   * now instead of after the component reported its settings */
+  if (self->out_presized && !gst_omx_port_is_enabled (self->dec_out_port)) {
+    GST_DEBUG_OBJECT (self, "Enabling output port from the stream headers");
+    if (gst_omx_video_dec_reconfigure_output_port (self) != OMX_ErrorNone)
+      return FALSE;
+  }
+
   self->disabled = FALSE;
 
   return TRUE;
@@ -2729,6 +3145,49 @@ gst_omx_video_dec_set_interlacing_parameters (GstOMXVideoDec * self,
 }
 #endif // USE_OMX_TARGET_ZYNQ_USCALE_PLUS
 
+/* Asks the component to prepare for frames up to max-width x max-height so
+ * it keeps its buffers when the resolution changes within that size */
+static void
+gst_omx_video_dec_set_adaptive_playback (GstOMXVideoDec * self,
+    GstVideoInfo * info)
+{
+  GstOMXVideoDecAdaptivePlaybackParams params;
+  OMX_INDEXTYPE index;
+  OMX_ERRORTYPE err;
+
+  self->adaptive_playback = FALSE;
+
+  if (self->max_width == 0 || self->max_height == 0)
+    return;
+
+  err = gst_omx_component_get_extension_index (self->dec,
+      GST_OMX_VIDEO_DEC_ADAPTIVE_PLAYBACK_EXTENSION, &index);
+  if (err != OMX_ErrorNone) {
+    GST_WARNING_OBJECT (self,
+        "Adaptive playback not supported by the component: %s (0x%08x)",
+        gst_omx_error_to_string (err), err);
+    return;
+  }
+
+  GST_OMX_INIT_STRUCT (&params);
+  params.nPortIndex = self->dec_out_port->index;
+  params.bEnable = OMX_TRUE;
+  params.nMaxFrameWidth = MAX (self->max_width, info->width);
+  params.nMaxFrameHeight = MAX (self->max_height, info->height);
+
+  err = gst_omx_component_set_parameter (self->dec, index, &params);
+  if (err != OMX_ErrorNone) {
+    GST_WARNING_OBJECT (self,
+        "Failed to enable adaptive playback: %s (0x%08x)",
+        gst_omx_error_to_string (err), err);
+    return;
+  }
+
+  GST_DEBUG_OBJECT (self, "Adaptive playback enabled for frames up to %ux%u",
+      (guint) params.nMaxFrameWidth, (guint) params.nMaxFrameHeight);
+  self->adaptive_playback = TRUE;
+}
+
 static gboolean
 gst_omx_video_dec_set_format (GstVideoDecoder * decoder,
     GstVideoCodecState * state)
@@ -2737,6 +3196,7 @@ gst_omx_video_dec_set_format (GstVideoDecoder * decoder,
   GstOMXVideoDecClass *klass;
   GstVideoInfo *info = &state->info;
   gboolean is_format_change = FALSE;
+  gboolean is_subclass_format_change = FALSE;
   gboolean needs_disable = FALSE;
   OMX_PARAM_PORTDEFINITIONTYPE port_def;
   OMX_U32 framerate_q16 = gst_omx_video_calculate_framerate_q16 (info);
@@ -2768,8 +3228,9 @@ gst_omx_video_dec_set_format (GstVideoDecoder * decoder,
       video.xFramerate, framerate_q16);
   is_format_change |= (self->codec_data != state->codec_data);
   if (klass->is_format_change)
-    is_format_change |=
+    is_subclass_format_change =
         klass->is_format_change (self, self->dec_in_port, state);
+  is_format_change |= is_subclass_format_change;
 
   needs_disable =
       gst_omx_component_get_state (self->dec,
@@ -2787,6 +3248,20 @@ gst_omx_video_dec_set_format (GstVideoDecoder * decoder,
     return TRUE;
   }
 
+  /* With adaptive playback the component follows resolution changes within
+   * the maximum size by itself, the new codec data are passed in-band */
+  if (needs_disable && !self->disabled && self->adaptive_playback
+      && !is_subclass_format_change && info->width <= self->max_width
+      && info->height <= self->max_height) {
+    GST_DEBUG_OBJECT (self,
+        "Already running and adaptive playback handles the new format");
+    gst_buffer_replace (&self->codec_data, state->codec_data);
+    if (self->input_state)
+      gst_video_codec_state_unref (self->input_state);
+    self->input_state = gst_video_codec_state_ref (state);
+    return TRUE;
+  }
+
   if (needs_disable && is_format_change) {
     if (!gst_omx_video_dec_disable (self))
       return FALSE;
@@ -2856,6 +3331,8 @@ gst_omx_video_dec_set_format (GstVideoDecoder * decoder,
     }
   }
 
+  gst_omx_video_dec_set_adaptive_playback (self, info);
+
   GST_DEBUG_OBJECT (self, "Updating ports definition");
   if (gst_omx_port_update_port_definition (self->dec_out_port,
           NULL) != OMX_ErrorNone)
@@ -2864,9 +3341,16 @@ gst_omx_video_dec_set_format (GstVideoDecoder * decoder,
           NULL) != OMX_ErrorNone)
     return FALSE;
 
+  gst_omx_video_dec_presize_port_buffers (self, self->dec_in_port);
+
   gst_buffer_replace (&self->codec_data, state->codec_data);
   self->input_state = gst_video_codec_state_ref (state);
 
+  self->out_presized = FALSE;
+  self->dpb_size = 0;
+  if (state->codec_data)
+    gst_omx_video_dec_presize_output_port (self, state->codec_data);
+
 #ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
   gst_omx_video_dec_set_latency (self);
 #endif
@@ -2875,30 +3359,80 @@ gst_omx_video_dec_set_format (GstVideoDecoder * decoder,
   return TRUE;
 }
 
+/* Flushes both ports while the component stays in Executing. The srcpad
+ * task is only paused and resumed by the next ::handle_frame() */
+static void
+gst_omx_video_dec_flush_executing (GstOMXVideoDec * self)
+{
+  OMX_ERRORTYPE err;
+
+  /* 1) Flush the ports */
+  GST_DEBUG_OBJECT (self, "flushing ports without pausing");
+  err = gst_omx_component_set_flushing (self->dec, 5 * GST_SECOND, TRUE);
+  if (err != OMX_ErrorNone) {
+    GST_WARNING_OBJECT (self, "Failed to flush ports: %s (0x%08x)",
+        gst_omx_error_to_string (err), err);
+  }
+
+  /* 2) Wait until the srcpad loop is paused,
+   * unlock GST_VIDEO_DECODER_STREAM_LOCK to prevent deadlocks
+   * caused by using this lock from inside the loop function */
+  GST_VIDEO_DECODER_STREAM_UNLOCK (self);
+  gst_pad_pause_task (GST_VIDEO_DECODER_SRC_PAD (self));
+  GST_DEBUG_OBJECT (self, "Flushing -- task paused");
+  GST_VIDEO_DECODER_STREAM_LOCK (self);
+
+  gst_omx_video_dec_return_output_batch (self);
+
+  /* 3) Unset flushing and give all output buffers back to the component */
+  gst_omx_component_set_flushing (self->dec, 5 * GST_SECOND, FALSE);
+
+  err = gst_omx_port_populate (self->dec_out_port);
+  if (err != OMX_ErrorNone) {
+    GST_WARNING_OBJECT (self, "Failed to populate output port: %s (0x%08x)",
+        gst_omx_error_to_string (err), err);
+  }
+}
+
 static gboolean
 gst_omx_video_dec_flush (GstVideoDecoder * decoder)
 {
   GstOMXVideoDec *self = GST_OMX_VIDEO_DEC (decoder);
+  GstOMXVideoDecClass *klass = GST_OMX_VIDEO_DEC_GET_CLASS (self);
   OMX_ERRORTYPE err = OMX_ErrorNone;
+  GstOMXComponent *comps[2];
+  guint n_comps = 0;
 
   GST_DEBUG_OBJECT (self, "Flushing decoder");
 
   if (gst_omx_component_get_state (self->dec, 0) == OMX_StateLoaded)
     return TRUE;
 
-  /* 0) Pause the components */
-  if (gst_omx_component_get_state (self->dec, 0) == OMX_StateExecuting) {
-    gst_omx_component_set_state (self->dec, OMX_StatePause);
-    gst_omx_component_get_state (self->dec, GST_CLOCK_TIME_NONE);
+  if (!(klass->cdata.hacks & GST_OMX_HACK_FLUSH_REQUIRES_PAUSE)
+#if defined (USE_OMX_TARGET_RPI) && defined (HAVE_GST_GL)
+      && !self->eglimage
+#endif
+      && gst_omx_component_get_state (self->dec, 0) == OMX_StateExecuting) {
+    gst_omx_video_dec_flush_executing (self);
+    goto done;
   }
+
+  comps[n_comps++] = self->dec;
+#if defined (USE_OMX_TARGET_RPI) && defined (HAVE_GST_GL)
+  if (self->eglimage)
+    comps[n_comps++] = self->egl_render;
+#endif
+
+  /* 0) Pause the components, both transitions run in parallel */
+  if (gst_omx_component_get_state (self->dec, 0) == OMX_StateExecuting)
+    gst_omx_component_set_state (self->dec, OMX_StatePause);
 #if defined (USE_OMX_TARGET_RPI) && defined (HAVE_GST_GL)
   if (self->eglimage) {
-    if (gst_omx_component_get_state (self->egl_render, 0) == OMX_StateExecuting) {
+    if (gst_omx_component_get_state (self->egl_render, 0) == OMX_StateExecuting)
       gst_omx_component_set_state (self->egl_render, OMX_StatePause);
-      gst_omx_component_get_state (self->egl_render, GST_CLOCK_TIME_NONE);
-    }
   }
 #endif
+  gst_omx_components_wait_state (comps, n_comps, GST_CLOCK_TIME_NONE);
 
   /* 1) Flush the ports */
   GST_DEBUG_OBJECT (self, "flushing ports");
@@ -2920,15 +3454,15 @@ gst_omx_video_dec_flush (GstVideoDecoder * decoder)
   GST_DEBUG_OBJECT (self, "Flushing -- task stopped");
   GST_VIDEO_DECODER_STREAM_LOCK (self);
 
+  gst_omx_video_dec_return_output_batch (self);
+
   /* 3) Resume components */
   gst_omx_component_set_state (self->dec, OMX_StateExecuting);
-  gst_omx_component_get_state (self->dec, GST_CLOCK_TIME_NONE);
 #if defined (USE_OMX_TARGET_RPI) && defined (HAVE_GST_GL)
-  if (self->eglimage) {
+  if (self->eglimage)
     gst_omx_component_set_state (self->egl_render, OMX_StateExecuting);
-    gst_omx_component_get_state (self->egl_render, GST_CLOCK_TIME_NONE);
-  }
 #endif
+  gst_omx_components_wait_state (comps, n_comps, GST_CLOCK_TIME_NONE);
 
   /* 4) Unset flushing to allow ports to accept data again */
   gst_omx_port_set_flushing (self->dec_in_port, 5 * GST_SECOND, FALSE);
@@ -2952,6 +3486,7 @@ gst_omx_video_dec_flush (GstVideoDecoder * decoder)
         gst_omx_error_to_string (err), err);
   }
 
+done:
   /* Reset our state */
   self->last_upstream_ts = 0;
   self->downstream_flow_ret = GST_FLOW_OK;
@@ -2961,12 +3496,95 @@ gst_omx_video_dec_flush (GstVideoDecoder * decoder)
   return TRUE;
 }
 
+static GstOMXBuffer *
+get_omx_buf (GstBuffer * buffer)
+{
+  GstMemory *mem;
+
+  mem = gst_buffer_peek_memory (buffer, 0);
+  return gst_omx_memory_get_omx_buf (mem);
+}
+
+static gboolean
+buffer_is_from_input_pool (GstOMXVideoDec * self, GstBuffer * buffer)
+{
+  /* Buffer from our input pool will already have a GstOMXBuffer associated
+   * with our input port. */
+  GstOMXBuffer *buf;
+
+  if (!self->in_pool_used || gst_buffer_n_memory (buffer) != 1)
+    return FALSE;
+
+  buf = get_omx_buf (buffer);
+  if (!buf)
+    return FALSE;
+
+  return buf->port == self->dec_in_port;
+}
+
+/* Once upstream activated our input pool, all buffers of the input port
+ * are handed out by it. Buffers of the pool are returned to it once the
+ * component emptied them. */
+static GstOMXAcquireBufferReturn
+gst_omx_video_dec_acquire_input_buffer (GstOMXVideoDec * self,
+    GstOMXBuffer ** buf)
+{
+  GstBuffer *buffer;
+  GstFlowReturn flow_ret;
+
+  if (!self->in_pool_used)
+    return gst_omx_port_acquire_buffer (self->dec_in_port, buf, GST_OMX_WAIT);
+
+  flow_ret = gst_buffer_pool_acquire_buffer (self->in_port_pool, &buffer, NULL);
+  if (flow_ret == GST_FLOW_FLUSHING)
+    return GST_OMX_ACQUIRE_BUFFER_FLUSHING;
+  else if (flow_ret != GST_FLOW_OK)
+    return GST_OMX_ACQUIRE_BUFFER_ERROR;
+
+  *buf = get_omx_buf (buffer);
+  g_assert (!(*buf)->input_buffer);
+  (*buf)->input_buffer = buffer;
+
+  return GST_OMX_ACQUIRE_BUFFER_OK;
+}
+
+/* Frames outside of the segment and frames that are late already are only
+ * decoded for reference, the component doesn't output them. Their codec
+ * frames are released as ghost frames once a newer frame was output.
+ *
+ * NOTE: Call with GST_VIDEO_DECODER_STREAM_LOCK */
+static gboolean
+gst_omx_video_dec_is_decode_only (GstOMXVideoDec * self,
+    GstVideoCodecFrame * frame, gboolean late)
+{
+  GstOMXVideoDecClass *klass = GST_OMX_VIDEO_DEC_GET_CLASS (self);
+  GstSegment *segment = &GST_VIDEO_DECODER (self)->input_segment;
+  GstClockTime stop = GST_CLOCK_TIME_NONE;
+
+  if (klass->cdata.hacks & GST_OMX_HACK_NO_DECODE_ONLY)
+    return FALSE;
+
+  if (late || GST_VIDEO_CODEC_FRAME_IS_DECODE_ONLY (frame))
+    return TRUE;
+
+  if (segment->format != GST_FORMAT_TIME
+      || !GST_CLOCK_TIME_IS_VALID (frame->pts))
+    return FALSE;
+
+  if (GST_CLOCK_TIME_IS_VALID (frame->duration))
+    stop = frame->pts + frame->duration;
+
+  return !gst_segment_clip (segment, GST_FORMAT_TIME, frame->pts, stop, NULL,
+      NULL);
+}
+
 static GstFlowReturn
 gst_omx_video_dec_handle_frame (GstVideoDecoder * decoder,
     GstVideoCodecFrame * frame)
 {
   GstOMXAcquireBufferReturn acq_ret = GST_OMX_ACQUIRE_BUFFER_ERROR;
   GstOMXVideoDec *self;
+  GstOMXVideoDecClass *klass;
   GstOMXPort *port;
   GstOMXBuffer *buf;
   GstBuffer *codec_data = NULL;
@@ -2975,6 +3593,8 @@ gst_omx_video_dec_handle_frame (GstVideoDecoder * decoder,
   OMX_ERRORTYPE err;
   gboolean done = FALSE;
   gboolean first_ouput_buffer = TRUE;
+  gboolean from_input_pool = FALSE;
+  gboolean late, decode_only;
   guint memory_idx = 0;         /* only used in dynamic buffer mode */
   gboolean last_subframe = GST_BUFFER_FLAG_IS_SET (frame->input_buffer,
       GST_VIDEO_BUFFER_FLAG_MARKER);
@@ -2983,6 +3603,7 @@ gst_omx_video_dec_handle_frame (GstVideoDecoder * decoder,
   gboolean subframe_mode = gst_video_decoder_get_subframe_mode (decoder);
 
   self = GST_OMX_VIDEO_DEC (decoder);
+  klass = GST_OMX_VIDEO_DEC_GET_CLASS (self);
 
   GST_DEBUG_OBJECT (self,
       "Handling frame %p last_subframe=%d header %d subframes %d", frame,
@@ -3000,6 +3621,10 @@ gst_omx_video_dec_handle_frame (GstVideoDecoder * decoder,
     }
 
     if (gst_omx_port_is_flushing (self->dec_out_port)) {
+      /* Without codec_data the headers are in-band */
+      if (!self->out_presized)
+        gst_omx_video_dec_presize_output_port (self, frame->input_buffer);
+
       if (!gst_omx_video_dec_enable (self, frame->input_buffer))
         goto enable_error;
     }
@@ -3009,6 +3634,38 @@ gst_omx_video_dec_handle_frame (GstVideoDecoder * decoder,
         (GstTaskFunction) gst_omx_video_dec_loop, decoder, NULL);
   }
 
+  /* Key unit trick modes only need the sync frames */
+  if ((self->keyframes_only
+          || (decoder->input_segment.flags &
+              GST_SEGMENT_FLAG_TRICKMODE_KEY_UNITS))
+      && !GST_VIDEO_CODEC_FRAME_IS_SYNC_POINT (frame) && !header) {
+    GST_LOG_OBJECT (self, "Skipping non-keyframe %p", frame);
+    gst_video_decoder_release_frame (decoder, frame);
+    return GST_FLOW_OK;
+  }
+
+  if (klass->parse_headers && (header
+          || GST_VIDEO_CODEC_FRAME_IS_SYNC_POINT (frame)))
+    klass->parse_headers (self, frame->input_buffer);
+
+  late = gst_video_decoder_get_max_decode_time (decoder, frame) < 0;
+
+  /* Catch up when we are late by not even copying the frames that no
+   * other frame depends on into the component */
+  if (late && klass->is_disposable && !header && !subframe_mode
+      && !GST_VIDEO_CODEC_FRAME_IS_SYNC_POINT (frame)
+      && klass->is_disposable (self, frame->input_buffer)) {
+    GST_LOG_OBJECT (self, "Dropping late disposable frame %p", frame);
+    gst_video_decoder_drop_frame (decoder, frame);
+    return GST_FLOW_OK;
+  }
+
+  decode_only = !header && gst_omx_video_dec_is_decode_only (self, frame, late);
+  if (decode_only)
+    GST_LOG_OBJECT (self, "Frame %p is only decoded for reference", frame);
+
+  gst_omx_video_frame_index_add (&self->frame_index, frame);
+
   timestamp = frame->pts;
   duration = frame->duration;
   port = self->dec_in_port;
@@ -3019,7 +3676,27 @@ gst_omx_video_dec_handle_frame (GstVideoDecoder * decoder,
      * _loop() can't call _finish_frame() and we might block forever
      * because no input buffers are released */
     GST_VIDEO_DECODER_STREAM_UNLOCK (self);
-    acq_ret = gst_omx_port_acquire_buffer (port, &buf, GST_OMX_WAIT);
+
+    if (!self->codec_data
+        && buffer_is_from_input_pool (self, frame->input_buffer)) {
+      /* Receiving a buffer from our input pool, the component reads the
+       * frame where upstream wrote it */
+      buf = get_omx_buf (frame->input_buffer);
+
+      GST_LOG_OBJECT (self,
+          "Input buffer %p already has a OMX buffer associated: %p",
+          frame->input_buffer, buf);
+
+      g_assert (!buf->input_buffer);
+      /* Prevent the buffer to be released to the pool while it's being
+       * processed by OMX. The reference will be dropped in EmptyBufferDone() */
+      buf->input_buffer = gst_buffer_ref (frame->input_buffer);
+
+      acq_ret = GST_OMX_ACQUIRE_BUFFER_OK;
+      from_input_pool = TRUE;
+    } else {
+      acq_ret = gst_omx_video_dec_acquire_input_buffer (self, &buf);
+    }
 
     if (acq_ret == GST_OMX_ACQUIRE_BUFFER_ERROR) {
       GST_VIDEO_DECODER_STREAM_LOCK (self);
@@ -3028,6 +3705,17 @@ gst_omx_video_dec_handle_frame (GstVideoDecoder * decoder,
       GST_VIDEO_DECODER_STREAM_LOCK (self);
       goto flushing;
     } else if (acq_ret == GST_OMX_ACQUIRE_BUFFER_RECONFIGURE) {
+      if (self->adaptive_playback && gst_omx_port_can_reuse_buffers (port)) {
+        GST_DEBUG_OBJECT (self,
+            "Keeping the input buffers for the new settings");
+
+        err = gst_omx_port_mark_reconfigured (port);
+        GST_VIDEO_DECODER_STREAM_LOCK (self);
+        if (err != OMX_ErrorNone)
+          goto reconfigure_error;
+        continue;
+      }
+
       /* Reallocate all buffers */
       err = gst_omx_port_set_enabled (port, FALSE);
       if (err != OMX_ErrorNone) {
@@ -3145,7 +3833,19 @@ gst_omx_video_dec_handle_frame (GstVideoDecoder * decoder,
 
     /* Now handle the frame */
 
-    if (self->input_allocation == GST_OMX_BUFFER_ALLOCATION_USE_BUFFER_DYNAMIC) {
+    if (from_input_pool) {
+      GstMemory *mem = gst_buffer_peek_memory (frame->input_buffer, 0);
+
+      buf->omx_buf->nOffset = mem->offset;
+      buf->omx_buf->nFilledLen = mem->size;
+
+      GST_LOG_OBJECT (self,
+          "Passing %d bytes to the component without copy",
+          (guint) buf->omx_buf->nFilledLen);
+
+      done = TRUE;
+    } else if (self->input_allocation ==
+        GST_OMX_BUFFER_ALLOCATION_USE_BUFFER_DYNAMIC) {
       /* Transfer the buffer content per memory rather than mapping the full
        * buffer to prevent copies. */
       GstMemory *mem = gst_buffer_peek_memory (frame->input_buffer, memory_idx);
@@ -3207,10 +3907,8 @@ gst_omx_video_dec_handle_frame (GstVideoDecoder * decoder,
     if (header)
       buf->omx_buf->nFlags |= OMX_BUFFERFLAG_CODECCONFIG;
 
-    /* TODO: Set flags
-     *   - OMX_BUFFERFLAG_DECODEONLY for buffers that are outside
-     *     the segment
-     */
+    if (decode_only)
+      buf->omx_buf->nFlags |= OMX_BUFFERFLAG_DECODEONLY;
 
     if (done) {
       /* If the input buffer is a subframe mark the OMX buffer as such */
@@ -3364,7 +4062,7 @@ gst_omx_video_dec_finish (GstVideoDecoder * decoder)
   /* Send an EOS buffer to the component and let the base
    * class drop the EOS event. We will send it later when
    * the EOS buffer arrives on the output port. */
-  acq_ret = gst_omx_port_acquire_buffer (self->dec_in_port, &buf, GST_OMX_WAIT);
+  acq_ret = gst_omx_video_dec_acquire_input_buffer (self, &buf);
   if (acq_ret != GST_OMX_ACQUIRE_BUFFER_OK) {
     GST_VIDEO_DECODER_STREAM_LOCK (self);
     GST_ERROR_OBJECT (self, "Failed to acquire buffer for draining: %d",
@@ -3502,21 +4200,127 @@ gst_omx_video_dec_decide_allocation (GstVideoDecoder * bdec, GstQuery * query)
   gst_buffer_pool_set_config (pool, config);
   gst_object_unref (pool);
 
+  gst_omx_video_dec_set_copy_out_pool (self, query);
+
   return TRUE;
 }
 
+/* Called by upstream activating the pool, on its own thread. Takes the
+ * stream lock as the component is brought to Idle and in_pool_used set,
+ * like from the streaming thread */
+static gboolean
+pool_request_allocate_cb (GstBufferPool * pool, GstOMXVideoDec * self)
+{
+  GstStructure *config;
+  gboolean ret = FALSE;
+  guint min;
+
+  config = gst_buffer_pool_get_config (pool);
+
+  if (!gst_buffer_pool_config_get_params (config, NULL, NULL, &min, NULL)) {
+    gst_structure_free (config);
+    return FALSE;
+  }
+  gst_structure_free (config);
+
+  GST_VIDEO_DECODER_STREAM_LOCK (self);
+
+  /* Replaced or dropped by set_format() or stop() in the meantime */
+  if (pool != self->in_port_pool) {
+    GST_DEBUG_OBJECT (self, "input pool %p is not used anymore", pool);
+    goto done;
+  }
+
+  GST_DEBUG_OBJECT (self,
+      "input pool configured for %d buffers, adjust nBufferCountActual", min);
+
+  if (!gst_omx_port_update_buffer_count_actual (self->dec_in_port, min))
+    goto done;
+
+  self->input_allocation = GST_OMX_BUFFER_ALLOCATION_ALLOCATE_BUFFER;
+
+  if (!gst_omx_video_dec_set_to_idle (self))
+    goto done;
+
+  self->in_pool_used = TRUE;
+
+  /* gst_omx_port_acquire_buffer() will fail if the input port is still
+   * flushing which will prevent upstream from acquiring buffers. */
+  gst_omx_port_set_flushing (self->dec_in_port, 5 * GST_SECOND, FALSE);
+
+  ret = TRUE;
+
+done:
+  GST_VIDEO_DECODER_STREAM_UNLOCK (self);
+
+  return ret;
+}
+
+static GstBufferPool *
+create_input_pool (GstOMXVideoDec * self, GstCaps * caps, guint num_buffers)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+
+  pool =
+      gst_omx_buffer_pool_new (GST_ELEMENT_CAST (self), self->dec,
+      self->dec_in_port, GST_OMX_BUFFER_MODE_SYSTEM_MEMORY);
+
+  g_signal_connect_object (pool, "allocate",
+      G_CALLBACK (pool_request_allocate_cb), self, 0);
+
+  config = gst_buffer_pool_get_config (pool);
+
+  gst_buffer_pool_config_set_params (config, caps,
+      self->dec_in_port->port_def.nBufferSize, num_buffers, 0);
+
+  if (!gst_buffer_pool_set_config (pool, config)) {
+    GST_INFO_OBJECT (self, "Failed to set config on input pool");
+    gst_object_unref (pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
 static gboolean
 gst_omx_video_dec_propose_allocation (GstVideoDecoder * bdec, GstQuery * query)
 {
   GstOMXVideoDec *self = GST_OMX_VIDEO_DEC (bdec);
+  GstBufferPool *pool = NULL;
+  GstCaps *caps;
   guint size, num_buffers;
 
+  gst_query_parse_allocation (query, &caps, NULL);
+
   size = self->dec_in_port->port_def.nBufferSize;
   num_buffers = self->dec_in_port->port_def.nBufferCountMin + 1;
 
+  /* in_port_pool and in_pool_used are checked by pool_request_allocate_cb()
+   * with the stream lock too */
+  GST_VIDEO_DECODER_STREAM_LOCK (self);
+  if (self->in_pool_used) {
+    /* Upstream keeps on filling the buffers of the input port */
+    pool = gst_object_ref (self->in_port_pool);
+    num_buffers = self->dec_in_port->port_def.nBufferCountActual;
+  } else if (caps
+      && gst_omx_component_get_state (self->dec, 0) == OMX_StateLoaded) {
+    /* The buffers of the input port are not allocated yet so upstream can
+     * write the frames into them directly */
+    g_clear_object (&self->in_port_pool);
+    self->in_port_pool = create_input_pool (self, caps, num_buffers);
+    if (self->in_port_pool)
+      pool = gst_object_ref (self->in_port_pool);
+    else
+      GST_WARNING_OBJECT (self, "Failed to create and configure input pool");
+  }
+  GST_VIDEO_DECODER_STREAM_UNLOCK (self);
+
   GST_DEBUG_OBJECT (self,
       "request at least %d buffers of size %d", num_buffers, size);
-  gst_query_add_allocation_pool (query, NULL, size, num_buffers, 0);
+  gst_query_add_allocation_pool (query, pool, size, num_buffers, 0);
+
+  g_clear_object (&pool);
 
   return
       GST_VIDEO_DECODER_CLASS
@@ -30,6 +30,8 @@
 #include <gst/video/gstvideodecoder.h>
 
 #include "gstomx.h"
+#include "gstomxvideo.h"
+#include "gstomxvideocopy.h"
 
 G_BEGIN_DECLS
 
@@ -77,6 +79,17 @@ struct _GstOMXVideoDec
   gboolean draining; /* protected by drain_lock */
 
   GstFlowReturn downstream_flow_ret;
+  /* Output buffers acquired from the component in one go, only used
+   * by the srcpad loop while it is running */
+  GstOMXBufferBatch out_batch;
+  /* Frames passed to ::handle_frame() and not freed yet */
+  GstOMXVideoFrameIndex frame_index;
+  /* Splits the copies of large frames between threads and keeps track of
+   * the lazy ones. Only set between ::start() and ::stop() */
+  GstOMXVideoCopyPool *copy_pool;
+  /* Recycles the frames copied out of out_port_pool when it needs a copy,
+   * set in ::decide_allocation(). Protected by the object lock */
+  GstBufferPool *copy_out_pool;
   /* Initially FALSE. Switched to TRUE when all requirements
    * are met to try setting up the decoder with OMX_UseBuffer.
    * Switched to FALSE if this trial fails so that the decoder
@@ -95,11 +108,28 @@ struct _GstOMXVideoDec
   /* TRUE if decoder is producing dmabuf */
   gboolean dmabuf;
   GstOMXBufferAllocation input_allocation;
+  /* TRUE if the buffers of the input port are handed out by the pool we
+   * proposed to upstream */
+  gboolean in_pool_used;
+  /* TRUE if the component prepared for frames up to max_width x max_height
+   * and keeps its buffers when the resolution changes within that size */
+  gboolean adaptive_playback;
+  /* TRUE if the output port was configured from the stream headers before
+   * the component parsed them, its buffers are then allocated at start */
+  gboolean out_presized;
+  /* Frames the decoder keeps for reference and reordering according to
+   * the stream headers, 0 if unknown */
+  guint dpb_size;
 
   /* properties */
 #ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
   guint32 internal_entropy_buffers;
 #endif
+  guint stats_interval;
+  guint n_copy_threads;
+  guint max_width;
+  guint max_height;
+  gboolean keyframes_only;
 };
 
 struct _GstOMXVideoDecClass
@@ -110,6 +140,15 @@ struct _GstOMXVideoDecClass
 
   gboolean (*is_format_change) (GstOMXVideoDec * self, GstOMXPort * port, GstVideoCodecState * state);
   gboolean (*set_format)       (GstOMXVideoDec * self, GstOMXPort * port, GstVideoCodecState * state);
+  /* Returns TRUE if no other frame refers to the frame in buffer, it is
+   * dropped without being decoded when it is late already */
+  gboolean (*is_disposable)    (GstOMXVideoDec * self, GstBuffer * buffer);
+  /* Called with every header and sync frame before is_disposable, to track
+   * the in-band headers the disposable rules depend on */
+  void     (*parse_headers)    (GstOMXVideoDec * self, GstBuffer * buffer);
+  /* Parses the picture size and the DPB size in frames from the headers in
+   * buffer, the codec_data or the first frame. dpb_size is 0 if unknown */
+  gboolean (*parse_stream_info) (GstOMXVideoDec * self, GstBuffer * buffer, guint * width, guint * height, guint * dpb_size);
 };
 
 GType gst_omx_video_dec_get_type (void);
@@ -30,6 +30,7 @@
 
 #include "gstomxbufferpool.h"
 #include "gstomxvideo.h"
+#include "gstomxvideocopy.h"
 #include "gstomxvideoenc.h"
 
 #ifdef USE_OMX_TARGET_RPI
@@ -283,6 +284,9 @@ enum
   PROP_LONGTERM_REF,
   PROP_LONGTERM_FREQUENCY,
   PROP_LOOK_AHEAD,
+  PROP_STATS,
+  PROP_STATS_INTERVAL,
+  PROP_N_COPY_THREADS,
 };
 
 /* FIXME: Better defaults */
@@ -310,6 +314,7 @@ enum
 #define GST_OMX_VIDEO_ENC_LONGTERM_REF_DEFAULT (FALSE)
 #define GST_OMX_VIDEO_ENC_LONGTERM_FREQUENCY_DEFAULT (0)
 #define GST_OMX_VIDEO_ENC_LOOK_AHEAD_DEFAULT (0)
+#define GST_OMX_VIDEO_ENC_N_COPY_THREADS_DEFAULT (0)
 
 /* ZYNQ_USCALE_PLUS encoder custom events */
 #define OMX_ALG_GST_EVENT_INSERT_LONGTERM "omx-alg/insert-longterm"
@@ -522,6 +527,17 @@ gst_omx_video_enc_class_init (GstOMXVideoEncClass * klass)
           GST_PARAM_MUTABLE_READY));
 #endif
 
+  gst_omx_install_stats_properties (gobject_class, PROP_STATS,
+      PROP_STATS_INTERVAL);
+
+  g_object_class_install_property (gobject_class, PROP_N_COPY_THREADS,
+      g_param_spec_uint ("n-copy-threads", "Number of copy threads",
+          "Number of threads copying large frames when they can't be shared "
+          "with the OpenMAX component (0 = automatic, 1 = single-threaded)",
+          0, 16, GST_OMX_VIDEO_ENC_N_COPY_THREADS_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   element_class->change_state =
       GST_DEBUG_FUNCPTR (gst_omx_video_enc_change_state);
 
@@ -580,11 +596,14 @@ gst_omx_video_enc_init (GstOMXVideoEnc * self)
   self->long_term_freq = GST_OMX_VIDEO_ENC_LONGTERM_FREQUENCY_DEFAULT;
   self->look_ahead = GST_OMX_VIDEO_ENC_LOOK_AHEAD_DEFAULT;
 #endif
+  self->stats_interval = GST_OMX_STATS_INTERVAL_DEFAULT;
+  self->n_copy_threads = GST_OMX_VIDEO_ENC_N_COPY_THREADS_DEFAULT;
 
   self->default_target_bitrate = GST_OMX_PROP_OMX_DEFAULT;
 
   g_mutex_init (&self->drain_lock);
   g_cond_init (&self->drain_cond);
+  gst_omx_video_frame_index_init (&self->frame_index);
 
 #ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
   self->alg_roi_quality_enum_class =
@@ -948,17 +967,27 @@ gst_omx_video_enc_open (GstVideoEncoder * encoder)
 {
   GstOMXVideoEnc *self = GST_OMX_VIDEO_ENC (encoder);
   GstOMXVideoEncClass *klass = GST_OMX_VIDEO_ENC_GET_CLASS (self);
+  GstOMXComponent *enc;
+  GstOMXPort *in_port, *out_port;
   gint in_port_index, out_port_index;
 
-  self->enc =
+  enc =
       gst_omx_component_new (GST_OBJECT_CAST (self), klass->cdata.core_name,
       klass->cdata.component_name, klass->cdata.component_role,
       klass->cdata.hacks);
   self->started = FALSE;
 
-  if (!self->enc)
+  if (!enc)
     return FALSE;
 
+  /* The stats property might be read concurrently */
+  GST_OBJECT_LOCK (self);
+  self->enc = enc;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_omx_component_set_stats_interval (self->enc,
+      self->stats_interval * GST_MSECOND);
+
   if (gst_omx_component_get_state (self->enc,
           GST_CLOCK_TIME_NONE) != OMX_StateLoaded)
     return FALSE;
@@ -989,8 +1018,12 @@ gst_omx_video_enc_open (GstVideoEncoder * encoder)
     }
   }
 
-  self->enc_in_port = gst_omx_component_add_port (self->enc, in_port_index);
-  self->enc_out_port = gst_omx_component_add_port (self->enc, out_port_index);
+  in_port = gst_omx_component_add_port (self->enc, in_port_index);
+  out_port = gst_omx_component_add_port (self->enc, out_port_index);
+  GST_OBJECT_LOCK (self);
+  self->enc_in_port = in_port;
+  self->enc_out_port = out_port;
+  GST_OBJECT_UNLOCK (self);
 
   if (!self->enc_in_port || !self->enc_out_port)
     return FALSE;
@@ -1092,17 +1125,22 @@ static gboolean
 gst_omx_video_enc_close (GstVideoEncoder * encoder)
 {
   GstOMXVideoEnc *self = GST_OMX_VIDEO_ENC (encoder);
+  GstOMXComponent *enc;
 
   GST_DEBUG_OBJECT (self, "Closing encoder");
 
   if (!gst_omx_video_enc_shutdown (self))
     return FALSE;
 
+  /* The stats property might be read concurrently */
+  GST_OBJECT_LOCK (self);
   self->enc_in_port = NULL;
   self->enc_out_port = NULL;
-  if (self->enc)
-    gst_omx_component_unref (self->enc);
+  enc = self->enc;
   self->enc = NULL;
+  GST_OBJECT_UNLOCK (self);
+  if (enc)
+    gst_omx_component_unref (enc);
 
   self->started = FALSE;
 
@@ -1116,6 +1154,7 @@ gst_omx_video_enc_finalize (GObject * object)
 
   g_mutex_clear (&self->drain_lock);
   g_cond_clear (&self->drain_cond);
+  gst_omx_video_frame_index_clear (&self->frame_index);
 
 #ifdef USE_OMX_TARGET_ZYNQ_USCALE_PLUS
   g_clear_pointer (&self->alg_roi_quality_enum_class, g_type_class_unref);
@@ -1222,6 +1261,12 @@ gst_omx_video_enc_set_property (GObject * object, guint prop_id,
       self->look_ahead = g_value_get_uint (value);
       break;
 #endif
+    case PROP_STATS_INTERVAL:
+      self->stats_interval = g_value_get_uint (value);
+      break;
+    case PROP_N_COPY_THREADS:
+      self->n_copy_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1311,6 +1356,15 @@ gst_omx_video_enc_get_property (GObject * object, guint prop_id, GValue * value,
       g_value_set_uint (value, self->look_ahead);
       break;
 #endif
+    case PROP_STATS:
+      gst_omx_get_stats_property (GST_OBJECT (self), &self->enc, value);
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, self->stats_interval);
+      break;
+    case PROP_N_COPY_THREADS:
+      g_value_set_uint (value, self->n_copy_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1602,7 +1656,8 @@ gst_omx_video_enc_loop (GstOMXVideoEnc * self)
 
   klass = GST_OMX_VIDEO_ENC_GET_CLASS (self);
 
-  acq_return = gst_omx_port_acquire_buffer (port, &buf, GST_OMX_WAIT);
+  acq_return = gst_omx_port_acquire_batched_buffer (port, &self->out_batch,
+      &buf, GST_OMX_WAIT);
   if (acq_return == GST_OMX_ACQUIRE_BUFFER_ERROR) {
     goto component_error;
   } else if (acq_return == GST_OMX_ACQUIRE_BUFFER_FLUSHING) {
@@ -1711,8 +1766,10 @@ gst_omx_video_enc_loop (GstOMXVideoEnc * self)
       gst_omx_buffer_flags_to_string (buf->omx_buf->nFlags),
       (guint64) GST_OMX_GET_TICKS (buf->omx_buf->nTimeStamp));
 
+  GST_VIDEO_ENCODER_STREAM_LOCK (self);
   frame = gst_omx_video_find_nearest_frame (GST_ELEMENT_CAST (self), buf,
-      gst_video_encoder_get_frames (GST_VIDEO_ENCODER (self)));
+      &self->frame_index);
+  GST_VIDEO_ENCODER_STREAM_UNLOCK (self);
 
   g_assert (klass->handle_output_frame);
 
@@ -1727,7 +1784,7 @@ gst_omx_video_enc_loop (GstOMXVideoEnc * self)
 
   GST_DEBUG_OBJECT (self, "Finished frame: %s", gst_flow_get_name (flow_ret));
 
-  err = gst_omx_port_release_buffer (port, buf);
+  err = gst_omx_port_release_batched_buffer (port, &self->out_batch, buf);
   if (err != OMX_ErrorNone)
     goto release_error;
 
@@ -1840,6 +1897,10 @@ gst_omx_video_enc_start (GstVideoEncoder * encoder)
   self->downstream_flow_ret = GST_FLOW_OK;
   self->nb_downstream_buffers = 0;
   self->in_pool_used = FALSE;
+  self->copy_pool = gst_omx_video_copy_pool_new (self->n_copy_threads);
+  GST_DEBUG_OBJECT (self, "Copying large frames with %u threads (%s)",
+      gst_omx_video_copy_pool_get_n_threads (self->copy_pool),
+      gst_omx_video_copy_get_implementation ());
 
   return TRUE;
 }
@@ -1858,6 +1919,8 @@ gst_omx_video_enc_stop (GstVideoEncoder * encoder)
 
   gst_pad_stop_task (GST_VIDEO_ENCODER_SRC_PAD (encoder));
 
+  gst_omx_port_return_batched_buffers (self->enc_out_port, &self->out_batch);
+
   if (gst_omx_component_get_state (self->enc, 0) > OMX_StateIdle)
     gst_omx_component_set_state (self->enc, OMX_StateIdle);
 
@@ -1875,6 +1938,8 @@ gst_omx_video_enc_stop (GstVideoEncoder * encoder)
 
   self->default_target_bitrate = GST_OMX_PROP_OMX_DEFAULT;
 
+  g_clear_pointer (&self->copy_pool, gst_omx_video_copy_pool_unref);
+
   gst_omx_component_get_state (self->enc, 5 * GST_SECOND);
 
   return TRUE;
@@ -1927,6 +1992,8 @@ gst_omx_video_enc_disable (GstOMXVideoEnc * self)
   gst_pad_stop_task (GST_VIDEO_ENCODER_SRC_PAD (self));
   GST_VIDEO_ENCODER_STREAM_LOCK (self);
 
+  gst_omx_port_return_batched_buffers (self->enc_out_port, &self->out_batch);
+
   if (klass->cdata.hacks & GST_OMX_HACK_NO_COMPONENT_RECONFIGURE) {
     GST_VIDEO_ENCODER_STREAM_UNLOCK (self);
     gst_omx_video_enc_stop (GST_VIDEO_ENCODER (self));
@@ -2671,6 +2738,7 @@ gst_omx_video_enc_flush (GstVideoEncoder * encoder)
    * caused by using this lock from inside the loop function */
   GST_VIDEO_ENCODER_STREAM_UNLOCK (self);
   GST_PAD_STREAM_LOCK (GST_VIDEO_ENCODER_SRC_PAD (self));
+  gst_omx_port_return_batched_buffers (self->enc_out_port, &self->out_batch);
   GST_PAD_STREAM_UNLOCK (GST_VIDEO_ENCODER_SRC_PAD (self));
   GST_VIDEO_ENCODER_STREAM_LOCK (self);
 
@@ -2692,80 +2760,6 @@ gst_omx_video_enc_flush (GstVideoEncoder * encoder)
   return TRUE;
 }
 
-static gboolean
-gst_omx_video_enc_copy_plane (GstOMXVideoEnc * self, guint i,
-    GstVideoFrame * frame, GstOMXBuffer * outbuf,
-    const GstVideoFormatInfo * finfo)
-{
-  OMX_PARAM_PORTDEFINITIONTYPE *port_def = &self->enc_in_port->port_def;
-  guint8 *src, *dest;
-  gint src_stride, dest_stride;
-  gint j, height, width;
-
-  src_stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, i);
-  dest_stride = port_def->format.video.nStride;
-  /* XXX: Try this if no stride was set */
-  if (dest_stride == 0)
-    dest_stride = src_stride;
-
-  dest = outbuf->omx_buf->pBuffer + outbuf->omx_buf->nOffset;
-  if (i == 1)
-    dest +=
-        port_def->format.video.nSliceHeight * port_def->format.video.nStride;
-
-  src = GST_VIDEO_FRAME_COMP_DATA (frame, i);
-  height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, i);
-  width = GST_VIDEO_FRAME_COMP_WIDTH (frame, i) * (i == 0 ? 1 : 2);
-
-  if (GST_VIDEO_FORMAT_INFO_BITS (finfo) == 10)
-    /* Need ((width + 2) / 3) 32-bits words */
-    width = (width + 2) / 3 * 4;
-
-  if (dest + dest_stride * height >
-      outbuf->omx_buf->pBuffer + outbuf->omx_buf->nAllocLen) {
-    GST_ERROR_OBJECT (self, "Invalid output buffer size");
-    return FALSE;
-  }
-
-  for (j = 0; j < height; j++) {
-    memcpy (dest, src, width);
-    src += src_stride;
-    dest += dest_stride;
-  }
-
-  /* nFilledLen should include the vertical padding in each slice (spec 3.1.3.7.1) */
-  outbuf->omx_buf->nFilledLen +=
-      GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, i,
-      port_def->format.video.nSliceHeight) * port_def->format.video.nStride;
-  return TRUE;
-}
-
-static gboolean
-gst_omx_video_enc_semi_planar_manual_copy (GstOMXVideoEnc * self,
-    GstBuffer * inbuf, GstOMXBuffer * outbuf, const GstVideoFormatInfo * finfo)
-{
-  GstVideoInfo *info = &self->input_state->info;
-  GstVideoFrame frame;
-  gint i;
-
-  outbuf->omx_buf->nFilledLen = 0;
-
-  if (!gst_video_frame_map (&frame, info, inbuf, GST_MAP_READ)) {
-    GST_ERROR_OBJECT (self, "Invalid input buffer size");
-    return FALSE;
-  }
-
-  for (i = 0; i < 2; i++) {
-    if (!gst_omx_video_enc_copy_plane (self, i, &frame, outbuf, finfo)) {
-      gst_video_frame_unmap (&frame);
-      return FALSE;
-    }
-  }
-
-  gst_video_frame_unmap (&frame);
-  return TRUE;
-}
-
 static gboolean
 gst_omx_video_enc_fill_buffer (GstOMXVideoEnc * self, GstBuffer * inbuf,
     GstOMXBuffer * outbuf)
@@ -2846,93 +2840,34 @@ gst_omx_video_enc_fill_buffer (GstOMXVideoEnc * self, GstBuffer * inbuf,
   GST_LOG_OBJECT (self, "Mismatched strides - copying line-by-line");
 
   switch (info->finfo->format) {
-    case GST_VIDEO_FORMAT_I420:{
-      gint i, j, height, width;
-      guint8 *src, *dest;
-      gint src_stride, dest_stride;
-
-      outbuf->omx_buf->nFilledLen = 0;
-
-      if (!gst_video_frame_map (&frame, info, inbuf, GST_MAP_READ)) {
-        GST_ERROR_OBJECT (self, "Invalid input buffer size");
-        ret = FALSE;
-        goto done;
-      }
-
-      for (i = 0; i < 3; i++) {
-        if (i == 0) {
-          dest_stride = port_def->format.video.nStride;
-        } else {
-          dest_stride = port_def->format.video.nStride / 2;
-        }
-
-        src_stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, i);
-        /* XXX: Try this if no stride was set */
-        if (dest_stride == 0)
-          dest_stride = src_stride;
-
-        dest = outbuf->omx_buf->pBuffer + outbuf->omx_buf->nOffset;
-        if (i > 0)
-          dest +=
-              port_def->format.video.nSliceHeight *
-              port_def->format.video.nStride;
-        if (i == 2)
-          dest +=
-              (port_def->format.video.nSliceHeight / 2) *
-              (port_def->format.video.nStride / 2);
-
-        src = GST_VIDEO_FRAME_COMP_DATA (&frame, i);
-        height = GST_VIDEO_FRAME_COMP_HEIGHT (&frame, i);
-        width = GST_VIDEO_FRAME_COMP_WIDTH (&frame, i);
-
-        if (dest + dest_stride * height >
-            outbuf->omx_buf->pBuffer + outbuf->omx_buf->nAllocLen) {
-          gst_video_frame_unmap (&frame);
-          GST_ERROR_OBJECT (self, "Invalid output buffer size");
-          ret = FALSE;
-          goto done;
-        }
-
-        for (j = 0; j < height; j++) {
-          memcpy (dest, src, width);
-          src += src_stride;
-          dest += dest_stride;
-        }
-
-        /* nFilledLen should include the vertical padding in each slice (spec 3.1.3.7.1) */
-        if (i == 0)
-          outbuf->omx_buf->nFilledLen +=
-              port_def->format.video.nSliceHeight *
-              port_def->format.video.nStride;
-        else
-          outbuf->omx_buf->nFilledLen +=
-              (port_def->format.video.nSliceHeight / 2) *
-              (port_def->format.video.nStride / 2);
-      }
-      gst_video_frame_unmap (&frame);
-      ret = TRUE;
-      break;
-    }
+    case GST_VIDEO_FORMAT_I420:
     case GST_VIDEO_FORMAT_NV12:
     case GST_VIDEO_FORMAT_NV16:
     case GST_VIDEO_FORMAT_NV12_10LE32:
     case GST_VIDEO_FORMAT_NV16_10LE32:
-      ret =
-          gst_omx_video_enc_semi_planar_manual_copy (self, inbuf, outbuf,
-          info->finfo);
-      break;
-    case GST_VIDEO_FORMAT_GRAY8:
-    {
+    case GST_VIDEO_FORMAT_GRAY8:{
+      gsize filled;
+
       if (!gst_video_frame_map (&frame, info, inbuf, GST_MAP_READ)) {
-        GST_ERROR_OBJECT (self, "Failed to map input buffer");
+        GST_ERROR_OBJECT (self, "Invalid input buffer size");
         ret = FALSE;
         goto done;
       }
 
-      ret = gst_omx_video_enc_copy_plane (self, 0, &frame, outbuf, info->finfo);
+      ret = gst_omx_video_copy_to_omx (self->copy_pool, &frame,
+          outbuf->omx_buf->pBuffer + outbuf->omx_buf->nOffset,
+          outbuf->omx_buf->nAllocLen - outbuf->omx_buf->nOffset,
+          port_def->format.video.nStride, port_def->format.video.nSliceHeight,
+          &filled);
       gst_video_frame_unmap (&frame);
-    }
+
+      if (!ret) {
+        GST_ERROR_OBJECT (self, "Invalid output buffer size");
+        goto done;
+      }
+      outbuf->omx_buf->nFilledLen = filled;
       break;
+    }
     default:
       GST_ERROR_OBJECT (self, "Unsupported format");
       goto done;
@@ -3042,6 +2977,8 @@ gst_omx_video_enc_handle_frame (GstVideoEncoder * encoder,
     return gst_video_encoder_finish_frame (GST_VIDEO_ENCODER (self), frame);
   }
 
+  gst_omx_video_frame_index_add (&self->frame_index, frame);
+
   if (!self->started) {
     if (gst_omx_port_is_flushing (self->enc_out_port)) {
       if (!gst_omx_video_enc_enable (self, frame->input_buffer))
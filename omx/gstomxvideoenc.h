@@ -26,6 +26,8 @@
 #include <gst/video/gstvideoencoder.h>
 
 #include "gstomx.h"
+#include "gstomxvideo.h"
+#include "gstomxvideocopy.h"
 
 G_BEGIN_DECLS
 
@@ -96,10 +98,20 @@ struct _GstOMXVideoEnc
   guint32 long_term_freq;
   guint32 look_ahead;
 #endif
+  guint stats_interval;
+  guint n_copy_threads;
 
   guint32 default_target_bitrate;
 
   GstFlowReturn downstream_flow_ret;
+  /* Output buffers acquired from the component in one go, only used
+   * by the srcpad loop while it is running */
+  GstOMXBufferBatch out_batch;
+  /* Frames passed to ::handle_frame() and not freed yet */
+  GstOMXVideoFrameIndex frame_index;
+  /* Splits the copies of large frames between threads and keeps track of
+   * the lazy ones. Only set between ::start() and ::stop() */
+  GstOMXVideoCopyPool *copy_pool;
 
   GstOMXBufferAllocation input_allocation;
   /* TRUE if encoder is passing dmabuf's fd directly to the OMX component */
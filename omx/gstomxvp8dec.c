@@ -34,6 +34,8 @@ static gboolean gst_omx_vp8_dec_is_format_change (GstOMXVideoDec * dec,
     GstOMXPort * port, GstVideoCodecState * state);
 static gboolean gst_omx_vp8_dec_set_format (GstOMXVideoDec * dec,
     GstOMXPort * port, GstVideoCodecState * state);
+static gboolean gst_omx_vp8_dec_parse_stream_info (GstOMXVideoDec * dec,
+    GstBuffer * buffer, guint * width, guint * height, guint * dpb_size);
 
 enum
 {
@@ -58,6 +60,8 @@ gst_omx_vp8_dec_class_init (GstOMXVP8DecClass * klass)
   videodec_class->is_format_change =
       GST_DEBUG_FUNCPTR (gst_omx_vp8_dec_is_format_change);
   videodec_class->set_format = GST_DEBUG_FUNCPTR (gst_omx_vp8_dec_set_format);
+  videodec_class->parse_stream_info =
+      GST_DEBUG_FUNCPTR (gst_omx_vp8_dec_parse_stream_info);
 
   videodec_class->cdata.default_sink_template_caps = "video/x-vp8, "
       "width=(int) [1,MAX], " "height=(int) [1,MAX]";
@@ -97,3 +101,26 @@ gst_omx_vp8_dec_set_format (GstOMXVideoDec * dec, GstOMXPort * port,
 
   return ret;
 }
+
+/* Key frames carry the frame size after their start code, 9.1. Inter frames
+ * refer to the last, golden and altref frames */
+static gboolean
+gst_omx_vp8_dec_parse_stream_info (GstOMXVideoDec * dec, GstBuffer * buffer,
+    guint * width, guint * height, guint * dpb_size)
+{
+  guint8 data[10];
+
+  if (gst_buffer_extract (buffer, 0, data, sizeof (data)) != sizeof (data))
+    return FALSE;
+
+  /* key_frame is 0 for key frames */
+  if ((data[0] & 0x1) != 0 || data[3] != 0x9d || data[4] != 0x01
+      || data[5] != 0x2a)
+    return FALSE;
+
+  *width = GST_READ_UINT16_LE (data + 6) & 0x3fff;
+  *height = GST_READ_UINT16_LE (data + 8) & 0x3fff;
+  *dpb_size = 3;
+
+  return *width > 0 && *height > 0;
+}
@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+/* Measures the throughput of the raw video copies done by the video
+ * decoder and encoder when zero-copy is not possible:
+ *
+ *   from-omx: OMX output buffer to GStreamer frame (video decoder)
+ *   to-omx:   GStreamer frame to OMX input buffer (video encoder)
+ *   buffer:   copy out of the output buffer pool (video decoder)
+ *   lazy:     same, deferred until the copy is mapped
+ *
+ * for all supported formats, a set of resolutions and OMX stride/slice
+ * height alignments. Set GST_OMX_VIDEO_COPY to c, sse2, avx2 or neon to
+ * force a plane copy implementation.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideopool.h>
+
+#include "gstomxvideocopy.h"
+
+typedef enum
+{
+  KERNEL_FROM_OMX,
+  KERNEL_TO_OMX,
+  KERNEL_BUFFER,
+  KERNEL_LAZY,
+} Kernel;
+
+static const gchar *kernel_names[] =
+    { "from-omx", "to-omx", "buffer", "lazy" };
+
+/* Keep synced with GST_OMX_VIDEO_DEC_SUPPORTED_FORMATS */
+static const GstVideoFormat dec_formats[] = {
+  GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_NV12, GST_VIDEO_FORMAT_NV16,
+  GST_VIDEO_FORMAT_NV12_10LE32, GST_VIDEO_FORMAT_NV16_10LE32,
+  GST_VIDEO_FORMAT_GRAY8, GST_VIDEO_FORMAT_YUY2, GST_VIDEO_FORMAT_YVYU,
+  GST_VIDEO_FORMAT_UYVY, GST_VIDEO_FORMAT_RGB16, GST_VIDEO_FORMAT_BGR16,
+  GST_VIDEO_FORMAT_ABGR, GST_VIDEO_FORMAT_ARGB,
+};
+
+/* Keep synced with GST_OMX_VIDEO_ENC_SUPPORTED_FORMATS */
+static const GstVideoFormat enc_formats[] = {
+  GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_NV12, GST_VIDEO_FORMAT_NV16,
+  GST_VIDEO_FORMAT_NV12_10LE32, GST_VIDEO_FORMAT_NV16_10LE32,
+  GST_VIDEO_FORMAT_GRAY8,
+};
+
+static const struct
+{
+  gint width, height;
+} resolutions[] = {
+  {640, 480}, {1280, 720}, {1920, 1080}, {3840, 2160},
+};
+
+/* Alignment of nStride and nSliceHeight, 1 for a tightly packed buffer */
+static const struct
+{
+  guint stride_align, slice_align;
+} layouts[] = {
+  {1, 1}, {64, 16}, {256, 32},
+};
+
+static gdouble min_time = 0.2;
+static gint n_threads = 1;
+static GstOMXVideoCopyPool *pool = NULL;
+static gchar *format_filter = NULL;
+static gchar *kernel_filter = NULL;
+
+static guint
+align_up (guint v, guint align)
+{
+  return ((v + align - 1) / align) * align;
+}
+
+/* Bytes of a line of the first plane in the OMX buffer */
+static guint
+omx_line_size (const GstVideoInfo * info)
+{
+  switch (GST_VIDEO_INFO_FORMAT (info)) {
+    case GST_VIDEO_FORMAT_NV12_10LE32:
+    case GST_VIDEO_FORMAT_NV16_10LE32:
+      return (GST_VIDEO_INFO_WIDTH (info) + 2) / 3 * 4;
+    default:
+      return GST_VIDEO_INFO_COMP_PSTRIDE (info, 0) *
+          GST_VIDEO_INFO_WIDTH (info);
+  }
+}
+
+static void
+run (Kernel kernel, GstVideoFormat format, gint width, gint height,
+    guint stride_align, guint slice_align)
+{
+  GstVideoInfo info;
+  GstBuffer *buf;
+  GstBufferPool *out_pool = NULL;
+  GstVideoFrame frame;
+  guint nstride, nslice;
+  gsize omx_size, filled;
+  guint8 *omx;
+  gint64 start, elapsed;
+  guint64 n = 0;
+  gboolean ok = TRUE;
+
+  gst_video_info_set_format (&info, format, width, height);
+  nstride = align_up (omx_line_size (&info), stride_align);
+  nslice = align_up (height, slice_align);
+  /* Large enough for all formats, 4:2:2 semi-planar needs 2 * nslice */
+  omx_size = (gsize) nstride * nslice * 2;
+
+  omx = g_malloc (omx_size);
+  memset (omx, 0x80, omx_size);
+  buf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+  gst_buffer_memset (buf, 0, 0x10, GST_VIDEO_INFO_SIZE (&info));
+
+  /* Like the decoder, recycle the copies */
+  if (kernel == KERNEL_BUFFER || kernel == KERNEL_LAZY) {
+    GstStructure *config;
+    GstCaps *caps = gst_video_info_to_caps (&info);
+
+    out_pool = gst_video_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (out_pool);
+    gst_buffer_pool_config_set_params (config, caps,
+        GST_VIDEO_INFO_SIZE (&info), 0, 0);
+    gst_buffer_pool_set_config (out_pool, config);
+    gst_buffer_pool_set_active (out_pool, TRUE);
+    gst_caps_unref (caps);
+  }
+
+  start = g_get_monotonic_time ();
+  do {
+    switch (kernel) {
+      case KERNEL_FROM_OMX:
+        gst_video_frame_map (&frame, &info, buf, GST_MAP_WRITE);
+        ok = gst_omx_video_copy_from_omx (pool, &frame, omx, nstride,
+            nslice);
+        gst_video_frame_unmap (&frame);
+        break;
+      case KERNEL_TO_OMX:
+        gst_video_frame_map (&frame, &info, buf, GST_MAP_READ);
+        ok = gst_omx_video_copy_to_omx (pool, &frame, omx, omx_size,
+            nstride, nslice, &filled);
+        gst_video_frame_unmap (&frame);
+        break;
+      case KERNEL_BUFFER:
+        gst_buffer_unref (gst_omx_video_copy_buffer (pool, out_pool, &info,
+                gst_buffer_ref (buf)));
+        break;
+      case KERNEL_LAZY:{
+        GstBuffer *copy;
+        GstMapInfo map;
+
+        copy = gst_omx_video_copy_buffer_lazy (pool, out_pool, &info,
+            gst_buffer_ref (buf), 1);
+        gst_buffer_map (copy, &map, GST_MAP_READ);
+        gst_buffer_unmap (copy, &map);
+        gst_buffer_unref (copy);
+        break;
+      }
+    }
+    n++;
+    elapsed = g_get_monotonic_time () - start;
+  } while (ok && elapsed < min_time * G_USEC_PER_SEC);
+
+  if (ok)
+    g_print ("%-9s %-12s %4dx%-4d %6u %6u %10.3f %10.1f\n",
+        kernel_names[kernel], gst_video_format_to_string (format), width,
+        height, nstride, nslice,
+        (gdouble) GST_VIDEO_INFO_SIZE (&info) * n / elapsed / 1000.0,
+        (gdouble) n * G_USEC_PER_SEC / elapsed);
+  else
+    g_print ("%-9s %-12s %4dx%-4d %6u %6u     failed\n", kernel_names[kernel],
+        gst_video_format_to_string (format), width, height, nstride, nslice);
+
+  if (out_pool) {
+    gst_buffer_pool_set_active (out_pool, FALSE);
+    gst_object_unref (out_pool);
+  }
+  gst_buffer_unref (buf);
+  g_free (omx);
+}
+
+static void
+run_kernel (Kernel kernel, const GstVideoFormat * formats, guint n_formats)
+{
+  guint f, r, l;
+
+  if (kernel_filter && !g_str_equal (kernel_filter, kernel_names[kernel]))
+    return;
+
+  for (f = 0; f < n_formats; f++) {
+    if (format_filter && !g_str_equal (format_filter,
+            gst_video_format_to_string (formats[f])))
+      continue;
+
+    for (r = 0; r < G_N_ELEMENTS (resolutions); r++) {
+      /* The layout of the OMX buffer doesn't matter for this one */
+      for (l = 0; l < (kernel >= KERNEL_BUFFER ? 1 : G_N_ELEMENTS (layouts));
+          l++)
+        run (kernel, formats[f], resolutions[r].width, resolutions[r].height,
+            layouts[l].stride_align, layouts[l].slice_align);
+    }
+  }
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GOptionEntry entries[] = {
+    {"time", 't', 0, G_OPTION_ARG_DOUBLE, &min_time,
+        "Minimum time per measurement in seconds (default: 0.2)", "SECONDS"},
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format_filter,
+        "Only measure this format", "FORMAT"},
+    {"kernel", 'k', 0, G_OPTION_ARG_STRING, &kernel_filter,
+        "Only measure from-omx, to-omx, buffer or lazy", "KERNEL"},
+    {"threads", 'j', 0, G_OPTION_ARG_INT, &n_threads,
+        "Number of copy threads, 0 for automatic (default: 1)", "N"},
+    {NULL}
+  };
+
+  ctx = g_option_context_new ("- benchmark the gst-omx raw video copies");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  pool = gst_omx_video_copy_pool_new (MAX (n_threads, 0));
+
+  g_print ("Plane copy implementation: %s, %u threads\n\n",
+      gst_omx_video_copy_get_implementation (),
+      gst_omx_video_copy_pool_get_n_threads (pool));
+  g_print ("%-9s %-12s %9s %6s %6s %10s %10s\n", "kernel", "format", "size",
+      "stride", "slice", "GB/s", "frames/s");
+
+  run_kernel (KERNEL_FROM_OMX, dec_formats, G_N_ELEMENTS (dec_formats));
+  run_kernel (KERNEL_TO_OMX, enc_formats, G_N_ELEMENTS (enc_formats));
+  run_kernel (KERNEL_BUFFER, dec_formats, G_N_ELEMENTS (dec_formats));
+  run_kernel (KERNEL_LAZY, dec_formats, G_N_ELEMENTS (dec_formats));
+
+  gst_omx_video_copy_pool_unref (pool);
+  g_free (format_filter);
+  g_free (kernel_filter);
+
+  return 0;
+}
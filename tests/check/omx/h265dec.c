@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+/* Unit test for the H.265 decoder running on the loopback core, which
+ * passes the frames through without parsing them */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define FRAME_DURATION (GST_SECOND / 30)
+
+/* NAL unit header of the given type and TemporalId, followed by two bytes
+ * of payload */
+#define NAL(type, tid, payload0, payload1) \
+  ((const guint8[]) { (type) << 1, (tid) + 1, payload0, payload1 })
+#define NAL_SIZE 4
+
+/* The byte after the NAL unit header of the SPS holds
+ * sps_max_sub_layers_minus1 */
+#define SPS(max_sub_layers_minus1) \
+  NAL (33, 0, ((max_sub_layers_minus1) << 1) | 0x1, 0x01)
+#define IDR_N_LP NAL (20, 0, 0xaf, 0x09)
+#define TRAIL_N(tid) NAL (0, tid, 0xaf, 0x09)
+#define TRAIL_R(tid) NAL (1, tid, 0xaf, 0x09)
+
+static GstHarness *
+setup_harness (void)
+{
+  GstHarness *h = gst_harness_new ("omxh265dec");
+
+  gst_harness_set_src_caps_str (h, "video/x-h265, "
+      "stream-format=(string) byte-stream, alignment=(string) au, "
+      "width=(int) 320, height=(int) 240, framerate=(fraction) 30/1");
+
+  return h;
+}
+
+/* Pushes the access unit made of the NAL units in nals as frame n */
+static void
+push_frame (GstHarness * h, guint n, gboolean sync,
+    const guint8 * const *nals, guint n_nals)
+{
+  static const guint8 start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+  GstBuffer *buf;
+  guint i;
+
+  buf = gst_buffer_new_allocate (NULL, n_nals * (sizeof (start_code)
+          + NAL_SIZE), NULL);
+  for (i = 0; i < n_nals; i++) {
+    gsize offset = i * (sizeof (start_code) + NAL_SIZE);
+
+    gst_buffer_fill (buf, offset, start_code, sizeof (start_code));
+    gst_buffer_fill (buf, offset + sizeof (start_code), nals[i], NAL_SIZE);
+  }
+
+  GST_BUFFER_PTS (buf) = n * FRAME_DURATION;
+  GST_BUFFER_DURATION (buf) = FRAME_DURATION;
+  if (!sync)
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+}
+
+/* Returns how many buffers the decoder passed to the component */
+static guint64
+get_submitted (GstHarness * h)
+{
+  GstStructure *stats, *port;
+  guint64 submitted = 0;
+
+  g_object_get (h->element, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get (stats, "port-0", GST_TYPE_STRUCTURE, &port,
+          NULL));
+  fail_unless (gst_structure_get_uint64 (port, "submitted", &submitted));
+
+  gst_structure_free (port);
+  gst_structure_free (stats);
+
+  return submitted;
+}
+
+/* Makes all frames up to 10 seconds late */
+static void
+send_qos (GstHarness * h)
+{
+  fail_unless (gst_harness_push_upstream_event (h,
+          gst_event_new_qos (GST_QOS_TYPE_UNDERFLOW, 1.0, 0,
+              10 * GST_SECOND)));
+}
+
+GST_START_TEST (test_drop_late_disposable)
+{
+  GstHarness *h = setup_harness ();
+  const guint8 *sps_3_layers_idr[] = { SPS (2), IDR_N_LP };
+  const guint8 *sps_1_layer_idr[] = { SPS (0), IDR_N_LP };
+  const guint8 *trail_n_top[] = { TRAIL_N (2) };
+  const guint8 *trail_n_middle[] = { TRAIL_N (1) };
+  const guint8 *trail_r_top[] = { TRAIL_R (2) };
+  const guint8 *trail_n_base[] = { TRAIL_N (0) };
+
+  /* The SPS only comes in-band, with the sync frames */
+  push_frame (h, 0, TRUE, sps_3_layers_idr, G_N_ELEMENTS (sps_3_layers_idr));
+  fail_unless_equals_uint64 (get_submitted (h), 1);
+
+  /* Frames in time are always decoded */
+  push_frame (h, 1, FALSE, trail_n_top, G_N_ELEMENTS (trail_n_top));
+  fail_unless_equals_uint64 (get_submitted (h), 2);
+
+  send_qos (h);
+
+  /* Only the late sub-layer non-reference pictures of the highest
+   * sub-layer never reach the component */
+  push_frame (h, 2, FALSE, trail_n_top, G_N_ELEMENTS (trail_n_top));
+  fail_unless_equals_uint64 (get_submitted (h), 2);
+  push_frame (h, 3, FALSE, trail_n_middle, G_N_ELEMENTS (trail_n_middle));
+  fail_unless_equals_uint64 (get_submitted (h), 3);
+  push_frame (h, 4, FALSE, trail_r_top, G_N_ELEMENTS (trail_r_top));
+  fail_unless_equals_uint64 (get_submitted (h), 4);
+
+  /* A new SPS applies from its sync frame on */
+  push_frame (h, 5, TRUE, sps_1_layer_idr, G_N_ELEMENTS (sps_1_layer_idr));
+  fail_unless_equals_uint64 (get_submitted (h), 5);
+  push_frame (h, 6, FALSE, trail_n_base, G_N_ELEMENTS (trail_n_base));
+  fail_unless_equals_uint64 (get_submitted (h), 5);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+h265dec_suite (void)
+{
+  Suite *s = suite_create ("omxh265dec");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_drop_late_disposable);
+
+  return s;
+}
+
+GST_CHECK_MAIN (h265dec);
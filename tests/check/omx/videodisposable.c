@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+/* Unit test for the rules telling which frames the video decoders can drop
+ * without affecting the decoding of other frames */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include "gstomxh264dec.h"
+#ifdef HAVE_HEVC
+#include "gstomxh265dec.h"
+#endif
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+static void
+test_class_init (gpointer g_class, gpointer data)
+{
+  GstElementClass *element_class = GST_ELEMENT_CLASS (g_class);
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+}
+
+/* Subclasses the decoder type to give it the pad templates the video decoder
+ * needs, like the plugin does for the elements of its configuration */
+static GstOMXVideoDec *
+create_decoder (GType type)
+{
+  gchar *type_name = g_strdup_printf ("%s-test", g_type_name (type));
+  GType subtype = g_type_from_name (type_name);
+
+  if (subtype == G_TYPE_INVALID) {
+    GTypeQuery type_query;
+    GTypeInfo type_info = { 0, };
+
+    g_type_query (type, &type_query);
+    type_info.class_size = type_query.class_size;
+    type_info.instance_size = type_query.instance_size;
+    type_info.class_init = test_class_init;
+    subtype = g_type_register_static (type, type_name, &type_info, 0);
+  }
+  g_free (type_name);
+
+  return gst_object_ref_sink (g_object_new (subtype, NULL));
+}
+
+/* NAL unit header and a few bytes of payload, which are not parsed */
+#define NAL(...) ((const guint8[]) { __VA_ARGS__ })
+#define NAL_SIZE 4
+
+static GstBuffer *
+build_access_unit (const guint8 * const *nals, guint n_nals)
+{
+  static const guint8 start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+  GByteArray *data = g_byte_array_new ();
+  gsize size;
+  guint i;
+
+  for (i = 0; i < n_nals; i++) {
+    g_byte_array_append (data, start_code, sizeof (start_code));
+    g_byte_array_append (data, nals[i], NAL_SIZE);
+  }
+
+  size = data->len;
+  return gst_buffer_new_wrapped (g_byte_array_free (data, FALSE), size);
+}
+
+/* Returns whether the access unit made of the NAL units in nals is
+ * disposable */
+static gboolean
+is_disposable (GstOMXVideoDec * dec, const guint8 * const *nals, guint n_nals)
+{
+  GstOMXVideoDecClass *klass = GST_OMX_VIDEO_DEC_GET_CLASS (dec);
+  GstBuffer *buffer = build_access_unit (nals, n_nals);
+  gboolean ret;
+
+  ret = klass->is_disposable (dec, buffer);
+  gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+/* Passes the headers of a sync frame made of the NAL units in nals */
+static void
+parse_headers (GstOMXVideoDec * dec, const guint8 * const *nals, guint n_nals)
+{
+  GstOMXVideoDecClass *klass = GST_OMX_VIDEO_DEC_GET_CLASS (dec);
+  GstBuffer *buffer = build_access_unit (nals, n_nals);
+
+  fail_unless (klass->parse_headers != NULL);
+  klass->parse_headers (dec, buffer);
+  gst_buffer_unref (buffer);
+}
+
+#define H264_SEI              NAL (0x06, 0x05, 0xaf, 0x80)
+#define H264_SPS              NAL (0x67, 0x42, 0xc0, 0x1e)
+#define H264_NON_REF_SLICE    NAL (0x01, 0x9a, 0x12, 0x80)
+#define H264_REF_SLICE        NAL (0x41, 0x9a, 0x12, 0x80)
+#define H264_NON_REF_SLICE_A  NAL (0x02, 0x9a, 0x12, 0x80)
+#define H264_IDR_SLICE        NAL (0x65, 0x88, 0x84, 0x80)
+
+GST_START_TEST (test_h264)
+{
+  GstOMXVideoDec *dec = create_decoder (GST_TYPE_OMX_H264_DEC);
+  const guint8 *non_ref[] = { H264_SEI, H264_NON_REF_SLICE };
+  const guint8 *non_ref_partition[] = { H264_NON_REF_SLICE_A };
+  const guint8 *ref[] = { H264_REF_SLICE, H264_NON_REF_SLICE };
+  const guint8 *idr[] = { H264_SPS, H264_IDR_SLICE };
+  const guint8 *no_slice[] = { H264_SEI, H264_SPS };
+
+  fail_unless (is_disposable (dec, non_ref, G_N_ELEMENTS (non_ref)));
+  fail_unless (is_disposable (dec, non_ref_partition,
+          G_N_ELEMENTS (non_ref_partition)));
+  /* Only the first slice is looked at */
+  fail_if (is_disposable (dec, ref, G_N_ELEMENTS (ref)));
+  fail_if (is_disposable (dec, idr, G_N_ELEMENTS (idr)));
+  fail_if (is_disposable (dec, no_slice, G_N_ELEMENTS (no_slice)));
+
+  gst_object_unref (dec);
+}
+
+GST_END_TEST;
+
+#ifdef HAVE_HEVC
+/* NAL unit header of the given type and TemporalId, followed by two bytes
+ * of payload */
+#define H265_NAL(type, tid, payload0, payload1) \
+  NAL ((type) << 1, (tid) + 1, payload0, payload1)
+
+/* The byte after the NAL unit header of the SPS holds
+ * sps_max_sub_layers_minus1 */
+#define H265_SPS(max_sub_layers_minus1) \
+  H265_NAL (33, 0, ((max_sub_layers_minus1) << 1) | 0x1, 0x01)
+#define H265_TRAIL_N(tid) H265_NAL (0, tid, 0xaf, 0x09)
+#define H265_TRAIL_R(tid) H265_NAL (1, tid, 0xaf, 0x09)
+#define H265_RASL_N(tid) H265_NAL (8, tid, 0xaf, 0x09)
+#define H265_IDR_N_LP H265_NAL (20, 0, 0xaf, 0x09)
+#define H265_RSV_VCL_N14(tid) H265_NAL (14, tid, 0xaf, 0x09)
+
+GST_START_TEST (test_h265)
+{
+  GstOMXVideoDec *dec = create_decoder (GST_TYPE_OMX_H265_DEC);
+  const guint8 *sps_3_layers[] = { H265_SPS (2), H265_IDR_N_LP };
+  const guint8 *sps_1_layer[] = { H265_SPS (0), H265_IDR_N_LP };
+  const guint8 *trail_n_top[] = { H265_TRAIL_N (2) };
+  const guint8 *trail_n_middle[] = { H265_TRAIL_N (1) };
+  const guint8 *trail_r_top[] = { H265_TRAIL_R (2) };
+  const guint8 *rasl_n_top[] = { H265_RASL_N (2) };
+  const guint8 *rsv_n14_top[] = { H265_RSV_VCL_N14 (2) };
+  const guint8 *trail_n_base[] = { H265_TRAIL_N (0) };
+
+  /* Nothing is known about the sub-layers before the first SPS */
+  fail_if (is_disposable (dec, trail_n_top, G_N_ELEMENTS (trail_n_top)));
+  fail_if (is_disposable (dec, trail_n_base, G_N_ELEMENTS (trail_n_base)));
+
+  parse_headers (dec, sps_3_layers, G_N_ELEMENTS (sps_3_layers));
+  fail_if (is_disposable (dec, sps_3_layers, G_N_ELEMENTS (sps_3_layers)));
+
+  /* Only the sub-layer non-reference pictures of the highest sub-layer */
+  fail_unless (is_disposable (dec, trail_n_top, G_N_ELEMENTS (trail_n_top)));
+  fail_unless (is_disposable (dec, rasl_n_top, G_N_ELEMENTS (rasl_n_top)));
+  fail_unless (is_disposable (dec, rsv_n14_top, G_N_ELEMENTS (rsv_n14_top)));
+  fail_if (is_disposable (dec, trail_n_middle,
+          G_N_ELEMENTS (trail_n_middle)));
+  fail_if (is_disposable (dec, trail_n_base, G_N_ELEMENTS (trail_n_base)));
+  fail_if (is_disposable (dec, trail_r_top, G_N_ELEMENTS (trail_r_top)));
+
+  /* Frames without SPS keep the current one */
+  parse_headers (dec, trail_n_base, G_N_ELEMENTS (trail_n_base));
+  fail_unless (is_disposable (dec, trail_n_top, G_N_ELEMENTS (trail_n_top)));
+
+  parse_headers (dec, sps_1_layer, G_N_ELEMENTS (sps_1_layer));
+  fail_unless (is_disposable (dec, trail_n_base, G_N_ELEMENTS (trail_n_base)));
+  fail_if (is_disposable (dec, trail_n_top, G_N_ELEMENTS (trail_n_top)));
+
+  gst_object_unref (dec);
+}
+
+GST_END_TEST;
+#endif
+
+static Suite *
+videodisposable_suite (void)
+{
+  Suite *s = suite_create ("omxvideodisposable");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_h264);
+#ifdef HAVE_HEVC
+  tcase_add_test (tc_chain, test_h265);
+#endif
+
+  return s;
+}
+
+GST_CHECK_MAIN (videodisposable);
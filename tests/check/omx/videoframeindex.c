@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+/* Unit test for the index of pending frames of the video decoder and
+ * encoder. The frames come from a dummy decoder that keeps every frame
+ * pending and adds it to the index, like the video decoder does */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+#include "gstomxvideo.h"
+
+static GstOMXVideoFrameIndex frame_index;
+
+typedef GstVideoDecoder TestDec;
+typedef GstVideoDecoderClass TestDecClass;
+
+GType test_dec_get_type (void);
+G_DEFINE_TYPE (TestDec, test_dec, GST_TYPE_VIDEO_DECODER);
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+static gboolean
+test_dec_set_format (GstVideoDecoder * decoder, GstVideoCodecState * state)
+{
+  return TRUE;
+}
+
+static GstFlowReturn
+test_dec_handle_frame (GstVideoDecoder * decoder, GstVideoCodecFrame * frame)
+{
+  gst_omx_video_frame_index_add (&frame_index, frame);
+  gst_video_codec_frame_unref (frame);
+
+  return GST_FLOW_OK;
+}
+
+static void
+test_dec_class_init (TestDecClass * klass)
+{
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class, "Test decoder",
+      "Codec/Decoder/Video", "Keeps all frames pending", "gst-omx");
+
+  klass->set_format = test_dec_set_format;
+  klass->handle_frame = test_dec_handle_frame;
+}
+
+static void
+test_dec_init (TestDec * self)
+{
+  gst_video_decoder_set_packetized (self, TRUE);
+}
+
+static GstHarness *
+setup_harness (void)
+{
+  GstElement *dec;
+  GstHarness *h;
+
+  gst_omx_video_frame_index_init (&frame_index);
+
+  dec = g_object_new (test_dec_get_type (), NULL);
+  h = gst_harness_new_with_element (dec, "sink", "src");
+  gst_object_unref (dec);
+  gst_harness_set_src_caps_str (h, "video/x-test");
+
+  return h;
+}
+
+static void
+teardown_harness (GstHarness * h)
+{
+  /* Frees the pending frames, which removes them from the index */
+  gst_harness_teardown (h);
+  gst_omx_video_frame_index_clear (&frame_index);
+}
+
+/* Pushes a frame with pts in seconds, or none if negative */
+static void
+push_frame (GstHarness * h, gint pts)
+{
+  GstBuffer *buf = gst_buffer_new ();
+
+  GST_BUFFER_PTS (buf) = pts >= 0 ? pts * GST_SECOND : GST_CLOCK_TIME_NONE;
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+}
+
+/* Checks that frames have the pts in seconds, none if negative, and frees
+ * them */
+static void
+check_frames (GList * frames, const gint * pts, guint n_pts)
+{
+  GList *l;
+  guint i;
+
+  fail_unless_equals_int (g_list_length (frames), n_pts);
+  for (l = frames, i = 0; l; l = l->next, i++) {
+    GstVideoCodecFrame *frame = l->data;
+
+    if (pts[i] >= 0)
+      fail_unless_equals_uint64 (frame->pts, pts[i] * GST_SECOND);
+    else
+      fail_if (GST_CLOCK_TIME_IS_VALID (frame->pts));
+  }
+
+  g_list_free_full (frames, (GDestroyNotify) gst_video_codec_frame_unref);
+}
+
+static GList *
+get_older (GstHarness * h, GstClockTime timestamp)
+{
+  GstVideoDecoder *decoder = GST_VIDEO_DECODER (h->element);
+  GList *frames;
+
+  GST_VIDEO_DECODER_STREAM_LOCK (decoder);
+  frames = gst_omx_video_frame_index_get_older (&frame_index, timestamp);
+  GST_VIDEO_DECODER_STREAM_UNLOCK (decoder);
+
+  return frames;
+}
+
+/* Returns the pts of the frame nearest to timestamp in seconds, -1 if
+ * there is none */
+static gint
+find_nearest (GstHarness * h, GstClockTime timestamp)
+{
+  GstVideoDecoder *decoder = GST_VIDEO_DECODER (h->element);
+  OMX_BUFFERHEADERTYPE omx_buf = { 0, };
+  GstOMXBuffer buf = { 0, };
+  GstVideoCodecFrame *frame;
+  gint pts = -1;
+
+  GST_OMX_SET_TICKS (omx_buf.nTimeStamp,
+      gst_util_uint64_scale (timestamp, OMX_TICKS_PER_SECOND, GST_SECOND));
+  buf.omx_buf = &omx_buf;
+
+  GST_VIDEO_DECODER_STREAM_LOCK (decoder);
+  frame = gst_omx_video_find_nearest_frame (h->element, &buf, &frame_index);
+  GST_VIDEO_DECODER_STREAM_UNLOCK (decoder);
+
+  if (frame) {
+    pts = frame->pts / GST_SECOND;
+    gst_video_codec_frame_unref (frame);
+  }
+
+  return pts;
+}
+
+GST_START_TEST (test_get_older_sorted)
+{
+  GstHarness *h = setup_harness ();
+  const gint older_than_3[] = { 0, 1, 2 };
+  const gint all[] = { 0, 1, 2, 3, 4 };
+
+  /* Decoding order of I P B B P */
+  push_frame (h, 0);
+  push_frame (h, 3);
+  push_frame (h, 1);
+  push_frame (h, 2);
+  push_frame (h, 4);
+
+  check_frames (get_older (h, 3 * GST_SECOND), older_than_3,
+      G_N_ELEMENTS (older_than_3));
+  check_frames (get_older (h, 10 * GST_SECOND), all, G_N_ELEMENTS (all));
+  check_frames (get_older (h, 0), NULL, 0);
+
+  teardown_harness (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_get_older_invalid_pts)
+{
+  GstHarness *h = setup_harness ();
+  const gint valid[] = { 1, 2 };
+  const gint invalid[] = { -1, -1 };
+
+  push_frame (h, -1);
+  push_frame (h, 2);
+  push_frame (h, -1);
+  push_frame (h, 1);
+
+  /* Frames without PTS are never older than a valid timestamp, and the
+   * only ones older than an invalid one */
+  check_frames (get_older (h, 10 * GST_SECOND), valid, G_N_ELEMENTS (valid));
+  check_frames (get_older (h, GST_CLOCK_TIME_NONE), invalid,
+      G_N_ELEMENTS (invalid));
+
+  teardown_harness (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_find_nearest)
+{
+  GstHarness *h = setup_harness ();
+
+  fail_unless_equals_int (find_nearest (h, GST_SECOND), -1);
+
+  push_frame (h, 0);
+  push_frame (h, 4);
+  push_frame (h, 2);
+
+  fail_unless_equals_int (find_nearest (h, 0), 0);
+  fail_unless_equals_int (find_nearest (h, 2 * GST_SECOND), 2);
+  fail_unless_equals_int (find_nearest (h, 3 * GST_SECOND + GST_MSECOND), 4);
+  fail_unless_equals_int (find_nearest (h, 100 * GST_SECOND), 4);
+
+  teardown_harness (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_frame_removed_when_freed)
+{
+  GstHarness *h = setup_harness ();
+  GstVideoDecoder *decoder;
+  GstVideoCodecFrame *frame;
+  const gint remaining[] = { 0, 2 };
+
+  push_frame (h, 0);
+  push_frame (h, 1);
+  push_frame (h, 2);
+
+  decoder = GST_VIDEO_DECODER (h->element);
+  GST_VIDEO_DECODER_STREAM_LOCK (decoder);
+  frame = gst_video_decoder_get_frame (decoder, 1);
+  fail_unless (frame != NULL);
+  fail_unless_equals_uint64 (frame->pts, GST_SECOND);
+  gst_video_decoder_release_frame (decoder, frame);
+  GST_VIDEO_DECODER_STREAM_UNLOCK (decoder);
+
+  check_frames (get_older (h, 10 * GST_SECOND), remaining,
+      G_N_ELEMENTS (remaining));
+  fail_unless_equals_int (find_nearest (h, GST_SECOND + GST_MSECOND), 2);
+
+  teardown_harness (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_add_twice)
+{
+  GstHarness *h = setup_harness ();
+  GstVideoDecoder *decoder;
+  GstVideoCodecFrame *frame;
+  const gint all[] = { 0, 1 };
+
+  push_frame (h, 0);
+  push_frame (h, 1);
+
+  /* Like for the subframes of a frame */
+  decoder = GST_VIDEO_DECODER (h->element);
+  GST_VIDEO_DECODER_STREAM_LOCK (decoder);
+  frame = gst_video_decoder_get_frame (decoder, 0);
+  gst_omx_video_frame_index_add (&frame_index, frame);
+  gst_video_codec_frame_unref (frame);
+  GST_VIDEO_DECODER_STREAM_UNLOCK (decoder);
+
+  check_frames (get_older (h, 10 * GST_SECOND), all, G_N_ELEMENTS (all));
+
+  teardown_harness (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+videoframeindex_suite (void)
+{
+  Suite *s = suite_create ("omxvideoframeindex");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_get_older_sorted);
+  tcase_add_test (tc_chain, test_get_older_invalid_pts);
+  tcase_add_test (tc_chain, test_find_nearest);
+  tcase_add_test (tc_chain, test_frame_removed_when_freed);
+  tcase_add_test (tc_chain, test_add_twice);
+
+  return s;
+}
+
+GST_CHECK_MAIN (videoframeindex);
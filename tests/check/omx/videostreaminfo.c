@@ -0,0 +1,533 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+/* Unit test for the stream header parsers used to size the output port
+ * of the video decoders before the component reports the settings */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/base/gstbitwriter.h>
+
+#include "gstomxh264dec.h"
+#ifdef HAVE_HEVC
+#include "gstomxh265dec.h"
+#endif
+#ifdef HAVE_VP8
+#include "gstomxvp8dec.h"
+#endif
+
+static void
+put_bits (GstBitWriter * bw, guint32 value, guint nbits)
+{
+  fail_unless (gst_bit_writer_put_bits_uint32 (bw, value, nbits));
+}
+
+static void
+put_ue (GstBitWriter * bw, guint32 value)
+{
+  guint nbits = g_bit_storage (value + 1);
+
+  if (nbits > 1)
+    put_bits (bw, 0, nbits - 1);
+  put_bits (bw, value + 1, nbits);
+}
+
+/* Appends the NAL unit made of header and the RBSP written to bw, with
+ * its trailing bits and emulation prevention bytes, optionally preceded
+ * by a start code. Returns the size of the NAL unit */
+static guint
+append_nal (GByteArray * data, gboolean start_code, const guint8 * header,
+    guint header_size, GstBitWriter * bw)
+{
+  static const guint8 start_code_prefix[] = { 0x00, 0x00, 0x00, 0x01 };
+  static const guint8 emulation_prevention = 0x03;
+  const guint8 *rbsp;
+  guint i, size, zeros = 0, start;
+
+  put_bits (bw, 1, 1);
+  fail_unless (gst_bit_writer_align_bytes (bw, 0));
+  rbsp = gst_bit_writer_get_data (bw);
+  size = gst_bit_writer_get_size (bw) / 8;
+
+  if (start_code)
+    g_byte_array_append (data, start_code_prefix,
+        sizeof (start_code_prefix));
+  start = data->len;
+
+  g_byte_array_append (data, header, header_size);
+  for (i = 0; i < size; i++) {
+    if (zeros == 2 && rbsp[i] <= 0x03) {
+      g_byte_array_append (data, &emulation_prevention, 1);
+      zeros = 0;
+    }
+    g_byte_array_append (data, rbsp + i, 1);
+    zeros = rbsp[i] == 0x00 ? zeros + 1 : 0;
+  }
+
+  gst_bit_writer_reset (bw);
+
+  return data->len - start;
+}
+
+static GstBuffer *
+buffer_from_data (GByteArray * data)
+{
+  gsize size = data->len;
+
+  return gst_buffer_new_wrapped (g_byte_array_free (data, FALSE), size);
+}
+
+/* Consumes buffer */
+static gboolean
+parse_stream_info (GType type, GstBuffer * buffer, guint * width,
+    guint * height, guint * dpb_size)
+{
+  GstOMXVideoDecClass *klass = g_type_class_ref (type);
+  gboolean ret;
+
+  *width = *height = *dpb_size = 0;
+
+  /* The parsers only look at the data, not at the decoder */
+  ret = klass->parse_stream_info (NULL, buffer, width, height, dpb_size);
+
+  g_type_class_unref (klass);
+  gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+/* Progressive 4:2:0 picture of width_mbs x height_mbs macroblocks, cropped
+ * by crop_bottom chroma lines at the bottom */
+static void
+write_h264_sps (GstBitWriter * bw, guint8 profile_idc, guint8 level_idc,
+    guint max_num_ref_frames, guint width_mbs, guint height_mbs,
+    guint crop_bottom)
+{
+  put_bits (bw, profile_idc, 8);
+  /* constraint_set_flags, reserved_zero_2bits */
+  put_bits (bw, 0, 8);
+  put_bits (bw, level_idc, 8);
+  /* seq_parameter_set_id */
+  put_ue (bw, 0);
+  if (profile_idc == 100) {
+    /* chroma_format_idc */
+    put_ue (bw, 1);
+    /* bit_depth_luma_minus8, bit_depth_chroma_minus8 */
+    put_ue (bw, 0);
+    put_ue (bw, 0);
+    /* qpprime_y_zero_transform_bypass_flag,
+     * seq_scaling_matrix_present_flag */
+    put_bits (bw, 0, 2);
+  }
+  /* log2_max_frame_num_minus4, pic_order_cnt_type,
+   * log2_max_pic_order_cnt_lsb_minus4 */
+  put_ue (bw, 0);
+  put_ue (bw, 0);
+  put_ue (bw, 0);
+  put_ue (bw, max_num_ref_frames);
+  /* gaps_in_frame_num_value_allowed_flag */
+  put_bits (bw, 0, 1);
+  put_ue (bw, width_mbs - 1);
+  put_ue (bw, height_mbs - 1);
+  /* frame_mbs_only_flag, direct_8x8_inference_flag */
+  put_bits (bw, 1, 1);
+  put_bits (bw, 1, 1);
+  /* frame_cropping_flag */
+  put_bits (bw, crop_bottom > 0, 1);
+  if (crop_bottom > 0) {
+    put_ue (bw, 0);
+    put_ue (bw, 0);
+    put_ue (bw, 0);
+    put_ue (bw, crop_bottom);
+  }
+  /* vui_parameters_present_flag */
+  put_bits (bw, 0, 1);
+}
+
+static const guint8 h264_sps_header[] = { 0x67 };
+static const guint8 h264_pps_header[] = { 0x68 };
+static const guint8 h264_idr_header[] = { 0x65 };
+static const guint8 h264_aud[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0 };
+
+/* Some bytes standing for a PPS or a slice, they are not parsed */
+static void
+write_h264_dummy_payload (GstBitWriter * bw)
+{
+  put_bits (bw, 0xce3c80, 24);
+}
+
+GST_START_TEST (test_h264_byte_stream)
+{
+  GByteArray *data = g_byte_array_new ();
+  GstBitWriter bw;
+  guint width, height, dpb_size;
+
+  gst_bit_writer_init (&bw);
+
+  g_byte_array_append (data, h264_aud, sizeof (h264_aud));
+  /* High profile 1080p, level 4: 32768 / (120 * 68) = 4 frames */
+  write_h264_sps (&bw, 100, 40, 2, 120, 68, 4);
+  append_nal (data, TRUE, h264_sps_header, 1, &bw);
+  write_h264_dummy_payload (&bw);
+  append_nal (data, TRUE, h264_pps_header, 1, &bw);
+  write_h264_dummy_payload (&bw);
+  append_nal (data, TRUE, h264_idr_header, 1, &bw);
+
+  fail_unless (parse_stream_info (GST_TYPE_OMX_H264_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+  fail_unless_equals_int (width, 1920);
+  fail_unless_equals_int (height, 1080);
+  fail_unless_equals_int (dpb_size, 4);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h264_dpb_size)
+{
+  GByteArray *data;
+  GstBitWriter bw;
+  guint width, height, dpb_size;
+
+  gst_bit_writer_init (&bw);
+
+  /* Baseline profile CIF, level 2.1: 4752 / 396 = 12 frames */
+  data = g_byte_array_new ();
+  write_h264_sps (&bw, 66, 21, 1, 22, 18, 0);
+  append_nal (data, TRUE, h264_sps_header, 1, &bw);
+  fail_unless (parse_stream_info (GST_TYPE_OMX_H264_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+  fail_unless_equals_int (width, 352);
+  fail_unless_equals_int (height, 288);
+  fail_unless_equals_int (dpb_size, 12);
+
+  /* Level 3: 8100 / 396 = 20 frames, more than the 16 allowed */
+  data = g_byte_array_new ();
+  write_h264_sps (&bw, 66, 30, 1, 22, 18, 0);
+  append_nal (data, TRUE, h264_sps_header, 1, &bw);
+  fail_unless (parse_stream_info (GST_TYPE_OMX_H264_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+  fail_unless_equals_int (dpb_size, 16);
+
+  /* More reference frames than the level gives */
+  data = g_byte_array_new ();
+  write_h264_sps (&bw, 100, 40, 6, 120, 68, 4);
+  append_nal (data, TRUE, h264_sps_header, 1, &bw);
+  fail_unless (parse_stream_info (GST_TYPE_OMX_H264_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+  fail_unless_equals_int (dpb_size, 6);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h264_avc)
+{
+  GByteArray *data = g_byte_array_new ();
+  GstBitWriter bw;
+  guint8 avcc[] = { 0x01, 66, 0x00, 21, 0xff, 0xe1, 0x00, 0x00 };
+  guint width, height, dpb_size, sps_size;
+
+  gst_bit_writer_init (&bw);
+
+  g_byte_array_append (data, avcc, sizeof (avcc));
+  write_h264_sps (&bw, 66, 21, 1, 22, 18, 0);
+  sps_size = append_nal (data, FALSE, h264_sps_header, 1, &bw);
+  GST_WRITE_UINT16_BE (data->data + 6, sps_size);
+
+  fail_unless (parse_stream_info (GST_TYPE_OMX_H264_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+  fail_unless_equals_int (width, 352);
+  fail_unless_equals_int (height, 288);
+  fail_unless_equals_int (dpb_size, 12);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h264_no_sps)
+{
+  GByteArray *data;
+  GstBitWriter bw;
+  guint width, height, dpb_size;
+
+  gst_bit_writer_init (&bw);
+
+  /* Only the SPS before the first slice is looked at */
+  data = g_byte_array_new ();
+  write_h264_dummy_payload (&bw);
+  append_nal (data, TRUE, h264_idr_header, 1, &bw);
+  write_h264_sps (&bw, 100, 40, 2, 120, 68, 4);
+  append_nal (data, TRUE, h264_sps_header, 1, &bw);
+  fail_if (parse_stream_info (GST_TYPE_OMX_H264_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+
+  /* Truncated SPS */
+  data = g_byte_array_new ();
+  write_h264_sps (&bw, 100, 40, 2, 120, 68, 4);
+  append_nal (data, TRUE, h264_sps_header, 1, &bw);
+  g_byte_array_set_size (data, 10);
+  fail_if (parse_stream_info (GST_TYPE_OMX_H264_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+}
+
+GST_END_TEST;
+
+#ifdef HAVE_HEVC
+/* Main profile 4:2:0 picture of pic_width x pic_height luma samples,
+ * cropped by conf_bottom chroma lines at the bottom, with
+ * max_sub_layers_minus1 + 1 sub-layers whose DPB sizes are in
+ * max_dec_pic_buffering_minus1 */
+static void
+write_h265_sps (GstBitWriter * bw, guint max_sub_layers_minus1,
+    guint pic_width, guint pic_height, guint conf_bottom,
+    const guint * max_dec_pic_buffering_minus1)
+{
+  guint i;
+
+  /* sps_video_parameter_set_id */
+  put_bits (bw, 0, 4);
+  put_bits (bw, max_sub_layers_minus1, 3);
+  /* sps_temporal_id_nesting_flag */
+  put_bits (bw, 1, 1);
+
+  /* profile_tier_level: general_profile_space, general_tier_flag,
+   * general_profile_idc, general_profile_compatibility_flags */
+  put_bits (bw, 0, 2);
+  put_bits (bw, 0, 1);
+  put_bits (bw, 1, 5);
+  put_bits (bw, 0x60000000, 32);
+  /* progressive_source_flag, interlaced_source_flag,
+   * non_packed_constraint_flag, frame_only_constraint_flag, 43 reserved
+   * bits and general_inbld_flag */
+  put_bits (bw, 0x9, 4);
+  put_bits (bw, 0, 32);
+  put_bits (bw, 0, 12);
+  /* general_level_idc, level 4 */
+  put_bits (bw, 120, 8);
+  /* sub_layer_profile_present_flag, sub_layer_level_present_flag */
+  for (i = 0; i < max_sub_layers_minus1; i++)
+    put_bits (bw, 0, 2);
+  if (max_sub_layers_minus1 > 0)
+    put_bits (bw, 0, 2 * (8 - max_sub_layers_minus1));
+
+  /* sps_seq_parameter_set_id */
+  put_ue (bw, 0);
+  /* chroma_format_idc */
+  put_ue (bw, 1);
+  put_ue (bw, pic_width);
+  put_ue (bw, pic_height);
+  /* conformance_window_flag */
+  put_bits (bw, conf_bottom > 0, 1);
+  if (conf_bottom > 0) {
+    put_ue (bw, 0);
+    put_ue (bw, 0);
+    put_ue (bw, 0);
+    put_ue (bw, conf_bottom);
+  }
+  /* bit_depth_luma_minus8, bit_depth_chroma_minus8,
+   * log2_max_pic_order_cnt_lsb_minus4 */
+  put_ue (bw, 0);
+  put_ue (bw, 0);
+  put_ue (bw, 4);
+  /* sps_sub_layer_ordering_info_present_flag */
+  put_bits (bw, 1, 1);
+  for (i = 0; i <= max_sub_layers_minus1; i++) {
+    put_ue (bw, max_dec_pic_buffering_minus1[i]);
+    /* sps_max_num_reorder_pics, sps_max_latency_increase_plus1 */
+    put_ue (bw, 0);
+    put_ue (bw, 0);
+  }
+}
+
+static const guint8 h265_vps_header[] = { 0x40, 0x01 };
+static const guint8 h265_sps_header[] = { 0x42, 0x01 };
+static const guint8 h265_idr_header[] = { 0x26, 0x01 };
+
+GST_START_TEST (test_h265_byte_stream)
+{
+  GByteArray *data = g_byte_array_new ();
+  GstBitWriter bw;
+  const guint max_dec_pic_buffering_minus1[] = { 2, 3, 5 };
+  guint width, height, dpb_size;
+
+  gst_bit_writer_init (&bw);
+
+  put_bits (&bw, 0x0c01ff, 24);
+  append_nal (data, TRUE, h265_vps_header, 2, &bw);
+  /* The DPB size is the one of the highest sub-layer */
+  write_h265_sps (&bw, 2, 1920, 1088, 4, max_dec_pic_buffering_minus1);
+  append_nal (data, TRUE, h265_sps_header, 2, &bw);
+  put_bits (&bw, 0xaf0900, 24);
+  append_nal (data, TRUE, h265_idr_header, 2, &bw);
+
+  fail_unless (parse_stream_info (GST_TYPE_OMX_H265_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+  fail_unless_equals_int (width, 1920);
+  fail_unless_equals_int (height, 1080);
+  fail_unless_equals_int (dpb_size, 6);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h265_hvcc)
+{
+  GByteArray *data = g_byte_array_new ();
+  GstBitWriter bw;
+  const guint max_dec_pic_buffering_minus1[] = { 4 };
+  guint8 hvcc[22] = { 0x01, };
+  guint8 array[] = { 0x00, 0x00, 0x01, 0x00, 0x00 };
+  guint width, height, dpb_size, pos, size;
+
+  gst_bit_writer_init (&bw);
+
+  g_byte_array_append (data, hvcc, sizeof (hvcc));
+  /* numOfArrays */
+  g_byte_array_append (data, (const guint8 *) "\x02", 1);
+
+  /* A VPS array to skip, then the SPS one */
+  array[0] = 0x80 | 32;
+  pos = data->len;
+  g_byte_array_append (data, array, sizeof (array));
+  put_bits (&bw, 0x0c01ff, 24);
+  size = append_nal (data, FALSE, h265_vps_header, 2, &bw);
+  GST_WRITE_UINT16_BE (data->data + pos + 3, size);
+
+  array[0] = 0x80 | 33;
+  pos = data->len;
+  g_byte_array_append (data, array, sizeof (array));
+  write_h265_sps (&bw, 0, 1280, 720, 0, max_dec_pic_buffering_minus1);
+  size = append_nal (data, FALSE, h265_sps_header, 2, &bw);
+  GST_WRITE_UINT16_BE (data->data + pos + 3, size);
+
+  fail_unless (parse_stream_info (GST_TYPE_OMX_H265_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+  fail_unless_equals_int (width, 1280);
+  fail_unless_equals_int (height, 720);
+  fail_unless_equals_int (dpb_size, 5);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h265_no_sps)
+{
+  GByteArray *data;
+  GstBitWriter bw;
+  const guint max_dec_pic_buffering_minus1[] = { 4 };
+  guint width, height, dpb_size;
+
+  gst_bit_writer_init (&bw);
+
+  /* Only the SPS before the first slice is looked at */
+  data = g_byte_array_new ();
+  put_bits (&bw, 0xaf0900, 24);
+  append_nal (data, TRUE, h265_idr_header, 2, &bw);
+  write_h265_sps (&bw, 0, 1280, 720, 0, max_dec_pic_buffering_minus1);
+  append_nal (data, TRUE, h265_sps_header, 2, &bw);
+  fail_if (parse_stream_info (GST_TYPE_OMX_H265_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+
+  /* Truncated SPS */
+  data = g_byte_array_new ();
+  write_h265_sps (&bw, 0, 1280, 720, 0, max_dec_pic_buffering_minus1);
+  append_nal (data, TRUE, h265_sps_header, 2, &bw);
+  g_byte_array_set_size (data, 20);
+  fail_if (parse_stream_info (GST_TYPE_OMX_H265_DEC,
+          buffer_from_data (data), &width, &height, &dpb_size));
+}
+
+GST_END_TEST;
+#endif
+
+#ifdef HAVE_VP8
+static GstBuffer *
+vp8_frame (gboolean key_frame, guint16 width, guint16 height)
+{
+  guint8 data[] = { 0x50, 0x01, 0x00, 0x9d, 0x01, 0x2a, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00
+  };
+  GstBuffer *buffer;
+
+  if (!key_frame)
+    data[0] |= 0x01;
+  GST_WRITE_UINT16_LE (data + 6, width);
+  GST_WRITE_UINT16_LE (data + 8, height);
+
+  buffer = gst_buffer_new_allocate (NULL, sizeof (data), NULL);
+  gst_buffer_fill (buffer, 0, data, sizeof (data));
+
+  return buffer;
+}
+
+GST_START_TEST (test_vp8)
+{
+  guint width, height, dpb_size;
+
+  fail_unless (parse_stream_info (GST_TYPE_OMX_VP8_DEC,
+          vp8_frame (TRUE, 640, 360), &width, &height, &dpb_size));
+  fail_unless_equals_int (width, 640);
+  fail_unless_equals_int (height, 360);
+  fail_unless_equals_int (dpb_size, 3);
+
+  /* The upper 2 bits are the scaling mode */
+  fail_unless (parse_stream_info (GST_TYPE_OMX_VP8_DEC,
+          vp8_frame (TRUE, 0x4000 | 1920, 0xc000 | 1080), &width, &height,
+          &dpb_size));
+  fail_unless_equals_int (width, 1920);
+  fail_unless_equals_int (height, 1080);
+
+  /* Only key frames have the picture size */
+  fail_if (parse_stream_info (GST_TYPE_OMX_VP8_DEC,
+          vp8_frame (FALSE, 640, 360), &width, &height, &dpb_size));
+
+  fail_if (parse_stream_info (GST_TYPE_OMX_VP8_DEC,
+          vp8_frame (TRUE, 0, 360), &width, &height, &dpb_size));
+
+  fail_if (parse_stream_info (GST_TYPE_OMX_VP8_DEC,
+          gst_buffer_new_allocate (NULL, 4, NULL), &width, &height,
+          &dpb_size));
+}
+
+GST_END_TEST;
+#endif
+
+static Suite *
+videostreaminfo_suite (void)
+{
+  Suite *s = suite_create ("omxvideostreaminfo");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_h264_byte_stream);
+  tcase_add_test (tc_chain, test_h264_dpb_size);
+  tcase_add_test (tc_chain, test_h264_avc);
+  tcase_add_test (tc_chain, test_h264_no_sps);
+#ifdef HAVE_HEVC
+  tcase_add_test (tc_chain, test_h265_byte_stream);
+  tcase_add_test (tc_chain, test_h265_hvcc);
+  tcase_add_test (tc_chain, test_h265_no_sps);
+#endif
+#ifdef HAVE_VP8
+  tcase_add_test (tc_chain, test_vp8);
+#endif
+
+  return s;
+}
+
+GST_CHECK_MAIN (videostreaminfo);
@@ -0,0 +1,781 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+/* Throughput and latency benchmark for the gst-omx elements.
+ *
+ * The input is first collected in memory, either from a file or generated
+ * with videotestsrc (and encoded with --source-encoder for decoding), so
+ * that only the element under test is measured. It is then pushed from an
+ * appsrc at a fixed rate or as fast as possible through
+ *
+ *   decode:    appsrc ! DECODER ! fakesink
+ *   encode:    appsrc ! ENCODER ! fakesink
+ *   transcode: appsrc ! DECODER ! ENCODER ! fakesink
+ *
+ * The latency of an element is the time between a buffer entering its
+ * sink pad and the buffer with the same PTS leaving its src pad, i.e.
+ * from handle_frame() until finish_frame() returned it.
+ *
+ * Which OpenMAX core is used depends on the gstomx.conf that registered
+ * the elements, see GST_OMX_CONFIG_DIR.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/resource.h>
+#if defined (_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+#define HAVE_THREAD_CPUTIME 1
+#endif
+#endif
+
+/* Raw input frames are reused cyclically to limit memory usage */
+#define MAX_RAW_FRAMES 16
+
+typedef struct
+{
+  const gchar *name;
+  GMutex lock;
+  /* PTS -> time the buffer entered the sink pad */
+  GHashTable *pending;
+  /* GstClockTime */
+  GArray *latencies;
+  /* Thread calling into the sink pad */
+  GThread *input_thread;
+} BenchStage;
+
+typedef struct
+{
+  gchar *name;
+  GThread *thread;
+  GstElement *owner;
+#ifdef HAVE_THREAD_CPUTIME
+  clockid_t clock;
+#endif
+  GstClockTime cpu_time;
+  gboolean done;
+} BenchTask;
+
+typedef struct
+{
+  /* Options */
+  const gchar *mode;
+  const gchar *decoder;
+  const gchar *encoder;
+  const gchar *source_encoder;
+  const gchar *input;
+  const gchar *json;
+  gint n_frames;
+  gint rate;
+  gint width;
+  gint height;
+  const gchar *format;
+
+  /* Input */
+  GPtrArray *frames;
+  GstCaps *caps;
+  gboolean raw_input;
+
+  /* Run */
+  GstElement *pipeline;
+  GstElement *appsrc;
+  GstElement *dec;
+  GstElement *enc;
+  BenchStage stages[3];
+  guint n_stages;
+  GMutex tasks_lock;
+  GPtrArray *tasks;
+  gint n_output;                /* atomic */
+  GstClockTime start;
+  GstClockTime end;
+} Bench;
+
+static void
+bench_stage_init (BenchStage * stage, const gchar * name)
+{
+  stage->name = name;
+  g_mutex_init (&stage->lock);
+  stage->pending = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+      g_free, g_free);
+  stage->latencies = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+  stage->input_thread = NULL;
+}
+
+static void
+bench_stage_clear (BenchStage * stage)
+{
+  g_hash_table_unref (stage->pending);
+  g_array_unref (stage->latencies);
+  g_mutex_clear (&stage->lock);
+}
+
+static GstPadProbeReturn
+stage_sink_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  BenchStage *stage = user_data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  gint64 *pts;
+  GstClockTime *now;
+
+  g_mutex_lock (&stage->lock);
+  if (!stage->input_thread)
+    stage->input_thread = g_thread_self ();
+
+  if (GST_BUFFER_PTS_IS_VALID (buf)) {
+    pts = g_new (gint64, 1);
+    now = g_new (GstClockTime, 1);
+    *pts = GST_BUFFER_PTS (buf);
+    *now = gst_util_get_timestamp ();
+    g_hash_table_replace (stage->pending, pts, now);
+  }
+  g_mutex_unlock (&stage->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+stage_src_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  BenchStage *stage = user_data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstClockTime now = gst_util_get_timestamp ();
+  GstClockTime *start;
+  gint64 pts;
+
+  if (!GST_BUFFER_PTS_IS_VALID (buf))
+    return GST_PAD_PROBE_OK;
+
+  pts = GST_BUFFER_PTS (buf);
+
+  g_mutex_lock (&stage->lock);
+  start = g_hash_table_lookup (stage->pending, &pts);
+  if (start) {
+    GstClockTime latency = now - *start;
+
+    g_array_append_val (stage->latencies, latency);
+    g_hash_table_remove (stage->pending, &pts);
+  }
+  g_mutex_unlock (&stage->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+bench_add_stage (Bench * bench, const gchar * name, GstPad * sinkpad,
+    GstPad * srcpad)
+{
+  BenchStage *stage = &bench->stages[bench->n_stages++];
+
+  bench_stage_init (stage, name);
+  gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER, stage_sink_probe,
+      stage, NULL);
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER, stage_src_probe,
+      stage, NULL);
+}
+
+static GstPadProbeReturn
+output_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  Bench *bench = user_data;
+
+  g_atomic_int_inc (&bench->n_output);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Called from the streaming threads themselves */
+static GstBusSyncReply
+bench_sync_handler (GstBus * bus, GstMessage * message, gpointer user_data)
+{
+  Bench *bench = user_data;
+  GstStreamStatusType type;
+  GstElement *owner;
+  BenchTask *task;
+  guint i;
+
+  if (GST_MESSAGE_TYPE (message) != GST_MESSAGE_STREAM_STATUS)
+    return GST_BUS_PASS;
+
+  gst_message_parse_stream_status (message, &type, &owner);
+
+  g_mutex_lock (&bench->tasks_lock);
+  switch (type) {
+    case GST_STREAM_STATUS_TYPE_ENTER:
+      task = g_new0 (BenchTask, 1);
+      task->name = g_strdup_printf ("%s:%s", GST_OBJECT_NAME (owner),
+          GST_OBJECT_NAME (GST_MESSAGE_SRC (message)));
+      task->thread = g_thread_self ();
+      task->owner = owner;
+#ifdef HAVE_THREAD_CPUTIME
+      pthread_getcpuclockid (pthread_self (), &task->clock);
+#endif
+      g_ptr_array_add (bench->tasks, task);
+      break;
+    case GST_STREAM_STATUS_TYPE_LEAVE:
+      for (i = 0; i < bench->tasks->len; i++) {
+        task = g_ptr_array_index (bench->tasks, i);
+        if (task->thread == g_thread_self () && !task->done) {
+#ifdef HAVE_THREAD_CPUTIME
+          struct timespec ts;
+
+          clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+          task->cpu_time = GST_TIMESPEC_TO_TIME (ts);
+#endif
+          task->done = TRUE;
+        }
+      }
+      break;
+    default:
+      break;
+  }
+  g_mutex_unlock (&bench->tasks_lock);
+
+  return GST_BUS_PASS;
+}
+
+/* Reads the CPU time of all task threads that are still running */
+static void
+bench_sample_tasks (Bench * bench)
+{
+  guint i;
+
+  g_mutex_lock (&bench->tasks_lock);
+  for (i = 0; i < bench->tasks->len; i++) {
+    BenchTask *task = g_ptr_array_index (bench->tasks, i);
+#ifdef HAVE_THREAD_CPUTIME
+    struct timespec ts;
+
+    if (!task->done && clock_gettime (task->clock, &ts) == 0) {
+      task->cpu_time = GST_TIMESPEC_TO_TIME (ts);
+      task->done = TRUE;
+    }
+#else
+    task->done = TRUE;
+#endif
+  }
+  g_mutex_unlock (&bench->tasks_lock);
+}
+
+static gboolean
+bench_run_pipeline (GstElement * pipeline, GError ** error)
+{
+  GstBus *bus = gst_element_get_bus (pipeline);
+  GstMessage *msg;
+  gboolean ret = TRUE;
+
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gchar *debug = NULL;
+
+    gst_message_parse_error (msg, error, &debug);
+    g_printerr ("Debug info: %s\n", debug ? debug : "none");
+    g_free (debug);
+    ret = FALSE;
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  return ret;
+}
+
+/* Collects the input buffers from a pipeline ending in an appsink called
+ * "sink" */
+static gboolean
+bench_collect_input (Bench * bench, const gchar * desc, guint max_frames,
+    GError ** error)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample;
+
+  g_print ("Collecting input: %s\n", desc);
+
+  pipeline = gst_parse_launch (desc, error);
+  if (!pipeline)
+    return FALSE;
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_object_set (sink, "sync", FALSE, NULL);
+
+  bench->frames = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_buffer_unref);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  while (bench->frames->len < max_frames
+      && (sample = gst_app_sink_pull_sample (GST_APP_SINK (sink)))) {
+    if (!bench->caps)
+      bench->caps = gst_caps_ref (gst_sample_get_caps (sample));
+    g_ptr_array_add (bench->frames,
+        gst_buffer_ref (gst_sample_get_buffer (sample)));
+    gst_sample_unref (sample);
+  }
+
+  if (bench->frames->len == 0) {
+    GstBus *bus = gst_element_get_bus (pipeline);
+    GstMessage *msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ERROR);
+
+    if (msg) {
+      gst_message_parse_error (msg, error, NULL);
+      gst_message_unref (msg);
+    } else {
+      g_set_error_literal (error, GST_CORE_ERROR, GST_CORE_ERROR_FAILED,
+          "No input frames");
+    }
+    gst_object_unref (bus);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  return bench->frames->len > 0;
+}
+
+static gboolean
+bench_prepare_input (Bench * bench, GError ** error)
+{
+  gchar *raw_caps, *desc;
+  gboolean ret;
+
+  bench->raw_input = g_str_equal (bench->mode, "encode");
+
+  raw_caps = g_strdup_printf ("video/x-raw,format=%s,width=%d,height=%d,"
+      "framerate=%d/1", bench->format, bench->width, bench->height,
+      bench->rate > 0 ? bench->rate : 30);
+
+  if (bench->raw_input) {
+    if (bench->input)
+      desc = g_strdup_printf ("filesrc location=\"%s\" ! decodebin ! "
+          "videoconvert ! videoscale ! %s ! appsink name=sink", bench->input,
+          raw_caps);
+    else
+      desc = g_strdup_printf ("videotestsrc num-buffers=%d ! %s ! "
+          "appsink name=sink", MIN (bench->n_frames, MAX_RAW_FRAMES),
+          raw_caps);
+  } else {
+    if (bench->input)
+      desc = g_strdup_printf ("filesrc location=\"%s\" ! parsebin ! "
+          "appsink name=sink", bench->input);
+    else
+      desc = g_strdup_printf ("videotestsrc num-buffers=%d ! %s ! %s ! "
+          "appsink name=sink", bench->n_frames, raw_caps,
+          bench->source_encoder ? bench->source_encoder : bench->encoder);
+  }
+
+  ret = bench_collect_input (bench, desc, bench->raw_input ?
+      MAX_RAW_FRAMES : bench->n_frames, error);
+
+  g_free (desc);
+  g_free (raw_caps);
+
+  if (ret && !bench->raw_input)
+    bench->n_frames = MIN (bench->n_frames, bench->frames->len);
+
+  return ret;
+}
+
+static gpointer
+bench_feed_thread (gpointer user_data)
+{
+  Bench *bench = user_data;
+  GstClockTime duration = GST_SECOND / (bench->rate > 0 ? bench->rate : 30);
+  gint i;
+
+  bench->start = gst_util_get_timestamp ();
+
+  for (i = 0; i < bench->n_frames; i++) {
+    GstBuffer *buf = g_ptr_array_index (bench->frames,
+        i % bench->frames->len);
+
+    if (bench->rate > 0) {
+      GstClockTime due = bench->start + i * duration;
+      GstClockTime now = gst_util_get_timestamp ();
+
+      if (due > now)
+        g_usleep (GST_TIME_AS_USECONDS (due - now));
+    }
+
+    buf = gst_buffer_copy (buf);
+    /* Raw frames are reused, give them unique timestamps */
+    if (bench->raw_input) {
+      GST_BUFFER_PTS (buf) = i * duration;
+      GST_BUFFER_DTS (buf) = GST_CLOCK_TIME_NONE;
+      GST_BUFFER_DURATION (buf) = duration;
+    }
+
+    if (gst_app_src_push_buffer (GST_APP_SRC (bench->appsrc),
+            buf) != GST_FLOW_OK)
+      break;
+  }
+
+  gst_app_src_end_of_stream (GST_APP_SRC (bench->appsrc));
+
+  return NULL;
+}
+
+static gboolean
+bench_run (Bench * bench, GError ** error)
+{
+  GstElement *sink;
+  GstPad *pad, *pad2;
+  GstBus *bus;
+  GThread *feeder;
+  gchar *desc;
+  gboolean ret;
+
+  if (g_str_equal (bench->mode, "decode"))
+    desc = g_strdup_printf ("appsrc name=src ! %s name=dec ! fakesink "
+        "name=sink", bench->decoder);
+  else if (g_str_equal (bench->mode, "encode"))
+    desc = g_strdup_printf ("appsrc name=src ! %s name=enc ! fakesink "
+        "name=sink", bench->encoder);
+  else
+    desc = g_strdup_printf ("appsrc name=src ! %s name=dec ! %s name=enc ! "
+        "fakesink name=sink", bench->decoder, bench->encoder);
+
+  g_print ("Running: %s\n", desc);
+  bench->pipeline = gst_parse_launch (desc, error);
+  g_free (desc);
+  if (!bench->pipeline)
+    return FALSE;
+
+  bench->appsrc = gst_bin_get_by_name (GST_BIN (bench->pipeline), "src");
+  bench->dec = gst_bin_get_by_name (GST_BIN (bench->pipeline), "dec");
+  bench->enc = gst_bin_get_by_name (GST_BIN (bench->pipeline), "enc");
+  sink = gst_bin_get_by_name (GST_BIN (bench->pipeline), "sink");
+
+  g_object_set (bench->appsrc, "caps", bench->caps, "format", GST_FORMAT_TIME,
+      "block", TRUE, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+
+  if (bench->dec) {
+    pad = gst_element_get_static_pad (bench->dec, "sink");
+    pad2 = gst_element_get_static_pad (bench->dec, "src");
+    bench_add_stage (bench, "decoder", pad, pad2);
+    gst_object_unref (pad);
+    gst_object_unref (pad2);
+  }
+  if (bench->enc) {
+    pad = gst_element_get_static_pad (bench->enc, "sink");
+    pad2 = gst_element_get_static_pad (bench->enc, "src");
+    bench_add_stage (bench, "encoder", pad, pad2);
+    gst_object_unref (pad);
+    gst_object_unref (pad2);
+  }
+
+  pad = gst_element_get_static_pad (bench->appsrc, "src");
+  pad2 = gst_element_get_static_pad (sink, "sink");
+  bench_add_stage (bench, "pipeline", pad, pad2);
+  gst_pad_add_probe (pad2, GST_PAD_PROBE_TYPE_BUFFER, output_probe, bench,
+      NULL);
+  gst_object_unref (pad);
+  gst_object_unref (pad2);
+  gst_object_unref (sink);
+
+  bus = gst_element_get_bus (bench->pipeline);
+  gst_bus_set_sync_handler (bus, bench_sync_handler, bench, NULL);
+  gst_object_unref (bus);
+
+  if (gst_element_set_state (bench->pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+    g_set_error_literal (error, GST_CORE_ERROR, GST_CORE_ERROR_STATE_CHANGE,
+        "Failed to start the pipeline");
+    return FALSE;
+  }
+
+  feeder = g_thread_new ("bench-feed", bench_feed_thread, bench);
+
+  ret = bench_run_pipeline (bench->pipeline, error);
+  bench->end = gst_util_get_timestamp ();
+  bench_sample_tasks (bench);
+
+  /* Unblocks the feeder on errors */
+  gst_element_set_state (bench->pipeline, GST_STATE_NULL);
+  g_thread_join (feeder);
+
+  return ret;
+}
+
+static gint
+compare_clock_time (gconstpointer a, gconstpointer b)
+{
+  GstClockTime ta = *(const GstClockTime *) a;
+  GstClockTime tb = *(const GstClockTime *) b;
+
+  return (ta > tb) - (ta < tb);
+}
+
+static gdouble
+percentile_ms (GArray * sorted, guint p)
+{
+  guint idx;
+
+  if (sorted->len == 0)
+    return 0;
+
+  idx = MIN ((sorted->len * p) / 100, sorted->len - 1);
+
+  return g_array_index (sorted, GstClockTime, idx) / (gdouble) GST_MSECOND;
+}
+
+static const gchar *
+task_role (Bench * bench, BenchTask * task)
+{
+  guint i;
+
+  if (task->owner == bench->dec)
+    return "decoder src pad task";
+  if (task->owner == bench->enc)
+    return "encoder src pad task";
+
+  for (i = 0; i < bench->n_stages; i++) {
+    if (bench->stages[i].input_thread == task->thread
+        && !g_str_equal (bench->stages[i].name, "pipeline"))
+      return g_str_equal (bench->stages[i].name, "decoder") ?
+          "decoder streaming thread" : "encoder streaming thread";
+  }
+
+  return "other";
+}
+
+static glong
+peak_rss_kb (void)
+{
+#ifdef G_OS_UNIX
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+  return -1;
+}
+
+static void
+bench_report (Bench * bench)
+{
+  GString *json = g_string_new (NULL);
+  gdouble seconds = (bench->end - bench->start) / (gdouble) GST_SECOND;
+  gint n_output = g_atomic_int_get (&bench->n_output);
+  gdouble fps = seconds > 0 ? n_output / seconds : 0;
+  guint i;
+
+  g_print ("\n%s: %d frames in %.3f s, %.2f frames/s\n", bench->mode,
+      n_output, seconds, fps);
+  g_string_append_printf (json, "{\n  \"mode\": \"%s\",\n"
+      "  \"input-frames\": %d,\n  \"output-frames\": %d,\n"
+      "  \"rate\": %d,\n  \"duration\": %.6f,\n  \"fps\": %.3f,\n",
+      bench->mode, bench->n_frames, n_output, bench->rate, seconds, fps);
+
+  g_print ("\nLatency (ms)      %8s %8s %8s %8s %8s\n", "p50", "p90", "p99",
+      "max", "frames");
+  g_string_append (json, "  \"latency\": {");
+  for (i = 0; i < bench->n_stages; i++) {
+    BenchStage *stage = &bench->stages[i];
+
+    g_array_sort (stage->latencies, compare_clock_time);
+    g_print ("  %-15s %8.3f %8.3f %8.3f %8.3f %8u\n", stage->name,
+        percentile_ms (stage->latencies, 50),
+        percentile_ms (stage->latencies, 90),
+        percentile_ms (stage->latencies, 99),
+        percentile_ms (stage->latencies, 100), stage->latencies->len);
+    g_string_append_printf (json, "%s\n    \"%s\": {\"p50\": %.3f, "
+        "\"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"frames\": %u}",
+        i > 0 ? "," : "", stage->name, percentile_ms (stage->latencies, 50),
+        percentile_ms (stage->latencies, 90),
+        percentile_ms (stage->latencies, 99),
+        percentile_ms (stage->latencies, 100), stage->latencies->len);
+  }
+  g_string_append (json, "\n  },\n");
+
+#ifdef HAVE_THREAD_CPUTIME
+  g_print ("\nCPU time (ms)\n");
+#else
+  g_print ("\nCPU time (ms): not supported on this platform\n");
+#endif
+  g_string_append (json, "  \"cpu\": {");
+  for (i = 0; i < bench->tasks->len; i++) {
+    BenchTask *task = g_ptr_array_index (bench->tasks, i);
+    const gchar *role = task_role (bench, task);
+
+#ifdef HAVE_THREAD_CPUTIME
+    g_print ("  %-24s %10.3f  (%s)\n", task->name,
+        task->cpu_time / (gdouble) GST_MSECOND, role);
+#endif
+    g_string_append_printf (json, "%s\n    \"%s\": {\"time\": %.3f, "
+        "\"role\": \"%s\"}", i > 0 ? "," : "", task->name,
+        task->cpu_time / (gdouble) GST_MSECOND, role);
+  }
+  g_string_append (json, "\n  },\n");
+
+  g_print ("\nPeak RSS: %ld kB\n", peak_rss_kb ());
+  g_string_append_printf (json, "  \"peak-rss-kb\": %ld\n}\n", peak_rss_kb ());
+
+  if (bench->json) {
+    if (g_str_equal (bench->json, "-")) {
+      g_print ("\n%s", json->str);
+    } else {
+      GError *err = NULL;
+
+      if (!g_file_set_contents (bench->json, json->str, json->len, &err)) {
+        g_printerr ("Failed to write %s: %s\n", bench->json, err->message);
+        g_clear_error (&err);
+      }
+    }
+  }
+
+  g_string_free (json, TRUE);
+}
+
+static void
+bench_free (Bench * bench)
+{
+  guint i;
+
+  for (i = 0; i < bench->n_stages; i++)
+    bench_stage_clear (&bench->stages[i]);
+
+  for (i = 0; i < bench->tasks->len; i++) {
+    BenchTask *task = g_ptr_array_index (bench->tasks, i);
+
+    g_free (task->name);
+    g_free (task);
+  }
+  g_ptr_array_unref (bench->tasks);
+  g_mutex_clear (&bench->tasks_lock);
+
+  if (bench->frames)
+    g_ptr_array_unref (bench->frames);
+  gst_clear_caps (&bench->caps);
+  gst_clear_object (&bench->appsrc);
+  gst_clear_object (&bench->dec);
+  gst_clear_object (&bench->enc);
+  gst_clear_object (&bench->pipeline);
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+  Bench bench = { 0, };
+  gchar *mode = NULL, *decoder = NULL, *encoder = NULL;
+  gchar *source_encoder = NULL, *input = NULL, *json = NULL, *format = NULL;
+  GOptionContext *ctx;
+  GError *err = NULL;
+  gint ret = 0;
+  GOptionEntry entries[] = {
+    {"mode", 'm', 0, G_OPTION_ARG_STRING, &mode,
+        "decode, encode or transcode (default: decode)", "MODE"},
+    {"decoder", 'd', 0, G_OPTION_ARG_STRING, &decoder,
+        "Decoder element with properties (default: omxh264dec)", "DESC"},
+    {"encoder", 'e', 0, G_OPTION_ARG_STRING, &encoder,
+        "Encoder element with properties (default: omxh264enc)", "DESC"},
+    {"source-encoder", 's', 0, G_OPTION_ARG_STRING, &source_encoder,
+          "Encoder used to generate the synthetic input for decoding "
+          "(default: the encoder)", "DESC"},
+    {"input", 'i', 0, G_OPTION_ARG_FILENAME, &input,
+        "Input file instead of synthetic input", "FILE"},
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &bench.n_frames,
+        "Number of frames (default: 300)", "N"},
+    {"rate", 'r', 0, G_OPTION_ARG_INT, &bench.rate,
+        "Input rate in frames/s (default: 0, as fast as possible)", "FPS"},
+    {"width", 'W', 0, G_OPTION_ARG_INT, &bench.width,
+        "Width of synthetic input (default: 1920)", "WIDTH"},
+    {"height", 'H', 0, G_OPTION_ARG_INT, &bench.height,
+        "Height of synthetic input (default: 1080)", "HEIGHT"},
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+        "Raw video format (default: I420)", "FORMAT"},
+    {"json", 'j', 0, G_OPTION_ARG_FILENAME, &json,
+        "Also write the results as JSON to FILE, - for stdout", "FILE"},
+    {NULL}
+  };
+
+  bench.n_frames = 300;
+  bench.width = 1920;
+  bench.height = 1080;
+
+  ctx = g_option_context_new ("- benchmark gst-omx elements");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  bench.mode = mode ? mode : "decode";
+  bench.decoder = decoder ? decoder : "omxh264dec";
+  bench.encoder = encoder ? encoder : "omxh264enc";
+  bench.source_encoder = source_encoder;
+  bench.input = input;
+  bench.json = json;
+  bench.format = format ? format : "I420";
+
+  if (!g_str_equal (bench.mode, "decode") && !g_str_equal (bench.mode,
+          "encode") && !g_str_equal (bench.mode, "transcode")) {
+    g_printerr ("Unknown mode '%s'\n", bench.mode);
+    return 1;
+  }
+  if (bench.n_frames <= 0 || bench.rate < 0) {
+    g_printerr ("Invalid number of frames or rate\n");
+    return 1;
+  }
+
+  g_mutex_init (&bench.tasks_lock);
+  bench.tasks = g_ptr_array_new ();
+
+  if (!bench_prepare_input (&bench, &err)) {
+    g_printerr ("Failed to prepare input: %s\n", err->message);
+    ret = 1;
+    goto done;
+  }
+
+  if (!bench_run (&bench, &err)) {
+    g_printerr ("Failed to run benchmark: %s\n", err ? err->message :
+        "unknown error");
+    ret = 1;
+    goto done;
+  }
+
+  bench_report (&bench);
+
+done:
+  g_clear_error (&err);
+  bench_free (&bench);
+  g_free (mode);
+  g_free (decoder);
+  g_free (encoder);
+  g_free (source_encoder);
+  g_free (input);
+  g_free (json);
+  g_free (format);
+
+  return ret;
+}
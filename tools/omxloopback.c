@@ -0,0 +1,1338 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+/* Software OpenMAX IL core with passthrough video decoder and encoder
+ * components. It does not decode or encode anything but behaves like a
+ * hardware codec from the point of view of the IL client, which allows
+ * measuring the per-frame overhead of gst-omx itself on any host.
+ *
+ * The H.265 decoder is only available if the OpenMAX headers define
+ * OMX_VIDEO_CodingHEVC.
+ *
+ * Each input buffer produces one output buffer. The decoder outputs full
+ * raw frames of the configured size, the encoder copies its input. The
+ * behaviour is configured with the GST_OMX_LOOPBACK environment variable,
+ * a comma separated list of key=value pairs read when a component is
+ * created:
+ *
+ *   latency=<us>             time between input and output (default 0)
+ *   max-fps=<n>              limit the output rate (default 0: unlimited)
+ *   in-buffers=<n>           minimum input buffer count (default 4)
+ *   out-buffers=<n>          minimum output buffer count (default 4)
+ *   stride-align=<n>         stride alignment of raw frames (default 16)
+ *   slice-height-align=<n>   slice height alignment (default 16)
+ *   settings-changed=<mode>  decoder PortSettingsChanged behaviour:
+ *                            "first" on the first frame (default), "never"
+ *                            or a number N to also send it every N frames
+ *
+ * e.g. GST_OMX_LOOPBACK=latency=10000,max-fps=60,out-buffers=8
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <string.h>
+
+#ifdef GST_OMX_STRUCT_PACKING
+# if GST_OMX_STRUCT_PACKING == 1
+#  pragma pack(1)
+# elif GST_OMX_STRUCT_PACKING == 2
+#  pragma pack(2)
+# elif GST_OMX_STRUCT_PACKING == 4
+#  pragma pack(4)
+# elif GST_OMX_STRUCT_PACKING == 8
+#  pragma pack(8)
+# else
+#  error "Unsupported struct packing value"
+# endif
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Component.h>
+
+#ifdef HAVE_VIDEO_EXT
+#include <OMX_VideoExt.h>
+#endif
+
+#ifdef GST_OMX_STRUCT_PACKING
+#pragma pack()
+#endif
+
+#define LOOPBACK_IN_PORT 0
+#define LOOPBACK_OUT_PORT 1
+#define LOOPBACK_N_PORTS 2
+
+#define LOOPBACK_DEFAULT_WIDTH 1920
+#define LOOPBACK_DEFAULT_HEIGHT 1080
+#define LOOPBACK_COMPRESSED_BUFFER_SIZE (2 * 1024 * 1024)
+
+#define LOOPBACK_INIT_STRUCT(st) G_STMT_START { \
+  memset ((st), 0, sizeof (*(st))); \
+  (st)->nSize = sizeof (*(st)); \
+  (st)->nVersion.s.nVersionMajor = OMX_VERSION_MAJOR; \
+  (st)->nVersion.s.nVersionMinor = OMX_VERSION_MINOR; \
+  (st)->nVersion.s.nRevision = OMX_VERSION_REVISION; \
+  (st)->nVersion.s.nStep = OMX_VERSION_STEP; \
+} G_STMT_END
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *role;
+  gboolean encoder;
+  OMX_VIDEO_CODINGTYPE coding;
+} LoopbackComponentInfo;
+
+static const LoopbackComponentInfo loopback_components[] = {
+  {"OMX.loopback.video_decoder.avc", "video_decoder.avc", FALSE,
+      OMX_VIDEO_CodingAVC},
+  {"OMX.loopback.video_decoder.mpeg4", "video_decoder.mpeg4", FALSE,
+      OMX_VIDEO_CodingMPEG4},
+#ifdef HAVE_HEVC
+  {"OMX.loopback.video_decoder.hevc", "video_decoder.hevc", FALSE,
+      (OMX_VIDEO_CODINGTYPE) OMX_VIDEO_CodingHEVC},
+#endif
+  {"OMX.loopback.video_encoder.avc", "video_encoder.avc", TRUE,
+      OMX_VIDEO_CodingAVC},
+};
+
+static const OMX_COLOR_FORMATTYPE loopback_color_formats[] = {
+  OMX_COLOR_FormatYUV420Planar,
+  OMX_COLOR_FormatYUV420SemiPlanar,
+};
+
+typedef struct
+{
+  gint64 latency;
+  guint max_fps;
+  guint in_buffers;
+  guint out_buffers;
+  guint stride_align;
+  guint slice_height_align;
+  /* -1: never, 0: on the first frame, N: also every N frames */
+  gint settings_changed;
+} LoopbackSettings;
+
+/* Allocated by us, the header must be the first member */
+typedef struct
+{
+  OMX_BUFFERHEADERTYPE header;
+  gboolean allocated;
+  /* When the buffer is due, for buffers owned by the component */
+  gint64 deadline;
+} LoopbackBuffer;
+
+typedef struct
+{
+  OMX_PARAM_PORTDEFINITIONTYPE def;
+  /* LoopbackBuffer* */
+  GPtrArray *buffers;
+  /* Buffers passed by the client, not processed yet */
+  GQueue queue;
+  gboolean enable_pending;
+  gboolean disable_pending;
+} LoopbackPort;
+
+typedef struct
+{
+  OMX_COMMANDTYPE cmd;
+  OMX_U32 param;
+} LoopbackCommand;
+
+typedef struct
+{
+  OMX_COMPONENTTYPE *handle;
+  const LoopbackComponentInfo *info;
+  LoopbackSettings settings;
+
+  OMX_CALLBACKTYPE callbacks;
+  OMX_PTR app_data;
+
+  GMutex lock;
+  GCond cond;
+  GThread *thread;
+  gboolean quit;
+
+  OMX_STATETYPE state;
+  /* OMX_StateInvalid if no transition is pending */
+  OMX_STATETYPE pending_state;
+  GQueue commands;
+
+  LoopbackPort ports[LOOPBACK_N_PORTS];
+  /* Output buffers holding a frame that is not due yet */
+  GQueue in_flight;
+  gint64 next_output;
+
+  /* Incremented whenever the client queued something */
+  guint generation;
+
+  guint64 n_frames;
+  guint64 settings_frame;
+  gboolean stream_started;
+  /* PortSettingsChanged was sent, waiting until the output port was
+   * reconfigured */
+  gboolean settings_pending;
+} LoopbackComponent;
+
+static void
+loopback_settings_parse (LoopbackSettings * settings)
+{
+  const gchar *env;
+  gchar **pairs, **p;
+
+  settings->latency = 0;
+  settings->max_fps = 0;
+  settings->in_buffers = 4;
+  settings->out_buffers = 4;
+  settings->stride_align = 16;
+  settings->slice_height_align = 16;
+  settings->settings_changed = 0;
+
+  env = g_getenv ("GST_OMX_LOOPBACK");
+  if (!env)
+    return;
+
+  pairs = g_strsplit (env, ",", -1);
+  for (p = pairs; *p; p++) {
+    gchar **kv = g_strsplit (g_strstrip (*p), "=", 2);
+    guint64 v;
+
+    if (!kv[0] || !kv[1]) {
+      if (kv[0] && *kv[0])
+        g_warning ("loopback: ignoring invalid setting '%s'", *p);
+      g_strfreev (kv);
+      continue;
+    }
+
+    v = g_ascii_strtoull (kv[1], NULL, 10);
+
+    if (g_str_equal (kv[0], "latency"))
+      settings->latency = v;
+    else if (g_str_equal (kv[0], "max-fps"))
+      settings->max_fps = v;
+    else if (g_str_equal (kv[0], "in-buffers"))
+      settings->in_buffers = MAX (v, 1);
+    else if (g_str_equal (kv[0], "out-buffers"))
+      settings->out_buffers = MAX (v, 1);
+    else if (g_str_equal (kv[0], "stride-align"))
+      settings->stride_align = MAX (v, 1);
+    else if (g_str_equal (kv[0], "slice-height-align"))
+      settings->slice_height_align = MAX (v, 1);
+    else if (g_str_equal (kv[0], "settings-changed")) {
+      if (g_str_equal (kv[1], "never"))
+        settings->settings_changed = -1;
+      else if (g_str_equal (kv[1], "first"))
+        settings->settings_changed = 0;
+      else
+        settings->settings_changed = v;
+    } else {
+      g_warning ("loopback: unknown setting '%s'", kv[0]);
+    }
+
+    g_strfreev (kv);
+  }
+  g_strfreev (pairs);
+}
+
+static guint
+loopback_align (guint v, guint align)
+{
+  return ((v + align - 1) / align) * align;
+}
+
+static gboolean
+loopback_port_is_raw (LoopbackComponent * comp, OMX_U32 index)
+{
+  return (index == LOOPBACK_OUT_PORT) != comp->info->encoder;
+}
+
+/* Updates stride, slice height and buffer size of a raw port from its
+ * frame size */
+static void
+loopback_port_update_raw (LoopbackComponent * comp, LoopbackPort * port)
+{
+  OMX_VIDEO_PORTDEFINITIONTYPE *video = &port->def.format.video;
+
+  if (video->nFrameWidth == 0)
+    video->nFrameWidth = LOOPBACK_DEFAULT_WIDTH;
+  if (video->nFrameHeight == 0)
+    video->nFrameHeight = LOOPBACK_DEFAULT_HEIGHT;
+
+  video->nStride = loopback_align (MAX ((guint) ABS (video->nStride),
+          video->nFrameWidth), comp->settings.stride_align);
+  video->nSliceHeight = loopback_align (MAX (video->nSliceHeight,
+          video->nFrameHeight), comp->settings.slice_height_align);
+  port->def.nBufferSize = video->nStride * video->nSliceHeight * 3 / 2;
+}
+
+/* What a real decoder does after parsing the headers: derives the output
+ * format from the input */
+static void
+loopback_update_output_port (LoopbackComponent * comp)
+{
+  LoopbackPort *in = &comp->ports[LOOPBACK_IN_PORT];
+  LoopbackPort *out = &comp->ports[LOOPBACK_OUT_PORT];
+
+  out->def.format.video.nFrameWidth = in->def.format.video.nFrameWidth;
+  out->def.format.video.nFrameHeight = in->def.format.video.nFrameHeight;
+  out->def.format.video.xFramerate = in->def.format.video.xFramerate;
+
+  if (comp->info->encoder) {
+    /* Passthrough, make sure every input frame fits */
+    out->def.nBufferSize = MAX (in->def.nBufferSize,
+        LOOPBACK_COMPRESSED_BUFFER_SIZE);
+  } else {
+    out->def.format.video.nStride = 0;
+    out->def.format.video.nSliceHeight = 0;
+    loopback_port_update_raw (comp, out);
+  }
+}
+
+static void
+loopback_port_init (LoopbackComponent * comp, OMX_U32 index)
+{
+  LoopbackPort *port = &comp->ports[index];
+  OMX_PARAM_PORTDEFINITIONTYPE *def = &port->def;
+
+  LOOPBACK_INIT_STRUCT (def);
+  def->nPortIndex = index;
+  def->eDir = index == LOOPBACK_IN_PORT ? OMX_DirInput : OMX_DirOutput;
+  def->nBufferCountMin = index == LOOPBACK_IN_PORT ?
+      comp->settings.in_buffers : comp->settings.out_buffers;
+  def->nBufferCountActual = def->nBufferCountMin;
+  def->bEnabled = OMX_TRUE;
+  def->bPopulated = OMX_FALSE;
+  def->eDomain = OMX_PortDomainVideo;
+  def->nBufferAlignment = 16;
+
+  if (loopback_port_is_raw (comp, index)) {
+    def->format.video.eCompressionFormat = OMX_VIDEO_CodingUnused;
+    def->format.video.eColorFormat = loopback_color_formats[0];
+    def->format.video.cMIMEType = (OMX_STRING) "video/x-raw";
+    loopback_port_update_raw (comp, port);
+  } else {
+    def->format.video.nFrameWidth = LOOPBACK_DEFAULT_WIDTH;
+    def->format.video.nFrameHeight = LOOPBACK_DEFAULT_HEIGHT;
+    def->format.video.eCompressionFormat = comp->info->coding;
+    def->format.video.eColorFormat = OMX_COLOR_FormatUnused;
+    def->format.video.cMIMEType = (OMX_STRING) "video/x-compressed";
+    def->nBufferSize = LOOPBACK_COMPRESSED_BUFFER_SIZE;
+  }
+
+  port->buffers = g_ptr_array_new ();
+  g_queue_init (&port->queue);
+}
+
+static LoopbackPort *
+loopback_get_port (LoopbackComponent * comp, OMX_U32 index)
+{
+  if (index >= LOOPBACK_N_PORTS)
+    return NULL;
+
+  return &comp->ports[index];
+}
+
+/* NOTE: Must be called with comp->lock, temporarily releases it as the
+ * client can call into the component from its callbacks */
+static void
+loopback_send_event (LoopbackComponent * comp, OMX_EVENTTYPE event,
+    OMX_U32 data1, OMX_U32 data2)
+{
+  g_mutex_unlock (&comp->lock);
+  comp->callbacks.EventHandler (comp->handle, comp->app_data, event, data1,
+      data2, NULL);
+  g_mutex_lock (&comp->lock);
+}
+
+/* NOTE: Must be called with comp->lock, temporarily releases it */
+static void
+loopback_return_buffer (LoopbackComponent * comp, OMX_U32 index,
+    LoopbackBuffer * buf)
+{
+  g_mutex_unlock (&comp->lock);
+  if (index == LOOPBACK_IN_PORT)
+    comp->callbacks.EmptyBufferDone (comp->handle, comp->app_data,
+        &buf->header);
+  else
+    comp->callbacks.FillBufferDone (comp->handle, comp->app_data,
+        &buf->header);
+  g_mutex_lock (&comp->lock);
+}
+
+/* Returns all buffers of the port owned by the component to the client
+ * NOTE: Must be called with comp->lock */
+static void
+loopback_port_return_all (LoopbackComponent * comp, OMX_U32 index)
+{
+  LoopbackPort *port = &comp->ports[index];
+  LoopbackBuffer *buf;
+
+  if (index == LOOPBACK_OUT_PORT) {
+    while ((buf = g_queue_pop_head (&comp->in_flight)))
+      loopback_return_buffer (comp, index, buf);
+  }
+
+  while ((buf = g_queue_pop_head (&port->queue))) {
+    if (index == LOOPBACK_OUT_PORT)
+      buf->header.nFilledLen = 0;
+    loopback_return_buffer (comp, index, buf);
+  }
+}
+
+/* Completes pending state transitions and port enables/disables once all
+ * buffers are allocated or freed
+ * NOTE: Must be called with comp->lock */
+static void
+loopback_check_pending (LoopbackComponent * comp)
+{
+  gboolean done = TRUE;
+  OMX_U32 i;
+
+  for (i = 0; i < LOOPBACK_N_PORTS; i++) {
+    LoopbackPort *port = &comp->ports[i];
+
+    if (port->disable_pending && port->buffers->len == 0) {
+      port->disable_pending = FALSE;
+      loopback_send_event (comp, OMX_EventCmdComplete, OMX_CommandPortDisable,
+          i);
+    } else if (port->enable_pending
+        && port->buffers->len >= port->def.nBufferCountActual) {
+      port->enable_pending = FALSE;
+      if (i == LOOPBACK_OUT_PORT)
+        comp->settings_pending = FALSE;
+      loopback_send_event (comp, OMX_EventCmdComplete, OMX_CommandPortEnable,
+          i);
+    }
+  }
+
+  if (comp->pending_state == OMX_StateInvalid)
+    return;
+
+  for (i = 0; i < LOOPBACK_N_PORTS; i++) {
+    LoopbackPort *port = &comp->ports[i];
+
+    if (comp->pending_state == OMX_StateIdle) {
+      if (port->def.bEnabled
+          && port->buffers->len < port->def.nBufferCountActual)
+        done = FALSE;
+    } else if (port->buffers->len > 0) {
+      done = FALSE;
+    }
+  }
+
+  if (done) {
+    comp->state = comp->pending_state;
+    comp->pending_state = OMX_StateInvalid;
+    loopback_send_event (comp, OMX_EventCmdComplete, OMX_CommandStateSet,
+        comp->state);
+  }
+}
+
+/* NOTE: Must be called with comp->lock */
+static void
+loopback_set_state (LoopbackComponent * comp, OMX_STATETYPE state)
+{
+  OMX_STATETYPE old = comp->state;
+  OMX_U32 i;
+
+  if (state == old) {
+    loopback_send_event (comp, OMX_EventError, OMX_ErrorSameState, 0);
+    return;
+  }
+
+  switch (state) {
+    case OMX_StateIdle:
+      if (old == OMX_StateLoaded) {
+        /* Completes once all buffers are allocated */
+        comp->pending_state = OMX_StateIdle;
+        loopback_check_pending (comp);
+        return;
+      }
+      if (old != OMX_StateExecuting && old != OMX_StatePause)
+        goto invalid;
+      for (i = 0; i < LOOPBACK_N_PORTS; i++)
+        loopback_port_return_all (comp, i);
+      comp->stream_started = FALSE;
+      comp->settings_pending = FALSE;
+      break;
+    case OMX_StateLoaded:
+      if (old != OMX_StateIdle)
+        goto invalid;
+      /* Completes once all buffers are freed */
+      comp->pending_state = OMX_StateLoaded;
+      loopback_check_pending (comp);
+      return;
+    case OMX_StateExecuting:
+    case OMX_StatePause:
+      if (old != OMX_StateIdle && old != OMX_StateExecuting
+          && old != OMX_StatePause)
+        goto invalid;
+      break;
+    default:
+      goto invalid;
+  }
+
+  comp->state = state;
+  loopback_send_event (comp, OMX_EventCmdComplete, OMX_CommandStateSet,
+      state);
+  return;
+
+invalid:
+  loopback_send_event (comp, OMX_EventError,
+      OMX_ErrorIncorrectStateTransition, 0);
+}
+
+/* NOTE: Must be called with comp->lock */
+static void
+loopback_handle_command (LoopbackComponent * comp, LoopbackCommand * cmd)
+{
+  OMX_U32 i;
+
+  switch (cmd->cmd) {
+    case OMX_CommandStateSet:
+      loopback_set_state (comp, cmd->param);
+      break;
+    case OMX_CommandFlush:
+      for (i = 0; i < LOOPBACK_N_PORTS; i++) {
+        if (cmd->param != OMX_ALL && cmd->param != i)
+          continue;
+        loopback_port_return_all (comp, i);
+        loopback_send_event (comp, OMX_EventCmdComplete, OMX_CommandFlush, i);
+      }
+      break;
+    case OMX_CommandPortDisable:
+      for (i = 0; i < LOOPBACK_N_PORTS; i++) {
+        if (cmd->param != OMX_ALL && cmd->param != i)
+          continue;
+        loopback_port_return_all (comp, i);
+        comp->ports[i].def.bEnabled = OMX_FALSE;
+        comp->ports[i].enable_pending = FALSE;
+        comp->ports[i].disable_pending = TRUE;
+      }
+      loopback_check_pending (comp);
+      break;
+    case OMX_CommandPortEnable:
+      for (i = 0; i < LOOPBACK_N_PORTS; i++) {
+        if (cmd->param != OMX_ALL && cmd->param != i)
+          continue;
+        comp->ports[i].def.bEnabled = OMX_TRUE;
+        comp->ports[i].disable_pending = FALSE;
+        if (comp->state == OMX_StateLoaded
+            && comp->pending_state != OMX_StateIdle) {
+          loopback_send_event (comp, OMX_EventCmdComplete,
+              OMX_CommandPortEnable, i);
+        } else {
+          comp->ports[i].enable_pending = TRUE;
+        }
+      }
+      loopback_check_pending (comp);
+      break;
+    case OMX_CommandMarkBuffer:
+      loopback_send_event (comp, OMX_EventCmdComplete, OMX_CommandMarkBuffer,
+          cmd->param);
+      break;
+    default:
+      loopback_send_event (comp, OMX_EventError, OMX_ErrorBadParameter, 0);
+      break;
+  }
+}
+
+static gboolean
+loopback_can_output (LoopbackComponent * comp)
+{
+  LoopbackPort *out = &comp->ports[LOOPBACK_OUT_PORT];
+
+  return out->def.bEnabled && !out->enable_pending && !comp->settings_pending
+      && !g_queue_is_empty (&out->queue);
+}
+
+/* Consumes input buffers, producing output buffers if possible. Returns
+ * FALSE if nothing could be done
+ * NOTE: Must be called with comp->lock */
+static gboolean
+loopback_process (LoopbackComponent * comp)
+{
+  LoopbackPort *in = &comp->ports[LOOPBACK_IN_PORT];
+  LoopbackPort *out = &comp->ports[LOOPBACK_OUT_PORT];
+  LoopbackBuffer *inbuf, *outbuf;
+  OMX_BUFFERHEADERTYPE *ih, *oh;
+  gint interval = comp->settings.settings_changed;
+
+  inbuf = g_queue_peek_head (&in->queue);
+  if (!inbuf)
+    return FALSE;
+  ih = &inbuf->header;
+
+  /* Nothing to output for these */
+  if ((ih->nFlags & OMX_BUFFERFLAG_CODECCONFIG)
+      || (ih->nFilledLen == 0 && !(ih->nFlags & OMX_BUFFERFLAG_EOS))) {
+    g_queue_pop_head (&in->queue);
+    loopback_return_buffer (comp, LOOPBACK_IN_PORT, inbuf);
+    return TRUE;
+  }
+
+  if (!comp->info->encoder && interval >= 0 && !comp->settings_pending
+      && ih->nFilledLen > 0 && (!comp->stream_started || (interval > 0
+              && comp->n_frames != comp->settings_frame
+              && comp->n_frames % interval == 0))) {
+    comp->stream_started = TRUE;
+    comp->settings_pending = TRUE;
+    comp->settings_frame = comp->n_frames;
+    loopback_update_output_port (comp);
+    loopback_send_event (comp, OMX_EventPortSettingsChanged,
+        LOOPBACK_OUT_PORT, OMX_IndexParamPortDefinition);
+    return TRUE;
+  }
+
+  if (!loopback_can_output (comp))
+    return FALSE;
+
+  g_queue_pop_head (&in->queue);
+  outbuf = g_queue_pop_head (&out->queue);
+  oh = &outbuf->header;
+
+  oh->nOffset = 0;
+  if (ih->nFilledLen == 0)
+    oh->nFilledLen = 0;
+  else if (comp->info->encoder)
+    oh->nFilledLen = MIN (ih->nFilledLen, oh->nAllocLen);
+  else
+    oh->nFilledLen = MIN (out->def.nBufferSize, oh->nAllocLen);
+  memcpy (oh->pBuffer, ih->pBuffer + ih->nOffset, MIN (ih->nFilledLen,
+          oh->nFilledLen));
+
+  oh->nTimeStamp = ih->nTimeStamp;
+  oh->nFlags = ih->nFlags | OMX_BUFFERFLAG_ENDOFFRAME;
+  if (comp->info->encoder)
+    oh->nFlags |= OMX_BUFFERFLAG_SYNCFRAME;
+  oh->hMarkTargetComponent = ih->hMarkTargetComponent;
+  oh->pMarkData = ih->pMarkData;
+  outbuf->deadline = inbuf->deadline;
+
+  if (ih->nFilledLen > 0)
+    comp->n_frames++;
+
+  g_queue_push_tail (&comp->in_flight, outbuf);
+  loopback_return_buffer (comp, LOOPBACK_IN_PORT, inbuf);
+
+  return TRUE;
+}
+
+/* Returns the output buffers that are due. Returns the monotonic time
+ * when the next one is due, or -1 if there is none
+ * NOTE: Must be called with comp->lock */
+static gint64
+loopback_output (LoopbackComponent * comp)
+{
+  LoopbackBuffer *buf;
+
+  while ((buf = g_queue_peek_head (&comp->in_flight))) {
+    gint64 now = g_get_monotonic_time ();
+    gint64 due = MAX (buf->deadline, comp->next_output);
+    OMX_U32 flags;
+
+    if (due > now)
+      return due;
+
+    g_queue_pop_head (&comp->in_flight);
+    if (comp->settings.max_fps > 0)
+      comp->next_output = MAX (now, comp->next_output) +
+          G_USEC_PER_SEC / comp->settings.max_fps;
+
+    flags = buf->header.nFlags;
+    loopback_return_buffer (comp, LOOPBACK_OUT_PORT, buf);
+
+    if ((flags & OMX_BUFFERFLAG_EOS))
+      loopback_send_event (comp, OMX_EventBufferFlag, LOOPBACK_OUT_PORT,
+          flags);
+  }
+
+  return -1;
+}
+
+static gpointer
+loopback_thread (gpointer user_data)
+{
+  LoopbackComponent *comp = user_data;
+
+  g_mutex_lock (&comp->lock);
+  while (!comp->quit) {
+    LoopbackCommand *cmd;
+    gint64 wakeup = -1;
+    guint generation = comp->generation;
+
+    if ((cmd = g_queue_pop_head (&comp->commands))) {
+      loopback_handle_command (comp, cmd);
+      g_slice_free (LoopbackCommand, cmd);
+      continue;
+    }
+
+    loopback_check_pending (comp);
+
+    if (comp->state == OMX_StateExecuting) {
+      if (loopback_process (comp))
+        continue;
+      wakeup = loopback_output (comp);
+    }
+
+    /* The lock is released while calling the callbacks, don't miss
+     * anything the client did in the meantime */
+    if (generation != comp->generation)
+      continue;
+
+    if (wakeup >= 0)
+      g_cond_wait_until (&comp->cond, &comp->lock, wakeup);
+    else
+      g_cond_wait (&comp->cond, &comp->lock);
+  }
+  g_mutex_unlock (&comp->lock);
+
+  return NULL;
+}
+
+#define LOOPBACK_COMPONENT(h) \
+  ((LoopbackComponent *) ((OMX_COMPONENTTYPE *) (h))->pComponentPrivate)
+
+static OMX_ERRORTYPE
+loopback_get_component_version (OMX_HANDLETYPE hComponent,
+    OMX_STRING pComponentName, OMX_VERSIONTYPE * pComponentVersion,
+    OMX_VERSIONTYPE * pSpecVersion, OMX_UUIDTYPE * pComponentUUID)
+{
+  LoopbackComponent *comp = LOOPBACK_COMPONENT (hComponent);
+
+  g_strlcpy (pComponentName, comp->info->name, OMX_MAX_STRINGNAME_SIZE);
+  pComponentVersion->nVersion = OMX_VERSION;
+  pSpecVersion->nVersion = OMX_VERSION;
+  if (pComponentUUID)
+    memset (*pComponentUUID, 0, sizeof (OMX_UUIDTYPE));
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+loopback_send_command (OMX_HANDLETYPE hComponent, OMX_COMMANDTYPE Cmd,
+    OMX_U32 nParam1, OMX_PTR pCmdData)
+{
+  LoopbackComponent *comp = LOOPBACK_COMPONENT (hComponent);
+  LoopbackCommand *cmd;
+
+  if ((Cmd == OMX_CommandFlush || Cmd == OMX_CommandPortDisable
+          || Cmd == OMX_CommandPortEnable) && nParam1 != OMX_ALL
+      && nParam1 >= LOOPBACK_N_PORTS)
+    return OMX_ErrorBadPortIndex;
+
+  cmd = g_slice_new (LoopbackCommand);
+  cmd->cmd = Cmd;
+  cmd->param = nParam1;
+
+  g_mutex_lock (&comp->lock);
+  g_queue_push_tail (&comp->commands, cmd);
+  comp->generation++;
+  g_cond_signal (&comp->cond);
+  g_mutex_unlock (&comp->lock);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+loopback_get_parameter (OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nParamIndex,
+    OMX_PTR pComponentParameterStructure)
+{
+  LoopbackComponent *comp = LOOPBACK_COMPONENT (hComponent);
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+
+  g_mutex_lock (&comp->lock);
+  switch (nParamIndex) {
+    case OMX_IndexParamPortDefinition:{
+      OMX_PARAM_PORTDEFINITIONTYPE *def = pComponentParameterStructure;
+      LoopbackPort *port = loopback_get_port (comp, def->nPortIndex);
+
+      if (!port) {
+        err = OMX_ErrorBadPortIndex;
+        break;
+      }
+      *def = port->def;
+      break;
+    }
+    case OMX_IndexParamVideoInit:{
+      OMX_PORT_PARAM_TYPE *param = pComponentParameterStructure;
+
+      param->nPorts = LOOPBACK_N_PORTS;
+      param->nStartPortNumber = 0;
+      break;
+    }
+    case OMX_IndexParamAudioInit:
+    case OMX_IndexParamImageInit:
+    case OMX_IndexParamOtherInit:{
+      OMX_PORT_PARAM_TYPE *param = pComponentParameterStructure;
+
+      param->nPorts = 0;
+      param->nStartPortNumber = 0;
+      break;
+    }
+    case OMX_IndexParamVideoPortFormat:{
+      OMX_VIDEO_PARAM_PORTFORMATTYPE *param = pComponentParameterStructure;
+      LoopbackPort *port = loopback_get_port (comp, param->nPortIndex);
+
+      if (!port) {
+        err = OMX_ErrorBadPortIndex;
+        break;
+      }
+
+      param->xFramerate = port->def.format.video.xFramerate;
+      if (loopback_port_is_raw (comp, param->nPortIndex)) {
+        param->eCompressionFormat = OMX_VIDEO_CodingUnused;
+        if (param->nIndex < G_N_ELEMENTS (loopback_color_formats)) {
+          param->eColorFormat = loopback_color_formats[param->nIndex];
+        } else {
+          param->eColorFormat = OMX_COLOR_FormatUnused;
+          err = OMX_ErrorNoMore;
+        }
+      } else {
+        param->eColorFormat = OMX_COLOR_FormatUnused;
+        if (param->nIndex == 0) {
+          param->eCompressionFormat = comp->info->coding;
+        } else {
+          param->eCompressionFormat = OMX_VIDEO_CodingUnused;
+          err = OMX_ErrorNoMore;
+        }
+      }
+      break;
+    }
+    case OMX_IndexParamStandardComponentRole:{
+      OMX_PARAM_COMPONENTROLETYPE *param = pComponentParameterStructure;
+
+      g_strlcpy ((gchar *) param->cRole, comp->info->role,
+          OMX_MAX_STRINGNAME_SIZE);
+      break;
+    }
+    default:
+      err = OMX_ErrorUnsupportedIndex;
+      break;
+  }
+  g_mutex_unlock (&comp->lock);
+
+  return err;
+}
+
+static OMX_ERRORTYPE
+loopback_set_parameter (OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex,
+    OMX_PTR pComponentParameterStructure)
+{
+  LoopbackComponent *comp = LOOPBACK_COMPONENT (hComponent);
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+
+  g_mutex_lock (&comp->lock);
+  switch (nIndex) {
+    case OMX_IndexParamPortDefinition:{
+      OMX_PARAM_PORTDEFINITIONTYPE *def = pComponentParameterStructure;
+      LoopbackPort *port = loopback_get_port (comp, def->nPortIndex);
+      OMX_VIDEO_PORTDEFINITIONTYPE *video;
+
+      if (!port) {
+        err = OMX_ErrorBadPortIndex;
+        break;
+      }
+      if (comp->state != OMX_StateLoaded && port->def.bEnabled) {
+        err = OMX_ErrorIncorrectStateOperation;
+        break;
+      }
+      if (def->nBufferCountActual < port->def.nBufferCountMin) {
+        err = OMX_ErrorBadParameter;
+        break;
+      }
+
+      port->def.nBufferCountActual = def->nBufferCountActual;
+
+      video = &port->def.format.video;
+      video->nFrameWidth = def->format.video.nFrameWidth;
+      video->nFrameHeight = def->format.video.nFrameHeight;
+      video->nStride = def->format.video.nStride;
+      video->nSliceHeight = def->format.video.nSliceHeight;
+      video->nBitrate = def->format.video.nBitrate;
+      video->xFramerate = def->format.video.xFramerate;
+
+      if (loopback_port_is_raw (comp, def->nPortIndex)) {
+        video->eColorFormat = def->format.video.eColorFormat;
+        loopback_port_update_raw (comp, port);
+      } else {
+        video->eCompressionFormat = def->format.video.eCompressionFormat;
+        port->def.nBufferSize = MAX (def->nBufferSize, port->def.nBufferSize);
+      }
+
+      /* Without PortSettingsChanged the output format has to be known
+       * right away */
+      if (def->nPortIndex == LOOPBACK_IN_PORT && (comp->info->encoder
+              || comp->settings.settings_changed < 0))
+        loopback_update_output_port (comp);
+      break;
+    }
+    case OMX_IndexParamVideoPortFormat:{
+      OMX_VIDEO_PARAM_PORTFORMATTYPE *param = pComponentParameterStructure;
+      LoopbackPort *port = loopback_get_port (comp, param->nPortIndex);
+
+      if (!port) {
+        err = OMX_ErrorBadPortIndex;
+        break;
+      }
+
+      if (loopback_port_is_raw (comp, param->nPortIndex))
+        port->def.format.video.eColorFormat = param->eColorFormat;
+      else
+        port->def.format.video.eCompressionFormat = param->eCompressionFormat;
+      break;
+    }
+    case OMX_IndexParamStandardComponentRole:{
+      OMX_PARAM_COMPONENTROLETYPE *param = pComponentParameterStructure;
+
+      if (!g_str_equal ((const gchar *) param->cRole, comp->info->role))
+        err = OMX_ErrorBadParameter;
+      break;
+    }
+    default:
+      err = OMX_ErrorUnsupportedIndex;
+      break;
+  }
+  g_mutex_unlock (&comp->lock);
+
+  return err;
+}
+
+static OMX_ERRORTYPE
+loopback_get_config (OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex,
+    OMX_PTR pComponentConfigStructure)
+{
+  return OMX_ErrorUnsupportedIndex;
+}
+
+static OMX_ERRORTYPE
+loopback_set_config (OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex,
+    OMX_PTR pComponentConfigStructure)
+{
+  return OMX_ErrorUnsupportedIndex;
+}
+
+static OMX_ERRORTYPE
+loopback_get_extension_index (OMX_HANDLETYPE hComponent,
+    OMX_STRING cParameterName, OMX_INDEXTYPE * pIndexType)
+{
+  return OMX_ErrorUnsupportedIndex;
+}
+
+static OMX_ERRORTYPE
+loopback_get_state (OMX_HANDLETYPE hComponent, OMX_STATETYPE * pState)
+{
+  LoopbackComponent *comp = LOOPBACK_COMPONENT (hComponent);
+
+  g_mutex_lock (&comp->lock);
+  *pState = comp->state;
+  g_mutex_unlock (&comp->lock);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+loopback_component_tunnel_request (OMX_HANDLETYPE hComp, OMX_U32 nPort,
+    OMX_HANDLETYPE hTunneledComp, OMX_U32 nTunneledPort,
+    OMX_TUNNELSETUPTYPE * pTunnelSetup)
+{
+  return OMX_ErrorNotImplemented;
+}
+
+static OMX_ERRORTYPE
+loopback_add_buffer (LoopbackComponent * comp,
+    OMX_BUFFERHEADERTYPE ** ppBufferHdr, OMX_U32 nPortIndex,
+    OMX_PTR pAppPrivate, OMX_U32 nSizeBytes, OMX_U8 * pBuffer)
+{
+  LoopbackPort *port;
+  LoopbackBuffer *buf;
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+
+  g_mutex_lock (&comp->lock);
+  port = loopback_get_port (comp, nPortIndex);
+  if (!port) {
+    err = OMX_ErrorBadPortIndex;
+    goto done;
+  }
+  if (nSizeBytes < port->def.nBufferSize) {
+    err = OMX_ErrorBadParameter;
+    goto done;
+  }
+  if (port->buffers->len >= port->def.nBufferCountActual) {
+    err = OMX_ErrorIncorrectStateOperation;
+    goto done;
+  }
+
+  buf = g_slice_new0 (LoopbackBuffer);
+  LOOPBACK_INIT_STRUCT (&buf->header);
+  buf->allocated = (pBuffer == NULL);
+  buf->header.pBuffer = pBuffer ? pBuffer : g_malloc (nSizeBytes);
+  buf->header.nAllocLen = nSizeBytes;
+  buf->header.pAppPrivate = pAppPrivate;
+  buf->header.nInputPortIndex =
+      nPortIndex == LOOPBACK_IN_PORT ? nPortIndex : OMX_ALL;
+  buf->header.nOutputPortIndex =
+      nPortIndex == LOOPBACK_OUT_PORT ? nPortIndex : OMX_ALL;
+
+  g_ptr_array_add (port->buffers, buf);
+  if (port->buffers->len == port->def.nBufferCountActual)
+    port->def.bPopulated = OMX_TRUE;
+
+  *ppBufferHdr = &buf->header;
+  comp->generation++;
+  g_cond_signal (&comp->cond);
+
+done:
+  g_mutex_unlock (&comp->lock);
+
+  return err;
+}
+
+static OMX_ERRORTYPE
+loopback_use_buffer (OMX_HANDLETYPE hComponent,
+    OMX_BUFFERHEADERTYPE ** ppBufferHdr, OMX_U32 nPortIndex,
+    OMX_PTR pAppPrivate, OMX_U32 nSizeBytes, OMX_U8 * pBuffer)
+{
+  if (!pBuffer)
+    return OMX_ErrorBadParameter;
+
+  return loopback_add_buffer (LOOPBACK_COMPONENT (hComponent), ppBufferHdr,
+      nPortIndex, pAppPrivate, nSizeBytes, pBuffer);
+}
+
+static OMX_ERRORTYPE
+loopback_allocate_buffer (OMX_HANDLETYPE hComponent,
+    OMX_BUFFERHEADERTYPE ** ppBuffer, OMX_U32 nPortIndex,
+    OMX_PTR pAppPrivate, OMX_U32 nSizeBytes)
+{
+  return loopback_add_buffer (LOOPBACK_COMPONENT (hComponent), ppBuffer,
+      nPortIndex, pAppPrivate, nSizeBytes, NULL);
+}
+
+static OMX_ERRORTYPE
+loopback_free_buffer (OMX_HANDLETYPE hComponent, OMX_U32 nPortIndex,
+    OMX_BUFFERHEADERTYPE * pBuffer)
+{
+  LoopbackComponent *comp = LOOPBACK_COMPONENT (hComponent);
+  LoopbackBuffer *buf = (LoopbackBuffer *) pBuffer;
+  LoopbackPort *port;
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+
+  g_mutex_lock (&comp->lock);
+  port = loopback_get_port (comp, nPortIndex);
+  if (!port) {
+    err = OMX_ErrorBadPortIndex;
+    goto done;
+  }
+  if (!g_ptr_array_remove (port->buffers, buf)) {
+    err = OMX_ErrorBadParameter;
+    goto done;
+  }
+
+  /* Freed while we still own it, can't happen with a sane client */
+  g_queue_remove (&port->queue, buf);
+  g_queue_remove (&comp->in_flight, buf);
+
+  port->def.bPopulated = OMX_FALSE;
+  if (buf->allocated)
+    g_free (buf->header.pBuffer);
+  g_slice_free (LoopbackBuffer, buf);
+  comp->generation++;
+  g_cond_signal (&comp->cond);
+
+done:
+  g_mutex_unlock (&comp->lock);
+
+  return err;
+}
+
+static OMX_ERRORTYPE
+loopback_queue_buffer (LoopbackComponent * comp, OMX_U32 index,
+    OMX_BUFFERHEADERTYPE * pBuffer)
+{
+  LoopbackBuffer *buf = (LoopbackBuffer *) pBuffer;
+  LoopbackPort *port = &comp->ports[index];
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+
+  g_mutex_lock (&comp->lock);
+  if (comp->state != OMX_StateExecuting && comp->state != OMX_StatePause) {
+    err = OMX_ErrorIncorrectStateOperation;
+    goto done;
+  }
+  if (!port->def.bEnabled) {
+    err = OMX_ErrorIncorrectStateOperation;
+    goto done;
+  }
+
+  buf->deadline = g_get_monotonic_time () + comp->settings.latency;
+  g_queue_push_tail (&port->queue, buf);
+  comp->generation++;
+  g_cond_signal (&comp->cond);
+
+done:
+  g_mutex_unlock (&comp->lock);
+
+  return err;
+}
+
+static OMX_ERRORTYPE
+loopback_empty_this_buffer (OMX_HANDLETYPE hComponent,
+    OMX_BUFFERHEADERTYPE * pBuffer)
+{
+  return loopback_queue_buffer (LOOPBACK_COMPONENT (hComponent),
+      LOOPBACK_IN_PORT, pBuffer);
+}
+
+static OMX_ERRORTYPE
+loopback_fill_this_buffer (OMX_HANDLETYPE hComponent,
+    OMX_BUFFERHEADERTYPE * pBuffer)
+{
+  return loopback_queue_buffer (LOOPBACK_COMPONENT (hComponent),
+      LOOPBACK_OUT_PORT, pBuffer);
+}
+
+static OMX_ERRORTYPE
+loopback_set_callbacks (OMX_HANDLETYPE hComponent,
+    OMX_CALLBACKTYPE * pCallbacks, OMX_PTR pAppData)
+{
+  LoopbackComponent *comp = LOOPBACK_COMPONENT (hComponent);
+
+  g_mutex_lock (&comp->lock);
+  comp->callbacks = *pCallbacks;
+  comp->app_data = pAppData;
+  g_mutex_unlock (&comp->lock);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+loopback_component_deinit (OMX_HANDLETYPE hComponent)
+{
+  LoopbackComponent *comp = LOOPBACK_COMPONENT (hComponent);
+  LoopbackCommand *cmd;
+  OMX_U32 i;
+
+  g_mutex_lock (&comp->lock);
+  comp->quit = TRUE;
+  g_cond_signal (&comp->cond);
+  g_mutex_unlock (&comp->lock);
+  g_thread_join (comp->thread);
+
+  while ((cmd = g_queue_pop_head (&comp->commands)))
+    g_slice_free (LoopbackCommand, cmd);
+
+  for (i = 0; i < LOOPBACK_N_PORTS; i++) {
+    LoopbackPort *port = &comp->ports[i];
+    guint j;
+
+    for (j = 0; j < port->buffers->len; j++) {
+      LoopbackBuffer *buf = g_ptr_array_index (port->buffers, j);
+
+      if (buf->allocated)
+        g_free (buf->header.pBuffer);
+      g_slice_free (LoopbackBuffer, buf);
+    }
+    g_ptr_array_unref (port->buffers);
+    g_queue_clear (&port->queue);
+  }
+  g_queue_clear (&comp->in_flight);
+
+  g_mutex_clear (&comp->lock);
+  g_cond_clear (&comp->cond);
+  g_free (comp);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+loopback_use_egl_image (OMX_HANDLETYPE hComponent,
+    OMX_BUFFERHEADERTYPE ** ppBufferHdr, OMX_U32 nPortIndex,
+    OMX_PTR pAppPrivate, void *eglImage)
+{
+  return OMX_ErrorNotImplemented;
+}
+
+static OMX_ERRORTYPE
+loopback_component_role_enum (OMX_HANDLETYPE hComponent, OMX_U8 * cRole,
+    OMX_U32 nIndex)
+{
+  LoopbackComponent *comp = LOOPBACK_COMPONENT (hComponent);
+
+  if (nIndex > 0)
+    return OMX_ErrorNoMore;
+
+  g_strlcpy ((gchar *) cRole, comp->info->role, OMX_MAX_STRINGNAME_SIZE);
+
+  return OMX_ErrorNone;
+}
+
+static const LoopbackComponentInfo *
+loopback_find_component (const gchar * name)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (loopback_components); i++) {
+    if (g_str_equal (loopback_components[i].name, name))
+      return &loopback_components[i];
+  }
+
+  return NULL;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY
+OMX_Init (void)
+{
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY
+OMX_Deinit (void)
+{
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY
+OMX_ComponentNameEnum (OMX_STRING cComponentName, OMX_U32 nNameLength,
+    OMX_U32 nIndex)
+{
+  if (nIndex >= G_N_ELEMENTS (loopback_components))
+    return OMX_ErrorNoMore;
+
+  g_strlcpy (cComponentName, loopback_components[nIndex].name, nNameLength);
+
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY
+OMX_GetHandle (OMX_HANDLETYPE * pHandle, OMX_STRING cComponentName,
+    OMX_PTR pAppData, OMX_CALLBACKTYPE * pCallBacks)
+{
+  const LoopbackComponentInfo *info;
+  LoopbackComponent *comp;
+  OMX_COMPONENTTYPE *handle;
+
+  info = loopback_find_component (cComponentName);
+  if (!info)
+    return OMX_ErrorComponentNotFound;
+
+  /* The handle is allocated together with the component */
+  comp = g_malloc0 (sizeof (LoopbackComponent) + sizeof (OMX_COMPONENTTYPE));
+  handle = (OMX_COMPONENTTYPE *) (comp + 1);
+
+  comp->handle = handle;
+  comp->info = info;
+  comp->callbacks = *pCallBacks;
+  comp->app_data = pAppData;
+  comp->state = OMX_StateLoaded;
+  comp->pending_state = OMX_StateInvalid;
+  loopback_settings_parse (&comp->settings);
+  g_mutex_init (&comp->lock);
+  g_cond_init (&comp->cond);
+  g_queue_init (&comp->commands);
+  g_queue_init (&comp->in_flight);
+
+  loopback_port_init (comp, LOOPBACK_IN_PORT);
+  loopback_port_init (comp, LOOPBACK_OUT_PORT);
+  loopback_update_output_port (comp);
+
+  LOOPBACK_INIT_STRUCT (handle);
+  handle->pComponentPrivate = comp;
+  handle->pApplicationPrivate = pAppData;
+  handle->GetComponentVersion = loopback_get_component_version;
+  handle->SendCommand = loopback_send_command;
+  handle->GetParameter = loopback_get_parameter;
+  handle->SetParameter = loopback_set_parameter;
+  handle->GetConfig = loopback_get_config;
+  handle->SetConfig = loopback_set_config;
+  handle->GetExtensionIndex = loopback_get_extension_index;
+  handle->GetState = loopback_get_state;
+  handle->ComponentTunnelRequest = loopback_component_tunnel_request;
+  handle->UseBuffer = loopback_use_buffer;
+  handle->AllocateBuffer = loopback_allocate_buffer;
+  handle->FreeBuffer = loopback_free_buffer;
+  handle->EmptyThisBuffer = loopback_empty_this_buffer;
+  handle->FillThisBuffer = loopback_fill_this_buffer;
+  handle->SetCallbacks = loopback_set_callbacks;
+  handle->ComponentDeInit = loopback_component_deinit;
+  handle->UseEGLImage = loopback_use_egl_image;
+  handle->ComponentRoleEnum = loopback_component_role_enum;
+
+  comp->thread = g_thread_new (info->name, loopback_thread, comp);
+
+  *pHandle = handle;
+
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY
+OMX_FreeHandle (OMX_HANDLETYPE hComponent)
+{
+  return ((OMX_COMPONENTTYPE *) hComponent)->ComponentDeInit (hComponent);
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY
+OMX_SetupTunnel (OMX_HANDLETYPE hOutput, OMX_U32 nPortOutput,
+    OMX_HANDLETYPE hInput, OMX_U32 nPortInput)
+{
+  return OMX_ErrorNotImplemented;
+}
+
+OMX_API OMX_ERRORTYPE
+OMX_GetComponentsOfRole (OMX_STRING role, OMX_U32 * pNumComps,
+    OMX_U8 ** compNames)
+{
+  OMX_U32 n = 0;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (loopback_components); i++) {
+    if (!g_str_equal (loopback_components[i].role, role))
+      continue;
+    if (compNames) {
+      if (n >= *pNumComps)
+        return OMX_ErrorInsufficientResources;
+      g_strlcpy ((gchar *) compNames[n], loopback_components[i].name,
+          OMX_MAX_STRINGNAME_SIZE);
+    }
+    n++;
+  }
+  *pNumComps = n;
+
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE
+OMX_GetRolesOfComponent (OMX_STRING compName, OMX_U32 * pNumRoles,
+    OMX_U8 ** roles)
+{
+  const LoopbackComponentInfo *info = loopback_find_component (compName);
+
+  if (!info)
+    return OMX_ErrorComponentNotFound;
+
+  if (roles) {
+    if (*pNumRoles < 1)
+      return OMX_ErrorInsufficientResources;
+    g_strlcpy ((gchar *) roles[0], info->role, OMX_MAX_STRINGNAME_SIZE);
+  }
+  *pNumRoles = 1;
+
+  return OMX_ErrorNone;
+}
@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2026, gst-omx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+/* Converts a binary trace written by gst-omx (see omx/gstomxtrace.h) to
+ * the Chrome trace event JSON format, which can be loaded in
+ * chrome://tracing or https://ui.perfetto.dev
+ *
+ * Every component is shown as a process and each of its ports as a
+ * thread. Buffers are shown as slices from {Empty,Fill}ThisBuffer until
+ * the component returned them, events, commands and parameter calls as
+ * instant events on the "component" thread.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gstomxtrace.h"
+
+/* Thread id used for everything not related to a port */
+#define COMPONENT_TID 0xffffffff
+
+typedef struct
+{
+  guint64 start;
+  guint32 type;
+} PendingBuffer;
+
+typedef struct
+{
+  const GstOMXTraceComponent *components;
+  guint n_components;
+  /* (component pid << 32 | port) -> buffers in the component */
+  GHashTable *in_component;
+  /* pid -> TRUE if the process name was written */
+  GHashTable *named;
+  /* "pid:buffer" -> PendingBuffer* */
+  GHashTable *pending;
+  FILE *out;
+  gboolean first;
+} Converter;
+
+static const gchar *
+event_name (guint32 event)
+{
+  static const gchar *names[] = {
+    "CmdComplete", "Error", "Mark", "PortSettingsChanged", "BufferFlag",
+    "ResourcesAcquired", "ComponentResumed", "DynamicResourcesAvailable",
+    "PortFormatDetected"
+  };
+
+  return event < G_N_ELEMENTS (names) ? names[event] : "Event";
+}
+
+static const gchar *
+command_name (guint32 cmd)
+{
+  static const gchar *names[] = {
+    "StateSet", "Flush", "PortDisable", "PortEnable", "MarkBuffer"
+  };
+
+  return cmd < G_N_ELEMENTS (names) ? names[cmd] : "Command";
+}
+
+static const gchar *
+type_name (guint32 type)
+{
+  switch (type) {
+    case GST_OMX_TRACE_EMPTY_THIS_BUFFER:
+      return "EmptyThisBuffer";
+    case GST_OMX_TRACE_FILL_THIS_BUFFER:
+      return "FillThisBuffer";
+    case GST_OMX_TRACE_EMPTY_BUFFER_DONE:
+      return "EmptyBufferDone";
+    case GST_OMX_TRACE_FILL_BUFFER_DONE:
+      return "FillBufferDone";
+    case GST_OMX_TRACE_GET_PARAMETER:
+      return "GetParameter";
+    case GST_OMX_TRACE_SET_PARAMETER:
+      return "SetParameter";
+    case GST_OMX_TRACE_GET_CONFIG:
+      return "GetConfig";
+    case GST_OMX_TRACE_SET_CONFIG:
+      return "SetConfig";
+    default:
+      return "Unknown";
+  }
+}
+
+static gint
+compare_records (gconstpointer a, gconstpointer b)
+{
+  const GstOMXTraceRecord *ra = *(const GstOMXTraceRecord **) a;
+  const GstOMXTraceRecord *rb = *(const GstOMXTraceRecord **) b;
+
+  return (ra->seq > rb->seq) - (ra->seq < rb->seq);
+}
+
+/* The pid of a record is the index of the latest registration of its
+ * component address before the record was written */
+static guint
+record_pid (Converter * conv, const GstOMXTraceRecord * rec)
+{
+  guint i, pid = 0;
+  guint64 best = 0;
+
+  for (i = 0; i < conv->n_components; i++) {
+    const GstOMXTraceComponent *c = &conv->components[i];
+
+    if (c->component == rec->component && c->timestamp <= rec->timestamp
+        && c->timestamp >= best) {
+      best = c->timestamp;
+      pid = i + 1;
+    }
+  }
+
+  return pid;
+}
+
+static void
+write_event (Converter * conv, const gchar * fmt, ...) G_GNUC_PRINTF (2, 3);
+
+static void
+write_event (Converter * conv, const gchar * fmt, ...)
+{
+  va_list args;
+
+  fputs (conv->first ? "\n  " : ",\n  ", conv->out);
+  conv->first = FALSE;
+
+  va_start (args, fmt);
+  vfprintf (conv->out, fmt, args);
+  va_end (args);
+}
+
+static void
+write_names (Converter * conv, guint pid, guint32 port)
+{
+  guint64 key = ((guint64) pid << 32) | port;
+
+  if (!g_hash_table_contains (conv->named, GUINT_TO_POINTER (pid))) {
+    gchar *name;
+
+    if (pid > 0)
+      name = g_strndup (conv->components[pid - 1].name,
+          sizeof (conv->components[pid - 1].name));
+    else
+      name = g_strdup ("unknown component");
+
+    write_event (conv, "{\"name\": \"process_name\", \"ph\": \"M\", "
+        "\"pid\": %u, \"args\": {\"name\": \"%s\"}}", pid, name);
+    g_hash_table_add (conv->named, GUINT_TO_POINTER (pid));
+    g_free (name);
+  }
+
+  if (!g_hash_table_contains (conv->in_component, &key)) {
+    guint64 *k = g_new (guint64, 1);
+
+    *k = key;
+    g_hash_table_insert (conv->in_component, k, GINT_TO_POINTER (0));
+
+    if (port == COMPONENT_TID)
+      write_event (conv, "{\"name\": \"thread_name\", \"ph\": \"M\", "
+          "\"pid\": %u, \"tid\": %u, \"args\": {\"name\": \"component\"}}",
+          pid, port);
+    else
+      write_event (conv, "{\"name\": \"thread_name\", \"ph\": \"M\", "
+          "\"pid\": %u, \"tid\": %u, \"args\": {\"name\": \"port %u\"}}",
+          pid, port, port);
+  }
+}
+
+static void
+update_in_component (Converter * conv, const GstOMXTraceRecord * rec,
+    guint pid, gint diff)
+{
+  guint64 *key = g_new (guint64, 1);
+  gint n;
+
+  *key = ((guint64) pid << 32) | rec->port;
+  n = GPOINTER_TO_INT (g_hash_table_lookup (conv->in_component, key));
+  n = MAX (n + diff, 0);
+  g_hash_table_replace (conv->in_component, key, GINT_TO_POINTER (n));
+
+  write_event (conv, "{\"name\": \"buffers in component\", \"ph\": \"C\", "
+      "\"ts\": %" G_GUINT64_FORMAT ", \"pid\": %u, "
+      "\"args\": {\"port %u\": %d}}", rec->timestamp, pid, rec->port, n);
+}
+
+static void
+convert_record (Converter * conv, const GstOMXTraceRecord * rec)
+{
+  guint pid = record_pid (conv, rec);
+  gchar *key;
+
+  switch (rec->type) {
+    case GST_OMX_TRACE_EMPTY_THIS_BUFFER:
+    case GST_OMX_TRACE_FILL_THIS_BUFFER:{
+      PendingBuffer *p = g_new (PendingBuffer, 1);
+
+      write_names (conv, pid, rec->port);
+
+      p->start = rec->timestamp;
+      p->type = rec->type;
+      key = g_strdup_printf ("%u:%" G_GINT64_MODIFIER "x", pid, rec->buffer);
+      g_hash_table_replace (conv->pending, key, p);
+      update_in_component (conv, rec, pid, 1);
+      break;
+    }
+    case GST_OMX_TRACE_EMPTY_BUFFER_DONE:
+    case GST_OMX_TRACE_FILL_BUFFER_DONE:{
+      PendingBuffer *p;
+
+      write_names (conv, pid, rec->port);
+
+      key = g_strdup_printf ("%u:%" G_GINT64_MODIFIER "x", pid, rec->buffer);
+      p = g_hash_table_lookup (conv->pending, key);
+      if (p) {
+        write_event (conv, "{\"name\": \"%s\", \"ph\": \"X\", "
+            "\"ts\": %" G_GUINT64_FORMAT ", \"dur\": %" G_GUINT64_FORMAT ", "
+            "\"pid\": %u, \"tid\": %u, \"args\": {\"buffer\": \"0x%"
+            G_GINT64_MODIFIER "x\", \"filled\": %u, \"flags\": \"0x%08x\", "
+            "\"timestamp\": %" G_GUINT64_FORMAT "}}", type_name (p->type),
+            p->start, rec->timestamp - p->start, pid, rec->port, rec->buffer,
+            rec->data1, rec->flags, rec->pts);
+        g_hash_table_remove (conv->pending, key);
+      } else {
+        /* Submitted before the start of the trace */
+        write_event (conv, "{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", "
+            "\"ts\": %" G_GUINT64_FORMAT ", \"pid\": %u, \"tid\": %u, "
+            "\"args\": {\"buffer\": \"0x%" G_GINT64_MODIFIER "x\", "
+            "\"filled\": %u, \"flags\": \"0x%08x\"}}", type_name (rec->type),
+            rec->timestamp, pid, rec->port, rec->buffer, rec->data1,
+            rec->flags);
+      }
+      g_free (key);
+      update_in_component (conv, rec, pid, -1);
+      break;
+    }
+    case GST_OMX_TRACE_EVENT:
+      write_names (conv, pid, COMPONENT_TID);
+      write_event (conv, "{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", "
+          "\"ts\": %" G_GUINT64_FORMAT ", \"pid\": %u, \"tid\": %u, "
+          "\"args\": {\"data1\": %u, \"data2\": %u}}", event_name (rec->data1),
+          rec->timestamp, pid, COMPONENT_TID, rec->data2, rec->data3);
+      break;
+    case GST_OMX_TRACE_SEND_COMMAND:
+      write_names (conv, pid, COMPONENT_TID);
+      write_event (conv, "{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", "
+          "\"ts\": %" G_GUINT64_FORMAT ", \"pid\": %u, \"tid\": %u, "
+          "\"args\": {\"param\": %u}}", command_name (rec->data1),
+          rec->timestamp, pid, COMPONENT_TID, rec->data2);
+      break;
+    default:
+      write_names (conv, pid, COMPONENT_TID);
+      write_event (conv, "{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", "
+          "\"ts\": %" G_GUINT64_FORMAT ", \"pid\": %u, \"tid\": %u, "
+          "\"args\": {\"index\": \"0x%08x\"}}", type_name (rec->type),
+          rec->timestamp, pid, COMPONENT_TID, rec->data1);
+      break;
+  }
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+  GError *err = NULL;
+  gchar *contents;
+  gsize length, expected;
+  const GstOMXTraceHeader *header;
+  const GstOMXTraceRecord *records;
+  GPtrArray *sorted;
+  Converter conv = { 0, };
+  guint i;
+
+  if (argc < 2 || argc > 3) {
+    g_printerr ("Usage: %s TRACE-FILE [OUTPUT.json]\n", argv[0]);
+    return -1;
+  }
+
+  if (!g_file_get_contents (argv[1], &contents, &length, &err)) {
+    g_printerr ("Failed to read %s: %s\n", argv[1], err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  header = (const GstOMXTraceHeader *) contents;
+  if (length < sizeof (*header)
+      || memcmp (header->magic, GST_OMX_TRACE_MAGIC, sizeof (header->magic))) {
+    g_printerr ("%s is not a gst-omx trace\n", argv[1]);
+    return -1;
+  }
+  if (header->version != GST_OMX_TRACE_VERSION
+      || header->record_size != sizeof (GstOMXTraceRecord)) {
+    g_printerr ("Unsupported trace version %u (record size %u)\n",
+        header->version, header->record_size);
+    return -1;
+  }
+
+  expected = sizeof (*header) +
+      (gsize) header->n_components * sizeof (GstOMXTraceComponent) +
+      (gsize) header->n_records * sizeof (GstOMXTraceRecord);
+  if (length < expected) {
+    g_printerr ("Truncated trace: %" G_GSIZE_FORMAT " bytes, expected %"
+        G_GSIZE_FORMAT "\n", length, expected);
+    return -1;
+  }
+
+  conv.components = (const GstOMXTraceComponent *) (header + 1);
+  conv.n_components = header->n_components;
+  records = (const GstOMXTraceRecord *) (conv.components + conv.n_components);
+
+  /* Skip records that were never written, torn or overwritten in between */
+  sorted = g_ptr_array_new ();
+  for (i = 0; i < header->n_records; i++) {
+    if (records[i].seq != 0 && ((records[i].seq - 1) & (header->n_records -
+                1)) == i)
+      g_ptr_array_add (sorted, (gpointer) & records[i]);
+  }
+  g_ptr_array_sort (sorted, compare_records);
+
+  if (argc == 3) {
+    conv.out = fopen (argv[2], "w");
+    if (!conv.out) {
+      g_printerr ("Failed to open %s for writing\n", argv[2]);
+      return -1;
+    }
+  } else {
+    conv.out = stdout;
+  }
+
+  conv.in_component =
+      g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+  conv.named = g_hash_table_new (NULL, NULL);
+  conv.pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      g_free);
+  conv.first = TRUE;
+
+  fputs ("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [", conv.out);
+  for (i = 0; i < sorted->len; i++)
+    convert_record (&conv, g_ptr_array_index (sorted, i));
+  fputs ("\n]}\n", conv.out);
+
+  if (conv.out != stdout)
+    fclose (conv.out);
+
+  g_printerr ("Converted %u records of %u components from process %"
+      G_GUINT64_FORMAT "\n", sorted->len, conv.n_components, header->pid);
+
+  g_hash_table_unref (conv.pending);
+  g_hash_table_unref (conv.named);
+  g_hash_table_unref (conv.in_component);
+  g_ptr_array_unref (sorted);
+  g_free (contents);
+
+  return 0;
+}